@@ -0,0 +1,40 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <cstddef>
+
+/**
+ * Memory for coroutine frames, recycled instead of returned to the heap:
+ *
+ *     void *frame{allocate_frame(size)};
+ *     ...
+ *     free_frame(frame, size);   // the next frame of a similar size reuses it
+ *
+ * A coroutine's local variables live in a frame on the heap, allocated
+ * when the coroutine is called and freed when it is destroyed. Code that
+ * creates many short-lived generators would otherwise spend much of its
+ * time in new and delete. Each thread keeps freed frames in lists by size,
+ * rounded up to 64 bytes, so getting one back is popping a list, with no
+ * lock. Frames larger than the largest list go to new and delete.
+ */
+
+void *allocate_frame(std::size_t size);
+
+// size must be the size the frame was allocated with
+void free_frame(void *frame, std::size_t size) noexcept;
+
+// The calling thread's use of the pool
+struct FramePoolStats
+{
+    std::size_t fromHeap{0};
+    std::size_t reused{0};
+    std::size_t bytesInUse{0};
+    std::size_t peakBytesInUse{0};
+};
+
+FramePoolStats frame_pool_stats();
+
+// Starts measuring peakBytesInUse from the current use
+void reset_frame_pool_peak();
+
+#endif
@@ -0,0 +1,276 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "frame_pool.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <utility>
+
+template <typename T>
+class Generator;
+
+// Yields every element of another generator: co_yield ElementsOf{other()};
+template <typename T>
+struct ElementsOf
+{
+    // A constructor, not aggregate initialization: GCC 12 copies a
+    // coroutine's result into an aggregate member without moving it, and
+    // both copies would own the frame
+    explicit ElementsOf(Generator<T> &&inner) : generator{std::move(inner)} {}
+
+    Generator<T> generator;
+};
+
+/**
+ * A lazy sequence, computed one element at a time as it is read:
+ *
+ *     Generator<int> countdown(int from)
+ *     {
+ *         for (int i{from}; i > 0; --i)
+ *         {
+ *             co_yield i;
+ *         }
+ *     }
+ *
+ *     for (const int i : countdown(3)) { ... }                  // 3, 2, 1
+ *     auto even{countdown(10) | std::views::filter(isEven)};    // lazy too
+ *
+ * The function's body runs only as far as needed for the next element,
+ * then suspends in co_yield until the reader asks for more, so a sequence
+ * of a billion elements never needs more memory than the function's own
+ * frame. The frame comes from a pool of recycled frames (frame_pool.h).
+ *
+ * A generator can yield all elements of another one, for recursive
+ * sequences such as walking a tree:
+ *
+ *     co_yield ElementsOf{walk(node->left)};
+ *
+ * Passing each element up through every level would make reading an
+ * element cost as much as the depth of the recursion. Instead, the outer
+ * generator transfers control straight to the inner one (symmetric
+ * transfer: one coroutine suspends by resuming another, without growing
+ * the stack), the reader resumes the innermost active generator directly,
+ * and when it finishes, it transfers control back to the one that yielded
+ * it. Each element costs one resume, however deep the recursion.
+ *
+ * A Generator is a view, so it works with range-for and std::views, but
+ * like any input range it can be read only once.
+ */
+template <typename T>
+class Generator : public std::ranges::view_interface<Generator<T>>
+{
+public:
+    class promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class promise_type
+    {
+    public:
+        Generator get_return_object() noexcept
+        {
+            m_leaf = Handle::from_promise(*this);
+            return Generator{m_leaf};
+        }
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+
+        auto final_suspend() const noexcept
+        {
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept { return false; }
+
+                // Back to the generator that yielded this one, if any
+                std::coroutine_handle<> await_suspend(Handle handle) const noexcept
+                {
+                    auto &promise{handle.promise()};
+                    if (promise.m_parent == nullptr)
+                    {
+                        return std::noop_coroutine();
+                    }
+                    promise.m_root->m_leaf = Handle::from_promise(*promise.m_parent);
+                    return promise.m_root->m_leaf;
+                }
+
+                void await_resume() const noexcept {}
+            };
+            return FinalAwaiter{};
+        }
+
+        // The element lives in the generator's frame until it resumes
+        std::suspend_always yield_value(const T &value) noexcept
+        {
+            m_root->m_value = std::addressof(value);
+            return {};
+        }
+
+        auto yield_value(ElementsOf<T> elements) noexcept
+        {
+            struct NestedAwaiter
+            {
+                promise_type *outer{nullptr};
+
+                bool await_ready() const noexcept { return !outer->m_inner; }
+
+                // Straight into the inner generator, which the reader then
+                // resumes directly
+                Handle await_suspend(Handle) const noexcept
+                {
+                    auto &inner{outer->m_inner.promise()};
+                    inner.m_parent = outer;
+                    inner.m_root = outer->m_root;
+                    inner.m_root->m_leaf = outer->m_inner;
+                    return outer->m_inner;
+                }
+
+                void await_resume() const
+                {
+                    if (!outer->m_inner)
+                    {
+                        return;
+                    }
+                    const auto inner{std::exchange(outer->m_inner, {})};
+                    const auto exception{inner.promise().m_exception};
+                    inner.destroy();
+                    if (exception)
+                    {
+                        std::rethrow_exception(exception);
+                    }
+                }
+            };
+            m_inner = std::exchange(elements.generator.m_handle, {});
+            return NestedAwaiter{this};
+        }
+
+        void return_void() const noexcept {}
+
+        // Rethrown to the outer generator, or to the reader
+        void unhandled_exception() noexcept { m_exception = std::current_exception(); }
+
+        static void *operator new(std::size_t size) { return allocate_frame(size); }
+        static void operator delete(void *frame, std::size_t size) noexcept { free_frame(frame, size); }
+
+        promise_type() = default;
+
+        // Destroyed with the outer frame if the reader stops early
+        ~promise_type()
+        {
+            if (m_inner)
+            {
+                m_inner.destroy();
+            }
+        }
+
+        promise_type(const promise_type &) = delete;
+        promise_type &operator=(const promise_type &) = delete;
+
+    private:
+        friend class Generator;
+
+        // Only used in the outermost generator
+        const T *m_value{nullptr};
+        Handle m_leaf{};
+
+        promise_type *m_root{this};
+        promise_type *m_parent{nullptr};
+        Handle m_inner{};
+        std::exception_ptr m_exception{};
+    };
+
+    class Iterator
+    {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+        explicit Iterator(Handle root) : m_root{root} {}
+
+        const T &operator*() const { return *m_root.promise().m_value; }
+
+        Iterator &operator++()
+        {
+            advance(m_root);
+            return *this;
+        }
+
+        // Like for any input iterator, the old copy is useless afterwards
+        Iterator operator++(int)
+        {
+            const Iterator previous{*this};
+            ++*this;
+            return previous;
+        }
+
+        friend bool operator==(const Iterator &iterator, std::default_sentinel_t) noexcept
+        {
+            return !iterator.m_root || iterator.m_root.done();
+        }
+
+    private:
+        Handle m_root{};
+    };
+
+    Generator() = default;
+
+    Generator(Generator &&other) noexcept : m_handle{std::exchange(other.m_handle, {})} {}
+
+    Generator &operator=(Generator &&other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    ~Generator() { destroy(); }
+
+    Generator(const Generator &) = delete;
+    Generator &operator=(const Generator &) = delete;
+
+    // Runs the generator up to its first element
+    Iterator begin()
+    {
+        if (m_handle)
+        {
+            advance(m_handle);
+        }
+        return Iterator{m_handle};
+    }
+
+    std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+
+private:
+    explicit Generator(Handle handle) : m_handle{handle} {}
+
+    // Resumes the innermost active generator up to the next element
+    static void advance(Handle root)
+    {
+        auto &promise{root.promise()};
+        promise.m_leaf.resume();
+        if (root.done() && promise.m_exception)
+        {
+            std::rethrow_exception(promise.m_exception);
+        }
+    }
+
+    void destroy()
+    {
+        // Inner generators are destroyed with the frame that holds them
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    Handle m_handle{};
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "frame_pool.h"
+
+#include <algorithm>
+#include <new>
+
+namespace
+{
+    constexpr std::size_t granularity{64};
+    constexpr std::size_t listCount{32};
+    constexpr std::size_t maxFramesPerList{256};
+
+    struct FreeFrame
+    {
+        FreeFrame *next{nullptr};
+    };
+
+    // Constant-initialized, so using it costs no check for initialization
+    struct ThreadFrames
+    {
+        FreeFrame *lists[listCount]{};
+        std::size_t lengths[listCount]{};
+        FramePoolStats stats{};
+        bool finished{false};
+    };
+
+    thread_local ThreadFrames t_frames{};
+
+    // Frees the thread's pooled frames when the thread exits
+    struct FrameReleaser
+    {
+        FrameReleaser() = default;
+        FrameReleaser(const FrameReleaser &) = delete;
+        FrameReleaser &operator=(const FrameReleaser &) = delete;
+
+        ~FrameReleaser()
+        {
+            for (std::size_t list{0}; list < listCount; ++list)
+            {
+                while (t_frames.lists[list] != nullptr)
+                {
+                    FreeFrame *frame{t_frames.lists[list]};
+                    t_frames.lists[list] = frame->next;
+                    ::operator delete(frame);
+                }
+                t_frames.lengths[list] = 0;
+            }
+            // Frames freed by later thread_local destructors go straight
+            // to delete
+            t_frames.finished = true;
+        }
+    };
+
+    std::size_t listOf(std::size_t size)
+    {
+        return (size + granularity - 1) / granularity;
+    }
+
+    void countInUse(std::ptrdiff_t bytes)
+    {
+        auto &stats{t_frames.stats};
+        stats.bytesInUse += static_cast<std::size_t>(bytes);
+        stats.peakBytesInUse = std::max(stats.peakBytesInUse, stats.bytesInUse);
+    }
+}
+
+void *allocate_frame(std::size_t size)
+{
+    const auto list{listOf(size)};
+    countInUse(static_cast<std::ptrdiff_t>(size));
+    if (list < listCount && t_frames.lists[list] != nullptr)
+    {
+        FreeFrame *frame{t_frames.lists[list]};
+        t_frames.lists[list] = frame->next;
+        --t_frames.lengths[list];
+        ++t_frames.stats.reused;
+        return frame;
+    }
+    ++t_frames.stats.fromHeap;
+    // Rounded up, so that any frame of the list fits when it is reused
+    return ::operator new(list < listCount ? list * granularity : size);
+}
+
+void free_frame(void *frame, std::size_t size) noexcept
+{
+    const auto list{listOf(size)};
+    countInUse(-static_cast<std::ptrdiff_t>(size));
+    if (list >= listCount || t_frames.finished || t_frames.lengths[list] == maxFramesPerList)
+    {
+        ::operator delete(frame);
+        return;
+    }
+    if (t_frames.lengths[list] == 0)
+    {
+        // Registers the release at thread exit, once per thread
+        thread_local const FrameReleaser releaser{};
+    }
+    t_frames.lists[list] = new (frame) FreeFrame{t_frames.lists[list]};
+    ++t_frames.lengths[list];
+}
+
+FramePoolStats frame_pool_stats()
+{
+    return t_frames.stats;
+}
+
+void reset_frame_pool_peak()
+{
+    t_frames.stats.peakBytesInUse = t_frames.stats.bytesInUse;
+}
@@ -0,0 +1,253 @@
+/**
+ * Lazy Sequences with Coroutine Generators
+ *
+ * Many examples build a whole container before using any of it: the
+ * vector of primes in ch16_containers_and_arrays, the array of months in
+ * ch20_functions_and_lambdas. That is fine for four primes and twelve
+ * months, but a sequence of a billion numbers would need gigabytes, and
+ * all of it has to be computed before the first element can be used.
+ *
+ * A generator (generator.h) is a coroutine that computes the sequence as
+ * it is read: it runs until its next co_yield, hands over one element and
+ * suspends until the reader wants the next. Its memory is its frame, a few
+ * dozen bytes, however long the sequence. Since it is a range, it works in
+ * std::views pipelines like the reverse view in vectors/ex03_reverse_range,
+ * except for views such as reverse that need to go backwards or to read an
+ * element twice.
+ *
+ * The example prints primes from an endless generator, walks a binary tree
+ * with recursive generators, then sums the numbers 0 to n - 1 once with a
+ * generator and once from a filled vector, for growing n, and reports time
+ * and memory.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="100000000"   # up to 10^8 numbers
+ */
+
+#include "frame_pool.h"
+#include "generator.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <ranges>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+static_assert(std::ranges::view<Generator<int>>);
+static_assert(std::ranges::input_range<Generator<int>>);
+
+// 2, 3, 4, ... without end
+Generator<std::uint64_t> naturalsFrom(std::uint64_t first)
+{
+    for (auto i{first};; ++i)
+    {
+        co_yield i;
+    }
+}
+
+bool isPrime(std::uint64_t n)
+{
+    if (n < 2)
+    {
+        return false;
+    }
+    for (std::uint64_t d{2}; d * d <= n; ++d)
+    {
+        if (n % d == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 0, 1, ..., count - 1
+Generator<std::uint64_t> sequence(std::uint64_t count)
+{
+    for (std::uint64_t i{0}; i < count; ++i)
+    {
+        co_yield i;
+    }
+}
+
+struct Node
+{
+    std::uint64_t value{0};
+    std::unique_ptr<Node> left{};
+    std::unique_ptr<Node> right{};
+};
+
+// Balanced tree of the values first to last - 1
+std::unique_ptr<Node> buildTree(std::uint64_t first, std::uint64_t last)
+{
+    if (first == last)
+    {
+        return nullptr;
+    }
+    const auto middle{first + (last - first) / 2};
+    return std::make_unique<Node>(Node{middle, buildTree(first, middle), buildTree(middle + 1, last)});
+}
+
+// The values of a tree in order, one nested generator per level
+Generator<std::uint64_t> walk(const Node *node)
+{
+    if (node == nullptr)
+    {
+        co_return;
+    }
+    co_yield ElementsOf{walk(node->left.get())};
+    co_yield node->value;
+    co_yield ElementsOf{walk(node->right.get())};
+}
+
+template <typename Function>
+double secondsFor(Function function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+std::string formatBytes(std::size_t bytes)
+{
+    if (bytes < 1024 * 1024)
+    {
+        return std::to_string(bytes) + " B";
+    }
+    return std::to_string(bytes / (1024 * 1024)) + " MiB";
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        const auto maxCount = std::uint64_t{argc > 1 ? std::stoull(argv[1]) : 1000000000};
+
+        // An endless generator is fine, as long as the pipeline stops
+        std::cout << "First primes:";
+        for (const auto prime : naturalsFrom(2) | std::views::filter(isPrime) | std::views::take(10))
+        {
+            std::cout << ' ' << prime;
+        }
+        std::cout << std::endl;
+        std::cout << "Squares below 100:";
+        for (const auto square : sequence(100) | std::views::transform([](std::uint64_t i) { return i * i; }) |
+                                     std::views::take_while([](std::uint64_t i) { return i < 100; }))
+        {
+            std::cout << ' ' << square;
+        }
+        std::cout << std::endl << std::endl;
+
+        // Every node is a generator, reused from the frame pool
+        constexpr std::uint64_t treeSize{1 << 20};
+        const auto tree = buildTree(0, treeSize);
+        std::uint64_t expected{0};
+        bool inOrder{true};
+        const auto walkSeconds = secondsFor(
+            [&]
+            {
+                for (const auto value : walk(tree.get()))
+                {
+                    inOrder = inOrder && value == expected++;
+                }
+            });
+        if (!inOrder || expected != treeSize)
+        {
+            std::cout << "Error: the tree walk produced the wrong sequence" << std::endl;
+            return 1;
+        }
+        const auto stats = frame_pool_stats();
+        std::cout << "Tree walk: " << treeSize << " values, " << std::fixed << std::setprecision(1)
+                  << walkSeconds * 1e9 / treeSize << " ns each, 21 generators deep" << std::endl
+                  << "Generator frames: " << stats.fromHeap << " from the heap, " << stats.reused << " reused"
+                  << std::endl
+                  << std::endl;
+
+        const auto physicalMemory =
+            static_cast<std::size_t>(sysconf(_SC_PHYS_PAGES)) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+        std::cout << "Sum of 0 to n - 1:" << std::endl
+                  << std::setw(12) << "n" << std::setw(14) << "generator" << std::setw(14) << "vector"
+                  << std::setw(14) << "generator" << std::setw(14) << "vector" << std::endl
+                  << std::setw(12) << "" << std::setw(14) << "ns/value" << std::setw(14) << "ns/value"
+                  << std::setw(14) << "memory" << std::setw(14) << "memory" << std::endl;
+        bool skipped{false};
+        for (std::uint64_t count{1000000}; count <= maxCount; count *= 10)
+        {
+            const auto expectedSum = count * (count - 1) / 2;
+
+            std::uint64_t lazySum{0};
+            reset_frame_pool_peak();
+            const auto lazySeconds = secondsFor(
+                [&]
+                {
+                    for (const auto value : sequence(count))
+                    {
+                        lazySum += value;
+                    }
+                });
+            const auto lazyBytes = frame_pool_stats().peakBytesInUse - frame_pool_stats().bytesInUse;
+
+            std::cout << std::setw(12) << count << std::setw(14) << lazySeconds * 1e9 / static_cast<double>(count);
+
+            const auto vectorBytes = count * sizeof(std::uint64_t);
+            if (vectorBytes > physicalMemory / 2)
+            {
+                skipped = true;
+                std::cout << std::setw(14) << "skipped" << std::setw(14) << formatBytes(lazyBytes) << std::setw(14)
+                          << formatBytes(vectorBytes) << std::endl;
+            }
+            else
+            {
+                std::uint64_t vectorSum{0};
+                const auto vectorSeconds = secondsFor(
+                    [&]
+                    {
+                        std::vector<std::uint64_t> values{};
+                        values.reserve(count);
+                        for (std::uint64_t i{0}; i < count; ++i)
+                        {
+                            values.push_back(i);
+                        }
+                        for (const auto value : values)
+                        {
+                            vectorSum += value;
+                        }
+                    });
+                std::cout << std::setw(14) << vectorSeconds * 1e9 / static_cast<double>(count) << std::setw(14)
+                          << formatBytes(lazyBytes) << std::setw(14) << formatBytes(vectorBytes) << std::endl;
+                if (vectorSum != expectedSum)
+                {
+                    std::cout << "Error: the vector sum is wrong" << std::endl;
+                    return 1;
+                }
+            }
+            if (lazySum != expectedSum)
+            {
+                std::cout << "Error: the generator sum is wrong" << std::endl;
+                return 1;
+            }
+        }
+        if (skipped)
+        {
+            std::cout << std::endl << "skipped: the vector would need more than half of the memory" << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef CHUNK_READER_H
+#define CHUNK_READER_H
+
+#include "uring.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+struct ReaderOptions
+{
+    std::size_t chunkSize{std::size_t{1} << 20};
+    // Chunks being read or parsed at a time: 2 is double buffering, 3
+    // triple buffering
+    unsigned queueDepth{4};
+    // Otherwise, or if io_uring is not available, pread
+    bool useIoUring{true};
+};
+
+/**
+ * Reads a file front to back in chunks, ahead of the code that parses
+ * them:
+ *
+ *     ChunkReader reader{"input.txt", ReaderOptions{}};
+ *     for (auto chunk{reader.next()}; !chunk.empty(); chunk = reader.next())
+ *     {
+ *         parse(chunk);   // the next chunks are being read meanwhile
+ *     }
+ *
+ * With io_uring, the reader keeps queueDepth - 1 reads in flight while the
+ * caller parses the current chunk, so reading and parsing overlap, with no
+ * thread of its own. Each chunk has its own buffer, registered with the
+ * ring once. Asking for the next chunk hands the previous buffer back to
+ * be read into again, so a chunk stays valid only until the next call.
+ *
+ * Without io_uring (options.useIoUring is false, or the kernel refuses
+ * it), next() reads each chunk with pread when it is asked for, like a
+ * plain read loop. The size of the file is taken when it is opened. Throws
+ * std::system_error if the file cannot be opened or read.
+ */
+class ChunkReader
+{
+public:
+    ChunkReader(const std::string &path, const ReaderOptions &options);
+    ~ChunkReader();
+
+    ChunkReader(const ChunkReader &) = delete;
+    ChunkReader &operator=(const ChunkReader &) = delete;
+
+    // The next chunk, or an empty one at the end of the file
+    std::span<const char> next();
+
+    bool usesIoUring() const { return m_ring != nullptr; }
+
+private:
+    struct Chunk
+    {
+        char *data{nullptr};
+        std::uint64_t offset{0};
+        std::size_t length{0};
+        std::size_t filled{0};
+        bool ready{false};
+    };
+
+    void startRead(std::size_t buffer);
+    void queueRead(std::size_t buffer);
+    void complete(const IoUring::Completion &completion);
+    void waitFor(std::size_t buffer);
+    std::span<const char> readSynchronously();
+
+    int m_fd{-1};
+    std::uint64_t m_fileSize{0};
+    std::size_t m_chunkSize{0};
+    std::unique_ptr<IoUring> m_ring{};
+    std::unique_ptr<char[]> m_memory{};
+    std::vector<Chunk> m_chunks{};
+    bool m_fixedBuffers{false};
+    unsigned m_inFlight{0};
+    // Offset of the next chunk to start reading, and index of the next one
+    // to hand out
+    std::uint64_t m_nextOffset{0};
+    std::size_t m_nextChunk{0};
+    bool m_returnedChunk{false};
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef URING_H
+#define URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <sys/uio.h>
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+/**
+ * A minimal io_uring, set up with the raw system calls:
+ *
+ *     IoUring ring{8};
+ *     ring.prepareRead(fd, buffer, size, offset, 42);
+ *     ring.submit(1);                      // and wait for one completion
+ *     auto completion{ring.pollCompletion()};   // userData 42, result bytes read
+ *
+ * The kernel and the program share two rings in memory: the program puts
+ * requests (submission queue entries) into one and the kernel puts results
+ * (completion queue entries) into the other. A single io_uring_enter call
+ * hands over any number of requests and waits for results, and while the
+ * requests run, the program is free to do other work. Each ring has one
+ * writer, which moves the tail, and one reader, which moves the head, so
+ * neither side needs a lock, only acquire and release ordering.
+ *
+ * Buffers registered with registerBuffers are mapped into the kernel once,
+ * instead of for every read. Throws std::system_error if a system call
+ * fails; io_uring may be missing or disabled (kernel.io_uring_disabled,
+ * seccomp in containers), which shows as ENOSYS or EPERM from the
+ * constructor. Not safe to use from several threads.
+ */
+class IoUring
+{
+public:
+    struct Completion
+    {
+        std::uint64_t userData{0};
+        // Bytes transferred, or -errno
+        int result{0};
+    };
+
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    void registerBuffers(std::span<const iovec> buffers);
+
+    // Queues a read into buffer, which must lie in registered buffer
+    // bufferIndex unless that is -1. False if the submission queue is full
+    bool prepareRead(int fd, void *buffer, unsigned length, std::uint64_t offset, std::uint64_t userData,
+                     int bufferIndex = -1);
+
+    // Hands the queued reads to the kernel and waits until at least
+    // waitFor completions are ready
+    void submit(unsigned waitFor);
+
+    std::optional<Completion> pollCompletion();
+
+private:
+    void release() noexcept;
+
+    int m_fd{-1};
+    void *m_ringMemory{nullptr};
+    std::size_t m_ringSize{0};
+    void *m_cqMemory{nullptr};
+    std::size_t m_cqSize{0};
+    io_uring_sqe *m_sqes{nullptr};
+    std::size_t m_sqesSize{0};
+
+    unsigned m_sqEntries{0};
+    unsigned *m_sqHead{nullptr};
+    unsigned *m_sqTail{nullptr};
+    unsigned m_sqMask{0};
+    unsigned *m_sqArray{nullptr};
+    unsigned *m_cqHead{nullptr};
+    unsigned *m_cqTail{nullptr};
+    unsigned m_cqMask{0};
+    io_uring_cqe *m_cqes{nullptr};
+
+    // Queued but not yet handed to the kernel
+    unsigned m_unsubmitted{0};
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include "chunk_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ChunkReader::ChunkReader(const std::string &path, const ReaderOptions &options)
+    : m_chunkSize{std::max<std::size_t>(options.chunkSize, 1)}
+{
+    m_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
+    {
+        throw std::system_error{errno, std::generic_category(), "open " + path};
+    }
+    struct stat status{};
+    if (fstat(m_fd, &status) != 0)
+    {
+        const int error{errno};
+        close(m_fd);
+        throw std::system_error{error, std::generic_category(), "fstat " + path};
+    }
+    m_fileSize = static_cast<std::uint64_t>(status.st_size);
+    // Lets the kernel read ahead further
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    const unsigned depth{std::max(options.queueDepth, 1U)};
+    if (options.useIoUring)
+    {
+        try
+        {
+            m_ring = std::make_unique<IoUring>(depth);
+        }
+        catch (const std::system_error &)
+        {
+            // pread then
+        }
+    }
+
+    const std::size_t buffers{m_ring != nullptr ? depth : 1};
+    m_memory = std::make_unique_for_overwrite<char[]>(buffers * m_chunkSize);
+    m_chunks.resize(buffers);
+    std::vector<iovec> registered(buffers);
+    for (std::size_t buffer{0}; buffer < buffers; ++buffer)
+    {
+        m_chunks[buffer].data = m_memory.get() + buffer * m_chunkSize;
+        registered[buffer] = iovec{m_chunks[buffer].data, m_chunkSize};
+    }
+    if (m_ring == nullptr)
+    {
+        return;
+    }
+
+    try
+    {
+        m_ring->registerBuffers(registered);
+        m_fixedBuffers = true;
+    }
+    catch (const std::system_error &)
+    {
+        // Over the locked memory limit, say; plain reads work as well
+    }
+    for (std::size_t buffer{0}; buffer < buffers; ++buffer)
+    {
+        startRead(buffer);
+    }
+    m_ring->submit(0);
+}
+
+ChunkReader::~ChunkReader()
+{
+    // The kernel may still be writing into the buffers
+    try
+    {
+        while (m_inFlight > 0)
+        {
+            m_ring->submit(1);
+            while (const auto completion{m_ring->pollCompletion()})
+            {
+                --m_inFlight;
+            }
+        }
+    }
+    catch (const std::system_error &)
+    {
+    }
+    close(m_fd);
+}
+
+std::span<const char> ChunkReader::next()
+{
+    if (m_ring == nullptr)
+    {
+        return readSynchronously();
+    }
+
+    // The caller is done with the previous chunk, its buffer reads on
+    const std::size_t depth{m_chunks.size()};
+    if (m_returnedChunk)
+    {
+        startRead((m_nextChunk + depth - 1) % depth);
+        m_ring->submit(0);
+    }
+
+    const std::size_t buffer{m_nextChunk % depth};
+    Chunk &chunk{m_chunks[buffer]};
+    if (chunk.length == 0)
+    {
+        return {};
+    }
+    waitFor(buffer);
+    ++m_nextChunk;
+    m_returnedChunk = true;
+    return {chunk.data, chunk.filled};
+}
+
+void ChunkReader::startRead(std::size_t buffer)
+{
+    Chunk &chunk{m_chunks[buffer]};
+    chunk.offset = m_nextOffset;
+    chunk.length = static_cast<std::size_t>(std::min<std::uint64_t>(m_chunkSize, m_fileSize - m_nextOffset));
+    chunk.filled = 0;
+    chunk.ready = chunk.length == 0;
+    m_nextOffset += chunk.length;
+    if (!chunk.ready)
+    {
+        queueRead(buffer);
+    }
+}
+
+void ChunkReader::queueRead(std::size_t buffer)
+{
+    const Chunk &chunk{m_chunks[buffer]};
+    // Never full: there is at most one read per buffer, and as many
+    // entries as buffers
+    m_ring->prepareRead(m_fd, chunk.data + chunk.filled, static_cast<unsigned>(chunk.length - chunk.filled),
+                        chunk.offset + chunk.filled, buffer, m_fixedBuffers ? static_cast<int>(buffer) : -1);
+    ++m_inFlight;
+}
+
+void ChunkReader::complete(const IoUring::Completion &completion)
+{
+    --m_inFlight;
+    const auto buffer{static_cast<std::size_t>(completion.userData)};
+    Chunk &chunk{m_chunks[buffer]};
+    if (completion.result == -EINTR || completion.result == -EAGAIN)
+    {
+        queueRead(buffer);
+        return;
+    }
+    if (completion.result < 0)
+    {
+        throw std::system_error{-completion.result, std::generic_category(), "read"};
+    }
+    chunk.filled += static_cast<std::size_t>(completion.result);
+    if (completion.result == 0)
+    {
+        // The file got shorter since it was opened
+        chunk.length = chunk.filled;
+    }
+    chunk.ready = chunk.filled == chunk.length;
+    if (!chunk.ready)
+    {
+        // A short read, the rest follows
+        queueRead(buffer);
+    }
+}
+
+void ChunkReader::waitFor(std::size_t buffer)
+{
+    while (true)
+    {
+        while (const auto completion{m_ring->pollCompletion()})
+        {
+            complete(*completion);
+        }
+        if (m_chunks[buffer].ready)
+        {
+            return;
+        }
+        // Submits any reads queued again, too
+        m_ring->submit(1);
+    }
+}
+
+std::span<const char> ChunkReader::readSynchronously()
+{
+    Chunk &chunk{m_chunks.front()};
+    chunk.length = static_cast<std::size_t>(std::min<std::uint64_t>(m_chunkSize, m_fileSize - m_nextOffset));
+    chunk.filled = 0;
+    while (chunk.filled < chunk.length)
+    {
+        const auto bytes{pread(m_fd, chunk.data + chunk.filled, chunk.length - chunk.filled,
+                               static_cast<off_t>(m_nextOffset + chunk.filled))};
+        if (bytes == 0)
+        {
+            break;
+        }
+        if (bytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error{errno, std::generic_category(), "pread"};
+        }
+        chunk.filled += static_cast<std::size_t>(bytes);
+    }
+    m_nextOffset += chunk.filled;
+    return {chunk.data, chunk.filled};
+}
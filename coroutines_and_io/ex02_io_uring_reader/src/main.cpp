@@ -0,0 +1,323 @@
+/**
+ * Reading Large Files with io_uring
+ *
+ * The only input in the earlier examples is std::cin in
+ * ch01_basic_examples/ex05_input_and_output, which blocks until the data
+ * is there. For a file of several gigabytes that means the program either
+ * waits for the disk or parses, never both at once.
+ *
+ * ChunkReader (chunk_reader.h) reads a file in chunks with io_uring
+ * (uring.h): while the program parses one chunk, the kernel is already
+ * reading the next ones into their own buffers, registered with the ring
+ * once. How many chunks are on the way is the queue depth: 2 is double
+ * buffering, 3 triple buffering. Where io_uring is missing or disabled, it
+ * falls back to pread.
+ *
+ * The example writes a 1 GiB file of numbers, one per line, into bin/
+ * (make clean removes it) or takes an existing file. It reads the file
+ * with std::ifstream, with a read loop, with ChunkReader's pread fallback
+ * and with io_uring at several queue depths, each three times: scanning it
+ * with the file dropped from the page cache (cold, the disk's speed) and
+ * right after (warm, memory's speed), and parsing its numbers, cold.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="4096"              # a 4 GiB file
+ *     > make run ARGS="/path/to/file"     # an existing file
+ */
+
+#include "chunk_reader.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+constexpr std::size_t bufferSize{std::size_t{1} << 20};
+
+using ChunkHandler = std::function<void(std::span<const char>)>;
+
+// A checksum cheap enough that scanning a file is as fast as reading it.
+// Sums the file as 64-bit words, however it is split into chunks
+class WordSum
+{
+public:
+    void add(std::span<const char> chunk)
+    {
+        std::size_t i{0};
+        for (; i < chunk.size() && m_position % 8 != 0; ++i)
+        {
+            addByte(chunk[i]);
+        }
+        for (; i + 8 <= chunk.size(); i += 8)
+        {
+            std::uint64_t word{0};
+            std::memcpy(&word, chunk.data() + i, sizeof(word));
+            m_sum += word;
+        }
+        m_position += i - i % 8;
+        for (; i < chunk.size(); ++i)
+        {
+            addByte(chunk[i]);
+        }
+    }
+
+    std::uint64_t sum() const { return m_sum; }
+
+private:
+    void addByte(char byte)
+    {
+        m_sum += static_cast<std::uint64_t>(static_cast<unsigned char>(byte)) << (8 * (m_position % 8));
+        ++m_position;
+    }
+
+    std::uint64_t m_sum{0};
+    std::uint64_t m_position{0};
+};
+
+// Sums the numbers of a text, one per line, a byte at a time like a real
+// parser. Keeps its state between chunks, so a number may be split across
+// two
+class LineSummer
+{
+public:
+    void parse(std::span<const char> chunk)
+    {
+        for (const char c : chunk)
+        {
+            if (c >= '0' && c <= '9')
+            {
+                m_current = m_current * 10 + static_cast<std::uint64_t>(c - '0');
+            }
+            else if (c == '\n')
+            {
+                m_sum += m_current;
+                m_current = 0;
+                ++m_lines;
+            }
+        }
+    }
+
+    std::uint64_t lines() const { return m_lines; }
+    std::uint64_t sum() const { return m_sum; }
+
+private:
+    std::uint64_t m_current{0};
+    std::uint64_t m_sum{0};
+    std::uint64_t m_lines{0};
+};
+
+void writeNumbers(const std::filesystem::path &path, std::uint64_t bytes)
+{
+    std::ofstream file{path, std::ios::binary};
+    std::vector<char> buffer(bufferSize);
+    std::uint64_t written{0};
+    std::uint64_t number{1};
+    while (written < bytes)
+    {
+        std::size_t used{0};
+        while (used + 24 < buffer.size() && written + used < bytes)
+        {
+            number = number * 6364136223846793005 + 1442695040888963407;
+            const auto end{std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), number >> 44).ptr};
+            *end = '\n';
+            used = static_cast<std::size_t>(end + 1 - buffer.data());
+        }
+        file.write(buffer.data(), static_cast<std::streamsize>(used));
+        written += used;
+    }
+    if (!file)
+    {
+        throw std::runtime_error{"cannot write " + path.string()};
+    }
+}
+
+// Written pages are only dropped from the page cache once they are on disk
+void dropFromPageCache(const std::filesystem::path &path)
+{
+    const int fd{open(path.c_str(), O_RDONLY)};
+    if (fd < 0)
+    {
+        throw std::system_error{errno, std::generic_category(), "open " + path.string()};
+    }
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+void readWithIfstream(const std::filesystem::path &path, const ChunkHandler &handle)
+{
+    std::ifstream file{path, std::ios::binary};
+    std::vector<char> buffer(bufferSize);
+    while (file.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || file.gcount() > 0)
+    {
+        handle({buffer.data(), static_cast<std::size_t>(file.gcount())});
+    }
+}
+
+void readWithRead(const std::filesystem::path &path, const ChunkHandler &handle)
+{
+    const int fd{open(path.c_str(), O_RDONLY)};
+    if (fd < 0)
+    {
+        throw std::system_error{errno, std::generic_category(), "open " + path.string()};
+    }
+    std::vector<char> buffer(bufferSize);
+    ssize_t bytes{0};
+    while ((bytes = read(fd, buffer.data(), buffer.size())) != 0)
+    {
+        if (bytes < 0 && errno != EINTR)
+        {
+            const int error{errno};
+            close(fd);
+            throw std::system_error{error, std::generic_category(), "read"};
+        }
+        if (bytes > 0)
+        {
+            handle({buffer.data(), static_cast<std::size_t>(bytes)});
+        }
+    }
+    close(fd);
+}
+
+// False if the reader had to fall back to pread
+bool readWithChunkReader(const std::filesystem::path &path, const ReaderOptions &options,
+                         const ChunkHandler &handle)
+{
+    ChunkReader reader{path, options};
+    for (auto chunk{reader.next()}; !chunk.empty(); chunk = reader.next())
+    {
+        handle(chunk);
+    }
+    return reader.usesIoUring() || !options.useIoUring;
+}
+
+struct Method
+{
+    std::string name{};
+    std::function<void(const std::filesystem::path &, const ChunkHandler &)> read{};
+};
+
+// GB/s
+double measure(const Method &method, const std::filesystem::path &path, bool cold, const ChunkHandler &handle)
+{
+    if (cold)
+    {
+        dropFromPageCache(path);
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    method.read(path, handle);
+    auto end = std::chrono::high_resolution_clock::now();
+    const auto seconds = std::chrono::duration<double>(end - start).count();
+    return static_cast<double>(std::filesystem::file_size(path)) / seconds / 1e9;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        auto path = std::filesystem::path{argv[0]}.parent_path() / "scan.data";
+        if (argc > 1 && std::filesystem::exists(argv[1]))
+        {
+            path = argv[1];
+        }
+        else
+        {
+            const auto bytes = std::uint64_t{argc > 1 ? std::stoull(argv[1]) : 1024} << 20;
+            // Kept from an earlier run if it has the size asked for
+            if (!std::filesystem::exists(path) || std::filesystem::file_size(path) >> 20 != bytes >> 20)
+            {
+                std::cout << "Writing " << path.string() << "..." << std::endl;
+                writeNumbers(path, bytes);
+            }
+        }
+        const auto fileSize = std::filesystem::file_size(path);
+        std::cout << "Scanning " << path.string() << ", " << fileSize / (1024 * 1024) << " MiB" << std::endl
+                  << std::endl;
+
+        bool ioUringAvailable{true};
+        const auto chunkReader = [&ioUringAvailable](unsigned depth, bool useIoUring)
+        {
+            return [&ioUringAvailable, depth, useIoUring](const std::filesystem::path &file,
+                                                          const ChunkHandler &handle)
+            {
+                const ReaderOptions options{bufferSize, depth, useIoUring};
+                ioUringAvailable = readWithChunkReader(file, options, handle) && ioUringAvailable;
+            };
+        };
+        const auto methods = std::vector<Method>{
+            {"std::ifstream", readWithIfstream},
+            {"read", readWithRead},
+            {"pread fallback", chunkReader(1, false)},
+            {"io_uring, depth 1", chunkReader(1, true)},
+            {"io_uring, depth 2", chunkReader(2, true)},
+            {"io_uring, depth 3", chunkReader(3, true)},
+            {"io_uring, depth 8", chunkReader(8, true)},
+        };
+
+        // Scanning shows how fast each method reads, parsing how well
+        // reading hides behind work on the data
+        std::cout << std::setw(20) << "" << std::setw(12) << "scan" << std::setw(12) << "scan" << std::setw(12)
+                  << "parse" << std::endl
+                  << std::setw(20) << "" << std::setw(12) << "cold GB/s" << std::setw(12) << "warm GB/s"
+                  << std::setw(12) << "cold GB/s" << std::endl;
+        std::uint64_t expectedSum{0};
+        LineSummer expectedLines{};
+        bool first{true};
+        for (const auto &method : methods)
+        {
+            std::cout << std::setw(20) << std::left << method.name << std::right << std::fixed << std::setprecision(2);
+            WordSum coldSum{};
+            WordSum warmSum{};
+            LineSummer lines{};
+            std::cout << std::setw(12) << measure(method, path, true, [&](auto chunk) { coldSum.add(chunk); })
+                      << std::flush;
+            std::cout << std::setw(12) << measure(method, path, false, [&](auto chunk) { warmSum.add(chunk); })
+                      << std::flush;
+            std::cout << std::setw(12) << measure(method, path, true, [&](auto chunk) { lines.parse(chunk); })
+                      << std::endl;
+
+            if (first)
+            {
+                expectedSum = coldSum.sum();
+                expectedLines = lines;
+                first = false;
+            }
+            if (coldSum.sum() != expectedSum || warmSum.sum() != expectedSum || lines.lines() != expectedLines.lines() ||
+                lines.sum() != expectedLines.sum())
+            {
+                std::cout << "Error: " << method.name << " read different data" << std::endl;
+                return 1;
+            }
+        }
+        std::cout << std::endl
+                  << expectedLines.lines() << " lines, their sum is " << expectedLines.sum() << std::endl;
+        if (!ioUringAvailable)
+        {
+            std::cout << "io_uring is not available here, the io_uring rows used pread" << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include "uring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    // glibc has no wrappers for these, and liburing is not needed for reads
+    int io_uring_setup(unsigned entries, io_uring_params *params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    int io_uring_register(int fd, unsigned opcode, const void *arg, unsigned count)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    void *mapRing(int fd, std::size_t size, std::uint64_t offset)
+    {
+        void *memory{
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, static_cast<off_t>(offset))};
+        if (memory == MAP_FAILED)
+        {
+            throw std::system_error{errno, std::generic_category(), "mmap"};
+        }
+        return memory;
+    }
+
+    template <typename T>
+    T *at(void *memory, std::uint32_t offset)
+    {
+        return reinterpret_cast<T *>(static_cast<char *>(memory) + offset);
+    }
+
+    // The kernel reads and writes the ring indices concurrently
+    unsigned loadAcquire(unsigned *index)
+    {
+        return std::atomic_ref<unsigned>{*index}.load(std::memory_order_acquire);
+    }
+
+    void storeRelease(unsigned *index, unsigned value)
+    {
+        std::atomic_ref<unsigned>{*index}.store(value, std::memory_order_release);
+    }
+}
+
+IoUring::IoUring(unsigned entries)
+{
+    io_uring_params params{};
+    m_fd = io_uring_setup(entries, &params);
+    if (m_fd < 0)
+    {
+        throw std::system_error{errno, std::generic_category(), "io_uring_setup"};
+    }
+
+    try
+    {
+        m_ringSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        // Since Linux 5.4 both rings share one mapping
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+        {
+            m_ringSize = std::max(m_ringSize, m_cqSize);
+        }
+        m_ringMemory = mapRing(m_fd, m_ringSize, IORING_OFF_SQ_RING);
+        m_cqMemory = (params.features & IORING_FEAT_SINGLE_MMAP) != 0
+                         ? m_ringMemory
+                         : mapRing(m_fd, m_cqSize, IORING_OFF_CQ_RING);
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = static_cast<io_uring_sqe *>(mapRing(m_fd, m_sqesSize, IORING_OFF_SQES));
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+
+    m_sqEntries = params.sq_entries;
+    m_sqHead = at<unsigned>(m_ringMemory, params.sq_off.head);
+    m_sqTail = at<unsigned>(m_ringMemory, params.sq_off.tail);
+    m_sqMask = *at<unsigned>(m_ringMemory, params.sq_off.ring_mask);
+    m_sqArray = at<unsigned>(m_ringMemory, params.sq_off.array);
+    m_cqHead = at<unsigned>(m_cqMemory, params.cq_off.head);
+    m_cqTail = at<unsigned>(m_cqMemory, params.cq_off.tail);
+    m_cqMask = *at<unsigned>(m_cqMemory, params.cq_off.ring_mask);
+    m_cqes = at<io_uring_cqe>(m_cqMemory, params.cq_off.cqes);
+}
+
+IoUring::~IoUring()
+{
+    release();
+}
+
+void IoUring::release() noexcept
+{
+    if (m_sqes != nullptr)
+    {
+        munmap(m_sqes, m_sqesSize);
+    }
+    if (m_cqMemory != nullptr && m_cqMemory != m_ringMemory)
+    {
+        munmap(m_cqMemory, m_cqSize);
+    }
+    if (m_ringMemory != nullptr)
+    {
+        munmap(m_ringMemory, m_ringSize);
+    }
+    // Closing the ring cancels what is still in flight
+    close(m_fd);
+}
+
+void IoUring::registerBuffers(std::span<const iovec> buffers)
+{
+    if (io_uring_register(m_fd, IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size())) <
+        0)
+    {
+        throw std::system_error{errno, std::generic_category(), "io_uring_register"};
+    }
+}
+
+bool IoUring::prepareRead(int fd, void *buffer, unsigned length, std::uint64_t offset, std::uint64_t userData,
+                          int bufferIndex)
+{
+    // Only this side moves the tail
+    const unsigned tail{*m_sqTail};
+    if (tail - loadAcquire(m_sqHead) == m_sqEntries)
+    {
+        return false;
+    }
+    const unsigned index{tail & m_sqMask};
+    io_uring_sqe &entry{m_sqes[index]};
+    std::memset(&entry, 0, sizeof(entry));
+    entry.opcode = bufferIndex >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    entry.fd = fd;
+    entry.addr = reinterpret_cast<std::uint64_t>(buffer);
+    entry.len = length;
+    entry.off = offset;
+    entry.buf_index = static_cast<std::uint16_t>(bufferIndex >= 0 ? bufferIndex : 0);
+    entry.user_data = userData;
+    m_sqArray[index] = index;
+    // The entry is written before the kernel can see the new tail
+    storeRelease(m_sqTail, tail + 1);
+    ++m_unsubmitted;
+    return true;
+}
+
+void IoUring::submit(unsigned waitFor)
+{
+    while (true)
+    {
+        const int submitted{io_uring_enter(m_fd, m_unsubmitted, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0)};
+        if (submitted >= 0)
+        {
+            m_unsubmitted -= static_cast<unsigned>(submitted);
+            return;
+        }
+        if (errno != EINTR)
+        {
+            throw std::system_error{errno, std::generic_category(), "io_uring_enter"};
+        }
+    }
+}
+
+std::optional<IoUring::Completion> IoUring::pollCompletion()
+{
+    // Only this side moves the head
+    const unsigned head{*m_cqHead};
+    if (head == loadAcquire(m_cqTail))
+    {
+        return std::nullopt;
+    }
+    const io_uring_cqe &entry{m_cqes[head & m_cqMask]};
+    const Completion completion{entry.user_data, entry.res};
+    // The entry is read before the kernel may overwrite it
+    storeRelease(m_cqHead, head + 1);
+    return completion;
+}
@@ -0,0 +1,190 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "thread_pool.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+/**
+ * A bounded queue between coroutines:
+ *
+ *     Channel<Chunk> chunks{pool, 4};
+ *
+ *     co_await chunks.send(std::move(chunk));      // in the producer
+ *     chunks.close();                              // when it is done
+ *
+ *     while (auto chunk{co_await chunks.receive()})   // in the consumer
+ *     {
+ *         ...
+ *     }
+ *
+ * A sender waits while the channel holds capacity values, a receiver
+ * while it is empty. Waiting suspends the coroutine instead of blocking
+ * its thread, so the thread runs other stages meanwhile, and a fast
+ * producer cannot run ahead of a slow consumer by more than capacity
+ * values (backpressure). A waiting coroutine is resumed on the pool, not
+ * on the thread that woke it.
+ *
+ * close() ends the channel: receivers get what is still queued, then
+ * std::nullopt, and send returns false instead of queuing. Any number of
+ * senders and receivers, on any threads.
+ */
+template <typename T>
+class Channel
+{
+    struct Waiter;
+
+public:
+    Channel(ThreadPool &pool, std::size_t capacity) : m_pool{pool}, m_capacity{capacity} {}
+
+    Channel(const Channel &) = delete;
+    Channel &operator=(const Channel &) = delete;
+
+    // co_await send(value) is false if the channel was closed
+    auto send(T value)
+    {
+        struct SendAwaiter
+        {
+            Channel *channel{nullptr};
+            Waiter waiter{};
+
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> handle) { return channel->suspendSender(waiter, handle); }
+            bool await_resume() const noexcept { return !waiter.closed; }
+        };
+        return SendAwaiter{this, Waiter{std::move(value)}};
+    }
+
+    // co_await receive() is std::nullopt once the channel is closed and empty
+    auto receive()
+    {
+        struct ReceiveAwaiter
+        {
+            Channel *channel{nullptr};
+            Waiter waiter{};
+
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> handle) { return channel->suspendReceiver(waiter, handle); }
+            std::optional<T> await_resume() { return std::move(waiter.value); }
+        };
+        return ReceiveAwaiter{this, Waiter{}};
+    }
+
+    void close()
+    {
+        std::deque<Waiter *> woken{};
+        {
+            const std::lock_guard lock{m_mutex};
+            m_closed = true;
+            woken.swap(m_receivers);
+            for (Waiter *sender : m_senders)
+            {
+                sender->closed = true;
+                woken.push_back(sender);
+            }
+            m_senders.clear();
+        }
+        for (Waiter *waiter : woken)
+        {
+            m_pool.post(waiter->handle);
+        }
+    }
+
+private:
+    // Lives in the awaiter, in the frame of the waiting coroutine
+    struct Waiter
+    {
+        std::optional<T> value{};
+        std::coroutine_handle<> handle{};
+        bool closed{false};
+    };
+
+    // False if the value could be handed over without waiting
+    bool suspendSender(Waiter &sender, std::coroutine_handle<> handle)
+    {
+        Waiter *receiver{nullptr};
+        {
+            const std::lock_guard lock{m_mutex};
+            if (m_closed)
+            {
+                sender.closed = true;
+                return false;
+            }
+            if (!m_receivers.empty())
+            {
+                // Only when nothing is queued, straight to the receiver
+                receiver = m_receivers.front();
+                m_receivers.pop_front();
+                receiver->value = std::move(sender.value);
+            }
+            else if (m_values.size() < m_capacity)
+            {
+                m_values.push_back(std::move(*sender.value));
+                return false;
+            }
+            else
+            {
+                sender.handle = handle;
+                m_senders.push_back(&sender);
+                return true;
+            }
+        }
+        m_pool.post(receiver->handle);
+        return false;
+    }
+
+    // False if a value was there without waiting
+    bool suspendReceiver(Waiter &receiver, std::coroutine_handle<> handle)
+    {
+        Waiter *sender{nullptr};
+        {
+            const std::lock_guard lock{m_mutex};
+            if (!m_values.empty())
+            {
+                receiver.value = std::move(m_values.front());
+                m_values.pop_front();
+            }
+            if (!m_senders.empty())
+            {
+                // A sender was waiting for room, or, with capacity 0, for
+                // a receiver
+                sender = m_senders.front();
+                m_senders.pop_front();
+                if (receiver.value)
+                {
+                    m_values.push_back(std::move(*sender->value));
+                }
+                else
+                {
+                    receiver.value = std::move(sender->value);
+                }
+            }
+            else if (!receiver.value && !m_closed)
+            {
+                receiver.handle = handle;
+                m_receivers.push_back(&receiver);
+                return true;
+            }
+        }
+        if (sender != nullptr)
+        {
+            m_pool.post(sender->handle);
+        }
+        return false;
+    }
+
+    ThreadPool &m_pool;
+    std::size_t m_capacity{0};
+    std::mutex m_mutex{};
+    std::deque<T> m_values{};
+    std::deque<Waiter *> m_senders{};
+    std::deque<Waiter *> m_receivers{};
+    bool m_closed{false};
+};
+
+#endif
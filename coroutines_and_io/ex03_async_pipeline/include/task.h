@@ -0,0 +1,191 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "thread_pool.h"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+template <typename T = void>
+class Task;
+
+// What every Task's promise has, whatever it returns
+class TaskPromiseBase
+{
+public:
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+
+    auto final_suspend() const noexcept
+    {
+        struct FinalAwaiter
+        {
+            std::coroutine_handle<> continuation{};
+
+            bool await_ready() const noexcept { return false; }
+
+            // Straight back into the awaiting coroutine, without growing
+            // the stack
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<>) const noexcept
+            {
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+        return FinalAwaiter{m_continuation};
+    }
+
+    void unhandled_exception() noexcept { m_exception = std::current_exception(); }
+
+    void setContinuation(std::coroutine_handle<> continuation) noexcept { m_continuation = continuation; }
+
+protected:
+    void rethrowIfFailed() const
+    {
+        if (m_exception)
+        {
+            std::rethrow_exception(m_exception);
+        }
+    }
+
+private:
+    std::coroutine_handle<> m_continuation{};
+    std::exception_ptr m_exception{};
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase
+{
+public:
+    Task<T> get_return_object() noexcept;
+
+    void return_value(T value) { m_value.emplace(std::move(value)); }
+
+    T result()
+    {
+        rethrowIfFailed();
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value{};
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void result() const { rethrowIfFailed(); }
+};
+
+/**
+ * A coroutine that runs when it is awaited, and returns a T (or throws)
+ * to the coroutine awaiting it:
+ *
+ *     Task<int> answer()
+ *     {
+ *         co_return 42;
+ *     }
+ *
+ *     Task<> caller()
+ *     {
+ *         const int value{co_await answer()};   // runs answer() to its end
+ *     }
+ *
+ * Awaiting a Task transfers control into it, and when it finishes it
+ * transfers control back, so neither costs stack space, and a Task that
+ * waits for something in between suspends the whole chain without
+ * blocking its thread. A Task that is never awaited never runs; use
+ * sync_wait_all to start Tasks from ordinary code.
+ */
+template <typename T>
+class Task
+{
+public:
+    using promise_type = TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle handle) : m_handle{handle} {}
+
+    Task(Task &&other) noexcept : m_handle{std::exchange(other.m_handle, {})} {}
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    ~Task() { destroy(); }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    // A default-constructed or moved-from Task has no coroutine to run:
+    // awaiting it throws std::logic_error
+    auto operator co_await() const
+    {
+        if (!m_handle)
+        {
+            throw std::logic_error{"Task: awaiting a task without a coroutine"};
+        }
+
+        struct TaskAwaiter
+        {
+            Handle handle{};
+
+            bool await_ready() const noexcept { return handle.done(); }
+
+            Handle await_suspend(std::coroutine_handle<> awaiting) const noexcept
+            {
+                handle.promise().setContinuation(awaiting);
+                return handle;
+            }
+
+            T await_resume() const { return handle.promise().result(); }
+        };
+        return TaskAwaiter{m_handle};
+    }
+
+private:
+    void destroy()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    Handle m_handle{};
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>{Task<T>::Handle::from_promise(*this)};
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>{Task<void>::Handle::from_promise(*this)};
+}
+
+/**
+ * Runs tasks concurrently on pool and blocks until all have finished.
+ * Rethrows the first exception a task threw, once all are done.
+ */
+void sync_wait_all(ThreadPool &pool, std::vector<Task<>> tasks);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of threads that resume coroutines:
+ *
+ *     Task<> work(ThreadPool &pool)
+ *     {
+ *         co_await pool.schedule();   // continues on one of the pool's threads
+ *         ...
+ *     }
+ *
+ * A coroutine that waits for something (a Channel, say) gives its thread
+ * back, so a few threads run any number of coroutines. Resumed coroutines
+ * are taken from one queue, first in first out. The destructor resumes
+ * what is still queued, then joins the threads.
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Resumes handle on one of the threads
+    void post(std::coroutine_handle<> handle);
+
+    auto schedule()
+    {
+        struct ScheduleAwaiter
+        {
+            ThreadPool *pool{nullptr};
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) const { pool->post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return ScheduleAwaiter{this};
+    }
+
+    unsigned size() const { return static_cast<unsigned>(m_threads.size()); }
+
+private:
+    void run();
+
+    std::mutex m_mutex{};
+    std::condition_variable m_wakeUp{};
+    std::deque<std::coroutine_handle<>> m_queue{};
+    bool m_stopping{false};
+    std::vector<std::jthread> m_threads{};
+};
+
+#endif
@@ -0,0 +1,374 @@
+/**
+ * An Asynchronous Pipeline with Coroutines
+ *
+ * getValueFromUser() in ch02_functions_and_scope/ex02_function_return_values
+ * and ex05_local_scope waits for std::cin, then computes. For one number
+ * that does not matter, but a program working through a large file the
+ * same way spends its time either waiting for the disk or computing,
+ * never both.
+ *
+ * Here the work is split into three stages, connected by bounded channels
+ * (channel.h): reading chunks of a file, parsing numbers out of them, and
+ * computing on the numbers. Each stage is a coroutine (task.h), and all of
+ * them run on one small thread pool (thread_pool.h), not one thread per
+ * stage. A stage waiting for its input or for room in its output suspends
+ * and gives its thread to another stage, so reading overlaps with parsing
+ * and computing, while the bounded channels keep the reader from running
+ * ahead by more than a few chunks (backpressure).
+ *
+ * The read stage blocks its thread in read(), so the pool has one thread
+ * more than there are CPUs. The example writes a file of numbers into bin/
+ * (make clean removes it) and processes it once with a sequential
+ * read-parse-compute loop and once with the pipeline, each with the file
+ * dropped from the page cache (cold) and right after (warm). With a single
+ * CPU, only the time spent waiting for the disk can overlap, so the
+ * pipeline gains little there.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="1024"   # a 1 GiB file
+ */
+
+#include "channel.h"
+#include "task.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+constexpr std::size_t chunkSize{std::size_t{1} << 20};
+constexpr std::size_t channelCapacity{4};
+
+using Chunk = std::vector<char>;
+using Batch = std::vector<std::uint64_t>;
+
+// The numbers of a text, one per line. Keeps its state between chunks,
+// so a number may be split across two
+class NumberParser
+{
+public:
+    void parse(std::span<const char> chunk, Batch &numbers)
+    {
+        for (const char c : chunk)
+        {
+            if (c >= '0' && c <= '9')
+            {
+                m_current = m_current * 10 + static_cast<std::uint64_t>(c - '0');
+            }
+            else if (c == '\n')
+            {
+                numbers.push_back(m_current);
+                m_current = 0;
+            }
+        }
+    }
+
+private:
+    std::uint64_t m_current{0};
+};
+
+// The work done per number, about as long as parsing it takes
+std::uint64_t compute(std::uint64_t x)
+{
+    for (int round{0}; round < 8; ++round)
+    {
+        x ^= x >> 31;
+        x *= 0x7fb5d329728ea185;
+        x ^= x >> 27;
+    }
+    return x;
+}
+
+struct Result
+{
+    std::uint64_t count{0};
+    std::uint64_t sum{0};
+
+    void add(const Batch &numbers)
+    {
+        count += numbers.size();
+        for (const auto number : numbers)
+        {
+            sum += compute(number);
+        }
+    }
+};
+
+class File
+{
+public:
+    explicit File(const std::filesystem::path &path) : m_fd{open(path.c_str(), O_RDONLY)}
+    {
+        if (m_fd < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "open " + path.string()};
+        }
+    }
+
+    ~File() { close(m_fd); }
+
+    File(const File &) = delete;
+    File &operator=(const File &) = delete;
+
+    // Up to chunkSize bytes, empty at the end of the file
+    Chunk read()
+    {
+        Chunk chunk(chunkSize);
+        ssize_t bytes{0};
+        do
+        {
+            bytes = ::read(m_fd, chunk.data(), chunk.size());
+        } while (bytes < 0 && errno == EINTR);
+        if (bytes < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "read"};
+        }
+        chunk.resize(static_cast<std::size_t>(bytes));
+        return chunk;
+    }
+
+private:
+    int m_fd{-1};
+};
+
+Result readOnly(const std::filesystem::path &path)
+{
+    File file{path};
+    Result result{};
+    for (auto chunk{file.read()}; !chunk.empty(); chunk = file.read())
+    {
+        result.count += chunk.size();
+    }
+    return result;
+}
+
+Result processSequentially(const std::filesystem::path &path)
+{
+    File file{path};
+    NumberParser parser{};
+    Result result{};
+    Batch numbers{};
+    for (auto chunk{file.read()}; !chunk.empty(); chunk = file.read())
+    {
+        numbers.clear();
+        parser.parse(chunk, numbers);
+        result.add(numbers);
+    }
+    return result;
+}
+
+// Closes a channel when a stage ends, also by an exception, so the stages
+// around it do not wait for it forever
+template <typename T>
+class ClosesOnExit
+{
+public:
+    explicit ClosesOnExit(Channel<T> &channel) : m_channel{channel} {}
+    ~ClosesOnExit() { m_channel.close(); }
+
+    ClosesOnExit(const ClosesOnExit &) = delete;
+    ClosesOnExit &operator=(const ClosesOnExit &) = delete;
+
+private:
+    Channel<T> &m_channel;
+};
+
+Task<> readStage(const std::filesystem::path &path, Channel<Chunk> &chunks)
+{
+    const ClosesOnExit closeChunks{chunks};
+    File file{path};
+    for (auto chunk{file.read()}; !chunk.empty(); chunk = file.read())
+    {
+        if (!co_await chunks.send(std::move(chunk)))
+        {
+            break;
+        }
+    }
+}
+
+Task<> parseStage(Channel<Chunk> &chunks, Channel<Batch> &batches)
+{
+    const ClosesOnExit closeChunks{chunks};
+    const ClosesOnExit closeBatches{batches};
+    NumberParser parser{};
+    while (const auto chunk{co_await chunks.receive()})
+    {
+        Batch numbers{};
+        numbers.reserve(chunk->size() / 4);
+        parser.parse(*chunk, numbers);
+        if (!co_await batches.send(std::move(numbers)))
+        {
+            break;
+        }
+    }
+}
+
+Task<> computeStage(Channel<Batch> &batches, Result &result)
+{
+    const ClosesOnExit closeBatches{batches};
+    while (const auto numbers{co_await batches.receive()})
+    {
+        result.add(*numbers);
+    }
+}
+
+Result processWithPipeline(ThreadPool &pool, const std::filesystem::path &path, unsigned computeTasks)
+{
+    Channel<Chunk> chunks{pool, channelCapacity};
+    Channel<Batch> batches{pool, channelCapacity};
+    std::vector<Result> partial(computeTasks);
+
+    std::vector<Task<>> stages{};
+    stages.push_back(readStage(path, chunks));
+    stages.push_back(parseStage(chunks, batches));
+    for (auto &result : partial)
+    {
+        stages.push_back(computeStage(batches, result));
+    }
+    sync_wait_all(pool, std::move(stages));
+
+    Result total{};
+    for (const auto &result : partial)
+    {
+        total.count += result.count;
+        total.sum += result.sum;
+    }
+    return total;
+}
+
+void writeNumbers(const std::filesystem::path &path, std::uint64_t bytes)
+{
+    std::ofstream file{path, std::ios::binary};
+    std::vector<char> buffer(chunkSize);
+    std::uint64_t written{0};
+    std::uint64_t number{1};
+    while (written < bytes)
+    {
+        std::size_t used{0};
+        while (used + 24 < buffer.size() && written + used < bytes)
+        {
+            number = number * 6364136223846793005 + 1442695040888963407;
+            const auto end{std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), number >> 44).ptr};
+            *end = '\n';
+            used = static_cast<std::size_t>(end + 1 - buffer.data());
+        }
+        file.write(buffer.data(), static_cast<std::streamsize>(used));
+        written += used;
+    }
+    if (!file)
+    {
+        throw std::runtime_error{"cannot write " + path.string()};
+    }
+}
+
+// Written pages are only dropped from the page cache once they are on disk
+void dropFromPageCache(const std::filesystem::path &path)
+{
+    const int fd{open(path.c_str(), O_RDONLY)};
+    if (fd < 0)
+    {
+        throw std::system_error{errno, std::generic_category(), "open " + path.string()};
+    }
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+template <typename Function>
+double secondsFor(Function function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        const auto bytes = std::uint64_t{argc > 1 ? std::stoull(argv[1]) : 256} << 20;
+        const auto path = std::filesystem::path{argv[0]}.parent_path() / "numbers.data";
+        // Kept from an earlier run if it has the size asked for
+        if (!std::filesystem::exists(path) || std::filesystem::file_size(path) >> 20 != bytes >> 20)
+        {
+            std::cout << "Writing " << path.string() << "..." << std::endl;
+            writeNumbers(path, bytes);
+        }
+        const auto fileSize = std::filesystem::file_size(path);
+
+        // One thread more than CPUs, for the read stage blocking in read()
+        const auto cpus = std::max(std::thread::hardware_concurrency(), 1U);
+        const auto computeTasks = std::max(cpus - 1, 1U);
+        ThreadPool pool{cpus + 1};
+        std::cout << "Processing " << fileSize / (1024 * 1024) << " MiB with " << pool.size()
+                  << " pool threads: 1 read, 1 parse and " << computeTasks << " compute tasks, channels of "
+                  << channelCapacity << " chunks of " << chunkSize / 1024 << " KiB" << std::endl
+                  << std::endl;
+
+        std::cout << std::setw(14) << "" << std::setw(12) << "cold" << std::setw(12) << "warm" << std::endl
+                  << std::setw(14) << "" << std::setw(12) << "MB/s" << std::setw(12) << "MB/s" << std::endl;
+        // Reading alone is the most the pipeline can reach, however many
+        // CPUs it has
+        const auto methods = std::vector<std::pair<std::string, std::function<Result()>>>{
+            {"read only", [&] { return readOnly(path); }},
+            {"sequential", [&] { return processSequentially(path); }},
+            {"pipeline", [&] { return processWithPipeline(pool, path, computeTasks); }},
+        };
+        Result expected{};
+        for (const auto &[name, process] : methods)
+        {
+            std::cout << std::setw(14) << std::left << name << std::right;
+            for (const bool cold : {true, false})
+            {
+                if (cold)
+                {
+                    dropFromPageCache(path);
+                }
+                Result result{};
+                const auto seconds = secondsFor([&] { result = process(); });
+                std::cout << std::setw(12) << std::fixed << std::setprecision(0)
+                          << static_cast<double>(fileSize) / seconds / 1e6 << std::flush;
+
+                if (name == "sequential" && cold)
+                {
+                    expected = result;
+                }
+                else if (name != "read only" && (result.count != expected.count || result.sum != expected.sum))
+                {
+                    std::cout << std::endl << "Error: the results differ" << std::endl;
+                    return 1;
+                }
+            }
+            std::cout << std::endl;
+        }
+        std::cout << std::endl << expected.count << " numbers" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
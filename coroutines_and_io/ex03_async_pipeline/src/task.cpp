@@ -0,0 +1,54 @@
+#include "task.h"
+
+#include <cstddef>
+#include <latch>
+
+namespace
+{
+    // Starts running as soon as it is called and frees itself at the end
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() const noexcept { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+    };
+
+    Detached runOnPool(ThreadPool &pool, Task<> task, std::exception_ptr &error, std::latch &finished)
+    {
+        co_await pool.schedule();
+        try
+        {
+            // Destroyed before the waiting thread can go on
+            const Task<> running{std::move(task)};
+            co_await running;
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        finished.count_down();
+    }
+}
+
+void sync_wait_all(ThreadPool &pool, std::vector<Task<>> tasks)
+{
+    std::vector<std::exception_ptr> errors(tasks.size());
+    std::latch finished{static_cast<std::ptrdiff_t>(tasks.size())};
+    for (std::size_t i{0}; i < tasks.size(); ++i)
+    {
+        runOnPool(pool, std::move(tasks[i]), errors[i], finished);
+    }
+    finished.wait();
+    for (const auto &error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
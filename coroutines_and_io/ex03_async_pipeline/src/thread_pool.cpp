@@ -0,0 +1,52 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    threads = std::max(threads, 1U);
+    m_threads.reserve(threads);
+    for (unsigned i{0}; i < threads; ++i)
+    {
+        m_threads.emplace_back([this] { run(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        const std::lock_guard lock{m_mutex};
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+    // The jthreads join as they are destroyed, before the queue is
+    m_threads.clear();
+}
+
+void ThreadPool::post(std::coroutine_handle<> handle)
+{
+    {
+        const std::lock_guard lock{m_mutex};
+        m_queue.push_back(handle);
+    }
+    m_wakeUp.notify_one();
+}
+
+void ThreadPool::run()
+{
+    while (true)
+    {
+        std::coroutine_handle<> handle{};
+        {
+            std::unique_lock lock{m_mutex};
+            m_wakeUp.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty())
+            {
+                return;
+            }
+            handle = m_queue.front();
+            m_queue.pop_front();
+        }
+        handle.resume();
+    }
+}
@@ -0,0 +1,138 @@
+#ifndef FIELD_TOKENIZER_H
+#define FIELD_TOKENIZER_H
+
+#include "cpu_dispatch.h"
+
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/**
+ * Sets bit i of masks[b] if byte 64 * b + i of data is whitespace (space,
+ * \t, \n, \v, \f or \r), for blocks blocks of 64 bytes.
+ */
+using WhitespaceMasks = void (*)(const char *data, std::size_t blocks, std::uint64_t *masks);
+
+// The best kernel for this CPU (AVX-512BW, AVX2 or scalar)
+void whitespace_masks(const char *data, std::size_t blocks, std::uint64_t *masks);
+
+// All kernels, e.g. to compare them
+const CpuDispatch<void(const char *, std::size_t, std::uint64_t *)> &whitespace_masks_dispatch();
+
+/**
+ * Splits a text into the fields between whitespace:
+ *
+ *     FieldSplitter fields{"  12 apple\t-3.5\n"};
+ *     std::string_view field{};
+ *     while (fields.next(field))
+ *     {
+ *         ...   // "12", "apple", "-3.5"
+ *     }
+ *
+ * Instead of looking at one character at a time, the splitter classifies
+ * 64 bytes at once with SIMD compares into a bitmask with a bit set for
+ * every whitespace byte. Shifting the mask by one and XORing it with
+ * itself leaves a bit only where whitespace turns into a field or back,
+ * and countr_zero (tzcnt) finds those bits one after the other, so a line
+ * of hundreds of fields costs a few instructions per field, not per byte.
+ * Masks are made for 4 KiB at a time, so short texts pay for little more
+ * than they are long.
+ *
+ * The fields point into the text, which must outlive them.
+ */
+class FieldSplitter
+{
+public:
+    explicit FieldSplitter(std::string_view text, WhitespaceMasks classify = whitespace_masks)
+        : m_text{text}, m_classify{classify}
+    {
+    }
+
+    // False at the end of the text
+    bool next(std::string_view &field)
+    {
+        // Transitions alternate between the first byte of a field and the
+        // first byte after it
+        std::size_t start{0};
+        if (!nextTransition(start))
+        {
+            return false;
+        }
+        std::size_t end{m_text.size()};
+        nextTransition(end);
+        field = std::string_view{m_text.data() + start, end - start};
+        return true;
+    }
+
+private:
+    static constexpr std::size_t windowBlocks{64};
+
+    bool nextTransition(std::size_t &position)
+    {
+        while (m_transitions == 0)
+        {
+            if (!nextBlock())
+            {
+                return false;
+            }
+        }
+        position = m_blockOffset + static_cast<std::size_t>(std::countr_zero(m_transitions));
+        m_transitions &= m_transitions - 1;
+        return true;
+    }
+
+    bool nextBlock();
+    void classifyWindow();
+
+    std::string_view m_text{};
+    WhitespaceMasks m_classify{nullptr};
+    // Filled as needed, not initialized
+    std::uint64_t m_masks[windowBlocks];
+    std::size_t m_windowOffset{0};
+    std::size_t m_windowBlocks{0};
+    std::size_t m_block{0};
+    std::size_t m_blockOffset{0};
+    std::uint64_t m_transitions{0};
+    // Whether the byte before the current block is whitespace; the text
+    // starts after whitespace
+    std::uint64_t m_previousWhitespace{1};
+};
+
+/**
+ * Appends the whitespace-separated fields of text to values, each read as a
+ * T (an integer or floating-point type) with std::from_chars:
+ *
+ *     std::vector<int> values{};
+ *     parse_fields("3 4", values);   // {3, 4}
+ *
+ * Throws std::invalid_argument for a field that is not a T and
+ * std::out_of_range for one that does not fit.
+ */
+template <typename T>
+void parse_fields(std::string_view text, std::vector<T> &values)
+{
+    FieldSplitter fields{text};
+    std::string_view field{};
+    while (fields.next(field))
+    {
+        T value{};
+        const auto [end, error]{std::from_chars(field.data(), field.data() + field.size(), value)};
+        if (error == std::errc::result_out_of_range)
+        {
+            throw std::out_of_range{"parse_fields: " + std::string{field} + " is out of range"};
+        }
+        if (error != std::errc{} || end != field.data() + field.size())
+        {
+            throw std::invalid_argument{"parse_fields: " + std::string{field} + " is not a number"};
+        }
+        values.push_back(value);
+    }
+}
+
+#endif
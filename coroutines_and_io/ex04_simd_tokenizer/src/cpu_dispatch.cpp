@@ -0,0 +1,146 @@
+#include "cpu_dispatch.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include <cpuid.h>
+
+namespace
+{
+    struct Registers
+    {
+        unsigned eax{0};
+        unsigned ebx{0};
+        unsigned ecx{0};
+        unsigned edx{0};
+    };
+
+    // Returns all zeros if the leaf is not supported
+    Registers cpuid(unsigned leaf, unsigned subleaf = 0)
+    {
+        Registers r{};
+        __get_cpuid_count(leaf, subleaf, &r.eax, &r.ebx, &r.ecx, &r.edx);
+        return r;
+    }
+
+    // Register state the operating system saves and restores (XCR0)
+    std::uint64_t enabledRegisterState()
+    {
+        std::uint32_t low{};
+        std::uint32_t high{};
+        __asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return (std::uint64_t{high} << 32) | low;
+    }
+
+    CpuFeatures detect()
+    {
+        CpuFeatures cpu{};
+        const Registers leaf1{cpuid(1)};
+        const Registers leaf7{cpuid(7)};
+
+        cpu.sse2 = leaf1.edx & bit_SSE2;
+        cpu.sse42 = leaf1.ecx & bit_SSE4_2;
+        cpu.popcnt = leaf1.ecx & bit_POPCNT;
+        cpu.bmi1 = leaf7.ebx & bit_BMI;
+        cpu.bmi2 = leaf7.ebx & bit_BMI2;
+
+        /**
+         * A CPU can support AVX while the operating system does not save the
+         * upper halves of the registers, in which case using them would
+         * corrupt other programs' state. XCR0 bits 1-2 cover the 256-bit YMM
+         * registers, bits 5-7 the AVX-512 mask and 512-bit ZMM registers.
+         */
+        const bool osSavesYmm{(leaf1.ecx & bit_OSXSAVE) && (enabledRegisterState() & 0x06) == 0x06};
+        const bool osSavesZmm{osSavesYmm && (enabledRegisterState() & 0xe0) == 0xe0};
+
+        cpu.avx = osSavesYmm && (leaf1.ecx & bit_AVX);
+        cpu.avx2 = osSavesYmm && (leaf7.ebx & bit_AVX2);
+        cpu.fma = osSavesYmm && (leaf1.ecx & bit_FMA);
+        cpu.avx512f = osSavesZmm && (leaf7.ebx & bit_AVX512F);
+        cpu.avx512bw = osSavesZmm && (leaf7.ebx & bit_AVX512BW);
+        cpu.avx512vl = osSavesZmm && (leaf7.ebx & bit_AVX512VL);
+        return cpu;
+    }
+
+    std::vector<std::pair<std::string_view, std::string_view>> &dispatches()
+    {
+        static std::vector<std::pair<std::string_view, std::string_view>> registered{};
+        return registered;
+    }
+}
+
+const CpuFeatures &cpu_features()
+{
+    static const CpuFeatures features{detect()};
+    return features;
+}
+
+std::string cpu_brand()
+{
+    // Leaves 0x80000002-0x80000004 hold 48 characters of brand string
+    if (cpuid(0x80000000).eax < 0x80000004)
+    {
+        return "unknown CPU";
+    }
+    std::array<char, 49> brand{};
+    for (unsigned i{0}; i < 3; ++i)
+    {
+        const Registers r{cpuid(0x80000002 + i)};
+        std::memcpy(brand.data() + 16 * i, &r, 16);
+    }
+    std::string name{brand.data()};
+    name.erase(0, name.find_first_not_of(' '));
+    return name;
+}
+
+void register_dispatch(std::string_view function, std::string_view kernel)
+{
+    dispatches().emplace_back(function, kernel);
+}
+
+std::string_view forced_kernel_name()
+{
+    static const char *const forced{std::getenv("CPU_DISPATCH")};
+    return forced == nullptr ? std::string_view{} : std::string_view{forced};
+}
+
+void print_cpu_report(std::ostream &out)
+{
+    const CpuFeatures &cpu{cpu_features()};
+    const std::array<std::pair<const char *, bool>, 11> features{{{"SSE2", cpu.sse2},
+                                                                  {"SSE4.2", cpu.sse42},
+                                                                  {"POPCNT", cpu.popcnt},
+                                                                  {"AVX", cpu.avx},
+                                                                  {"AVX2", cpu.avx2},
+                                                                  {"FMA", cpu.fma},
+                                                                  {"BMI1", cpu.bmi1},
+                                                                  {"BMI2", cpu.bmi2},
+                                                                  {"AVX-512F", cpu.avx512f},
+                                                                  {"AVX-512BW", cpu.avx512bw},
+                                                                  {"AVX-512VL", cpu.avx512vl}}};
+
+    out << "Your CPU is " << cpu_brand() << '\n';
+    out << "Supported:    ";
+    for (const auto &[name, supported] : features)
+    {
+        out << (supported ? name : "") << (supported ? " " : "");
+    }
+    out << "\nUnsupported:  ";
+    for (const auto &[name, supported] : features)
+    {
+        out << (supported ? "" : name) << (supported ? "" : " ");
+    }
+    out << '\n';
+
+    if (!forced_kernel_name().empty())
+    {
+        out << "CPU_DISPATCH=" << forced_kernel_name() << " forces that kernel where possible\n";
+    }
+    for (const auto &[function, kernel] : dispatches())
+    {
+        out << "    " << function << " -> " << kernel << '\n';
+    }
+}
@@ -0,0 +1,114 @@
+#include "field_tokenizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <immintrin.h>
+
+namespace
+{
+    bool isWhitespace(char c)
+    {
+        return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+    }
+
+    void whitespaceMasksScalar(const char *data, std::size_t blocks, std::uint64_t *masks)
+    {
+        for (std::size_t block{0}; block < blocks; ++block)
+        {
+            std::uint64_t mask{0};
+            for (std::size_t i{0}; i < 64; ++i)
+            {
+                mask |= static_cast<std::uint64_t>(isWhitespace(data[64 * block + i])) << i;
+            }
+            masks[block] = mask;
+        }
+    }
+
+    // \t to \r are 9 to 13: a byte is in that range if subtracting 9 leaves
+    // at most 4, compared unsigned
+    __attribute__((target("avx2"))) std::uint32_t whitespace32(const char *data)
+    {
+        const __m256i bytes{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data))};
+        const __m256i spaces{_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '))};
+        const __m256i offsets{_mm256_sub_epi8(bytes, _mm256_set1_epi8('\t'))};
+        const __m256i controls{_mm256_cmpeq_epi8(_mm256_min_epu8(offsets, _mm256_set1_epi8('\r' - '\t')), offsets)};
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(spaces, controls)));
+    }
+
+    __attribute__((target("avx2"))) void whitespaceMasksAvx2(const char *data, std::size_t blocks,
+                                                            std::uint64_t *masks)
+    {
+        for (std::size_t block{0}; block < blocks; ++block)
+        {
+            const char *bytes{data + 64 * block};
+            masks[block] = whitespace32(bytes) | static_cast<std::uint64_t>(whitespace32(bytes + 32)) << 32;
+        }
+    }
+
+    // AVX-512BW compares straight into a 64-bit mask register
+    __attribute__((target("avx512f,avx512bw"))) void whitespaceMasksAvx512(const char *data, std::size_t blocks,
+                                                                          std::uint64_t *masks)
+    {
+        for (std::size_t block{0}; block < blocks; ++block)
+        {
+            const __m512i bytes{_mm512_loadu_si512(data + 64 * block)};
+            const __m512i offsets{_mm512_sub_epi8(bytes, _mm512_set1_epi8('\t'))};
+            masks[block] = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(' ')) |
+                           _mm512_cmple_epu8_mask(offsets, _mm512_set1_epi8('\r' - '\t'));
+        }
+    }
+
+    const CpuDispatch<void(const char *, std::size_t, std::uint64_t *)> whitespaceMasks{
+        "whitespace_masks",
+        {{"avx512", [](const CpuFeatures &cpu) { return cpu.avx512f && cpu.avx512bw; }, whitespaceMasksAvx512},
+         {"avx2", [](const CpuFeatures &cpu) { return cpu.avx2; }, whitespaceMasksAvx2},
+         {"scalar", nullptr, whitespaceMasksScalar}}};
+}
+
+void whitespace_masks(const char *data, std::size_t blocks, std::uint64_t *masks)
+{
+    whitespaceMasks(data, blocks, masks);
+}
+
+const CpuDispatch<void(const char *, std::size_t, std::uint64_t *)> &whitespace_masks_dispatch()
+{
+    return whitespaceMasks;
+}
+
+bool FieldSplitter::nextBlock()
+{
+    if (m_block == m_windowBlocks)
+    {
+        m_windowOffset += m_windowBlocks * 64;
+        if (m_windowOffset >= m_text.size())
+        {
+            return false;
+        }
+        classifyWindow();
+    }
+    const std::uint64_t whitespace{m_masks[m_block]};
+    m_blockOffset = m_windowOffset + m_block * 64;
+    ++m_block;
+    m_transitions = whitespace ^ (whitespace << 1 | m_previousWhitespace);
+    m_previousWhitespace = whitespace >> 63;
+    return true;
+}
+
+void FieldSplitter::classifyWindow()
+{
+    const std::size_t remaining{m_text.size() - m_windowOffset};
+    const std::size_t fullBlocks{std::min(remaining / 64, windowBlocks)};
+    m_classify(m_text.data() + m_windowOffset, fullBlocks, m_masks);
+    m_windowBlocks = fullBlocks;
+    m_block = 0;
+    if (fullBlocks < windowBlocks && remaining % 64 != 0)
+    {
+        // The end of the text, padded with whitespace, so that a field
+        // running up to the end ends there
+        char last[64];
+        std::memset(last, ' ', sizeof(last));
+        std::memcpy(last, m_text.data() + m_windowOffset + fullBlocks * 64, remaining % 64);
+        m_classify(last, 1, m_masks + fullBlocks);
+        ++m_windowBlocks;
+    }
+}
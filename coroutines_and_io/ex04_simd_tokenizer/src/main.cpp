@@ -0,0 +1,388 @@
+/**
+ * Splitting Lines into Fields with SIMD
+ *
+ * ch01_basic_examples/ex05_input_and_output reads "two numbers separated
+ * by a space" with std::cin >> a >> b. Each >> skips whitespace and reads
+ * a number one character at a time, through the locale machinery of the
+ * stream. For two numbers that is nothing, but input lines with hundreds
+ * of fields, gigabytes of them, spend most of their time there.
+ *
+ * FieldSplitter (field_tokenizer.h) looks at 64 bytes at a time: one SIMD
+ * compare per class of whitespace turns them into a 64-bit mask with a
+ * bit per whitespace byte. Where a field starts or ends, the mask changes
+ * from one bit to the next, so mask ^ (mask << 1) has exactly those
+ * positions set, and countr_zero (tzcnt) walks them, a few instructions
+ * per field instead of a branch per byte. The fields are string_views
+ * into the line, and parse_fields reads them as numbers with
+ * std::from_chars, without a stream or locale. The kernel is picked for
+ * the CPU at run time (cpu_dispatch.h, as in cpu_and_arithmetic).
+ *
+ * The example parses a few lines, checks every kernel against a plain
+ * loop on random text, then splits and parses generated lines of hundreds
+ * of numbers with std::istringstream, strtok, a plain loop and
+ * FieldSplitter, and reports GB/s.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="200000"   # lines of 200 fields
+ *     > CPU_DISPATCH=scalar make run
+ */
+
+#include "cpu_dispatch.h"
+#include "field_tokenizer.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr std::size_t fieldsPerLine{200};
+
+struct Fields
+{
+    std::uint64_t count{0};
+    std::uint64_t bytes{0};
+
+    void add(std::string_view field)
+    {
+        ++count;
+        bytes += field.size();
+    }
+
+    bool operator==(const Fields &) const = default;
+};
+
+bool isWhitespace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// The reference: one character at a time
+template <typename Visit>
+void splitByLoop(std::string_view text, Visit visit)
+{
+    std::size_t i{0};
+    while (true)
+    {
+        while (i < text.size() && isWhitespace(text[i]))
+        {
+            ++i;
+        }
+        if (i == text.size())
+        {
+            return;
+        }
+        const std::size_t start{i};
+        while (i < text.size() && !isWhitespace(text[i]))
+        {
+            ++i;
+        }
+        visit(text.substr(start, i - start));
+    }
+}
+
+template <typename Visit>
+void forEachLine(std::string_view text, Visit visit)
+{
+    while (!text.empty())
+    {
+        const auto end{std::min(text.find('\n'), text.size())};
+        visit(text.substr(0, end));
+        text.remove_prefix(std::min(end + 1, text.size()));
+    }
+}
+
+// Checks FieldSplitter with every kernel against splitByLoop, on texts of
+// every length around the 64-byte blocks and 4 KiB windows
+bool checkKernels()
+{
+    auto rng = std::mt19937{7};
+    constexpr char alphabet[]{' ', ' ', '\t', '\n', '\r', 'a', '7', '-', '\x0e', '\x08'};
+    for (std::size_t length{0}; length < 4500; length += length < 300 ? 1 : 61)
+    {
+        std::string text(length, ' ');
+        for (auto &c : text)
+        {
+            c = alphabet[rng() % sizeof(alphabet)];
+        }
+        std::vector<std::string_view> expected{};
+        splitByLoop(text, [&](std::string_view field) { expected.push_back(field); });
+
+        for (const auto &kernel : whitespace_masks_dispatch().kernels())
+        {
+            if (!kernel.runs_here())
+            {
+                continue;
+            }
+            std::vector<std::string_view> found{};
+            FieldSplitter fields{text, kernel.function};
+            std::string_view field{};
+            while (fields.next(field))
+            {
+                found.push_back(field);
+            }
+            if (found != expected)
+            {
+                std::cout << "Error: the " << kernel.name << " kernel splits " << length << " bytes wrongly"
+                          << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::string generateLines(std::size_t lines)
+{
+    auto rng = std::mt19937_64{42};
+    std::string text{};
+    text.reserve(lines * fieldsPerLine * 8);
+    for (std::size_t line{0}; line < lines; ++line)
+    {
+        for (std::size_t field{0}; field < fieldsPerLine; ++field)
+        {
+            // Mostly one space, sometimes a tab or several
+            const auto separator{rng() % 8};
+            text += separator == 0 ? "\t" : separator == 1 ? "   " : " ";
+            const auto digits{1 + rng() % 9};
+            auto value{static_cast<std::int64_t>(rng() % 1000000000)};
+            for (std::uint64_t d{digits}; d < 9; ++d)
+            {
+                value /= 10;
+            }
+            text += std::to_string(rng() % 4 == 0 ? -value : value);
+        }
+        text += '\n';
+    }
+    return text;
+}
+
+template <typename Function>
+double gigabytesPerSecond(std::size_t bytes, Function function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    auto end = std::chrono::high_resolution_clock::now();
+    return static_cast<double>(bytes) / std::chrono::duration<double>(end - start).count() / 1e9;
+}
+
+void printRow(std::string_view name, double speed)
+{
+    std::cout << "  " << std::setw(42) << std::left << name << std::right << std::setw(8) << std::fixed
+              << std::setprecision(2) << speed << " GB/s" << std::endl;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        // Which SIMD kernels this CPU runs
+        print_cpu_report(std::cout);
+        std::cout << std::endl;
+
+        std::vector<int> pair{};
+        parse_fields("3 4", pair);
+        std::cout << "\"3 4\": " << pair[0] << " + " << pair[1] << " = " << pair[0] + pair[1] << std::endl;
+        std::vector<double> reals{};
+        parse_fields("  -2.5\t1e3 0.125\n", reals);
+        std::cout << "\"  -2.5\\t1e3 0.125\\n\":";
+        for (const auto real : reals)
+        {
+            std::cout << ' ' << real;
+        }
+        std::cout << std::endl;
+        try
+        {
+            std::vector<int> bad{};
+            parse_fields("12 1x", bad);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            std::cout << "\"12 1x\": " << e.what() << std::endl;
+        }
+        std::cout << std::endl;
+
+        if (!checkKernels())
+        {
+            return 1;
+        }
+
+        const auto lines = std::size_t{argc > 1 ? std::stoul(argv[1]) : 50000};
+        const auto text = generateLines(lines);
+        std::cout << "Splitting " << lines << " lines of " << fieldsPerLine << " numbers, "
+                  << text.size() / (1024 * 1024) << " MiB" << std::endl;
+
+        // strtok writes into the text, and needs every line to end in '\0'
+        std::string terminated{text};
+        for (auto &c : terminated)
+        {
+            c = c == '\n' ? '\0' : c;
+        }
+        const auto forEachTerminatedLine = [&](auto visit)
+        {
+            for (std::size_t start{0}; start < terminated.size();)
+            {
+                // Before strtok puts more '\0's into it
+                const std::size_t length{std::strlen(&terminated[start])};
+                visit(&terminated[start]);
+                start += length + 1;
+            }
+        };
+        constexpr const char *separators{" \t\v\f\r"};
+
+        Fields expected{};
+        const auto check = [&expected](std::string_view name, const Fields &fields)
+        {
+            if (!(fields == expected))
+            {
+                throw std::logic_error{std::string{name} + " found other fields"};
+            }
+        };
+
+        printRow("loop, a byte at a time", gigabytesPerSecond(text.size(), [&]
+                                                              { forEachLine(text, [&](std::string_view line)
+                                                                            { splitByLoop(line, [&](std::string_view field)
+                                                                                          { expected.add(field); }); }); }));
+
+        Fields found{};
+        printRow("std::istringstream >> std::string",
+                 gigabytesPerSecond(text.size(),
+                                    [&]
+                                    {
+                                        forEachLine(text,
+                                                    [&](std::string_view line)
+                                                    {
+                                                        std::istringstream stream{std::string{line}};
+                                                        std::string field{};
+                                                        while (stream >> field)
+                                                        {
+                                                            found.add(field);
+                                                        }
+                                                    });
+                                    }));
+        check("std::istringstream", found);
+
+        found = {};
+        std::string copy{terminated};
+        printRow("strtok", gigabytesPerSecond(text.size(),
+                                              [&]
+                                              {
+                                                  forEachTerminatedLine(
+                                                      [&](char *line)
+                                                      {
+                                                          for (char *field{std::strtok(line, separators)};
+                                                               field != nullptr;
+                                                               field = std::strtok(nullptr, separators))
+                                                          {
+                                                              found.add(field);
+                                                          }
+                                                      });
+                                              }));
+        check("strtok", found);
+        terminated = copy;
+
+        for (const auto &kernel : whitespace_masks_dispatch().kernels())
+        {
+            if (!kernel.runs_here())
+            {
+                continue;
+            }
+            found = {};
+            const auto speed{gigabytesPerSecond(text.size(),
+                                                [&]
+                                                {
+                                                    forEachLine(text,
+                                                                [&](std::string_view line)
+                                                                {
+                                                                    FieldSplitter fields{line, kernel.function};
+                                                                    std::string_view field{};
+                                                                    while (fields.next(field))
+                                                                    {
+                                                                        found.add(field);
+                                                                    }
+                                                                });
+                                                })};
+            printRow("FieldSplitter, " + std::string{kernel.name}, speed);
+            check("FieldSplitter", found);
+        }
+
+        std::cout << std::endl << "Parsing the numbers" << std::endl;
+        std::int64_t expectedSum{0};
+        printRow("std::istringstream >> std::int64_t",
+                 gigabytesPerSecond(text.size(),
+                                    [&]
+                                    {
+                                        forEachLine(text,
+                                                    [&](std::string_view line)
+                                                    {
+                                                        std::istringstream stream{std::string{line}};
+                                                        std::int64_t value{0};
+                                                        while (stream >> value)
+                                                        {
+                                                            expectedSum += value;
+                                                        }
+                                                    });
+                                    }));
+
+        std::int64_t sum{0};
+        printRow("strtok and strtoll", gigabytesPerSecond(text.size(),
+                                                          [&]
+                                                          {
+                                                              forEachTerminatedLine(
+                                                                  [&](char *line)
+                                                                  {
+                                                                      for (char *field{std::strtok(line, separators)};
+                                                                           field != nullptr;
+                                                                           field = std::strtok(nullptr, separators))
+                                                                      {
+                                                                          sum += std::strtoll(field, nullptr, 10);
+                                                                      }
+                                                                  });
+                                                          }));
+        if (sum != expectedSum)
+        {
+            std::cout << "Error: strtoll found another sum" << std::endl;
+            return 1;
+        }
+
+        sum = 0;
+        std::vector<std::int64_t> values{};
+        printRow("parse_fields (FieldSplitter, from_chars)", gigabytesPerSecond(text.size(),
+                                                                       [&]
+                                                                       {
+                                                                           forEachLine(text,
+                                                                                       [&](std::string_view line)
+                                                                                       {
+                                                                                           values.clear();
+                                                                                           parse_fields(line, values);
+                                                                                           for (const auto value : values)
+                                                                                           {
+                                                                                               sum += value;
+                                                                                           }
+                                                                                       });
+                                                                       }));
+        if (sum != expectedSum)
+        {
+            std::cout << "Error: parse_fields found another sum" << std::endl;
+            return 1;
+        }
+        std::cout << std::endl << expected.count << " fields, their sum is " << sum << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
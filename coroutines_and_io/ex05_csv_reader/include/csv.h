@@ -0,0 +1,130 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// From the narrowest to the widest: every integer is also a real, and
+// every field is text
+enum class ColumnType
+{
+    integer,   // std::int64_t
+    real,      // double, an empty field is NaN
+    text,
+};
+
+/**
+ * The values of one column of a table, stored by type: integers and reals
+ * in one vector each, text as one block of characters plus the offset
+ * where each value starts. A column of a million numbers is then a single
+ * array of a million numbers, ready for a loop, not a million strings.
+ */
+class Column
+{
+public:
+    Column(std::string name, ColumnType type) : m_name{std::move(name)}, m_type{type} {}
+
+    const std::string &name() const { return m_name; }
+    ColumnType type() const { return m_type; }
+    std::size_t size() const;
+
+    // Only the one that matches type() has values
+    std::span<const std::int64_t> integers() const { return m_integers; }
+    std::span<const double> reals() const { return m_reals; }
+    std::string_view text(std::size_t row) const
+    {
+        return {m_characters.data() + m_offsets[row], m_offsets[row + 1] - m_offsets[row]};
+    }
+
+    void push_back(std::int64_t value) { m_integers.push_back(value); }
+    void push_back(double value) { m_reals.push_back(value); }
+    void push_back(std::string_view value)
+    {
+        m_characters.insert(m_characters.end(), value.begin(), value.end());
+        m_offsets.push_back(m_characters.size());
+    }
+
+    // Room for rows values, so that filling the column does not copy it
+    void reserve(std::size_t rows);
+
+    // Appends the rows of other, a column of the same type
+    void append(const Column &other);
+
+private:
+    std::string m_name{};
+    ColumnType m_type{ColumnType::text};
+    std::vector<std::int64_t> m_integers{};
+    std::vector<double> m_reals{};
+    std::vector<char> m_characters{};
+    std::vector<std::size_t> m_offsets{0};
+};
+
+struct Table
+{
+    std::vector<Column> columns{};
+
+    std::size_t rows() const { return columns.empty() ? 0 : columns.front().size(); }
+
+    // Throws std::out_of_range if there is no such column
+    const Column &column(std::string_view name) const;
+};
+
+struct CsvOptions
+{
+    char delimiter{','};
+    // Chunks parsed at the same time; 0 for one per CPU
+    unsigned threads{0};
+    // One per column; if empty, guessed (see read_csv)
+    std::vector<ColumnType> types{};
+};
+
+/**
+ * Reads CSV text (RFC 4180) whose first row names the columns:
+ *
+ *     const Table table{read_csv_file("sales.csv", CsvOptions{})};
+ *     for (const double price : table.column("price").reals()) { ... }
+ *
+ * Fields may be quoted, with "" for a quote inside, and then contain the
+ * delimiter and line breaks. Lines may end in \n or \r\n, and blank lines
+ * are skipped. A line with nothing but "" is a row with one empty field.
+ *
+ * The reader finds quotes, delimiters and newlines 64 bytes at a time with
+ * SIMD compares (AVX-512BW, AVX2 or scalar, picked at run time). A prefix
+ * XOR of the quote mask (bit i is the XOR of bits 0 to i) marks what lies
+ * between quotes, so delimiters and newlines in quoted fields drop out of
+ * the mask with one AND NOT, and the remaining bits are walked with
+ * countr_zero. For several threads, the text is cut into chunks at
+ * newlines outside quotes: one pass counts the quotes in each part in
+ * parallel, which says whether a part starts inside a quoted field, then
+ * every chunk is parsed into its own columns, which are appended in order.
+ *
+ * Without options.types, each column's type is guessed from its field in
+ * the first row of values: integer, real if it is a number or empty, text
+ * otherwise, and text for all columns if there is no such row. A later
+ * value that does not fit widens its column, integer to real or either to
+ * text, like pandas.read_csv does, and only the widened columns are parsed
+ * a second time. Given types are never widened.
+ *
+ * Throws std::runtime_error for a malformed row (too few or many fields, an
+ * unterminated quote, a value not of its given column type) with the byte
+ * offset where it is, and std::system_error if the file cannot be read.
+ */
+Table read_csv(std::string_view text, const CsvOptions &options);
+Table read_csv_file(const std::filesystem::path &path, const CsvOptions &options);
+
+/**
+ * Writes table as CSV with a header row. Text is quoted where needed, reals
+ * are written in their shortest form that reads back as the same double,
+ * and NaN as an empty field. In a table of one column an empty field is
+ * written as "", since an empty line would be read as a blank line.
+ */
+void write_csv(std::ostream &out, const Table &table, char delimiter = ',');
+
+#endif
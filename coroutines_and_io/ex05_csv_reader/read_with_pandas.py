@@ -0,0 +1,31 @@
+"""Times pandas.read_csv on the table the C++ example wrote.
+
+Usage:
+
+    > poetry run python read_with_pandas.py bin/sales.csv
+"""
+
+import os
+import sys
+import time
+
+
+def main() -> int:
+    try:
+        import pandas as pd
+    except ImportError:
+        print("  pandas.read_csv: pandas is not installed (poetry install)")
+        return 0
+
+    path = sys.argv[1]
+    start = time.perf_counter()
+    frame = pd.read_csv(path)
+    seconds = time.perf_counter() - start
+
+    speed = os.path.getsize(path) / seconds / 1e9
+    print(f"  {'pandas.read_csv':<28}{speed:8.2f} GB/s ({len(frame)} rows)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
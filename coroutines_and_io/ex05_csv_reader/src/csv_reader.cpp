@@ -0,0 +1,814 @@
+#include "csv.h"
+
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <exception>
+#include <immintrin.h>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // Chunks smaller than this are not worth a thread
+    constexpr std::size_t minChunkSize{std::size_t{1} << 20};
+
+    // Bit i is set if byte i of a 64-byte block is a quote, the delimiter
+    // or a newline
+    struct BlockMasks
+    {
+        std::uint64_t quotes{0};
+        std::uint64_t delimiters{0};
+        std::uint64_t newlines{0};
+    };
+
+    void csvMasksScalar(const char *data, std::size_t blocks, char delimiter, BlockMasks *masks)
+    {
+        for (std::size_t block{0}; block < blocks; ++block)
+        {
+            BlockMasks result{};
+            for (std::size_t i{0}; i < 64; ++i)
+            {
+                const char c{data[64 * block + i]};
+                result.quotes |= static_cast<std::uint64_t>(c == '"') << i;
+                result.delimiters |= static_cast<std::uint64_t>(c == delimiter) << i;
+                result.newlines |= static_cast<std::uint64_t>(c == '\n') << i;
+            }
+            masks[block] = result;
+        }
+    }
+
+    __attribute__((target("avx2"))) std::uint64_t equalMask(__m256i low, __m256i high, __m256i character)
+    {
+        const auto lowBits{static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, character)))};
+        const auto highBits{static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, character)))};
+        return lowBits | static_cast<std::uint64_t>(highBits) << 32;
+    }
+
+    __attribute__((target("avx2"))) void csvMasksAvx2(const char *data, std::size_t blocks, char delimiter,
+                                                     BlockMasks *masks)
+    {
+        const __m256i quote{_mm256_set1_epi8('"')};
+        const __m256i separator{_mm256_set1_epi8(delimiter)};
+        const __m256i newline{_mm256_set1_epi8('\n')};
+        for (std::size_t block{0}; block < blocks; ++block)
+        {
+            const __m256i low{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 64 * block))};
+            const __m256i high{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 64 * block + 32))};
+            masks[block] = BlockMasks{equalMask(low, high, quote), equalMask(low, high, separator),
+                                      equalMask(low, high, newline)};
+        }
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) void csvMasksAvx512(const char *data, std::size_t blocks,
+                                                                   char delimiter, BlockMasks *masks)
+    {
+        const __m512i quote{_mm512_set1_epi8('"')};
+        const __m512i separator{_mm512_set1_epi8(delimiter)};
+        const __m512i newline{_mm512_set1_epi8('\n')};
+        for (std::size_t block{0}; block < blocks; ++block)
+        {
+            const __m512i bytes{_mm512_loadu_si512(data + 64 * block)};
+            masks[block] = BlockMasks{_mm512_cmpeq_epi8_mask(bytes, quote), _mm512_cmpeq_epi8_mask(bytes, separator),
+                                      _mm512_cmpeq_epi8_mask(bytes, newline)};
+        }
+    }
+
+    const CpuDispatch<void(const char *, std::size_t, char, BlockMasks *)> csvMasks{
+        "csv_masks",
+        {{"avx512", [](const CpuFeatures &cpu) { return cpu.avx512f && cpu.avx512bw; }, csvMasksAvx512},
+         {"avx2", [](const CpuFeatures &cpu) { return cpu.avx2; }, csvMasksAvx2},
+         {"scalar", nullptr, csvMasksScalar}}};
+
+    // Bit i is the XOR of bits 0 to i: set between an opening quote and
+    // the closing one. Six shifts, or one carry-less multiply (pclmulqdq)
+    // by all ones, which is not worth a dispatch of its own
+    std::uint64_t prefixXor(std::uint64_t bits)
+    {
+        for (int shift{1}; shift < 64; shift *= 2)
+        {
+            bits ^= bits << shift;
+        }
+        return bits;
+    }
+
+    // The masks of text[begin, end), classified 4 KiB at a time. A last,
+    // partial block is copied and padded, with the padding bits cleared
+    class MaskReader
+    {
+    public:
+        MaskReader(std::string_view text, std::size_t begin, std::size_t end, char delimiter)
+            : m_text{text}, m_next{begin}, m_end{end}, m_delimiter{delimiter}
+        {
+        }
+
+        // False at the end; offset is where the block starts in the text
+        bool next(BlockMasks &masks, std::size_t &offset)
+        {
+            if (m_block == m_blocks)
+            {
+                if (m_next >= m_end)
+                {
+                    return false;
+                }
+                classify();
+            }
+            masks = m_masks[m_block];
+            offset = m_windowStart + 64 * m_block;
+            ++m_block;
+            return true;
+        }
+
+    private:
+        static constexpr std::size_t windowBlocks{64};
+
+        void classify()
+        {
+            const std::size_t remaining{m_end - m_next};
+            const std::size_t fullBlocks{std::min(remaining / 64, windowBlocks)};
+            csvMasks(m_text.data() + m_next, fullBlocks, m_delimiter, m_masks);
+            m_windowStart = m_next;
+            m_blocks = fullBlocks;
+            m_block = 0;
+            m_next += fullBlocks * 64;
+            if (fullBlocks < windowBlocks && m_next < m_end)
+            {
+                const std::size_t length{m_end - m_next};
+                char last[64]{};
+                std::copy_n(m_text.data() + m_next, length, last);
+                csvMasks(last, 1, m_delimiter, m_masks + fullBlocks);
+                const std::uint64_t valid{(std::uint64_t{1} << length) - 1};
+                m_masks[fullBlocks].quotes &= valid;
+                m_masks[fullBlocks].delimiters &= valid;
+                m_masks[fullBlocks].newlines &= valid;
+                ++m_blocks;
+                m_next = m_end;
+            }
+        }
+
+        std::string_view m_text{};
+        std::size_t m_next{0};
+        std::size_t m_end{0};
+        char m_delimiter{','};
+        // Filled as needed, not initialized
+        BlockMasks m_masks[windowBlocks];
+        std::size_t m_windowStart{0};
+        std::size_t m_blocks{0};
+        std::size_t m_block{0};
+    };
+
+    [[noreturn]] void fail(const std::string &what, std::size_t offset)
+    {
+        throw std::runtime_error{"read_csv: " + what + " at byte " + std::to_string(offset)};
+    }
+
+    template <typename T>
+    bool fromChars(std::string_view field, T &value)
+    {
+        const char *end{field.data() + field.size()};
+        const auto result{std::from_chars(field.data(), end, value)};
+        return result.ec == std::errc{} && result.ptr == end;
+    }
+
+    // Up to 18 digits cannot overflow; longer numbers go to std::from_chars
+    bool parseInteger(std::string_view field, std::int64_t &value)
+    {
+        const bool negative{!field.empty() && field.front() == '-'};
+        const std::size_t digits{field.size() - (negative ? 1 : 0)};
+        if (digits == 0 || digits > 18)
+        {
+            return fromChars(field, value);
+        }
+        std::int64_t magnitude{0};
+        for (std::size_t i{negative ? 1U : 0U}; i < field.size(); ++i)
+        {
+            const auto digit{static_cast<unsigned char>(field[i] - '0')};
+            if (digit > 9)
+            {
+                return false;
+            }
+            magnitude = magnitude * 10 + digit;
+        }
+        value = negative ? -magnitude : magnitude;
+        return true;
+    }
+
+    /**
+     * Clinger's fast path: a decimal with at most 15 significant digits and
+     * at most 22 decimals is a mantissa and a power of ten that are both
+     * exact doubles, and dividing them rounds correctly. Exponents, longer
+     * numbers and anything else go to std::from_chars.
+     */
+    bool parseReal(std::string_view field, double &value)
+    {
+        static constexpr double powersOfTen[]{1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                              1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                              1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        const bool negative{!field.empty() && field.front() == '-'};
+        std::uint64_t mantissa{0};
+        std::size_t digits{0};
+        std::size_t decimals{0};
+        bool point{false};
+        for (std::size_t i{negative ? 1U : 0U}; i < field.size(); ++i)
+        {
+            const auto digit{static_cast<unsigned char>(field[i] - '0')};
+            if (digit <= 9)
+            {
+                mantissa = mantissa * 10 + digit;
+                ++digits;
+                decimals += point ? 1 : 0;
+            }
+            else if (field[i] == '.' && !point)
+            {
+                point = true;
+            }
+            else
+            {
+                return fromChars(field, value);
+            }
+        }
+        if (digits == 0 || digits > 15 || decimals >= std::size(powersOfTen))
+        {
+            return fromChars(field, value);
+        }
+        value = static_cast<double>(mantissa) / powersOfTen[decimals];
+        value = negative ? -value : value;
+        return true;
+    }
+
+    // The value of a field without its quotes, with "" turned into "
+    std::string_view unquote(std::string_view field, std::string &scratch)
+    {
+        if (field.size() < 2 || field.front() != '"' || field.back() != '"')
+        {
+            return field;
+        }
+        field = field.substr(1, field.size() - 2);
+        if (field.find('"') == std::string_view::npos)
+        {
+            return field;
+        }
+        scratch.clear();
+        for (std::size_t i{0}; i < field.size(); ++i)
+        {
+            scratch += field[i];
+            if (field[i] == '"' && i + 1 < field.size() && field[i + 1] == '"')
+            {
+                ++i;
+            }
+        }
+        return scratch;
+    }
+
+    // The fields of the row at offset, and the offset after it, one byte
+    // at a time; only for the header and the first row
+    std::size_t splitRow(std::string_view text, std::size_t offset, char delimiter, std::vector<std::string> &fields)
+    {
+        fields.clear();
+        bool insideQuotes{false};
+        std::size_t fieldStart{offset};
+        std::string scratch{};
+        for (std::size_t i{offset}; i <= text.size(); ++i)
+        {
+            const bool atEnd{i == text.size()};
+            if (!atEnd && text[i] == '"')
+            {
+                insideQuotes = !insideQuotes;
+            }
+            else if (atEnd || (!insideQuotes && (text[i] == delimiter || text[i] == '\n')))
+            {
+                auto field{text.substr(fieldStart, i - fieldStart)};
+                const bool endsRow{atEnd || text[i] == '\n'};
+                if (endsRow && !field.empty() && field.back() == '\r')
+                {
+                    field.remove_suffix(1);
+                }
+                fields.emplace_back(unquote(field, scratch));
+                fieldStart = i + 1;
+                if (endsRow)
+                {
+                    return std::min(i + 1, text.size());
+                }
+            }
+        }
+        return text.size();
+    }
+
+    // Nothing but the line break, not even "" for one empty field
+    bool isBlankLine(std::string_view line)
+    {
+        return line == "\n" || line == "\r\n";
+    }
+
+    ColumnType guessType(std::string_view field)
+    {
+        std::int64_t integer{0};
+        if (parseInteger(field, integer))
+        {
+            return ColumnType::integer;
+        }
+        double real{0};
+        return field.empty() || parseReal(field, real) ? ColumnType::real : ColumnType::text;
+    }
+
+    /**
+     * Parses whole rows into columns of its own, only those marked in
+     * parsed. With widen, a value that does not fit its column's type does
+     * not fail: the parser stops filling that column and only finds the
+     * widest type its values need, so that it can be parsed again.
+     */
+    class ChunkParser
+    {
+    public:
+        ChunkParser(std::string_view text, char delimiter, const std::vector<Column> &layout,
+                    const std::vector<bool> &parsed, bool widen)
+            : m_text{text}, m_delimiter{delimiter}, m_parsed{parsed}, m_widen{widen}
+        {
+            for (const auto &column : layout)
+            {
+                m_columns.emplace_back(column.name(), column.type());
+                m_widest.push_back(column.type());
+            }
+        }
+
+        // begin must be the start of a row; rowSize is a guess at the
+        // average size of one
+        void parse(std::size_t begin, std::size_t end, std::size_t rowSize)
+        {
+            // A little too much only reserves address space, which costs
+            // nothing until it is used
+            for (std::size_t column{0}; column < m_columns.size(); ++column)
+            {
+                if (m_parsed[column])
+                {
+                    m_columns[column].reserve((end - begin) / rowSize * 5 / 4);
+                }
+            }
+            MaskReader reader{m_text, begin, end, m_delimiter};
+            // All ones while inside a quoted field
+            std::uint64_t insideQuotes{0};
+            std::size_t fieldStart{begin};
+            BlockMasks masks{};
+            std::size_t offset{0};
+            while (reader.next(masks, offset))
+            {
+                const std::uint64_t inside{prefixXor(masks.quotes) ^ insideQuotes};
+                insideQuotes = static_cast<std::uint64_t>(static_cast<std::int64_t>(inside) >> 63);
+                std::uint64_t structural{(masks.delimiters | masks.newlines) & ~inside};
+                const std::uint64_t rowEnds{masks.newlines & ~inside};
+                while (structural != 0)
+                {
+                    const auto bit{std::countr_zero(structural)};
+                    const std::size_t position{offset + static_cast<std::size_t>(bit)};
+                    addField(fieldStart, position, ((rowEnds >> bit) & 1) != 0);
+                    fieldStart = position + 1;
+                    structural &= structural - 1;
+                }
+            }
+            if (insideQuotes != 0)
+            {
+                fail("unterminated quote", fieldStart);
+            }
+            // The last row, without a newline at the end
+            if (fieldStart < end || m_column > 0)
+            {
+                addField(fieldStart, end, true);
+            }
+        }
+
+        std::vector<Column> &columns() { return m_columns; }
+
+        // The type each column needs; wider than its type if it was widened
+        const std::vector<ColumnType> &widest() const { return m_widest; }
+
+    private:
+        void addField(std::size_t start, std::size_t end, bool endsRow)
+        {
+            std::string_view field{m_text.data() + start, end - start};
+            if (endsRow && !field.empty() && field.back() == '\r')
+            {
+                field.remove_suffix(1);
+            }
+            if (endsRow && m_column == 0 && field.empty())
+            {
+                // A blank line
+                return;
+            }
+            if (m_column == m_columns.size())
+            {
+                fail("more than " + std::to_string(m_columns.size()) + " fields", start);
+            }
+            store(m_column, unquote(field, m_scratch), start);
+            ++m_column;
+            if (endsRow)
+            {
+                if (m_column != m_columns.size())
+                {
+                    fail("only " + std::to_string(m_column) + " of " + std::to_string(m_columns.size()) + " fields",
+                         start);
+                }
+                m_column = 0;
+            }
+        }
+
+        void store(std::size_t index, std::string_view field, std::size_t offset)
+        {
+            Column &column{m_columns[index]};
+            if (!m_parsed[index])
+            {
+                return;
+            }
+            if (m_widest[index] != column.type())
+            {
+                widen(index, field);
+                return;
+            }
+            switch (column.type())
+            {
+            case ColumnType::integer:
+            {
+                std::int64_t value{0};
+                if (!parseInteger(field, value))
+                {
+                    if (!m_widen)
+                    {
+                        fail(std::string{field} + " is not an integer", offset);
+                    }
+                    widen(index, field);
+                    return;
+                }
+                column.push_back(value);
+                break;
+            }
+            case ColumnType::real:
+            {
+                double value{std::numeric_limits<double>::quiet_NaN()};
+                if (!field.empty() && !parseReal(field, value))
+                {
+                    if (!m_widen)
+                    {
+                        fail(std::string{field} + " is not a number", offset);
+                    }
+                    widen(index, field);
+                    return;
+                }
+                column.push_back(value);
+                break;
+            }
+            case ColumnType::text:
+                column.push_back(field);
+                break;
+            }
+        }
+
+        void widen(std::size_t index, std::string_view field)
+        {
+            if (m_widest[index] != ColumnType::text)
+            {
+                m_widest[index] = std::max(m_widest[index], guessType(field));
+            }
+        }
+
+        std::string_view m_text{};
+        char m_delimiter{','};
+        std::vector<bool> m_parsed{};
+        bool m_widen{false};
+        std::vector<Column> m_columns{};
+        std::vector<ColumnType> m_widest{};
+        std::size_t m_column{0};
+        std::string m_scratch{};
+    };
+
+    std::size_t countQuotes(std::string_view text, std::size_t begin, std::size_t end, char delimiter)
+    {
+        MaskReader reader{text, begin, end, delimiter};
+        BlockMasks masks{};
+        std::size_t offset{0};
+        std::size_t count{0};
+        while (reader.next(masks, offset))
+        {
+            count += static_cast<std::size_t>(std::popcount(masks.quotes));
+        }
+        return count;
+    }
+
+    // Where the first row starting at or after offset starts, given whether
+    // offset is inside a quoted field
+    std::size_t nextRowStart(std::string_view text, std::size_t offset, bool insideQuotes)
+    {
+        for (std::size_t i{offset}; i < text.size(); ++i)
+        {
+            if (text[i] == '"')
+            {
+                insideQuotes = !insideQuotes;
+            }
+            else if (text[i] == '\n' && !insideQuotes)
+            {
+                return i + 1;
+            }
+        }
+        return text.size();
+    }
+
+    // Runs work(0) to work(count - 1) on a thread each, and rethrows the
+    // first exception once all are done
+    template <typename Work>
+    void runInParallel(std::size_t count, Work work)
+    {
+        std::vector<std::exception_ptr> errors(count);
+        {
+            std::vector<std::jthread> threads{};
+            for (std::size_t i{0}; i < count; ++i)
+            {
+                threads.emplace_back(
+                    [&, i]
+                    {
+                        try
+                        {
+                            work(i);
+                        }
+                        catch (...)
+                        {
+                            errors[i] = std::current_exception();
+                        }
+                    });
+            }
+        }
+        for (const auto &error : errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    // Parses the rows between each two rowStarts, on a thread each if
+    // there are several
+    std::vector<ChunkParser> parseChunks(std::string_view text, char delimiter,
+                                         const std::vector<std::size_t> &rowStarts, std::size_t rowSize,
+                                         const std::vector<Column> &layout, const std::vector<bool> &parsed,
+                                         bool widen)
+    {
+        const std::size_t chunks{rowStarts.size() - 1};
+        std::vector<ChunkParser> parsers{};
+        for (std::size_t i{0}; i < chunks; ++i)
+        {
+            parsers.emplace_back(text, delimiter, layout, parsed, widen);
+        }
+        if (chunks == 1)
+        {
+            parsers[0].parse(rowStarts[0], rowStarts[1], rowSize);
+        }
+        else
+        {
+            runInParallel(chunks, [&](std::size_t i) { parsers[i].parse(rowStarts[i], rowStarts[i + 1], rowSize); });
+        }
+        return parsers;
+    }
+
+    // Puts the columns marked in parsed together from the chunks, in order
+    void joinChunks(std::vector<ChunkParser> &parsers, const std::vector<bool> &parsed, std::vector<Column> &columns)
+    {
+        for (std::size_t column{0}; column < columns.size(); ++column)
+        {
+            if (!parsed[column])
+            {
+                continue;
+            }
+            columns[column] = std::move(parsers.front().columns()[column]);
+            for (std::size_t chunk{1}; chunk < parsers.size(); ++chunk)
+            {
+                columns[column].append(parsers[chunk].columns()[column]);
+            }
+        }
+    }
+
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::filesystem::path &path)
+        {
+            const int fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+            if (fd < 0)
+            {
+                throw std::system_error{errno, std::generic_category(), "open " + path.string()};
+            }
+            struct stat status{};
+            if (fstat(fd, &status) != 0)
+            {
+                const int error{errno};
+                close(fd);
+                throw std::system_error{error, std::generic_category(), "fstat " + path.string()};
+            }
+            m_size = static_cast<std::size_t>(status.st_size);
+            if (m_size > 0)
+            {
+                m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            const int error{errno};
+            close(fd);
+            if (m_data == MAP_FAILED)
+            {
+                throw std::system_error{error, std::generic_category(), "mmap " + path.string()};
+            }
+            if (m_data != nullptr)
+            {
+                madvise(m_data, m_size, MADV_SEQUENTIAL);
+            }
+        }
+
+        ~MappedFile()
+        {
+            if (m_data != nullptr)
+            {
+                munmap(m_data, m_size);
+            }
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        std::string_view text() const { return {static_cast<const char *>(m_data), m_size}; }
+
+    private:
+        void *m_data{nullptr};
+        std::size_t m_size{0};
+    };
+}
+
+std::size_t Column::size() const
+{
+    switch (m_type)
+    {
+    case ColumnType::integer:
+        return m_integers.size();
+    case ColumnType::real:
+        return m_reals.size();
+    case ColumnType::text:
+        break;
+    }
+    return m_offsets.size() - 1;
+}
+
+void Column::reserve(std::size_t rows)
+{
+    switch (m_type)
+    {
+    case ColumnType::integer:
+        m_integers.reserve(rows);
+        break;
+    case ColumnType::real:
+        m_reals.reserve(rows);
+        break;
+    case ColumnType::text:
+        m_offsets.reserve(rows + 1);
+        break;
+    }
+}
+
+void Column::append(const Column &other)
+{
+    m_integers.insert(m_integers.end(), other.m_integers.begin(), other.m_integers.end());
+    m_reals.insert(m_reals.end(), other.m_reals.begin(), other.m_reals.end());
+    const std::size_t base{m_characters.size()};
+    m_characters.insert(m_characters.end(), other.m_characters.begin(), other.m_characters.end());
+    m_offsets.reserve(m_offsets.size() + other.m_offsets.size() - 1);
+    for (auto offset{other.m_offsets.begin() + 1}; offset != other.m_offsets.end(); ++offset)
+    {
+        m_offsets.push_back(base + *offset);
+    }
+}
+
+const Column &Table::column(std::string_view name) const
+{
+    for (const auto &column : columns)
+    {
+        if (column.name() == name)
+        {
+            return column;
+        }
+    }
+    throw std::out_of_range{"no column " + std::string{name}};
+}
+
+Table read_csv(std::string_view text, const CsvOptions &options)
+{
+    Table table{};
+    if (text.empty())
+    {
+        return table;
+    }
+
+    std::vector<std::string> names{};
+    const std::size_t dataStart{splitRow(text, 0, options.delimiter, names)};
+    // The first row that is not a blank line tells the types
+    std::vector<std::string> firstRow{};
+    std::size_t firstRowStart{dataStart};
+    std::size_t firstRowEnd{dataStart};
+    while (firstRowStart < text.size())
+    {
+        firstRowEnd = splitRow(text, firstRowStart, options.delimiter, firstRow);
+        if (!isBlankLine(text.substr(firstRowStart, firstRowEnd - firstRowStart)))
+        {
+            break;
+        }
+        firstRowStart = firstRowEnd;
+    }
+    const std::size_t rowSize{std::max<std::size_t>(firstRowEnd - firstRowStart, 1)};
+    std::vector<ColumnType> types{options.types};
+    if (types.empty())
+    {
+        // Without a row of values, such as the table write_csv writes for
+        // no rows, nothing says the types
+        if (firstRowStart == text.size())
+        {
+            types.assign(names.size(), ColumnType::text);
+        }
+        else
+        {
+            for (const auto &field : firstRow)
+            {
+                types.push_back(guessType(field));
+            }
+        }
+    }
+    if (types.size() != names.size())
+    {
+        fail(std::to_string(names.size()) + " column names but " + std::to_string(types.size()) + " types", 0);
+    }
+    for (std::size_t i{0}; i < names.size(); ++i)
+    {
+        table.columns.emplace_back(names[i], types[i]);
+    }
+
+    const std::size_t dataSize{text.size() - dataStart};
+    const std::size_t threads{std::clamp<std::size_t>(
+        options.threads != 0 ? options.threads : std::thread::hardware_concurrency(), 1,
+        std::max<std::size_t>(dataSize / minChunkSize, 1))};
+    std::vector<std::size_t> rowStarts{dataStart, text.size()};
+    if (threads > 1)
+    {
+        // Cut at rough positions, then move each cut to the next row start,
+        // which depends on the quotes before it
+        std::vector<std::size_t> cuts(threads + 1);
+        for (std::size_t i{0}; i <= threads; ++i)
+        {
+            cuts[i] = dataStart + dataSize * i / threads;
+        }
+        std::vector<std::size_t> quotes(threads);
+        runInParallel(threads, [&](std::size_t i)
+                      { quotes[i] = countQuotes(text, cuts[i], cuts[i + 1], options.delimiter); });
+        rowStarts.assign(threads + 1, text.size());
+        rowStarts[0] = dataStart;
+        std::size_t quotesBefore{0};
+        for (std::size_t i{1}; i < threads; ++i)
+        {
+            quotesBefore += quotes[i - 1];
+            rowStarts[i] = std::max(nextRowStart(text, cuts[i], quotesBefore % 2 == 1), rowStarts[i - 1]);
+        }
+    }
+
+    // Guessed types may be too narrow for later rows: those columns are
+    // parsed again, with the widest type any chunk found for them
+    const std::vector<bool> all(names.size(), true);
+    auto parsers{parseChunks(text, options.delimiter, rowStarts, rowSize, table.columns, all, options.types.empty())};
+    for (const auto &parser : parsers)
+    {
+        for (std::size_t i{0}; i < names.size(); ++i)
+        {
+            types[i] = std::max(types[i], parser.widest()[i]);
+        }
+    }
+    std::vector<bool> fitting(names.size(), true);
+    std::vector<bool> narrow(names.size(), false);
+    std::vector<Column> wider{};
+    for (std::size_t i{0}; i < names.size(); ++i)
+    {
+        narrow[i] = types[i] != table.columns[i].type();
+        fitting[i] = !narrow[i];
+        wider.emplace_back(names[i], types[i]);
+    }
+    joinChunks(parsers, fitting, table.columns);
+    if (std::ranges::find(narrow, true) != narrow.end())
+    {
+        parsers = parseChunks(text, options.delimiter, rowStarts, rowSize, wider, narrow, false);
+        joinChunks(parsers, narrow, table.columns);
+    }
+    return table;
+}
+
+Table read_csv_file(const std::filesystem::path &path, const CsvOptions &options)
+{
+    const MappedFile file{path};
+    return read_csv(file.text(), options);
+}
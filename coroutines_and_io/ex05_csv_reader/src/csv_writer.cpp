@@ -0,0 +1,91 @@
+#include "csv.h"
+
+#include <charconv>
+#include <cmath>
+#include <string>
+
+namespace
+{
+    constexpr std::size_t flushSize{std::size_t{1} << 20};
+
+    void appendText(std::string &out, std::string_view text, char delimiter)
+    {
+        const char special[]{'"', '\n', '\r', delimiter};
+        if (text.find_first_of(std::string_view{special, sizeof(special)}) == std::string_view::npos)
+        {
+            out += text;
+            return;
+        }
+        out += '"';
+        for (const char c : text)
+        {
+            out += c;
+            if (c == '"')
+            {
+                out += '"';
+            }
+        }
+        out += '"';
+    }
+
+    template <typename T>
+    void appendNumber(std::string &out, T value)
+    {
+        char digits[32];
+        const auto end{std::to_chars(digits, digits + sizeof(digits), value).ptr};
+        out.append(digits, end);
+    }
+}
+
+void write_csv(std::ostream &out, const Table &table, char delimiter)
+{
+    std::string buffer{};
+    buffer.reserve(flushSize + 4096);
+    for (std::size_t column{0}; column < table.columns.size(); ++column)
+    {
+        buffer += column == 0 ? "" : std::string{delimiter};
+        appendText(buffer, table.columns[column].name(), delimiter);
+    }
+    buffer += '\n';
+
+    for (std::size_t row{0}; row < table.rows(); ++row)
+    {
+        const std::size_t rowStart{buffer.size()};
+        for (std::size_t column{0}; column < table.columns.size(); ++column)
+        {
+            if (column > 0)
+            {
+                buffer += delimiter;
+            }
+            const Column &values{table.columns[column]};
+            switch (values.type())
+            {
+            case ColumnType::integer:
+                appendNumber(buffer, values.integers()[row]);
+                break;
+            case ColumnType::real:
+                if (!std::isnan(values.reals()[row]))
+                {
+                    appendNumber(buffer, values.reals()[row]);
+                }
+                break;
+            case ColumnType::text:
+                appendText(buffer, values.text(row), delimiter);
+                break;
+            }
+            // A row of one empty field would be a blank line, which
+            // readers skip
+            if (table.columns.size() == 1 && buffer.size() == rowStart)
+            {
+                buffer += "\"\"";
+            }
+        }
+        buffer += '\n';
+        if (buffer.size() >= flushSize)
+        {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
@@ -0,0 +1,383 @@
+/**
+ * Reading and Writing CSV Quickly
+ *
+ * The Python side of this repository (pyproject.toml) has pandas for
+ * looking at the data the examples produce, and CSV is what both sides
+ * read. read_csv and write_csv (csv.h) give the C++ side typed columns:
+ * every column is one vector of int64, double or text, like a pandas
+ * DataFrame, not a vector of strings per row.
+ *
+ * The reader classifies 64 bytes at a time with SIMD compares into masks
+ * of quotes, delimiters and newlines, removes the delimiters and newlines
+ * inside quoted fields with a prefix XOR of the quote mask, and walks the
+ * rest with countr_zero. Large files are cut into chunks at row starts and
+ * parsed on several threads.
+ *
+ * The example reads a small CSV with quotes and line breaks in fields,
+ * checks that what write_csv writes reads back identically with one thread
+ * and with several, then writes a generated table into bin/ (make clean
+ * removes it) and reads it with a std::getline-based parser, with read_csv
+ * on one thread and on several, and with pandas.read_csv if Python and
+ * pandas are installed (read_with_pandas.py, run it with poetry run).
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="50000000"   # rows, about 2 GB
+ */
+
+#include "cpu_dispatch.h"
+#include "csv.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+constexpr const char *sample{"id,product,price,quantity\n"
+                             "1,apple,0.5,10\r\n"
+                             "2,\"melon, large\",3.25,1\n"
+                             "\n"
+                             "3,\"12\"\" pipe\",,4\n"
+                             "4,\"two\nlines\",1e3,-2"};
+
+// What every reader must agree on
+struct Summary
+{
+    std::size_t rows{0};
+    std::int64_t ids{0};
+    std::int64_t quantities{0};
+    double prices{0};
+    std::size_t discounts{0};
+    std::size_t productBytes{0};
+
+    bool operator==(const Summary &) const = default;
+};
+
+Summary summarize(const Table &table)
+{
+    Summary summary{};
+    summary.rows = table.rows();
+    for (const auto id : table.column("id").integers())
+    {
+        summary.ids += id;
+    }
+    for (const auto quantity : table.column("quantity").integers())
+    {
+        summary.quantities += quantity;
+    }
+    for (const auto price : table.column("price").reals())
+    {
+        summary.prices += price;
+    }
+    for (const auto discount : table.column("discount").reals())
+    {
+        summary.discounts += std::isnan(discount) ? 0 : 1;
+    }
+    const auto &products{table.column("product")};
+    for (std::size_t row{0}; row < products.size(); ++row)
+    {
+        summary.productBytes += products.text(row).size();
+    }
+    return summary;
+}
+
+// Sales records; some products need quotes, some discounts are missing.
+// With lineBreaks, some products span lines
+Table generateSales(std::size_t rows, bool lineBreaks)
+{
+    constexpr const char *products[]{"apple", "pear", "melon, large", "12\" pipe", "bolt", "\"quoted\"", "nut"};
+    auto rng = std::mt19937_64{42};
+    Table table{};
+    table.columns.emplace_back("id", ColumnType::integer);
+    table.columns.emplace_back("product", ColumnType::text);
+    table.columns.emplace_back("price", ColumnType::real);
+    table.columns.emplace_back("quantity", ColumnType::integer);
+    table.columns.emplace_back("discount", ColumnType::real);
+    for (std::size_t row{0}; row < rows; ++row)
+    {
+        table.columns[0].push_back(static_cast<std::int64_t>(row));
+        std::string product{products[rng() % std::size(products)]};
+        if (lineBreaks && rng() % 16 == 0)
+        {
+            product += "\nsecond line";
+        }
+        table.columns[1].push_back(std::string_view{product});
+        table.columns[2].push_back(static_cast<double>(rng() % 100000) / 100);
+        table.columns[3].push_back(static_cast<std::int64_t>(rng() % 200) - 20);
+        table.columns[4].push_back(rng() % 10 == 0 ? std::nan("") : static_cast<double>(rng() % 50) / 100);
+    }
+    return table;
+}
+
+bool sameTables(const Table &a, const Table &b)
+{
+    if (a.columns.size() != b.columns.size() || a.rows() != b.rows())
+    {
+        return false;
+    }
+    for (std::size_t column{0}; column < a.columns.size(); ++column)
+    {
+        const Column &x{a.columns[column]};
+        const Column &y{b.columns[column]};
+        if (x.name() != y.name() || x.type() != y.type() || !std::ranges::equal(x.integers(), y.integers()))
+        {
+            return false;
+        }
+        // NaN == NaN here
+        if (!std::ranges::equal(x.reals(), y.reals(), [](double p, double q)
+                                { return p == q || (std::isnan(p) && std::isnan(q)); }))
+        {
+            return false;
+        }
+        for (std::size_t row{0}; x.type() == ColumnType::text && row < x.size(); ++row)
+        {
+            if (x.text(row) != y.text(row))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The usual way: a line at a time, a character at a time, std::stod
+Table readWithGetline(const std::filesystem::path &path)
+{
+    std::ifstream file{path};
+    std::string line{};
+    std::getline(file, line);
+    Table table{};
+    table.columns.emplace_back("id", ColumnType::integer);
+    table.columns.emplace_back("product", ColumnType::text);
+    table.columns.emplace_back("price", ColumnType::real);
+    table.columns.emplace_back("quantity", ColumnType::integer);
+    table.columns.emplace_back("discount", ColumnType::real);
+
+    std::vector<std::string> fields{};
+    while (std::getline(file, line))
+    {
+        fields.assign(1, "");
+        bool insideQuotes{false};
+        for (std::size_t i{0}; i < line.size(); ++i)
+        {
+            if (line[i] == '"')
+            {
+                if (insideQuotes && i + 1 < line.size() && line[i + 1] == '"')
+                {
+                    fields.back() += '"';
+                    ++i;
+                }
+                else
+                {
+                    insideQuotes = !insideQuotes;
+                }
+            }
+            else if (line[i] == ',' && !insideQuotes)
+            {
+                fields.emplace_back();
+            }
+            else
+            {
+                fields.back() += line[i];
+            }
+        }
+        table.columns[0].push_back(static_cast<std::int64_t>(std::stoll(fields.at(0))));
+        table.columns[1].push_back(std::string_view{fields.at(1)});
+        table.columns[2].push_back(std::stod(fields.at(2)));
+        table.columns[3].push_back(static_cast<std::int64_t>(std::stoll(fields.at(3))));
+        table.columns[4].push_back(fields.at(4).empty() ? std::nan("") : std::stod(fields[4]));
+    }
+    return table;
+}
+
+// Runs python3 script csv in a child process, without a shell that would
+// split or interpret the paths, and returns whether it succeeded
+bool runPython(const std::filesystem::path &script, const std::filesystem::path &csv)
+{
+    std::cout.flush();
+    const pid_t child = fork();
+    if (child == 0)
+    {
+        execlp("python3", "python3", script.c_str(), csv.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    int status{0};
+    return child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+template <typename Function>
+double secondsFor(Function function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+void printRow(const std::string &name, std::size_t bytes, double seconds)
+{
+    std::cout << "  " << std::setw(28) << std::left << name << std::right << std::setw(8) << std::fixed
+              << std::setprecision(2) << static_cast<double>(bytes) / seconds / 1e9 << " GB/s" << std::endl;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        // Which SIMD kernels this CPU runs
+        print_cpu_report(std::cout);
+        std::cout << std::endl;
+
+        const Table small{read_csv(sample, CsvOptions{})};
+        std::cout << "Read " << small.rows() << " rows of " << small.columns.size()
+                  << " columns, written back:" << std::endl;
+        write_csv(std::cout, small);
+        std::cout << std::endl << std::endl;
+
+        // Big enough for several chunks, with quoted line breaks at the cuts
+        const Table original{generateSales(200000, true)};
+        std::ostringstream written{};
+        write_csv(written, original);
+        const std::string text{written.str()};
+        for (const unsigned threads : {1U, 3U, 8U})
+        {
+            if (!sameTables(read_csv(text, CsvOptions{',', threads, {}}), original))
+            {
+                std::cout << "Error: the table read back with " << threads << " threads differs" << std::endl;
+                return 1;
+            }
+        }
+
+        // In a single column, an empty value must not turn into a blank
+        // line, which would be skipped
+        Table names{};
+        names.columns.emplace_back("name", ColumnType::text);
+        Table discounts{};
+        discounts.columns.emplace_back("discount", ColumnType::real);
+        for (const std::string_view name : {"Ann", "", "Bob", ""})
+        {
+            names.columns[0].push_back(name);
+            discounts.columns[0].push_back(name.empty() ? std::nan("") : 0.5);
+        }
+        for (const Table *table : {&names, &discounts})
+        {
+            std::ostringstream column{};
+            write_csv(column, *table);
+            if (!sameTables(read_csv(column.str(), CsvOptions{}), *table))
+            {
+                std::cout << "Error: a table of one column with empty values reads back differently" << std::endl;
+                return 1;
+            }
+        }
+
+        // A header without rows reads back as the named columns and no
+        // rows, with or without its newline
+        for (const std::string_view header : {"a,b\n", "a,b", "a,b\n\n"})
+        {
+            const Table empty{read_csv(header, CsvOptions{})};
+            if (empty.columns.size() != 2 || empty.rows() != 0 || empty.columns[1].name() != "b")
+            {
+                std::cout << "Error: a header without rows does not read as an empty table" << std::endl;
+                return 1;
+            }
+        }
+        {
+            std::ostringstream header{};
+            write_csv(header, generateSales(0, false));
+            const Table empty{read_csv(header.str(), CsvOptions{',', 0, std::vector<ColumnType>(5, ColumnType::real)})};
+            if (empty.columns.size() != 5 || empty.rows() != 0 || empty.columns[4].type() != ColumnType::real)
+            {
+                std::cout << "Error: an empty table does not read back" << std::endl;
+                return 1;
+            }
+        }
+
+        // Types guessed from the first row widen when a later value does
+        // not fit, but given types do not
+        {
+            const Table mixed{read_csv("x,y,z\n1,,1\n1.5,foo,2\n,bar,3\n", CsvOptions{})};
+            const auto x{mixed.column("x").reals()};
+            if (mixed.column("x").type() != ColumnType::real || x.size() != 3 || x[1] != 1.5 || !std::isnan(x[2]) ||
+                mixed.column("y").type() != ColumnType::text || mixed.column("y").text(1) != "foo" ||
+                mixed.column("z").type() != ColumnType::integer)
+            {
+                std::cout << "Error: guessed column types do not widen" << std::endl;
+                return 1;
+            }
+            try
+            {
+                read_csv("x\n1\n1.5\n", CsvOptions{',', 0, {ColumnType::integer}});
+                std::cout << "Error: a given column type widened" << std::endl;
+                return 1;
+            }
+            catch (const std::runtime_error &)
+            {
+            }
+        }
+
+        const auto rows = std::size_t{argc > 1 ? std::stoull(argv[1]) : 5000000};
+        const auto path = std::filesystem::path{argv[0]}.parent_path() / "sales.csv";
+        const auto cpus = std::max(std::thread::hardware_concurrency(), 1U);
+        {
+            const Table sales{generateSales(rows, false)};
+            std::ofstream file{path, std::ios::binary};
+            const auto seconds = secondsFor([&] { write_csv(file, sales); });
+            file.close();
+            std::cout << "Wrote " << rows << " rows, " << std::filesystem::file_size(path) / (1024 * 1024)
+                      << " MiB, to " << path.string() << std::endl;
+            printRow("write_csv", std::filesystem::file_size(path), seconds);
+        }
+        const auto bytes = std::filesystem::file_size(path);
+
+        Summary expected{};
+        {
+            Table table{};
+            printRow("std::getline and std::stod", bytes, secondsFor([&] { table = readWithGetline(path); }));
+            expected = summarize(table);
+        }
+        for (const unsigned threads : {1U, std::max(cpus, 2U)})
+        {
+            Table table{};
+            const auto seconds = secondsFor([&] { table = read_csv_file(path, CsvOptions{',', threads, {}}); });
+            printRow("read_csv, " + std::to_string(threads) + (threads == 1 ? " thread" : " threads"), bytes,
+                     seconds);
+            if (!(summarize(table) == expected))
+            {
+                std::cout << "Error: read_csv read other values than std::getline" << std::endl;
+                return 1;
+            }
+        }
+        std::cout << "  (" << cpus << (cpus == 1 ? " CPU" : " CPUs") << ")" << std::endl;
+
+        // The script lives next to bin/, wherever the program is run from
+        const auto script = std::filesystem::read_symlink("/proc/self/exe").parent_path().parent_path() /
+                            "read_with_pandas.py";
+        if (std::filesystem::exists(script) && !runPython(script, path))
+        {
+            std::cout << "  (pandas.read_csv did not run)" << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
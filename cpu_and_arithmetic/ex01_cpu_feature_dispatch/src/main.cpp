@@ -0,0 +1,178 @@
+/**
+ * Runtime CPU Feature Dispatch
+ *
+ * The print standard example in ch01_basic_examples asks the *compiler*
+ * which language standard it is using, through __cplusplus. The instruction
+ * set works the same way at compile time: -mavx2 defines __AVX2__ and lets
+ * the compiler use AVX2 instructions everywhere. But a program compiled with
+ * -mavx2 crashes with "illegal instruction" on a CPU without AVX2, so
+ * programs that are distributed as binaries are compiled for the oldest CPU
+ * they support (plain x86-64 has SSE2 and nothing newer).
+ *
+ * To use newer instructions anyway, the program asks the *CPU* at runtime:
+ *
+ *     1. The cpuid instruction reports which extensions the CPU has.
+ *     2. The fast loops are compiled several times, once per instruction set,
+ *        with __attribute__((target("avx2"))) and the like. Only these
+ *        functions may use the newer instructions.
+ *     3. At startup, a function pointer is bound to the best version the CPU
+ *        supports, and the program calls through it.
+ *
+ * GCC can also do steps 2 and 3 by itself for a single function with
+ * __attribute__((target_clones("avx2", "default"))), but only for code the
+ * compiler vectorizes on its own; hand-written intrinsics need one function
+ * per instruction set as below.
+ *
+ * The dispatch framework is in cpu_dispatch.h. The examples with SIMD
+ * kernels in sorting_and_searching carry a copy of it, since every example
+ * compiles on its own.
+ *
+ * Usage:
+ *
+ *     > make run                            # count newlines in 64 MiB
+ *     > make run ARGS="1024"                # in 1 GiB
+ *     > CPU_DISPATCH=scalar make run        # force the scalar kernel
+ */
+
+#include "cpu_dispatch.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <immintrin.h>
+
+// What the compiler may assume about the CPU, like getCPPStandard() for the
+// language standard
+std::string getCompileTimeIsa()
+{
+#if defined(__AVX512F__)
+    return "AVX-512";
+#elif defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE4_2__)
+    return "SSE4.2";
+#elif defined(__SSE2__)
+    return "SSE2 (the x86-64 baseline)";
+#else
+    return "no x86 SIMD extensions";
+#endif
+}
+
+/**
+ * Kernels counting how often a byte occurs, one per instruction set. Each
+ * compares a whole register of bytes at once, turns the result into a bit
+ * mask with one bit per byte and counts the set bits.
+ */
+std::size_t countByteScalar(const char *data, std::size_t size, char byte)
+{
+    std::size_t count{0};
+    for (std::size_t i{0}; i < size; ++i)
+    {
+        count += data[i] == byte;
+    }
+    return count;
+}
+
+std::size_t countByteSse2(const char *data, std::size_t size, char byte)
+{
+    const __m128i needle{_mm_set1_epi8(byte)};
+    std::size_t count{0};
+    std::size_t i{0};
+    for (; i + 16 <= size; i += 16)
+    {
+        const __m128i chunk{_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i))};
+        count += static_cast<std::size_t>(__builtin_popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)))));
+    }
+    return count + countByteScalar(data + i, size - i, byte);
+}
+
+__attribute__((target("avx2,popcnt"))) std::size_t countByteAvx2(const char *data, std::size_t size, char byte)
+{
+    const __m256i needle{_mm256_set1_epi8(byte)};
+    std::size_t count{0};
+    std::size_t i{0};
+    for (; i + 32 <= size; i += 32)
+    {
+        const __m256i chunk{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i))};
+        count += static_cast<std::size_t>(_mm_popcnt_u32(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)))));
+    }
+    return count + countByteScalar(data + i, size - i, byte);
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt"))) std::size_t countByteAvx512(const char *data, std::size_t size, char byte)
+{
+    const __m512i needle{_mm512_set1_epi8(byte)};
+    std::size_t count{0};
+    std::size_t i{0};
+    for (; i + 64 <= size; i += 64)
+    {
+        const __m512i chunk{_mm512_loadu_si512(data + i)};
+        count += static_cast<std::size_t>(_mm_popcnt_u64(_mm512_cmpeq_epi8_mask(chunk, needle)));
+    }
+    return count + countByteScalar(data + i, size - i, byte);
+}
+
+const CpuDispatch<std::size_t(const char *, std::size_t, char)> countByte{
+    "count_byte",
+    {{"avx512", [](const CpuFeatures &cpu)
+      { return cpu.avx512f && cpu.avx512bw && cpu.popcnt; },
+      countByteAvx512},
+     {"avx2", [](const CpuFeatures &cpu)
+      { return cpu.avx2 && cpu.popcnt; },
+      countByteAvx2},
+     {"sse2", [](const CpuFeatures &cpu)
+      { return cpu.sse2; },
+      countByteSse2},
+     {"scalar", nullptr, countByteScalar}}};
+
+auto main(int argc, char *argv[]) -> int
+{
+    std::cout << "This program was compiled for " << getCompileTimeIsa() << '\n';
+    print_cpu_report(std::cout);
+
+    const auto mebibytes = std::size_t{argc > 1 ? std::stoul(argv[1]) : 64};
+    auto text = std::string(mebibytes * 1024 * 1024, ' ');
+    auto rng = std::mt19937{42};
+    std::uniform_int_distribution<int> letter{'a', 'z'};
+    std::uniform_int_distribution<int> lineLength{0, 80};
+    for (auto i = std::size_t{0}; i < text.size(); ++i)
+    {
+        text[i] = lineLength(rng) == 0 ? '\n' : static_cast<char>(letter(rng));
+    }
+
+    std::cout << "\nCounting newlines in " << mebibytes << " MiB:" << std::endl;
+    const auto expected = countByteScalar(text.data(), text.size(), '\n');
+    for (const auto &kernel : countByte.kernels())
+    {
+        if (!kernel.runs_here())
+        {
+            std::cout << kernel.name << ": not supported by this CPU" << std::endl;
+            continue;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        const auto count = kernel.function(text.data(), text.size(), '\n');
+        auto stop = std::chrono::high_resolution_clock::now();
+        std::cout << kernel.name << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count()
+                  << " ms" << std::endl;
+
+        if (count != expected)
+        {
+            std::cout << "Error: " << kernel.name << " counted " << count << " instead of " << expected << std::endl;
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    const auto count = countByte(text.data(), text.size(), '\n');
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "dispatched (" << countByte.selected() << "): "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << " ms, " << count
+              << " lines" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+#include <initializer_list>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Instruction set extensions of the CPU the program is running on, as
+ * reported by cpuid. The AVX and AVX-512 flags are only set if the operating
+ * system also saves the wider registers on context switches.
+ */
+struct CpuFeatures
+{
+    bool sse2{false};
+    bool sse42{false};
+    bool popcnt{false};
+    bool avx{false};
+    bool avx2{false};
+    bool fma{false};
+    bool bmi1{false};
+    bool bmi2{false};
+    bool avx512f{false};
+    bool avx512bw{false};
+    bool avx512vl{false};
+};
+
+// Detected once, on first use
+const CpuFeatures &cpu_features();
+
+// Brand string of the CPU, e.g. "Intel(R) Core(TM) i7-9700K CPU @ 3.60GHz"
+std::string cpu_brand();
+
+// Lists the CPU's features and the kernel picked by every CpuDispatch
+void print_cpu_report(std::ostream &out);
+
+// Called by CpuDispatch so that print_cpu_report can list its choice
+void register_dispatch(std::string_view function, std::string_view kernel);
+
+// Value of the CPU_DISPATCH environment variable, or empty
+std::string_view forced_kernel_name();
+
+/**
+ * A function with several implementations ("kernels") for different
+ * instruction sets, bound to the best one the CPU supports when the
+ * dispatcher is constructed:
+ *
+ *     const CpuDispatch<std::size_t(const char *, std::size_t)> countSpaces{
+ *         "count_spaces",
+ *         {{"avx2", [](const CpuFeatures &cpu) { return cpu.avx2; }, countSpacesAvx2},
+ *          {"scalar", nullptr, countSpacesScalar}}};
+ *
+ *     countSpaces(text, size); // calls countSpacesAvx2 on CPUs with AVX2
+ *
+ * Kernels are listed from best to worst, and the last one should run on any
+ * CPU (a null check means "always supported"). Kernels for wider instruction
+ * sets are compiled with __attribute__((target("..."))), so the rest of the
+ * program still runs on older CPUs.
+ *
+ * Setting the environment variable CPU_DISPATCH to a kernel name (e.g.
+ * CPU_DISPATCH=scalar) picks that kernel wherever it exists and is supported,
+ * which is handy for testing the fallbacks on a new machine.
+ *
+ * Calling through the dispatcher costs one indirect call, so dispatch whole
+ * loops over arrays rather than single elements.
+ */
+template <typename Signature>
+class CpuDispatch;
+
+template <typename Result, typename... Args>
+class CpuDispatch<Result(Args...)>
+{
+public:
+    using Function = Result (*)(Args...);
+
+    struct Kernel
+    {
+        std::string_view name{};
+        bool (*supported)(const CpuFeatures &){nullptr};
+        Function function{nullptr};
+
+        bool runs_here() const { return supported == nullptr || supported(cpu_features()); }
+    };
+
+    CpuDispatch(std::string_view name, std::initializer_list<Kernel> kernels)
+        : m_kernels{kernels}
+    {
+        for (const auto &kernel : m_kernels)
+        {
+            if (kernel.runs_here() && (m_function == nullptr || kernel.name == forced_kernel_name()))
+            {
+                m_function = kernel.function;
+                m_selected = kernel.name;
+            }
+        }
+        if (m_function == nullptr)
+        {
+            throw std::logic_error{"CpuDispatch: no kernel runs on this CPU"};
+        }
+        register_dispatch(name, m_selected);
+    }
+
+    Result operator()(Args... args) const { return m_function(args...); }
+
+    // Name of the kernel in use
+    std::string_view selected() const { return m_selected; }
+
+    // All kernels, e.g. to benchmark every one that runs_here()
+    const std::vector<Kernel> &kernels() const { return m_kernels; }
+
+private:
+    std::vector<Kernel> m_kernels{};
+    Function m_function{nullptr};
+    std::string_view m_selected{};
+};
+
+#endif
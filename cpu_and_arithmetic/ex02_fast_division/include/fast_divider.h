@@ -0,0 +1,73 @@
+#ifndef FAST_DIVIDER_H
+#define FAST_DIVIDER_H
+
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+/**
+ * Integer division by a divisor that is only known at runtime, but then used
+ * for many divisions.
+ *
+ *     const FastDivider<std::uint32_t> bySeven{7};
+ *     bySeven.divide(100);                 // 14, same as 100 / 7
+ *     bySeven.divide(values, quotients);   // quotients[i] = values[i] / 7
+ *
+ * The results are exactly those of the / operator (rounding towards zero),
+ * but each division is a multiplication and two shifts instead of a
+ * hardware divide. Works for std::int32_t, std::uint32_t, std::int64_t and
+ * std::uint64_t. A divisor of 0 throws std::invalid_argument; dividing the
+ * minimum value of a signed type by -1 overflows, just like with /.
+ */
+template <typename T>
+class FastDivider
+{
+    static_assert(std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::uint32_t> ||
+                      std::is_same_v<T, std::int64_t> || std::is_same_v<T, std::uint64_t>,
+                  "FastDivider supports 32-bit and 64-bit integers");
+
+public:
+    using Unsigned = std::make_unsigned_t<T>;
+
+    explicit FastDivider(T divisor);
+
+    T divisor() const { return m_divisor; }
+
+    T divide(T value) const
+    {
+        // For signed types, divide the magnitudes and fix the sign afterwards
+        const Unsigned sign{std::is_signed_v<T> ? static_cast<Unsigned>(value >> (bits - 1)) : Unsigned{0}};
+        const Unsigned magnitude{(static_cast<Unsigned>(value) ^ sign) - sign};
+        const Unsigned high{multiplyHigh(magnitude, m_magic)};
+        const Unsigned quotient{(high + ((magnitude - high) >> m_shift1)) >> m_shift2};
+        const Unsigned quotientSign{sign ^ m_divisorSign};
+        return static_cast<T>((quotient ^ quotientSign) - quotientSign);
+    }
+
+    // quotients[i] = values[i] / divisor(), using SIMD where available
+    void divide(std::span<const T> values, std::span<T> quotients) const;
+
+private:
+    static constexpr unsigned bits{sizeof(T) * 8};
+
+    static Unsigned multiplyHigh(Unsigned a, Unsigned b)
+    {
+        if constexpr (bits == 32)
+        {
+            return static_cast<Unsigned>((std::uint64_t{a} * b) >> 32);
+        }
+        else
+        {
+            __extension__ using Wide = unsigned __int128;
+            return static_cast<Unsigned>((Wide{a} * b) >> 64);
+        }
+    }
+
+    T m_divisor{};
+    Unsigned m_magic{0};
+    unsigned m_shift1{0};
+    unsigned m_shift2{0};
+    Unsigned m_divisorSign{0};
+};
+
+#endif
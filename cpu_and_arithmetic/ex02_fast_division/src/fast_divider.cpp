@@ -0,0 +1,217 @@
+#include "fast_divider.h"
+
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#include <immintrin.h>
+
+namespace
+{
+    __extension__ using Wide = unsigned __int128;
+
+    // What the 32-bit batch kernels need to know about the divisor
+    struct Parameters32
+    {
+        std::uint32_t magic{0};
+        unsigned shift1{0};
+        unsigned shift2{0};
+        std::uint32_t divisorSign{0};
+    };
+
+    template <bool Signed>
+    void divideScalar(const std::uint32_t *values, std::uint32_t *quotients, std::size_t count, const Parameters32 &p)
+    {
+        for (std::size_t i{0}; i < count; ++i)
+        {
+            const std::uint32_t sign{Signed ? static_cast<std::uint32_t>(static_cast<std::int32_t>(values[i]) >> 31) : 0};
+            const std::uint32_t magnitude{(values[i] ^ sign) - sign};
+            const auto high{static_cast<std::uint32_t>((std::uint64_t{magnitude} * p.magic) >> 32)};
+            const std::uint32_t quotient{(high + ((magnitude - high) >> p.shift1)) >> p.shift2};
+            const std::uint32_t quotientSign{sign ^ p.divisorSign};
+            quotients[i] = (quotient ^ quotientSign) - quotientSign;
+        }
+    }
+
+    /**
+     * There is no instruction for the high half of a 32 x 32 bit product per
+     * lane, but _mm256_mul_epu32 gives the full 64-bit product of the even
+     * lanes. Doing that once for the even and once for the (shifted down) odd
+     * lanes and blending the high halves back together gives all 8.
+     */
+    template <bool Signed>
+    __attribute__((target("avx2"))) void divideAvx2(const std::uint32_t *values, std::uint32_t *quotients,
+                                                     std::size_t count, const Parameters32 &p)
+    {
+        const __m256i magic{_mm256_set1_epi32(static_cast<int>(p.magic))};
+        const __m256i divisorSign{_mm256_set1_epi32(static_cast<int>(p.divisorSign))};
+        const __m128i shift1{_mm_cvtsi32_si128(static_cast<int>(p.shift1))};
+        const __m128i shift2{_mm_cvtsi32_si128(static_cast<int>(p.shift2))};
+
+        std::size_t i{0};
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i magnitude{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i))};
+            __m256i sign{_mm256_setzero_si256()};
+            if constexpr (Signed)
+            {
+                sign = _mm256_srai_epi32(magnitude, 31);
+                magnitude = _mm256_abs_epi32(magnitude);
+            }
+
+            const __m256i even{_mm256_srli_epi64(_mm256_mul_epu32(magnitude, magic), 32)};
+            const __m256i odd{_mm256_mul_epu32(_mm256_srli_epi64(magnitude, 32), magic)};
+            const __m256i high{_mm256_blend_epi32(even, odd, 0b10101010)};
+            __m256i quotient{_mm256_srl_epi32(
+                _mm256_add_epi32(high, _mm256_srl_epi32(_mm256_sub_epi32(magnitude, high), shift1)), shift2)};
+
+            if constexpr (Signed)
+            {
+                const __m256i quotientSign{_mm256_xor_si256(sign, divisorSign)};
+                quotient = _mm256_sub_epi32(_mm256_xor_si256(quotient, quotientSign), quotientSign);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(quotients + i), quotient);
+        }
+        divideScalar<Signed>(values + i, quotients + i, count - i, p);
+    }
+
+    // GCC 12's AVX-512 headers start many intrinsics from a deliberately
+    // undefined register, which -Wmaybe-uninitialized wrongly reports
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    template <bool Signed>
+    __attribute__((target("avx512f"))) void divideAvx512(const std::uint32_t *values, std::uint32_t *quotients,
+                                                          std::size_t count, const Parameters32 &p)
+    {
+        const __m512i magic{_mm512_set1_epi32(static_cast<int>(p.magic))};
+        const __m512i divisorSign{_mm512_set1_epi32(static_cast<int>(p.divisorSign))};
+        const __m512i shift1{_mm512_set1_epi32(static_cast<int>(p.shift1))};
+        const __m512i shift2{_mm512_set1_epi32(static_cast<int>(p.shift2))};
+
+        std::size_t i{0};
+        for (; i + 16 <= count; i += 16)
+        {
+            __m512i magnitude{_mm512_loadu_si512(values + i)};
+            __m512i sign{_mm512_setzero_si512()};
+            if constexpr (Signed)
+            {
+                sign = _mm512_srai_epi32(magnitude, 31);
+                magnitude = _mm512_abs_epi32(magnitude);
+            }
+
+            const __m512i even{_mm512_srli_epi64(_mm512_mul_epu32(magnitude, magic), 32)};
+            const __m512i odd{_mm512_mul_epu32(_mm512_srli_epi64(magnitude, 32), magic)};
+            const __m512i high{_mm512_mask_blend_epi32(0xaaaa, even, odd)};
+            __m512i quotient{_mm512_srlv_epi32(
+                _mm512_add_epi32(high, _mm512_srlv_epi32(_mm512_sub_epi32(magnitude, high), shift1)), shift2)};
+
+            if constexpr (Signed)
+            {
+                const __m512i quotientSign{_mm512_xor_si512(sign, divisorSign)};
+                quotient = _mm512_sub_epi32(_mm512_xor_si512(quotient, quotientSign), quotientSign);
+            }
+            _mm512_storeu_si512(quotients + i, quotient);
+        }
+        divideScalar<Signed>(values + i, quotients + i, count - i, p);
+    }
+#pragma GCC diagnostic pop
+
+    using Divide32 = void(const std::uint32_t *, std::uint32_t *, std::size_t, const Parameters32 &);
+
+    const CpuDispatch<Divide32> divideUnsigned32{
+        "fast_divide_u32",
+        {{"avx512", [](const CpuFeatures &cpu)
+          { return cpu.avx512f; },
+          divideAvx512<false>},
+         {"avx2", [](const CpuFeatures &cpu)
+          { return cpu.avx2; },
+          divideAvx2<false>},
+         {"scalar", nullptr, divideScalar<false>}}};
+
+    const CpuDispatch<Divide32> divideSigned32{
+        "fast_divide_i32",
+        {{"avx512", [](const CpuFeatures &cpu)
+          { return cpu.avx512f; },
+          divideAvx512<true>},
+         {"avx2", [](const CpuFeatures &cpu)
+          { return cpu.avx2; },
+          divideAvx2<true>},
+         {"scalar", nullptr, divideScalar<true>}}};
+}
+
+template <typename T>
+FastDivider<T>::FastDivider(T divisor)
+    : m_divisor{divisor}
+{
+    if (divisor == 0)
+    {
+        throw std::invalid_argument{"FastDivider: division by zero"};
+    }
+
+    /**
+     * With l = ceil(log2(d)), the magic number m = 2^N * (2^l - d) / d + 1
+     * fits in N bits, and for every N-bit n
+     *
+     *     n / d == (t + ((n - t) >> 1)) >> (l - 1),   t = (m * n) >> N
+     *
+     * which is m * n / 2^(N + l) rounded down, computed without overflowing
+     * N bits. For d = 1 (l = 0) the shifts become 0 and 0, and m = 1 makes
+     * t = 0, so the same formula works for every divisor without branches.
+     */
+    const Unsigned magnitude{divisor < 0 ? static_cast<Unsigned>(Unsigned{0} - static_cast<Unsigned>(divisor))
+                                         : static_cast<Unsigned>(divisor)};
+    const auto log2{static_cast<unsigned>(bits - std::countl_zero(static_cast<Unsigned>(magnitude - 1)))};
+
+    if constexpr (bits == 32)
+    {
+        m_magic = static_cast<Unsigned>((((std::uint64_t{1} << log2) - magnitude) << 32) / magnitude + 1);
+    }
+    else
+    {
+        m_magic = static_cast<Unsigned>((((Wide{1} << log2) - magnitude) << 64) / magnitude + 1);
+    }
+    m_shift1 = std::min(log2, 1u);
+    m_shift2 = log2 == 0 ? 0 : log2 - 1;
+    m_divisorSign = divisor < 0 ? ~Unsigned{0} : Unsigned{0};
+}
+
+template <typename T>
+void FastDivider<T>::divide(std::span<const T> values, std::span<T> quotients) const
+{
+    if (quotients.size() < values.size())
+    {
+        throw std::invalid_argument{"FastDivider: quotients must be at least as long as values"};
+    }
+
+    if constexpr (bits == 32)
+    {
+        // Signed and unsigned integers of the same size may alias each other
+        const Parameters32 parameters{m_magic, m_shift1, m_shift2, m_divisorSign};
+        const auto *in{reinterpret_cast<const std::uint32_t *>(values.data())};
+        auto *out{reinterpret_cast<std::uint32_t *>(quotients.data())};
+        if constexpr (std::is_signed_v<T>)
+        {
+            divideSigned32(in, out, values.size(), parameters);
+        }
+        else
+        {
+            divideUnsigned32(in, out, values.size(), parameters);
+        }
+    }
+    else
+    {
+        // No SIMD instruction set has a 64 x 64 bit high multiply, but the
+        // scalar mul instruction is still far cheaper than div
+        for (std::size_t i{0}; i < values.size(); ++i)
+        {
+            quotients[i] = divide(values[i]);
+        }
+    }
+}
+
+template class FastDivider<std::int32_t>;
+template class FastDivider<std::uint32_t>;
+template class FastDivider<std::int64_t>;
+template class FastDivider<std::uint64_t>;
@@ -0,0 +1,224 @@
+/**
+ * Fast Division by a Runtime Constant
+ *
+ * The divide lambda in ch20_functions_and_lambdas/ex06_lambdas computes
+ * x / y with the / operator on every call. Integer division is one of the
+ * slowest things a CPU does: a 64-bit div takes tens of cycles and the
+ * divider cannot start a new division every cycle the way the multiplier
+ * can. Compilers avoid it when the divisor is a constant, replacing x / 7
+ * with a multiplication by a "magic number" and a shift. But when the
+ * divisor is only known at runtime, for example read from the command line,
+ * every x / y in a loop is a real division.
+ *
+ * If the same divisor is used many times, the program can compute the magic
+ * number itself, once, and then divide like the compiler would:
+ *
+ *     const FastDivider<std::uint32_t> byY{y};   // slow, once
+ *     byY.divide(x);                             // fast, many times
+ *
+ * This is what the libdivide library does. Since there are no divide
+ * instructions for SIMD registers at all, the multiply-and-shift version
+ * also makes it possible to divide 8 or 16 numbers at once, which
+ * FastDivider::divide(values, quotients) does for 32-bit integers.
+ *
+ * Usage:
+ *
+ *     > make run                    # divide 100 million numbers of each type by 7
+ *     > make run ARGS="1000 10"     # divide 10^9 numbers of each type by 10
+ *     > CPU_DISPATCH=scalar make run
+ */
+
+#include "cpu_dispatch.h"
+#include "fast_divider.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Compares FastDivider with / for edge cases and random values, returns
+// false and prints the first difference
+template <typename T>
+bool checkDivider(T divisor, std::mt19937_64 &rng)
+{
+    using Limits = std::numeric_limits<T>;
+    using Unsigned = std::make_unsigned_t<T>;
+    std::vector<T> values{0, 1, 2, 3, 5, 7, 100, Limits::max(), static_cast<T>(Limits::max() - 1), divisor,
+                          static_cast<T>(static_cast<Unsigned>(divisor) + 1),
+                          static_cast<T>(static_cast<Unsigned>(divisor) - 1)};
+    if constexpr (std::is_signed_v<T>)
+    {
+        values.insert(values.end(), {-1, -2, -7, -100, static_cast<T>(Limits::min() + 1)});
+        if (divisor != -1)
+        {
+            values.push_back(Limits::min());
+        }
+    }
+    const auto minusOne = static_cast<T>(-1);
+    std::uniform_int_distribution<T> anyValue{
+        std::is_signed_v<T> && divisor == minusOne ? static_cast<T>(Limits::min() + 1) : Limits::min(), Limits::max()};
+    for (auto i = 0; i < 1000; ++i)
+    {
+        values.push_back(anyValue(rng));
+    }
+
+    const auto divider = FastDivider<T>{divisor};
+    auto quotients = std::vector<T>(values.size());
+    divider.divide(values, quotients);
+    for (auto i = std::size_t{0}; i < values.size(); ++i)
+    {
+        const auto expected = static_cast<T>(values[i] / divisor);
+        if (divider.divide(values[i]) != expected || quotients[i] != expected)
+        {
+            std::cout << "Error: " << values[i] << " / " << divisor << " is " << expected << ", FastDivider gave "
+                      << divider.divide(values[i]) << " and " << quotients[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+bool checkDividers(std::mt19937_64 &rng)
+{
+    using Limits = std::numeric_limits<T>;
+    std::vector<T> divisors{1, 2, 3, 5, 6, 7, 10, 64, 641, 1000, Limits::max(), static_cast<T>(Limits::max() / 2),
+                            static_cast<T>(Limits::max() / 2 + 1), static_cast<T>(Limits::max() / 2 + 2)};
+    if constexpr (std::is_signed_v<T>)
+    {
+        divisors.insert(divisors.end(), {-1, -2, -3, -7, -1000, Limits::min(), static_cast<T>(Limits::min() + 1)});
+    }
+    std::uniform_int_distribution<T> anyDivisor{Limits::min(), Limits::max()};
+    for (auto i = 0; i < 200; ++i)
+    {
+        divisors.push_back(anyDivisor(rng));
+    }
+
+    for (const auto divisor : divisors)
+    {
+        if (divisor != 0 && !checkDivider(divisor, rng))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Calls divide with values over and over, the last time with only as many
+// as make total in all
+template <typename T, typename Function>
+void forEachBatch(const std::vector<T> &values, std::size_t total, Function divide)
+{
+    for (auto done = std::size_t{0}; done < total; done += values.size())
+    {
+        divide(std::span<const T>{values}.first(std::min(values.size(), total - done)));
+    }
+}
+
+// Divides a buffer of random values over and over until total numbers have
+// been divided, in three ways, and prints how long each took
+template <typename T>
+bool benchmark(const std::string &type, std::size_t total, T divisor)
+{
+    auto rng = std::mt19937_64{42};
+    std::uniform_int_distribution<T> anyValue{std::is_signed_v<T> ? static_cast<T>(-1000000000) : T{0},
+                                              std::numeric_limits<T>::max()};
+    auto values = std::vector<T>(std::size_t{1} << 16);
+    for (auto &value : values)
+    {
+        value = anyValue(rng);
+    }
+    auto expected = std::vector<T>(values.size());
+    auto quotients = std::vector<T>(values.size());
+    // Every batch starts at the front of the buffer, so this much of it
+    // holds quotients after each run
+    const auto checked = static_cast<std::ptrdiff_t>(std::min(total, values.size()));
+
+    const auto report = [&](const std::string &name, auto divideBatch)
+    {
+        std::make_unsigned_t<T> checksum{0};
+        auto batches = std::size_t{0};
+        auto start = std::chrono::high_resolution_clock::now();
+        forEachBatch(values, total, [&](std::span<const T> batch)
+                     {
+                         divideBatch(batch);
+                         checksum += static_cast<std::make_unsigned_t<T>>(quotients[batches++ % batch.size()]); });
+        auto stop = std::chrono::high_resolution_clock::now();
+        const auto nanoseconds = std::chrono::duration<double, std::nano>(stop - start).count();
+        std::cout << "    " << name << ": " << nanoseconds / 1e6 << " ms, "
+                  << nanoseconds / static_cast<double>(total) << " ns per division (checksum " << checksum << ")"
+                  << std::endl;
+        return std::equal(quotients.begin(), quotients.begin() + checked, expected.begin());
+    };
+
+    const auto divider = FastDivider<T>{divisor};
+    std::cout << type << " / " << divisor << ", " << total << " divisions:" << std::endl;
+
+    // The compiler cannot turn / into a multiplication, since divisor is
+    // only known at runtime
+    report("/ operator        ", [&](std::span<const T> batch)
+           {
+               for (auto i = std::size_t{0}; i < batch.size(); ++i)
+               {
+                   quotients[i] = batch[i] / divisor;
+               } });
+    expected = quotients;
+
+    const auto scalarOk = report("FastDivider       ", [&](std::span<const T> batch)
+                                 {
+                                     for (auto i = std::size_t{0}; i < batch.size(); ++i)
+                                     {
+                                         quotients[i] = divider.divide(batch[i]);
+                                     } });
+    const auto batchOk = report("FastDivider batch ", [&](std::span<const T> batch)
+                                { divider.divide(batch, std::span<T>{quotients}.first(batch.size())); });
+
+    if (!scalarOk || !batchOk)
+    {
+        std::cout << "Error: FastDivider disagrees with / for " << type << std::endl;
+        return false;
+    }
+    return true;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    // Which SIMD kernels this CPU runs
+    print_cpu_report(std::cout);
+    std::cout << '\n';
+
+    const auto millions = std::size_t{argc > 1 ? std::stoul(argv[1]) : 100};
+    const auto divisor = std::int32_t{argc > 2 ? std::stoi(argv[2]) : 7};
+    if (divisor <= 0)
+    {
+        std::cout << "Error: the divisor must be positive, so it works for every type" << std::endl;
+        return 1;
+    }
+
+    auto rng = std::mt19937_64{7};
+    if (!checkDividers<std::int32_t>(rng) || !checkDividers<std::uint32_t>(rng) ||
+        !checkDividers<std::int64_t>(rng) || !checkDividers<std::uint64_t>(rng))
+    {
+        return 1;
+    }
+    std::cout << "FastDivider agrees with / for all divisors tested\n"
+              << std::endl;
+
+    const auto total = std::max(millions * 1000000, std::size_t{1});
+    if (!benchmark<std::int32_t>("int32", total, divisor) ||
+        !benchmark<std::uint32_t>("uint32", total, static_cast<std::uint32_t>(divisor)) ||
+        !benchmark<std::int64_t>("int64", total, divisor) ||
+        !benchmark<std::uint64_t>("uint64", total, static_cast<std::uint64_t>(divisor)))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+#ifndef CHECKED_ARITHMETIC_H
+#define CHECKED_ARITHMETIC_H
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// The integer types std::in_range and std::cmp_less compare: bool and the
+// character types are integral too, but not numbers
+template <typename T>
+concept Integer = std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char> &&
+                  !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t> &&
+                  !std::is_same_v<T, char32_t>;
+
+/**
+ * An integer that throws std::overflow_error instead of wrapping around:
+ *
+ *     Checked<unsigned short> x{65535};
+ *     x += Checked<unsigned short>{1};     // throws
+ *     Checked<unsigned> u{2};
+ *     u - Checked<unsigned>{3};            // throws instead of 4294967295
+ *     Checked<unsigned> n{-1};             // throws, -1 is out of range
+ *
+ * Values of other integer types are converted to T only if they fit, so
+ * signed and unsigned values can be mixed safely. The conversion is
+ * explicit, so that it is visible where it may throw.
+ */
+template <typename T>
+class Checked
+{
+    static_assert(Integer<T>, "Checked needs an integer type");
+
+public:
+    constexpr Checked() = default;
+
+    template <Integer U>
+    explicit constexpr Checked(U value)
+        : m_value{static_cast<T>(value)}
+    {
+        if (!std::in_range<T>(value))
+        {
+            throw std::overflow_error{"Checked: value out of range"};
+        }
+    }
+
+    constexpr T value() const { return m_value; }
+
+    friend constexpr Checked operator+(Checked a, Checked b)
+    {
+        T result{};
+        if (__builtin_add_overflow(a.m_value, b.m_value, &result))
+        {
+            throw std::overflow_error{"Checked: addition overflows"};
+        }
+        return Checked{result};
+    }
+
+    friend constexpr Checked operator-(Checked a, Checked b)
+    {
+        T result{};
+        if (__builtin_sub_overflow(a.m_value, b.m_value, &result))
+        {
+            throw std::overflow_error{"Checked: subtraction overflows"};
+        }
+        return Checked{result};
+    }
+
+    friend constexpr Checked operator*(Checked a, Checked b)
+    {
+        T result{};
+        if (__builtin_mul_overflow(a.m_value, b.m_value, &result))
+        {
+            throw std::overflow_error{"Checked: multiplication overflows"};
+        }
+        return Checked{result};
+    }
+
+    constexpr Checked &operator+=(Checked other) { return *this = *this + other; }
+    constexpr Checked &operator-=(Checked other) { return *this = *this - other; }
+    constexpr Checked &operator*=(Checked other) { return *this = *this * other; }
+
+    friend constexpr bool operator==(Checked a, Checked b) = default;
+
+private:
+    T m_value{0};
+};
+
+/**
+ * An integer that clamps to its smallest or largest value instead of
+ * wrapping around, like an audio sample or a pixel channel:
+ *
+ *     Saturating<unsigned short> x{65535};
+ *     x += Saturating<unsigned short>{1};  // stays 65535
+ *     Saturating<unsigned> u{2};
+ *     u - Saturating<unsigned>{3};         // 0
+ *     Saturating<std::uint8_t> b{300};     // 255
+ *
+ * Like Checked, it is only made explicitly, from an integer of any type.
+ */
+template <typename T>
+class Saturating
+{
+    static_assert(Integer<T>, "Saturating needs an integer type");
+
+public:
+    constexpr Saturating() = default;
+
+    template <Integer U>
+    explicit constexpr Saturating(U value)
+        : m_value{clamp(value)}
+    {
+    }
+
+    constexpr T value() const { return m_value; }
+
+    friend constexpr Saturating operator+(Saturating a, Saturating b)
+    {
+        T result{};
+        if (__builtin_add_overflow(a.m_value, b.m_value, &result))
+        {
+            // Only adding a negative number can go below the minimum
+            if constexpr (std::is_signed_v<T>)
+            {
+                return Saturating{b.m_value < 0 ? Limits::min() : Limits::max()};
+            }
+            return Saturating{Limits::max()};
+        }
+        return Saturating{result};
+    }
+
+    friend constexpr Saturating operator-(Saturating a, Saturating b)
+    {
+        T result{};
+        if (__builtin_sub_overflow(a.m_value, b.m_value, &result))
+        {
+            if constexpr (std::is_signed_v<T>)
+            {
+                return Saturating{b.m_value > 0 ? Limits::min() : Limits::max()};
+            }
+            return Saturating{Limits::min()};
+        }
+        return Saturating{result};
+    }
+
+    friend constexpr Saturating operator*(Saturating a, Saturating b)
+    {
+        T result{};
+        if (__builtin_mul_overflow(a.m_value, b.m_value, &result))
+        {
+            if constexpr (std::is_signed_v<T>)
+            {
+                return Saturating{(a.m_value < 0) != (b.m_value < 0) ? Limits::min() : Limits::max()};
+            }
+            return Saturating{Limits::max()};
+        }
+        return Saturating{result};
+    }
+
+    constexpr Saturating &operator+=(Saturating other) { return *this = *this + other; }
+    constexpr Saturating &operator-=(Saturating other) { return *this = *this - other; }
+    constexpr Saturating &operator*=(Saturating other) { return *this = *this * other; }
+
+    friend constexpr bool operator==(Saturating a, Saturating b) = default;
+
+private:
+    using Limits = std::numeric_limits<T>;
+
+    template <Integer U>
+    static constexpr T clamp(U value)
+    {
+        if (std::cmp_less(value, Limits::min()))
+        {
+            return Limits::min();
+        }
+        if (std::cmp_greater(value, Limits::max()))
+        {
+            return Limits::max();
+        }
+        return static_cast<T>(value);
+    }
+
+    T m_value{0};
+};
+
+/**
+ * Element-wise arithmetic on whole arrays of 16-bit integers, using the
+ * saturating SIMD instructions (SSE2 and AVX2 have them for 8 and 16 bits).
+ * out must be at least as long as a, and b exactly as long as a, otherwise
+ * std::invalid_argument is thrown.
+ *
+ * out[i] = a[i] + b[i] or a[i] - b[i], clamped to the range of the type
+ */
+void saturating_add(std::span<const std::uint16_t> a, std::span<const std::uint16_t> b, std::span<std::uint16_t> out);
+void saturating_add(std::span<const std::int16_t> a, std::span<const std::int16_t> b, std::span<std::int16_t> out);
+void saturating_sub(std::span<const std::uint16_t> a, std::span<const std::uint16_t> b, std::span<std::uint16_t> out);
+void saturating_sub(std::span<const std::int16_t> a, std::span<const std::int16_t> b, std::span<std::int16_t> out);
+
+/**
+ * out[i] = a[i] + b[i] or a[i] - b[i], throwing std::overflow_error with the
+ * index of the first element that does not fit. The contents of out are
+ * unspecified after an overflow.
+ */
+void checked_add(std::span<const std::uint16_t> a, std::span<const std::uint16_t> b, std::span<std::uint16_t> out);
+void checked_add(std::span<const std::int16_t> a, std::span<const std::int16_t> b, std::span<std::int16_t> out);
+void checked_sub(std::span<const std::uint16_t> a, std::span<const std::uint16_t> b, std::span<std::uint16_t> out);
+void checked_sub(std::span<const std::int16_t> a, std::span<const std::int16_t> b, std::span<std::int16_t> out);
+
+#endif
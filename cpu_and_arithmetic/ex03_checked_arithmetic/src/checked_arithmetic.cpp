@@ -0,0 +1,257 @@
+#include "checked_arithmetic.h"
+
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+
+#include <immintrin.h>
+
+namespace
+{
+    enum class Operation
+    {
+        add,
+        sub,
+    };
+
+    /**
+     * Checking every single element for overflow would add a compare and a
+     * branch to every iteration. Instead the kernels remember whether any
+     * element of a block overflowed and test that once per block; only when
+     * a block did overflow is it searched again for the exact element.
+     */
+    constexpr std::size_t blockSize{1024};
+
+    template <typename T, Operation op>
+    bool overflows(T a, T b, T &result)
+    {
+        if constexpr (op == Operation::add)
+        {
+            return __builtin_add_overflow(a, b, &result);
+        }
+        else
+        {
+            return __builtin_sub_overflow(a, b, &result);
+        }
+    }
+
+    template <typename T, Operation op>
+    T saturate(T a, T b)
+    {
+        if constexpr (op == Operation::add)
+        {
+            return (Saturating<T>{a} + Saturating<T>{b}).value();
+        }
+        else
+        {
+            return (Saturating<T>{a} - Saturating<T>{b}).value();
+        }
+    }
+
+    // Each kernel returns the start of the first block that overflowed, or
+    // count if none did (the saturating kernels always return count)
+    template <typename T, Operation op, bool Check>
+    std::size_t kernelScalar(const T *a, const T *b, T *out, std::size_t count)
+    {
+        for (std::size_t block{0}; block < count; block += blockSize)
+        {
+            const std::size_t end{std::min(block + blockSize, count)};
+            bool overflow{false};
+            for (std::size_t i{block}; i < end; ++i)
+            {
+                if constexpr (Check)
+                {
+                    overflow |= overflows<T, op>(a[i], b[i], out[i]);
+                }
+                else
+                {
+                    out[i] = saturate<T, op>(a[i], b[i]);
+                }
+            }
+            if (overflow)
+            {
+                return block;
+            }
+        }
+        return count;
+    }
+
+    // A checked result is the saturated one, if saturating did not change it
+    template <typename T, Operation op>
+    __m128i saturate128(__m128i a, __m128i b)
+    {
+        if constexpr (std::is_signed_v<T>)
+        {
+            return op == Operation::add ? _mm_adds_epi16(a, b) : _mm_subs_epi16(a, b);
+        }
+        else
+        {
+            return op == Operation::add ? _mm_adds_epu16(a, b) : _mm_subs_epu16(a, b);
+        }
+    }
+
+    template <Operation op>
+    __m128i wrap128(__m128i a, __m128i b)
+    {
+        return op == Operation::add ? _mm_add_epi16(a, b) : _mm_sub_epi16(a, b);
+    }
+
+    template <typename T, Operation op, bool Check>
+    std::size_t kernelSse2(const T *a, const T *b, T *out, std::size_t count)
+    {
+        std::size_t block{0};
+        for (; block + blockSize <= count; block += blockSize)
+        {
+            __m128i overflow{_mm_setzero_si128()};
+            for (std::size_t i{block}; i < block + blockSize; i += 8)
+            {
+                const __m128i x{_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i))};
+                const __m128i y{_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i))};
+                const __m128i saturated{saturate128<T, op>(x, y)};
+                if constexpr (Check)
+                {
+                    overflow = _mm_or_si128(overflow, _mm_xor_si128(saturated, wrap128<op>(x, y)));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), saturated);
+            }
+            if (Check && _mm_movemask_epi8(_mm_cmpeq_epi8(overflow, _mm_setzero_si128())) != 0xffff)
+            {
+                return block;
+            }
+        }
+        return block + kernelScalar<T, op, Check>(a + block, b + block, out + block, count - block);
+    }
+
+    template <typename T, Operation op>
+    __attribute__((target("avx2"))) __m256i saturate256(__m256i a, __m256i b)
+    {
+        if constexpr (std::is_signed_v<T>)
+        {
+            return op == Operation::add ? _mm256_adds_epi16(a, b) : _mm256_subs_epi16(a, b);
+        }
+        else
+        {
+            return op == Operation::add ? _mm256_adds_epu16(a, b) : _mm256_subs_epu16(a, b);
+        }
+    }
+
+    template <Operation op>
+    __attribute__((target("avx2"))) __m256i wrap256(__m256i a, __m256i b)
+    {
+        return op == Operation::add ? _mm256_add_epi16(a, b) : _mm256_sub_epi16(a, b);
+    }
+
+    template <typename T, Operation op, bool Check>
+    __attribute__((target("avx2"))) std::size_t kernelAvx2(const T *a, const T *b, T *out, std::size_t count)
+    {
+        std::size_t block{0};
+        for (; block + blockSize <= count; block += blockSize)
+        {
+            __m256i overflow{_mm256_setzero_si256()};
+            for (std::size_t i{block}; i < block + blockSize; i += 16)
+            {
+                const __m256i x{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i))};
+                const __m256i y{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i))};
+                const __m256i saturated{saturate256<T, op>(x, y)};
+                if constexpr (Check)
+                {
+                    overflow = _mm256_or_si256(overflow, _mm256_xor_si256(saturated, wrap256<op>(x, y)));
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), saturated);
+            }
+            if (Check && !_mm256_testz_si256(overflow, overflow))
+            {
+                return block;
+            }
+        }
+        return block + kernelScalar<T, op, Check>(a + block, b + block, out + block, count - block);
+    }
+
+    template <typename T, Operation op, bool Check>
+    constexpr std::string_view dispatchName()
+    {
+        constexpr std::array<std::string_view, 8> names{"saturating_add_u16", "saturating_add_i16",
+                                                        "saturating_sub_u16", "saturating_sub_i16",
+                                                        "checked_add_u16", "checked_add_i16",
+                                                        "checked_sub_u16", "checked_sub_i16"};
+        return names[std::is_signed_v<T> + 2 * (op == Operation::sub) + 4 * Check];
+    }
+
+    template <typename T, Operation op, bool Check>
+    const CpuDispatch<std::size_t(const T *, const T *, T *, std::size_t)> kernel{
+        dispatchName<T, op, Check>(),
+        {{"avx2", [](const CpuFeatures &cpu)
+          { return cpu.avx2; },
+          kernelAvx2<T, op, Check>},
+         {"sse2", [](const CpuFeatures &cpu)
+          { return cpu.sse2; },
+          kernelSse2<T, op, Check>},
+         {"scalar", nullptr, kernelScalar<T, op, Check>}}};
+
+    template <typename T, Operation op, bool Check>
+    void apply(std::span<const T> a, std::span<const T> b, std::span<T> out, std::string_view function)
+    {
+        if (b.size() != a.size() || out.size() < a.size())
+        {
+            throw std::invalid_argument{std::string{function} + ": spans must have matching sizes"};
+        }
+
+        const std::size_t block{kernel<T, op, Check>(a.data(), b.data(), out.data(), a.size())};
+        if (block == a.size())
+        {
+            return;
+        }
+        for (std::size_t i{block}; i < a.size(); ++i)
+        {
+            T result{};
+            if (overflows<T, op>(a[i], b[i], result))
+            {
+                throw std::overflow_error{std::string{function} + ": overflow at index " +
+                                          std::to_string(i)};
+            }
+        }
+    }
+}
+
+void saturating_add(std::span<const std::uint16_t> a, std::span<const std::uint16_t> b, std::span<std::uint16_t> out)
+{
+    apply<std::uint16_t, Operation::add, false>(a, b, out, "saturating_add");
+}
+
+void saturating_add(std::span<const std::int16_t> a, std::span<const std::int16_t> b, std::span<std::int16_t> out)
+{
+    apply<std::int16_t, Operation::add, false>(a, b, out, "saturating_add");
+}
+
+void saturating_sub(std::span<const std::uint16_t> a, std::span<const std::uint16_t> b, std::span<std::uint16_t> out)
+{
+    apply<std::uint16_t, Operation::sub, false>(a, b, out, "saturating_sub");
+}
+
+void saturating_sub(std::span<const std::int16_t> a, std::span<const std::int16_t> b, std::span<std::int16_t> out)
+{
+    apply<std::int16_t, Operation::sub, false>(a, b, out, "saturating_sub");
+}
+
+void checked_add(std::span<const std::uint16_t> a, std::span<const std::uint16_t> b, std::span<std::uint16_t> out)
+{
+    apply<std::uint16_t, Operation::add, true>(a, b, out, "checked_add");
+}
+
+void checked_add(std::span<const std::int16_t> a, std::span<const std::int16_t> b, std::span<std::int16_t> out)
+{
+    apply<std::int16_t, Operation::add, true>(a, b, out, "checked_add");
+}
+
+void checked_sub(std::span<const std::uint16_t> a, std::span<const std::uint16_t> b, std::span<std::uint16_t> out)
+{
+    apply<std::uint16_t, Operation::sub, true>(a, b, out, "checked_sub");
+}
+
+void checked_sub(std::span<const std::int16_t> a, std::span<const std::int16_t> b, std::span<std::int16_t> out)
+{
+    apply<std::int16_t, Operation::sub, true>(a, b, out, "checked_sub");
+}
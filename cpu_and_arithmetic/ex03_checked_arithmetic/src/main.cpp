@@ -0,0 +1,191 @@
+/**
+ * Checked and Saturating Arithmetic
+ *
+ * The unsigned length problem example in ch16_containers_and_arrays shows
+ * how unsigned arithmetic silently wraps around: an unsigned short holding
+ * 65535 becomes 0 after x += 1, and 2u - 3 is 4294967295. Signed overflow is
+ * even worse, since it is undefined behavior. There are two common ways to
+ * make overflow harmless:
+ *
+ *     1. Checked arithmetic reports the overflow, here by throwing
+ *        std::overflow_error. GCC and Clang have __builtin_add_overflow and
+ *        friends, which compute the wrapped result and tell whether it
+ *        overflowed, usually by looking at the CPU's carry or overflow flag
+ *        right after the add.
+ *     2. Saturating arithmetic clamps the result to the smallest or largest
+ *        value, so 65535 + 1 stays 65535. This is what audio and image code
+ *        wants: a sample that is too loud should clip, not turn silent.
+ *
+ * Checking every element of a large array costs a compare and a branch per
+ * element, which also stops the compiler from vectorizing the loop. SSE2 and
+ * AVX2 have saturating add and subtract instructions for 8 and 16-bit
+ * integers, and they make a fast checked add possible too: an element
+ * overflowed exactly when its saturated and wrapped results differ. The
+ * checked_add kernel ORs those differences together over a block of 1024
+ * elements and tests them once per block.
+ *
+ * Usage:
+ *
+ *     > make run                       # 1 Mi elements, 200 rounds
+ *     > make run ARGS="65536 5000"     # elements, rounds
+ *     > CPU_DISPATCH=sse2 make run
+ */
+
+#include "checked_arithmetic.h"
+#include "cpu_dispatch.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Runs fn rounds times and prints the time per element
+template <typename Function>
+void timeLoop(const std::string &name, std::size_t elements, std::size_t rounds, Function fn)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto round = std::size_t{0}; round < rounds; ++round)
+    {
+        fn();
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    const auto nanoseconds = std::chrono::duration<double, std::nano>(stop - start).count();
+    std::cout << "    " << name << ": " << nanoseconds / 1e6 << " ms, "
+              << nanoseconds / static_cast<double>(elements * rounds) << " ns per element" << std::endl;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    // Which SIMD kernels this CPU runs
+    print_cpu_report(std::cout);
+    std::cout << '\n';
+
+    // The examples from the unsigned length problem, made safe
+    std::cout << "Unsigned integer dangers, revisited:\n";
+    Saturating<unsigned short> saturated{65535};
+    saturated += Saturating<unsigned short>{1};
+    std::cout << "Saturating: after incrementing 65535, x = " << saturated.value() << '\n';
+    saturated = Saturating<unsigned short>{0};
+    saturated -= Saturating<unsigned short>{1};
+    std::cout << "Saturating: after decrementing 0, x = " << saturated.value() << '\n';
+    saturated = Saturating<unsigned short>{-80};
+    std::cout << "Saturating: after setting x to -80, x = " << saturated.value() << '\n';
+
+    try
+    {
+        Checked<unsigned short> checked{65535};
+        checked += Checked<unsigned short>{1};
+        std::cout << "Checked: after incrementing 65535, x = " << checked.value() << '\n';
+    }
+    catch (const std::overflow_error &e)
+    {
+        std::cout << "Checked: incrementing 65535 throws \"" << e.what() << "\"\n";
+    }
+
+    try
+    {
+        const auto u = Checked<unsigned int>{2};
+        const auto s = 3;
+        const auto difference = u - Checked<unsigned int>{s};
+        std::cout << "Checked: unsigned - signed integer: " << difference.value() << '\n';
+    }
+    catch (const std::overflow_error &e)
+    {
+        std::cout << "Checked: 2u - 3 throws \"" << e.what() << "\"\n";
+    }
+    std::cout << std::endl;
+
+    const auto elements = std::size_t{argc > 1 ? std::stoul(argv[1]) : 1024 * 1024};
+    const auto rounds = std::size_t{argc > 2 ? std::stoul(argv[2]) : 200};
+
+    // Sums of two values up to 30000 never overflow an unsigned short, so
+    // all variants compute the same result
+    auto rng = std::mt19937{42};
+    std::uniform_int_distribution<unsigned> anyValue{0, 30000};
+    auto a = std::vector<std::uint16_t>(elements);
+    auto b = std::vector<std::uint16_t>(elements);
+    for (auto i = std::size_t{0}; i < elements; ++i)
+    {
+        a[i] = static_cast<std::uint16_t>(anyValue(rng));
+        b[i] = static_cast<std::uint16_t>(anyValue(rng));
+    }
+    auto wrapped = std::vector<std::uint16_t>(elements);
+    auto out = std::vector<std::uint16_t>(elements);
+
+    std::cout << "Adding " << elements << " unsigned shorts, " << rounds << " times:" << std::endl;
+    timeLoop("wrap-around +          ", elements, rounds, [&]
+             {
+                 for (auto i = std::size_t{0}; i < elements; ++i)
+                 {
+                     wrapped[i] = static_cast<std::uint16_t>(a[i] + b[i]);
+                 } });
+
+    timeLoop("Saturating<T> loop     ", elements, rounds, [&]
+             {
+                 for (auto i = std::size_t{0}; i < elements; ++i)
+                 {
+                     out[i] = (Saturating<std::uint16_t>{a[i]} + Saturating<std::uint16_t>{b[i]}).value();
+                 } });
+    if (out != wrapped)
+    {
+        std::cout << "Error: Saturating<T> disagrees with +" << std::endl;
+        return 1;
+    }
+
+    timeLoop("Checked<T> loop        ", elements, rounds, [&]
+             {
+                 for (auto i = std::size_t{0}; i < elements; ++i)
+                 {
+                     out[i] = (Checked<std::uint16_t>{a[i]} + Checked<std::uint16_t>{b[i]}).value();
+                 } });
+    if (out != wrapped)
+    {
+        std::cout << "Error: Checked<T> disagrees with +" << std::endl;
+        return 1;
+    }
+
+    timeLoop("saturating_add (SIMD)  ", elements, rounds, [&]
+             { saturating_add(a, b, out); });
+    if (out != wrapped)
+    {
+        std::cout << "Error: saturating_add disagrees with +" << std::endl;
+        return 1;
+    }
+
+    timeLoop("checked_add (SIMD)     ", elements, rounds, [&]
+             { checked_add(a, b, out); });
+    if (out != wrapped)
+    {
+        std::cout << "Error: checked_add disagrees with +" << std::endl;
+        return 1;
+    }
+
+    if (elements == 0)
+    {
+        return 0;
+    }
+
+    // One overflowing element somewhere in the middle
+    const auto bad = elements / 2;
+    a[bad] = 65000;
+    b[bad] = 1000;
+    try
+    {
+        checked_add(a, b, out);
+        std::cout << "Error: checked_add missed the overflow" << std::endl;
+        return 1;
+    }
+    catch (const std::overflow_error &e)
+    {
+        std::cout << "\nAfter setting element " << bad << " to 65000 + 1000, checked_add throws \"" << e.what()
+                  << "\"" << std::endl;
+    }
+    saturating_add(a, b, out);
+    std::cout << "and saturating_add gives " << out[bad] << std::endl;
+
+    return 0;
+}
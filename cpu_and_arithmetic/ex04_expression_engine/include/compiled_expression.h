@@ -0,0 +1,100 @@
+#ifndef COMPILED_EXPRESSION_H
+#define COMPILED_EXPRESSION_H
+
+#include "expression.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * An expression compiled to bytecode for a register machine whose registers
+ * hold a block of 1024 values instead of one. Evaluating it runs each
+ * instruction over a whole block of rows before moving on to the next, so
+ * the cost of decoding an instruction is shared by 1024 rows and each
+ * instruction is a simple loop the compiler vectorizes:
+ *
+ *     const Node tree{parse_expression("price * (1 - discount)", names)};
+ *     const CompiledExpression expression{tree};
+ *     expression.evaluate(columns, results);   // results[row] for every row
+ *
+ * The results are identical to evaluate_row, since every row goes through
+ * the same operations in the same order.
+ */
+class CompiledExpression
+{
+public:
+    static constexpr std::size_t blockSize{1024};
+
+    explicit CompiledExpression(const Node &root);
+
+    /**
+     * results[row] = the expression for row, where columns[i] is column i of
+     * the names the expression was parsed with. All columns must have
+     * results.size() rows, otherwise std::invalid_argument is thrown.
+     */
+    void evaluate(std::span<const std::span<const double>> columns, std::span<double> results) const;
+
+    // The bytecode, one instruction per line
+    std::string disassemble() const;
+
+    std::size_t instruction_count() const { return m_instructions.size(); }
+    std::size_t register_count() const { return m_registerCount; }
+
+private:
+    enum class Opcode : std::uint8_t
+    {
+        negate,
+        add,
+        subtract,
+        multiply,
+        divide,
+        multiplyAdd,
+        sqrt,
+        abs,
+        min,
+        max,
+    };
+
+    // Where an operand's block of values comes from
+    struct Operand
+    {
+        enum class Source : std::uint8_t
+        {
+            column,
+            constant,
+            scratch,
+        };
+
+        Source source{Source::scratch};
+        std::uint32_t index{0};
+    };
+
+    struct Instruction
+    {
+        Opcode opcode{Opcode::add};
+        std::uint32_t result{0};   // scratch register
+        Operand a{};
+        Operand b{};
+        Operand c{};               // only for multiplyAdd: a * b + c
+    };
+
+    Operand compile(const Node &node);
+    Operand emit(Opcode opcode, Operand a, Operand b, Operand c);
+    void release(Operand operand);
+
+    // Runs one instruction over count rows, or FixedCount if it is not 0
+    template <std::size_t FixedCount>
+    static void execute(Opcode opcode, double *out, const double *a, const double *b, const double *c,
+                        std::size_t count);
+
+    std::vector<Instruction> m_instructions{};
+    std::vector<double> m_constants{};
+    Operand m_result{};
+    std::uint32_t m_registerCount{0};
+    std::vector<std::uint32_t> m_freeRegisters{};
+};
+
+#endif
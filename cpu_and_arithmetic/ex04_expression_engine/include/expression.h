@@ -0,0 +1,55 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Syntax tree of an arithmetic formula over named columns, e.g.
+ *
+ *     price * quantity * (1 - discount) + max(shipping, 4.95)
+ *
+ * Supported are numbers, column names, + - * / with the usual precedence,
+ * unary minus, parentheses and the functions sqrt(x), abs(x), min(x, y)
+ * and max(x, y). All arithmetic is done in double.
+ */
+struct Node
+{
+    enum class Kind
+    {
+        number,
+        column,
+        negate,
+        add,
+        subtract,
+        multiply,
+        divide,
+        sqrt,
+        abs,
+        min,
+        max,
+    };
+
+    Kind kind{Kind::number};
+    double value{0};          // for numbers
+    std::size_t column{0};    // for columns, the index into the column names
+    std::vector<Node> operands{};
+};
+
+/**
+ * Parses text into a syntax tree. Column names are looked up in columnNames,
+ * and the index of the name is stored in the node. Throws
+ * std::invalid_argument for syntax errors and unknown names.
+ */
+Node parse_expression(std::string_view text, std::span<const std::string> columnNames);
+
+/**
+ * Evaluates the expression for a single row by walking the tree, the way a
+ * simple interpreter would. columns[i][row] is the value of column i.
+ */
+double evaluate_row(const Node &node, std::span<const std::span<const double>> columns, std::size_t row);
+
+#endif
@@ -0,0 +1,331 @@
+#include "compiled_expression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace
+{
+    /**
+     * The loops every instruction runs over a block. The result register is
+     * never one of the operands (see CompiledExpression::emit), so the
+     * pointers are marked __restrict and the compiler vectorizes the loops
+     * without checking for overlap at runtime.
+     */
+    template <typename Operation>
+    void unaryLoop(double *__restrict out, const double *__restrict a, std::size_t count, Operation operation)
+    {
+        for (std::size_t i{0}; i < count; ++i)
+        {
+            out[i] = operation(a[i]);
+        }
+    }
+
+    template <typename Operation>
+    void binaryLoop(double *__restrict out, const double *__restrict a, const double *__restrict b, std::size_t count,
+                    Operation operation)
+    {
+        for (std::size_t i{0}; i < count; ++i)
+        {
+            out[i] = operation(a[i], b[i]);
+        }
+    }
+
+    void multiplyAddLoop(double *__restrict out, const double *__restrict a, const double *__restrict b,
+                         const double *__restrict c, std::size_t count)
+    {
+        for (std::size_t i{0}; i < count; ++i)
+        {
+            out[i] = a[i] * b[i] + c[i];
+        }
+    }
+
+    bool isConstant(const Node &node)
+    {
+        return node.kind != Node::Kind::column &&
+               std::all_of(node.operands.begin(), node.operands.end(), isConstant);
+    }
+}
+
+CompiledExpression::CompiledExpression(const Node &root)
+{
+    m_result = compile(root);
+    m_freeRegisters.clear();
+}
+
+CompiledExpression::Operand CompiledExpression::compile(const Node &node)
+{
+    // Parts without columns are computed once, here, instead of per row
+    if (isConstant(node))
+    {
+        m_constants.push_back(evaluate_row(node, {}, 0));
+        return {Operand::Source::constant, static_cast<std::uint32_t>(m_constants.size() - 1)};
+    }
+
+    switch (node.kind)
+    {
+    case Node::Kind::column:
+        return {Operand::Source::column, static_cast<std::uint32_t>(node.column)};
+    case Node::Kind::negate:
+        return emit(Opcode::negate, compile(node.operands[0]), {}, {});
+    case Node::Kind::sqrt:
+        return emit(Opcode::sqrt, compile(node.operands[0]), {}, {});
+    case Node::Kind::abs:
+        return emit(Opcode::abs, compile(node.operands[0]), {}, {});
+    case Node::Kind::add:
+    {
+        // x * y + z in one pass over the block instead of two
+        for (std::size_t i{0}; i < 2; ++i)
+        {
+            const Node &product{node.operands[i]};
+            if (product.kind == Node::Kind::multiply && !isConstant(product))
+            {
+                const Operand a{compile(product.operands[0])};
+                const Operand b{compile(product.operands[1])};
+                return emit(Opcode::multiplyAdd, a, b, compile(node.operands[1 - i]));
+            }
+        }
+        const Operand a{compile(node.operands[0])};
+        return emit(Opcode::add, a, compile(node.operands[1]), {});
+    }
+    default:
+        break;
+    }
+
+    Opcode opcode{Opcode::subtract};
+    switch (node.kind)
+    {
+    case Node::Kind::multiply:
+        opcode = Opcode::multiply;
+        break;
+    case Node::Kind::divide:
+        opcode = Opcode::divide;
+        break;
+    case Node::Kind::min:
+        opcode = Opcode::min;
+        break;
+    case Node::Kind::max:
+        opcode = Opcode::max;
+        break;
+    default:
+        break;
+    }
+    const Operand a{compile(node.operands[0])};
+    return emit(opcode, a, compile(node.operands[1]), {});
+}
+
+CompiledExpression::Operand CompiledExpression::emit(Opcode opcode, Operand a, Operand b, Operand c)
+{
+    // Take the result register before giving back the operands', so that
+    // an instruction never writes the block it is reading
+    std::uint32_t result{m_registerCount};
+    if (m_freeRegisters.empty())
+    {
+        ++m_registerCount;
+    }
+    else
+    {
+        result = m_freeRegisters.back();
+        m_freeRegisters.pop_back();
+    }
+
+    const bool usesB{opcode != Opcode::negate && opcode != Opcode::sqrt && opcode != Opcode::abs};
+    const bool usesC{opcode == Opcode::multiplyAdd};
+    release(a);
+    if (usesB)
+    {
+        release(b);
+    }
+    if (usesC)
+    {
+        release(c);
+    }
+
+    m_instructions.push_back({opcode, result, a, b, c});
+    return {Operand::Source::scratch, result};
+}
+
+void CompiledExpression::release(Operand operand)
+{
+    if (operand.source == Operand::Source::scratch)
+    {
+        m_freeRegisters.push_back(operand.index);
+    }
+}
+
+template <std::size_t FixedCount>
+void CompiledExpression::execute(Opcode opcode, double *out, const double *a, const double *b, const double *c,
+                                 std::size_t count)
+{
+    if constexpr (FixedCount != 0)
+    {
+        count = FixedCount;
+    }
+
+    switch (opcode)
+    {
+    case Opcode::negate:
+        unaryLoop(out, a, count, [](double x)
+                  { return -x; });
+        break;
+    case Opcode::add:
+        binaryLoop(out, a, b, count, [](double x, double y)
+                   { return x + y; });
+        break;
+    case Opcode::subtract:
+        binaryLoop(out, a, b, count, [](double x, double y)
+                   { return x - y; });
+        break;
+    case Opcode::multiply:
+        binaryLoop(out, a, b, count, [](double x, double y)
+                   { return x * y; });
+        break;
+    case Opcode::divide:
+        binaryLoop(out, a, b, count, [](double x, double y)
+                   { return x / y; });
+        break;
+    case Opcode::multiplyAdd:
+        multiplyAddLoop(out, a, b, c, count);
+        break;
+    case Opcode::sqrt:
+        unaryLoop(out, a, count, [](double x)
+                  { return std::sqrt(x); });
+        break;
+    case Opcode::abs:
+        unaryLoop(out, a, count, [](double x)
+                  { return std::abs(x); });
+        break;
+    case Opcode::min:
+        binaryLoop(out, a, b, count, [](double x, double y)
+                   { return y < x ? y : x; });
+        break;
+    case Opcode::max:
+        binaryLoop(out, a, b, count, [](double x, double y)
+                   { return x < y ? y : x; });
+        break;
+    }
+}
+
+void CompiledExpression::evaluate(std::span<const std::span<const double>> columns, std::span<double> results) const
+{
+    const std::size_t rows{results.size()};
+    for (const auto &column : columns)
+    {
+        if (column.size() != rows)
+        {
+            throw std::invalid_argument{"CompiledExpression: all columns need one value per result"};
+        }
+    }
+    const auto checkColumn{[&](Operand operand)
+                           {
+                               if (operand.source == Operand::Source::column && operand.index >= columns.size())
+                               {
+                                   throw std::invalid_argument{"CompiledExpression: missing column " +
+                                                               std::to_string(operand.index)};
+                               }
+                           }};
+    for (const auto &instruction : m_instructions)
+    {
+        for (const Operand &operand : {instruction.a, instruction.b, instruction.c})
+        {
+            checkColumn(operand);
+        }
+    }
+    // A formula that is just a column name compiles to no instructions,
+    // only a result that reads the column
+    checkColumn(m_result);
+
+    // Constants are blocks too, so every instruction works the same way
+    std::vector<double> scratch(m_registerCount * blockSize);
+    std::vector<double> constants(m_constants.size() * blockSize);
+    for (std::size_t i{0}; i < m_constants.size(); ++i)
+    {
+        std::fill_n(constants.begin() + static_cast<std::ptrdiff_t>(i * blockSize), blockSize, m_constants[i]);
+    }
+
+    for (std::size_t start{0}; start < rows; start += blockSize)
+    {
+        const std::size_t count{std::min(blockSize, rows - start)};
+        const auto block{[&](Operand operand) -> const double *
+                         {
+                             switch (operand.source)
+                             {
+                             case Operand::Source::column:
+                                 return columns[operand.index].data() + start;
+                             case Operand::Source::constant:
+                                 return constants.data() + operand.index * blockSize;
+                             case Operand::Source::scratch:
+                                 break;
+                             }
+                             return scratch.data() + operand.index * blockSize;
+                         }};
+
+        for (const auto &instruction : m_instructions)
+        {
+            double *out{scratch.data() + instruction.result * blockSize};
+            const double *a{block(instruction.a)};
+            const double *b{block(instruction.b)};
+            // Full blocks pass their size as a constant, since GCC's -O2
+            // only vectorizes loops whose trip count it knows
+            if (count == blockSize)
+            {
+                execute<blockSize>(instruction.opcode, out, a, b, block(instruction.c), count);
+            }
+            else
+            {
+                execute<0>(instruction.opcode, out, a, b, block(instruction.c), count);
+            }
+        }
+
+        const double *result{block(m_result)};
+        std::copy(result, result + count, results.begin() + static_cast<std::ptrdiff_t>(start));
+    }
+}
+
+std::string CompiledExpression::disassemble() const
+{
+    constexpr std::array<std::string_view, 10> names{"neg", "add", "sub", "mul", "div", "madd", "sqrt", "abs", "min",
+                                                     "max"};
+    const auto print{[this](std::ostream &out, Operand operand)
+                     {
+                         switch (operand.source)
+                         {
+                         case Operand::Source::column:
+                             out << "column" << operand.index;
+                             break;
+                         case Operand::Source::constant:
+                             out << m_constants[operand.index];
+                             break;
+                         case Operand::Source::scratch:
+                             out << 'r' << operand.index;
+                             break;
+                         }
+                     }};
+
+    std::ostringstream out{};
+    for (const auto &instruction : m_instructions)
+    {
+        const auto opcode{static_cast<std::size_t>(instruction.opcode)};
+        out << 'r' << instruction.result << " = " << names[opcode] << ' ';
+        print(out, instruction.a);
+        if (instruction.opcode != Opcode::negate && instruction.opcode != Opcode::sqrt &&
+            instruction.opcode != Opcode::abs)
+        {
+            out << ", ";
+            print(out, instruction.b);
+        }
+        if (instruction.opcode == Opcode::multiplyAdd)
+        {
+            out << ", ";
+            print(out, instruction.c);
+        }
+        out << '\n';
+    }
+    out << "result = ";
+    print(out, m_result);
+    out << '\n';
+    return out.str();
+}
@@ -0,0 +1,264 @@
+#include "expression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    /**
+     * Recursive descent parser, one function per precedence level:
+     *
+     *     sum     = product (("+" | "-") product)*
+     *     product = unary (("*" | "/") unary)*
+     *     unary   = "-" unary | primary
+     *     primary = number | name | name "(" sum ("," sum)* ")" | "(" sum ")"
+     */
+    class Parser
+    {
+    public:
+        Parser(std::string_view text, std::span<const std::string> columnNames)
+            : m_text{text}, m_columnNames{columnNames}
+        {
+        }
+
+        Node parse()
+        {
+            Node node{sum()};
+            skipSpaces();
+            if (m_position != m_text.size())
+            {
+                fail("unexpected '" + std::string{m_text[m_position]} + "'");
+            }
+            return node;
+        }
+
+    private:
+        Node sum()
+        {
+            Node node{product()};
+            while (true)
+            {
+                if (accept('+'))
+                {
+                    node = binary(Node::Kind::add, std::move(node), product());
+                }
+                else if (accept('-'))
+                {
+                    node = binary(Node::Kind::subtract, std::move(node), product());
+                }
+                else
+                {
+                    return node;
+                }
+            }
+        }
+
+        Node product()
+        {
+            Node node{unary()};
+            while (true)
+            {
+                if (accept('*'))
+                {
+                    node = binary(Node::Kind::multiply, std::move(node), unary());
+                }
+                else if (accept('/'))
+                {
+                    node = binary(Node::Kind::divide, std::move(node), unary());
+                }
+                else
+                {
+                    return node;
+                }
+            }
+        }
+
+        Node unary()
+        {
+            if (accept('-'))
+            {
+                Node node{Node::Kind::negate};
+                node.operands.push_back(unary());
+                return node;
+            }
+            return primary();
+        }
+
+        Node primary()
+        {
+            skipSpaces();
+            if (accept('('))
+            {
+                Node node{sum()};
+                expect(')');
+                return node;
+            }
+            if (m_position < m_text.size() && (std::isdigit(static_cast<unsigned char>(m_text[m_position])) ||
+                                               m_text[m_position] == '.'))
+            {
+                return number();
+            }
+
+            const std::string name{identifier()};
+            if (!accept('('))
+            {
+                const auto found{std::find(m_columnNames.begin(), m_columnNames.end(), name)};
+                if (found == m_columnNames.end())
+                {
+                    fail("unknown column '" + name + "'");
+                }
+                Node node{Node::Kind::column};
+                node.column = static_cast<std::size_t>(found - m_columnNames.begin());
+                return node;
+            }
+
+            Node node{};
+            std::size_t arity{1};
+            if (name == "sqrt")
+            {
+                node.kind = Node::Kind::sqrt;
+            }
+            else if (name == "abs")
+            {
+                node.kind = Node::Kind::abs;
+            }
+            else if (name == "min" || name == "max")
+            {
+                node.kind = name == "min" ? Node::Kind::min : Node::Kind::max;
+                arity = 2;
+            }
+            else
+            {
+                fail("unknown function '" + name + "'");
+            }
+
+            node.operands.push_back(sum());
+            while (node.operands.size() < arity)
+            {
+                expect(',');
+                node.operands.push_back(sum());
+            }
+            expect(')');
+            return node;
+        }
+
+        Node number()
+        {
+            // strtod needs a null-terminated string
+            const std::string rest{m_text.substr(m_position)};
+            char *end{nullptr};
+            Node node{Node::Kind::number};
+            node.value = std::strtod(rest.c_str(), &end);
+            m_position += static_cast<std::size_t>(end - rest.c_str());
+            return node;
+        }
+
+        std::string identifier()
+        {
+            const std::size_t start{m_position};
+            while (m_position < m_text.size() &&
+                   (std::isalnum(static_cast<unsigned char>(m_text[m_position])) || m_text[m_position] == '_'))
+            {
+                ++m_position;
+            }
+            if (m_position == start)
+            {
+                fail(m_position == m_text.size() ? "unexpected end of expression"
+                                                 : "unexpected '" + std::string{m_text[m_position]} + "'");
+            }
+            return std::string{m_text.substr(start, m_position - start)};
+        }
+
+        static Node binary(Node::Kind kind, Node left, Node right)
+        {
+            Node node{kind};
+            node.operands.push_back(std::move(left));
+            node.operands.push_back(std::move(right));
+            return node;
+        }
+
+        void skipSpaces()
+        {
+            while (m_position < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_position])))
+            {
+                ++m_position;
+            }
+        }
+
+        bool accept(char c)
+        {
+            skipSpaces();
+            if (m_position < m_text.size() && m_text[m_position] == c)
+            {
+                ++m_position;
+                return true;
+            }
+            return false;
+        }
+
+        void expect(char c)
+        {
+            if (!accept(c))
+            {
+                fail("expected '" + std::string{c} + "'");
+            }
+        }
+
+        [[noreturn]] void fail(const std::string &message) const
+        {
+            throw std::invalid_argument{"parse_expression: " + message + " at position " +
+                                        std::to_string(m_position)};
+        }
+
+        std::string_view m_text;
+        std::span<const std::string> m_columnNames;
+        std::size_t m_position{0};
+    };
+}
+
+Node parse_expression(std::string_view text, std::span<const std::string> columnNames)
+{
+    return Parser{text, columnNames}.parse();
+}
+
+double evaluate_row(const Node &node, std::span<const std::span<const double>> columns, std::size_t row)
+{
+    switch (node.kind)
+    {
+    case Node::Kind::number:
+        return node.value;
+    case Node::Kind::column:
+        return columns[node.column][row];
+    case Node::Kind::negate:
+        return -evaluate_row(node.operands[0], columns, row);
+    case Node::Kind::add:
+        return evaluate_row(node.operands[0], columns, row) + evaluate_row(node.operands[1], columns, row);
+    case Node::Kind::subtract:
+        return evaluate_row(node.operands[0], columns, row) - evaluate_row(node.operands[1], columns, row);
+    case Node::Kind::multiply:
+        return evaluate_row(node.operands[0], columns, row) * evaluate_row(node.operands[1], columns, row);
+    case Node::Kind::divide:
+        return evaluate_row(node.operands[0], columns, row) / evaluate_row(node.operands[1], columns, row);
+    case Node::Kind::sqrt:
+        return std::sqrt(evaluate_row(node.operands[0], columns, row));
+    case Node::Kind::abs:
+        return std::abs(evaluate_row(node.operands[0], columns, row));
+    case Node::Kind::min:
+    {
+        const double a{evaluate_row(node.operands[0], columns, row)};
+        const double b{evaluate_row(node.operands[1], columns, row)};
+        return b < a ? b : a;
+    }
+    case Node::Kind::max:
+    {
+        const double a{evaluate_row(node.operands[0], columns, row)};
+        const double b{evaluate_row(node.operands[1], columns, row)};
+        return a < b ? b : a;
+    }
+    }
+    return 0;
+}
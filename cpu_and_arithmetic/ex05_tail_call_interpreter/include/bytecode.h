@@ -0,0 +1,54 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Bytecode for a small stack machine with 64-bit integer values and a fixed
+ * number of local variables (all starting at 0). Binary operations pop b,
+ * then a, and push a op b; comparisons push 1 or 0. Jumps take the index of
+ * the target instruction. halt ends the program, whose result is the value
+ * on top of the stack.
+ */
+enum class Opcode : std::uint8_t
+{
+    push,        // push operand
+    load,        // push locals[operand]
+    store,       // pop into locals[operand]
+    add,
+    subtract,
+    multiply,
+    divide,      // division by zero gives 0
+    remainder,   // so does the remainder
+    lessThan,
+    equal,
+    jump,        // continue at operand
+    jumpIfZero,  // pop, continue at operand if it was 0
+    halt,
+};
+
+struct Instruction
+{
+    Opcode opcode{Opcode::halt};
+    std::int32_t operand{0};
+};
+
+struct Program
+{
+    std::vector<Instruction> code{};
+    std::size_t localCount{0};
+};
+
+/**
+ * Checks that every jump target and local is in range, the stack never
+ * underflows, every path ends in halt with a value on the stack, and the
+ * stack has the same depth whichever way an instruction is reached. Returns
+ * the largest stack depth, throws std::invalid_argument otherwise. The
+ * interpreters only run verified programs, so they need no checks of their
+ * own.
+ */
+std::size_t verify_program(const Program &program);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef HARDWARE_COUNTER_H
+#define HARDWARE_COUNTER_H
+
+#include <cstdint>
+
+/**
+ * Counts a CPU event, like mispredicted branches, for the calling thread
+ * using the Linux perf_event_open system call:
+ *
+ *     HardwareCounter misses{HardwareCounter::Event::branchMisses};
+ *     misses.start();
+ *     work();
+ *     const std::uint64_t count{misses.stop()};
+ *
+ * Counting is not always allowed: the kernel setting
+ * /proc/sys/kernel/perf_event_paranoid may forbid it, and containers and
+ * virtual machines often have no access to the CPU's counters. available()
+ * is false then, and stop() returns 0.
+ */
+class HardwareCounter
+{
+public:
+    enum class Event
+    {
+        instructions,
+        branches,
+        branchMisses,
+    };
+
+    explicit HardwareCounter(Event event);
+    ~HardwareCounter();
+
+    HardwareCounter(const HardwareCounter &) = delete;
+    HardwareCounter &operator=(const HardwareCounter &) = delete;
+
+    bool available() const { return m_fd >= 0; }
+
+    void start();
+    std::uint64_t stop();
+
+private:
+    int m_fd{-1};
+};
+
+#endif
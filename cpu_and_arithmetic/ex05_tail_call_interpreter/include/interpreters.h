@@ -0,0 +1,26 @@
+#ifndef INTERPRETERS_H
+#define INTERPRETERS_H
+
+#include "bytecode.h"
+
+#include <cstdint>
+
+/**
+ * Three interpreters for the same bytecode, differing only in how they get
+ * from one instruction to the next. All verify the program first (throwing
+ * std::invalid_argument if verify_program does) and return its result.
+ *
+ *     run_switch          a loop around a switch on the opcode
+ *     run_computed_goto   every handler jumps straight to the next handler
+ *                         through a table of label addresses (GCC and Clang)
+ *     run_tail_calls      every handler is a function that tail-calls the
+ *                         next handler
+ */
+std::int64_t run_switch(const Program &program);
+std::int64_t run_computed_goto(const Program &program);
+std::int64_t run_tail_calls(const Program &program);
+
+// How many instructions running the program executes
+std::uint64_t count_instructions(const Program &program);
+
+#endif
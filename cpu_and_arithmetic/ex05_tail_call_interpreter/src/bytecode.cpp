@@ -0,0 +1,112 @@
+#include "bytecode.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    [[noreturn]] void fail(std::size_t position, const std::string &message)
+    {
+        throw std::invalid_argument{"verify_program: instruction " + std::to_string(position) + ": " + message};
+    }
+}
+
+std::size_t verify_program(const Program &program)
+{
+    const std::size_t size{program.code.size()};
+    if (size == 0)
+    {
+        throw std::invalid_argument{"verify_program: empty program"};
+    }
+
+    // Stack depth before each instruction, found by following every path
+    constexpr std::size_t unknown{static_cast<std::size_t>(-1)};
+    std::vector<std::size_t> depths(size, unknown);
+    std::vector<std::size_t> pending{0};
+    depths[0] = 0;
+    std::size_t maxDepth{0};
+
+    const auto reach{[&](std::size_t position, std::size_t target, std::size_t depth)
+                     {
+                         if (target >= size)
+                         {
+                             fail(position, "jumps or runs past the end");
+                         }
+                         if (depths[target] == unknown)
+                         {
+                             depths[target] = depth;
+                             pending.push_back(target);
+                         }
+                         else if (depths[target] != depth)
+                         {
+                             fail(target, "reached with different stack depths");
+                         }
+                     }};
+
+    while (!pending.empty())
+    {
+        const std::size_t position{pending.back()};
+        pending.pop_back();
+        const Instruction instruction{program.code[position]};
+        std::size_t depth{depths[position]};
+
+        std::size_t pops{0};
+        std::size_t pushes{0};
+        switch (instruction.opcode)
+        {
+        case Opcode::push:
+            pushes = 1;
+            break;
+        case Opcode::load:
+        case Opcode::store:
+            if (instruction.operand < 0 || static_cast<std::size_t>(instruction.operand) >= program.localCount)
+            {
+                fail(position, "no local " + std::to_string(instruction.operand));
+            }
+            pops = instruction.opcode == Opcode::store;
+            pushes = instruction.opcode == Opcode::load;
+            break;
+        case Opcode::add:
+        case Opcode::subtract:
+        case Opcode::multiply:
+        case Opcode::divide:
+        case Opcode::remainder:
+        case Opcode::lessThan:
+        case Opcode::equal:
+            pops = 2;
+            pushes = 1;
+            break;
+        case Opcode::jump:
+        case Opcode::jumpIfZero:
+            if (instruction.operand < 0)
+            {
+                fail(position, "jumps before the start");
+            }
+            pops = instruction.opcode == Opcode::jumpIfZero;
+            break;
+        case Opcode::halt:
+            pops = 1;
+            break;
+        default:
+            fail(position, "unknown opcode");
+        }
+
+        if (depth < pops)
+        {
+            fail(position, "stack underflow");
+        }
+        depth = depth - pops + pushes;
+        maxDepth = std::max(maxDepth, depth);
+
+        if (instruction.opcode == Opcode::jump || instruction.opcode == Opcode::jumpIfZero)
+        {
+            reach(position, static_cast<std::size_t>(instruction.operand), depth);
+        }
+        if (instruction.opcode != Opcode::jump && instruction.opcode != Opcode::halt)
+        {
+            reach(position, position + 1, depth);
+        }
+    }
+    return maxDepth;
+}
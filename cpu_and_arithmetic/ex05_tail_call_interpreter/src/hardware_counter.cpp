@@ -0,0 +1,66 @@
+#include "hardware_counter.h"
+
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+HardwareCounter::HardwareCounter(Event event)
+{
+    perf_event_attr attributes{};
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    switch (event)
+    {
+    case Event::instructions:
+        attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case Event::branches:
+        attributes.config = PERF_COUNT_HW_BRANCH_INSTRUCTIONS;
+        break;
+    case Event::branchMisses:
+        attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    }
+    // Start stopped, and only count this program, not the kernel
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    // There is no glibc wrapper for perf_event_open
+    m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+HardwareCounter::~HardwareCounter()
+{
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+}
+
+void HardwareCounter::start()
+{
+    if (m_fd >= 0)
+    {
+        ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+std::uint64_t HardwareCounter::stop()
+{
+    std::uint64_t count{0};
+    if (m_fd >= 0)
+    {
+        ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(m_fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count)))
+        {
+            count = 0;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,336 @@
+#include "interpreters.h"
+
+#include <vector>
+
+/**
+ * [[clang::musttail]] makes Clang either turn the call into a jump or stop
+ * with an error, so the stack cannot grow however many instructions run.
+ * GCC 15 has the same as [[gnu::musttail]]. Older GCC versions still turn
+ * these calls into jumps when optimizing (-O2 includes
+ * -foptimize-sibling-calls), but without a guarantee: built with -O0, the
+ * tail call interpreter overflows the stack like the stack overflow example
+ * in crashes_and_undefined_behavior.
+ */
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(clang::musttail)
+#define MUSTTAIL [[clang::musttail]]
+#elif defined(__has_cpp_attribute) && __has_cpp_attribute(gnu::musttail)
+#define MUSTTAIL [[gnu::musttail]]
+#else
+#define MUSTTAIL
+#endif
+
+namespace
+{
+    // Arithmetic wraps around like unsigned arithmetic instead of being
+    // undefined on overflow, and dividing by zero gives zero
+    std::int64_t add(std::int64_t a, std::int64_t b)
+    {
+        return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) + static_cast<std::uint64_t>(b));
+    }
+
+    std::int64_t subtract(std::int64_t a, std::int64_t b)
+    {
+        return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) - static_cast<std::uint64_t>(b));
+    }
+
+    std::int64_t multiply(std::int64_t a, std::int64_t b)
+    {
+        return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) * static_cast<std::uint64_t>(b));
+    }
+
+    std::int64_t divide(std::int64_t a, std::int64_t b)
+    {
+        if (b == 0)
+        {
+            return 0;
+        }
+        // The smallest value divided by -1 does not fit
+        return b == -1 ? subtract(0, a) : a / b;
+    }
+
+    std::int64_t remainder(std::int64_t a, std::int64_t b)
+    {
+        return b == 0 || b == -1 ? 0 : a % b;
+    }
+
+    std::int64_t lessThan(std::int64_t a, std::int64_t b)
+    {
+        return a < b;
+    }
+
+    std::int64_t equal(std::int64_t a, std::int64_t b)
+    {
+        return a == b;
+    }
+
+    template <bool Count>
+    std::int64_t switchLoop(const Program &program, std::uint64_t &executed)
+    {
+        std::vector<std::int64_t> stack(verify_program(program));
+        std::vector<std::int64_t> locals(program.localCount);
+        const Instruction *code{program.code.data()};
+        std::int64_t *sp{stack.data()}; // one past the top of the stack
+        std::size_t pc{0};
+
+        while (true)
+        {
+            const Instruction instruction{code[pc++]};
+            if constexpr (Count)
+            {
+                ++executed;
+            }
+
+            switch (instruction.opcode)
+            {
+            case Opcode::push:
+                *sp++ = instruction.operand;
+                break;
+            case Opcode::load:
+                *sp++ = locals[static_cast<std::size_t>(instruction.operand)];
+                break;
+            case Opcode::store:
+                locals[static_cast<std::size_t>(instruction.operand)] = *--sp;
+                break;
+            case Opcode::add:
+                sp[-2] = add(sp[-2], sp[-1]);
+                --sp;
+                break;
+            case Opcode::subtract:
+                sp[-2] = subtract(sp[-2], sp[-1]);
+                --sp;
+                break;
+            case Opcode::multiply:
+                sp[-2] = multiply(sp[-2], sp[-1]);
+                --sp;
+                break;
+            case Opcode::divide:
+                sp[-2] = divide(sp[-2], sp[-1]);
+                --sp;
+                break;
+            case Opcode::remainder:
+                sp[-2] = remainder(sp[-2], sp[-1]);
+                --sp;
+                break;
+            case Opcode::lessThan:
+                sp[-2] = lessThan(sp[-2], sp[-1]);
+                --sp;
+                break;
+            case Opcode::equal:
+                sp[-2] = equal(sp[-2], sp[-1]);
+                --sp;
+                break;
+            case Opcode::jump:
+                pc = static_cast<std::size_t>(instruction.operand);
+                break;
+            case Opcode::jumpIfZero:
+                if (*--sp == 0)
+                {
+                    pc = static_cast<std::size_t>(instruction.operand);
+                }
+                break;
+            case Opcode::halt:
+                return sp[-1];
+            }
+        }
+    }
+
+    /**
+     * The tail call interpreter translates the bytecode into "threaded code"
+     * first: each instruction becomes a pointer to its handler plus its
+     * operand. A handler does its work and then calls the handler of the
+     * next instruction as the very last thing it does, which the compiler
+     * turns into a jump. All interpreter state is passed as arguments, so it
+     * stays in registers across handlers.
+     */
+    struct Threaded;
+    using Handler = std::int64_t (*)(const Threaded *ip, std::int64_t *sp, std::int64_t *locals, const Threaded *code);
+
+    struct Threaded
+    {
+        Handler handler{nullptr};
+        std::int64_t operand{0};
+    };
+
+    std::int64_t handlePush(const Threaded *ip, std::int64_t *sp, std::int64_t *locals, const Threaded *code)
+    {
+        *sp++ = ip->operand;
+        ++ip;
+        MUSTTAIL return ip->handler(ip, sp, locals, code);
+    }
+
+    std::int64_t handleLoad(const Threaded *ip, std::int64_t *sp, std::int64_t *locals, const Threaded *code)
+    {
+        *sp++ = locals[ip->operand];
+        ++ip;
+        MUSTTAIL return ip->handler(ip, sp, locals, code);
+    }
+
+    std::int64_t handleStore(const Threaded *ip, std::int64_t *sp, std::int64_t *locals, const Threaded *code)
+    {
+        locals[ip->operand] = *--sp;
+        ++ip;
+        MUSTTAIL return ip->handler(ip, sp, locals, code);
+    }
+
+    template <std::int64_t (*operation)(std::int64_t, std::int64_t)>
+    std::int64_t handleBinary(const Threaded *ip, std::int64_t *sp, std::int64_t *locals, const Threaded *code)
+    {
+        sp[-2] = operation(sp[-2], sp[-1]);
+        --sp;
+        ++ip;
+        MUSTTAIL return ip->handler(ip, sp, locals, code);
+    }
+
+    std::int64_t handleJump(const Threaded *ip, std::int64_t *sp, std::int64_t *locals, const Threaded *code)
+    {
+        ip = code + ip->operand;
+        MUSTTAIL return ip->handler(ip, sp, locals, code);
+    }
+
+    std::int64_t handleJumpIfZero(const Threaded *ip, std::int64_t *sp, std::int64_t *locals, const Threaded *code)
+    {
+        ip = *--sp == 0 ? code + ip->operand : ip + 1;
+        MUSTTAIL return ip->handler(ip, sp, locals, code);
+    }
+
+    std::int64_t handleHalt(const Threaded *, std::int64_t *sp, std::int64_t *, const Threaded *)
+    {
+        return sp[-1];
+    }
+
+    // Indexed by Opcode
+    constexpr Handler handlers[]{handlePush,
+                                 handleLoad,
+                                 handleStore,
+                                 handleBinary<add>,
+                                 handleBinary<subtract>,
+                                 handleBinary<multiply>,
+                                 handleBinary<divide>,
+                                 handleBinary<remainder>,
+                                 handleBinary<lessThan>,
+                                 handleBinary<equal>,
+                                 handleJump,
+                                 handleJumpIfZero,
+                                 handleHalt};
+}
+
+std::int64_t run_switch(const Program &program)
+{
+    std::uint64_t executed{0};
+    return switchLoop<false>(program, executed);
+}
+
+std::uint64_t count_instructions(const Program &program)
+{
+    std::uint64_t executed{0};
+    switchLoop<true>(program, executed);
+    return executed;
+}
+
+/**
+ * Labels as values are a GCC extension (also supported by Clang): &&label is
+ * the address of a label and goto *address jumps there. Replacing each
+ * opcode with the address of its handler ("direct threading") means the end
+ * of every handler has its own indirect jump, instead of all opcodes sharing
+ * the one jump of the switch. The branch predictor can then learn patterns
+ * like "after a load usually comes an add".
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+std::int64_t run_computed_goto(const Program &program)
+{
+    static const void *const labels[]{&&push, &&load, &&store, &&add, &&subtract, &&multiply, &&divide,
+                                      &&remainder, &&lessThan, &&equal, &&jump, &&jumpIfZero, &&halt};
+
+    struct LabelInstruction
+    {
+        const void *label{nullptr};
+        std::int64_t operand{0};
+    };
+
+    std::vector<std::int64_t> stack(verify_program(program));
+    std::vector<std::int64_t> locals(program.localCount);
+    std::vector<LabelInstruction> threaded{};
+    threaded.reserve(program.code.size());
+    for (const auto &instruction : program.code)
+    {
+        threaded.push_back({labels[static_cast<std::size_t>(instruction.opcode)], instruction.operand});
+    }
+
+    const LabelInstruction *code{threaded.data()};
+    const LabelInstruction *ip{code};
+    std::int64_t *sp{stack.data()};
+    goto *ip->label;
+
+push:
+    *sp++ = ip->operand;
+    ++ip;
+    goto *ip->label;
+load:
+    *sp++ = locals[static_cast<std::size_t>(ip->operand)];
+    ++ip;
+    goto *ip->label;
+store:
+    locals[static_cast<std::size_t>(ip->operand)] = *--sp;
+    ++ip;
+    goto *ip->label;
+add:
+    sp[-2] = add(sp[-2], sp[-1]);
+    --sp;
+    ++ip;
+    goto *ip->label;
+subtract:
+    sp[-2] = subtract(sp[-2], sp[-1]);
+    --sp;
+    ++ip;
+    goto *ip->label;
+multiply:
+    sp[-2] = multiply(sp[-2], sp[-1]);
+    --sp;
+    ++ip;
+    goto *ip->label;
+divide:
+    sp[-2] = divide(sp[-2], sp[-1]);
+    --sp;
+    ++ip;
+    goto *ip->label;
+remainder:
+    sp[-2] = remainder(sp[-2], sp[-1]);
+    --sp;
+    ++ip;
+    goto *ip->label;
+lessThan:
+    sp[-2] = lessThan(sp[-2], sp[-1]);
+    --sp;
+    ++ip;
+    goto *ip->label;
+equal:
+    sp[-2] = equal(sp[-2], sp[-1]);
+    --sp;
+    ++ip;
+    goto *ip->label;
+jump:
+    ip = code + ip->operand;
+    goto *ip->label;
+jumpIfZero:
+    ip = *--sp == 0 ? code + ip->operand : ip + 1;
+    goto *ip->label;
+halt:
+    return sp[-1];
+}
+#pragma GCC diagnostic pop
+
+std::int64_t run_tail_calls(const Program &program)
+{
+    std::vector<std::int64_t> stack(verify_program(program));
+    std::vector<std::int64_t> locals(program.localCount);
+    std::vector<Threaded> threaded{};
+    threaded.reserve(program.code.size());
+    for (const auto &instruction : program.code)
+    {
+        threaded.push_back({handlers[static_cast<std::size_t>(instruction.opcode)], instruction.operand});
+    }
+
+    const Threaded *code{threaded.data()};
+    return code->handler(code, stack.data(), locals.data(), code);
+}
@@ -0,0 +1,349 @@
+/**
+ * Bytecode Interpreters: Switch, Computed Goto and Tail Calls
+ *
+ * The stack overflow example in crashes_and_undefined_behavior prints
+ * something after its recursive call on purpose, so the compiler cannot
+ * turn the call into a jump and every call really takes another piece of
+ * the stack. This example relies on the opposite: when a call is the very
+ * last thing a function does (a tail call), the compiler can reuse the
+ * caller's stack frame and simply jump to the callee. A chain of a billion
+ * tail calls then needs no more stack than one call.
+ *
+ * That makes tail calls a way to write fast interpreters. The textbook
+ * interpreter is a loop around a switch on the opcode. Every instruction
+ * goes through the same indirect jump at the top of the switch, so the
+ * branch predictor only sees "some opcode follows some opcode" and guesses
+ * wrong often. When each handler instead ends by jumping to the next
+ * instruction's handler itself, every handler has its own indirect jump,
+ * and the predictor can learn that, say, a load is usually followed by a
+ * push. There are two ways to write that in C++:
+ *
+ *     1. Computed goto, a GCC extension that Clang also supports: the
+ *        handlers are labels in one big function and goto *address jumps
+ *        between them.
+ *     2. Tail calls: each handler is a small function that ends by calling
+ *        the next handler. With Clang's [[clang::musttail]] (and GCC 15's
+ *        [[gnu::musttail]]) the call is guaranteed to become a jump, which
+ *        is how the Protocol Buffers parser upb and CPython 3.14 dispatch.
+ *        Each handler is a separate function the compiler optimizes on its
+ *        own, with the interpreter's state in argument registers.
+ *
+ * How much each technique gains depends a lot on the CPU: recent branch
+ * predictors do well even with a single shared jump.
+ *
+ * The branch misprediction counts come from perf_event_open, which is not
+ * available everywhere (see hardware_counter.h).
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="10"     # programs running 10 times longer
+ */
+
+#include "bytecode.h"
+#include "hardware_counter.h"
+#include "interpreters.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Builds a Program with named jump targets:
+ *
+ *     const auto loop = assembler.label();
+ *     assembler.bind(loop);
+ *     ...
+ *     assembler.jump(Opcode::jump, loop);
+ */
+class Assembler
+{
+public:
+    std::size_t label()
+    {
+        m_labels.push_back(-1);
+        return m_labels.size() - 1;
+    }
+
+    void bind(std::size_t label)
+    {
+        m_labels[label] = static_cast<std::int32_t>(m_program.code.size());
+    }
+
+    void emit(Opcode opcode, std::int32_t operand = 0)
+    {
+        m_program.code.push_back({opcode, operand});
+    }
+
+    void jump(Opcode opcode, std::size_t label)
+    {
+        m_fixups.push_back({m_program.code.size(), label});
+        emit(opcode);
+    }
+
+    Program finish(std::size_t localCount)
+    {
+        for (const auto &[position, label] : m_fixups)
+        {
+            m_program.code[position].operand = m_labels[label];
+        }
+        m_program.localCount = localCount;
+        return m_program;
+    }
+
+private:
+    struct Fixup
+    {
+        std::size_t position{0};
+        std::size_t label{0};
+    };
+
+    Program m_program{};
+    std::vector<std::int32_t> m_labels{};
+    std::vector<Fixup> m_fixups{};
+};
+
+// s = 0; for (i = 0; i < n; ++i) s = (s + i * i) % 1000003; return s
+Program sumOfSquares(std::int32_t n)
+{
+    enum Local : std::int32_t
+    {
+        i,
+        s,
+    };
+    Assembler a{};
+    const auto loop = a.label();
+    const auto end = a.label();
+
+    a.bind(loop);
+    a.emit(Opcode::load, i);
+    a.emit(Opcode::push, n);
+    a.emit(Opcode::lessThan);
+    a.jump(Opcode::jumpIfZero, end);
+    a.emit(Opcode::load, s);
+    a.emit(Opcode::load, i);
+    a.emit(Opcode::load, i);
+    a.emit(Opcode::multiply);
+    a.emit(Opcode::add);
+    a.emit(Opcode::push, 1000003);
+    a.emit(Opcode::remainder);
+    a.emit(Opcode::store, s);
+    a.emit(Opcode::load, i);
+    a.emit(Opcode::push, 1);
+    a.emit(Opcode::add);
+    a.emit(Opcode::store, i);
+    a.jump(Opcode::jump, loop);
+    a.bind(end);
+    a.emit(Opcode::load, s);
+    a.emit(Opcode::halt);
+    return a.finish(2);
+}
+
+// Total number of Collatz steps for all starting values 1 to n - 1, with
+// branches that depend on the data and are hard to predict
+Program collatzSteps(std::int32_t n)
+{
+    enum Local : std::int32_t
+    {
+        x,
+        y,
+        steps,
+    };
+    Assembler a{};
+    const auto outer = a.label();
+    const auto inner = a.label();
+    const auto step = a.label();
+    const auto even = a.label();
+    const auto counted = a.label();
+    const auto next = a.label();
+    const auto end = a.label();
+
+    a.emit(Opcode::push, 1);
+    a.emit(Opcode::store, x);
+    a.bind(outer);
+    a.emit(Opcode::load, x);
+    a.emit(Opcode::push, n);
+    a.emit(Opcode::lessThan);
+    a.jump(Opcode::jumpIfZero, end);
+    a.emit(Opcode::load, x);
+    a.emit(Opcode::store, y);
+
+    a.bind(inner);
+    a.emit(Opcode::load, y);
+    a.emit(Opcode::push, 1);
+    a.emit(Opcode::equal);
+    a.jump(Opcode::jumpIfZero, step);
+    a.jump(Opcode::jump, next);
+
+    a.bind(step);
+    a.emit(Opcode::load, y);
+    a.emit(Opcode::push, 2);
+    a.emit(Opcode::remainder);
+    a.jump(Opcode::jumpIfZero, even);
+    a.emit(Opcode::load, y);
+    a.emit(Opcode::push, 3);
+    a.emit(Opcode::multiply);
+    a.emit(Opcode::push, 1);
+    a.emit(Opcode::add);
+    a.emit(Opcode::store, y);
+    a.jump(Opcode::jump, counted);
+    a.bind(even);
+    a.emit(Opcode::load, y);
+    a.emit(Opcode::push, 2);
+    a.emit(Opcode::divide);
+    a.emit(Opcode::store, y);
+    a.bind(counted);
+    a.emit(Opcode::load, steps);
+    a.emit(Opcode::push, 1);
+    a.emit(Opcode::add);
+    a.emit(Opcode::store, steps);
+    a.jump(Opcode::jump, inner);
+
+    a.bind(next);
+    a.emit(Opcode::load, x);
+    a.emit(Opcode::push, 1);
+    a.emit(Opcode::add);
+    a.emit(Opcode::store, x);
+    a.jump(Opcode::jump, outer);
+    a.bind(end);
+    a.emit(Opcode::load, steps);
+    a.emit(Opcode::halt);
+    return a.finish(3);
+}
+
+// Number of primes below n, by trial division
+Program countPrimes(std::int32_t n)
+{
+    enum Local : std::int32_t
+    {
+        x,
+        d,
+        count,
+    };
+    Assembler a{};
+    const auto outer = a.label();
+    const auto inner = a.label();
+    const auto check = a.label();
+    const auto prime = a.label();
+    const auto next = a.label();
+    const auto end = a.label();
+
+    a.emit(Opcode::push, 2);
+    a.emit(Opcode::store, x);
+    a.bind(outer);
+    a.emit(Opcode::load, x);
+    a.emit(Opcode::push, n);
+    a.emit(Opcode::lessThan);
+    a.jump(Opcode::jumpIfZero, end);
+    a.emit(Opcode::push, 2);
+    a.emit(Opcode::store, d);
+
+    // Prime once d * d > x
+    a.bind(inner);
+    a.emit(Opcode::load, x);
+    a.emit(Opcode::load, d);
+    a.emit(Opcode::load, d);
+    a.emit(Opcode::multiply);
+    a.emit(Opcode::lessThan);
+    a.jump(Opcode::jumpIfZero, check);
+    a.jump(Opcode::jump, prime);
+    a.bind(check);
+    a.emit(Opcode::load, x);
+    a.emit(Opcode::load, d);
+    a.emit(Opcode::remainder);
+    a.jump(Opcode::jumpIfZero, next);
+    a.emit(Opcode::load, d);
+    a.emit(Opcode::push, 1);
+    a.emit(Opcode::add);
+    a.emit(Opcode::store, d);
+    a.jump(Opcode::jump, inner);
+
+    a.bind(prime);
+    a.emit(Opcode::load, count);
+    a.emit(Opcode::push, 1);
+    a.emit(Opcode::add);
+    a.emit(Opcode::store, count);
+    a.bind(next);
+    a.emit(Opcode::load, x);
+    a.emit(Opcode::push, 1);
+    a.emit(Opcode::add);
+    a.emit(Opcode::store, x);
+    a.jump(Opcode::jump, outer);
+    a.bind(end);
+    a.emit(Opcode::load, count);
+    a.emit(Opcode::halt);
+    return a.finish(3);
+}
+
+// Runs the program with one interpreter and prints time and mispredictions
+// per executed instruction; returns the program's result
+std::int64_t measure(const std::string &name, std::int64_t (*run)(const Program &), const Program &program,
+                     std::uint64_t instructions)
+{
+    HardwareCounter misses{HardwareCounter::Event::branchMisses};
+    misses.start();
+    auto start = std::chrono::high_resolution_clock::now();
+    const auto result = run(program);
+    auto stop = std::chrono::high_resolution_clock::now();
+    const auto missCount = misses.stop();
+
+    const auto nanoseconds = std::chrono::duration<double, std::nano>(stop - start).count();
+    std::cout << "    " << name << ": " << nanoseconds / 1e6 << " ms, "
+              << nanoseconds / static_cast<double>(instructions) << " ns per instruction, ";
+    if (misses.available())
+    {
+        std::cout << static_cast<double>(missCount) / static_cast<double>(instructions)
+                  << " branch misses per instruction";
+    }
+    else
+    {
+        std::cout << "branch misses not available";
+    }
+    std::cout << " (result " << result << ")" << std::endl;
+    return result;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    const auto scale = std::int32_t{argc > 1 ? std::stoi(argv[1]) : 1};
+
+    struct Benchmark
+    {
+        std::string name{};
+        Program program{};
+    };
+    const auto benchmarks = std::vector<Benchmark>{{"sum of squares", sumOfSquares(3000000 * scale)},
+                                                   {"Collatz steps", collatzSteps(30000 * scale)},
+                                                   {"counting primes", countPrimes(200000 * scale)}};
+
+    try
+    {
+        for (const auto &[name, program] : benchmarks)
+        {
+            const auto instructions = count_instructions(program);
+            std::cout << name << ": " << program.code.size() << " instructions of bytecode, " << instructions
+                      << " executed" << std::endl;
+
+            const auto expected = measure("switch       ", run_switch, program, instructions);
+            const auto threaded = measure("computed goto", run_computed_goto, program, instructions);
+            const auto tailCalls = measure("tail calls   ", run_tail_calls, program, instructions);
+            if (threaded != expected || tailCalls != expected)
+            {
+                std::cout << "Error: the interpreters disagree" << std::endl;
+                return 1;
+            }
+            std::cout << std::endl;
+        }
+    }
+    catch (const std::invalid_argument &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
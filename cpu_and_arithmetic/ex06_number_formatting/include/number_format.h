@@ -0,0 +1,65 @@
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+
+/**
+ * Numbers to text, a whole column at a time:
+ *
+ *     std::vector<double> prices{19.99, 5, 0.1};
+ *     char buffer[1 << 16];
+ *     const auto done{format_column<double>(prices, buffer)};   // "19.99\n5\n0.1\n"
+ *     out.write(buffer, done.bytes);            // the first done.values prices
+ *
+ *     write_column<double>(out, prices);        // the same for any number of values
+ *
+ * Integers are written two digits at a time from a table of the pairs "00"
+ * to "99". The number of digits is known up front from the bit width, so
+ * the digits go straight to their final place, last pair first, with no
+ * reversing afterwards, and the sign is written without a branch. Numbers
+ * above 32 bits are first cut into pieces of 8 digits, so that the pairs
+ * come from cheaper 32-bit arithmetic.
+ *
+ * Floating-point numbers are written by std::to_chars in the shortest form
+ * that reads back as exactly the same value: "0.1" rather than printf's
+ * "0.10000000000000001" for %.17g, or its lossy "0.1" for %g, which also
+ * prints 0.10000001 as "0.1".
+ *
+ * Unlike operator<< and printf, neither looks at a locale or a stream's
+ * flags, or parses a format string for every value.
+ */
+
+template <typename T>
+concept Formattable = std::same_as<T, std::int32_t> || std::same_as<T, std::uint32_t> ||
+                      std::same_as<T, std::int64_t> || std::same_as<T, std::uint64_t> ||
+                      std::same_as<T, float> || std::same_as<T, double>;
+
+// Longest text of one value: "-9223372036854775808", "-2.2250738585072014e-308"
+template <Formattable T>
+constexpr std::size_t max_formatted_size{std::floating_point<T> ? 24 : 20};
+
+// Writes value at out, which needs room for max_formatted_size<T>
+// characters, and returns the end of the text
+template <Formattable T>
+char *format_number(T value, char *out);
+
+struct FormatResult
+{
+    std::size_t values{0};   // Of the values given, these were written
+    std::size_t bytes{0};    // Into this much of the buffer
+};
+
+// Writes values, each followed by separator, until the buffer has no room
+// for the next one
+template <Formattable T>
+FormatResult format_column(std::span<const T> values, std::span<char> buffer, char separator = '\n');
+
+// Writes all values, each followed by separator, through a buffer of 1 MiB
+template <Formattable T>
+void write_column(std::ostream &out, std::span<const T> values, char separator = '\n');
+
+#endif
@@ -0,0 +1,363 @@
+/**
+ * Formatting Numbers in Bulk
+ *
+ * The examples print their numbers with operator<<, as in the "Value at
+ * position i" lines of vectors/ex01_vector_memory_layout. For a handful of
+ * lines that is the right tool. For a hundred million numbers, as in a
+ * large CSV file or a log of measurements, turning numbers into text can
+ * take longer than everything else the program does.
+ *
+ * operator<< does a lot for each number: it builds a sentry that checks
+ * the stream, looks up the num_put facet of the stream's locale, reads the
+ * width, precision and flags and only then converts. printf parses its
+ * format string again for every call. And by default both write doubles
+ * with 6 significant digits, so what they write does not read back as the
+ * same number; %.17g does, but writes "0.10000000000000001" for 0.1.
+ *
+ * format_column (number_format.h) formats a whole column into a buffer:
+ * integers two digits at a time from a table of digit pairs, written
+ * straight into place, and doubles with std::to_chars, which writes the
+ * shortest text that reads back as the same double. The example checks
+ * both against std::to_string and std::from_chars, then writes integers,
+ * prices with two decimals and random doubles, one per line, with
+ * operator<<, printf and format_column, and reports the time and bytes per
+ * number. Doubles go through operator<< and printf with 17 digits, the
+ * precision they need to be exact.
+ *
+ * Usage:
+ *
+ *     > make run                              # 10^6 numbers of each kind, to /dev/null
+ *     > make run ARGS="100"                   # 10^8 numbers
+ *     > make run ARGS="10 bin/numbers.txt"    # 10^7 numbers to a file, which it overwrites
+ */
+
+#include "number_format.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <cerrno>
+
+// Formats values one at a time and all at once through a small buffer,
+// and compares both with std::to_string
+template <typename T>
+bool checkIntegers(std::mt19937_64 &rng)
+{
+    using Limits = std::numeric_limits<T>;
+    std::vector<T> values{0, 1, 9, Limits::min(), Limits::max(), static_cast<T>(Limits::min() + 1),
+                          static_cast<T>(Limits::max() - 1)};
+    // Every power of ten and its neighbours, and their negatives
+    for (T power{1}; power <= Limits::max() / 10; power = static_cast<T>(power * 10))
+    {
+        for (const auto value : {power, static_cast<T>(power * 10 - 1), static_cast<T>(power * 10),
+                                 static_cast<T>(power * 10 + 1)})
+        {
+            values.push_back(value);
+            if constexpr (std::is_signed_v<T>)
+            {
+                values.push_back(static_cast<T>(-value));
+            }
+        }
+    }
+    // Any number of digits, not mostly the maximum
+    for (auto i = 0; i < 100000; ++i)
+    {
+        const auto bits{static_cast<int>(rng() % (sizeof(T) * 8)) + 1};
+        values.push_back(static_cast<T>(rng() >> (64 - bits)));
+    }
+
+    std::string expected{};
+    for (const auto value : values)
+    {
+        const auto text = std::to_string(value);
+        char buffer[max_formatted_size<T>];
+        char *const end{format_number(value, buffer)};
+        if (std::string{buffer, end} != text)
+        {
+            std::cout << "Error: format_number wrote " << std::string{buffer, end} << " for " << text << std::endl;
+            return false;
+        }
+        expected += text + ',';
+    }
+
+    // A buffer for only a few values at a time, to check the ends
+    std::string column{};
+    auto remaining = std::span<const T>{values};
+    while (!remaining.empty())
+    {
+        char buffer[3 * (max_formatted_size<T> + 1) + 5];
+        const auto done = format_column(remaining, std::span<char>{buffer}, ',');
+        if (done.values == 0)
+        {
+            std::cout << "Error: format_column wrote nothing into a buffer with room" << std::endl;
+            return false;
+        }
+        column.append(buffer, done.bytes);
+        remaining = remaining.subspan(done.values);
+    }
+    if (column != expected)
+    {
+        std::cout << "Error: format_column does not match std::to_string" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Checks that format_number reads back as the same value for special and
+// random bit patterns, and returns the average length, or 0 on an error
+template <typename T, typename Bits>
+double checkFloats(std::mt19937_64 &rng)
+{
+    using Limits = std::numeric_limits<T>;
+    std::vector<T> values{0,
+                          -T{0},
+                          T{1},
+                          T{0.1},
+                          T{1e22},
+                          Limits::min(),
+                          Limits::denorm_min(),
+                          Limits::max(),
+                          Limits::lowest(),
+                          Limits::epsilon(),
+                          Limits::infinity(),
+                          -Limits::infinity()};
+    for (auto i = 0; i < 1000000; ++i)
+    {
+        const auto value = std::bit_cast<T>(static_cast<Bits>(rng()));
+        if (std::isfinite(value))
+        {
+            values.push_back(value);
+        }
+    }
+
+    std::size_t totalSize{0};
+    for (const auto value : values)
+    {
+        char buffer[max_formatted_size<T>];
+        char *const end{format_number(value, buffer)};
+        T readBack{};
+        const auto [rest, error] = std::from_chars(buffer, end, readBack);
+        if (error != std::errc{} || rest != end ||
+            std::bit_cast<Bits>(readBack) != std::bit_cast<Bits>(value))
+        {
+            std::cout << "Error: format_number wrote " << std::string{buffer, end} << " for "
+                      << std::setprecision(Limits::max_digits10) << value << std::endl;
+            return 0;
+        }
+        totalSize += static_cast<std::size_t>(end - buffer);
+    }
+    return static_cast<double>(totalSize) / static_cast<double>(values.size());
+}
+
+// A million values to write over and over, so that making them costs
+// nothing and the branch predictor cannot learn them
+struct Numbers
+{
+    std::vector<std::int64_t> integers{};
+    std::vector<double> prices{};
+    std::vector<double> doubles{};
+};
+
+Numbers makeNumbers(std::size_t count)
+{
+    auto rng = std::mt19937_64{42};
+    auto numbers = Numbers{};
+    auto digits = std::uniform_int_distribution<int>{1, 18};
+    auto cents = std::uniform_int_distribution<std::int64_t>{1, 9999999};
+    auto anyDouble = std::uniform_real_distribution<double>{-1000, 1000};
+    for (auto i = std::size_t{0}; i < count; ++i)
+    {
+        // Integers of any length from 1 to 18 digits, half of them negative
+        const auto magnitude = static_cast<std::int64_t>(rng() % static_cast<std::uint64_t>(std::pow(10, digits(rng))));
+        numbers.integers.push_back(rng() % 2 == 0 ? magnitude : -magnitude);
+        numbers.prices.push_back(static_cast<double>(cents(rng)) / 100);
+        numbers.doubles.push_back(anyDouble(rng));
+    }
+    return numbers;
+}
+
+// Calls write with values over and over, the last time with only as many
+// as make total in all
+template <typename T, typename Function>
+void forEachBatch(const std::vector<T> &values, std::size_t total, Function write)
+{
+    for (auto done = std::size_t{0}; done < total; done += values.size())
+    {
+        write(std::span<const T>{values}.first(std::min(values.size(), total - done)));
+    }
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        const auto millions = std::size_t{argc > 1 ? std::stoul(argv[1]) : 1};
+        const auto path = std::string{argc > 2 ? argv[2] : "/dev/null"};
+
+        auto rng = std::mt19937_64{7};
+        if (!checkIntegers<std::int32_t>(rng) || !checkIntegers<std::uint32_t>(rng) ||
+            !checkIntegers<std::int64_t>(rng) || !checkIntegers<std::uint64_t>(rng))
+        {
+            return 1;
+        }
+        const auto floatSize = checkFloats<float, std::uint32_t>(rng);
+        const auto doubleSize = checkFloats<double, std::uint64_t>(rng);
+        if (floatSize == 0 || doubleSize == 0)
+        {
+            return 1;
+        }
+        std::cout << "format_number agrees with std::to_string for integers and reads back exactly for floats"
+                  << std::endl
+                  << std::fixed << std::setprecision(1) << "Random bit patterns take " << floatSize
+                  << " characters per float and " << doubleSize
+                  << " per double, %.9g and %.17g up to 15 and 24" << std::endl
+                  << std::endl;
+
+        const auto numbers = makeNumbers(std::size_t{1} << 20);
+        const auto total = std::max(millions * 1000000, std::size_t{1});
+
+        // The same text as each benchmark, into memory, to count its size
+        const auto streamSize = [](const auto &values)
+        {
+            std::ostringstream out{};
+            out << std::setprecision(std::numeric_limits<double>::max_digits10);
+            for (const auto value : values)
+            {
+                out << value << '\n';
+            }
+            return out.str().size();
+        };
+        const auto printfSize = [](const auto &values)
+        {
+            std::size_t size{0};
+            char buffer[64];
+            for (const auto value : values)
+            {
+                if constexpr (std::is_same_v<std::decay_t<decltype(value)>, double>)
+                {
+                    size += static_cast<std::size_t>(std::snprintf(buffer, sizeof(buffer), "%.17g\n", value));
+                }
+                else
+                {
+                    size += static_cast<std::size_t>(std::snprintf(buffer, sizeof(buffer), "%" PRId64 "\n", value));
+                }
+            }
+            return size;
+        };
+        const auto columnSize = [](const auto &values)
+        {
+            std::ostringstream out{};
+            write_column(out, std::span{values});
+            return out.str().size();
+        };
+
+        std::cout << "Writing " << total << " numbers of each kind to " << path << ", one per line:" << std::endl
+                  << std::setw(22) << "" << std::setw(20) << "integers" << std::setw(20) << "prices"
+                  << std::setw(20) << "doubles" << std::endl;
+
+        const auto report = [&](const std::string &name, auto sizeOf, auto writeAll)
+        {
+            std::cout << "  " << std::left << std::setw(20) << name << std::right << std::flush;
+            const auto time = [&](const auto &values)
+            {
+                const auto bytes = static_cast<double>(sizeOf(values)) / static_cast<double>(values.size());
+                auto start = std::chrono::high_resolution_clock::now();
+                writeAll(values);
+                auto stop = std::chrono::high_resolution_clock::now();
+                const auto nanoseconds = std::chrono::duration<double, std::nano>(stop - start).count();
+                std::ostringstream cell{};
+                cell << std::fixed << std::setprecision(1) << nanoseconds / static_cast<double>(total) << " ns ("
+                     << bytes << " B)";
+                std::cout << std::setw(20) << cell.str() << std::flush;
+            };
+            time(numbers.integers);
+            time(numbers.prices);
+            time(numbers.doubles);
+            std::cout << std::endl;
+        };
+
+        report("std::ostream <<", streamSize,
+               [&](const auto &values)
+               {
+                   std::ofstream out{path};
+                   out << std::setprecision(std::numeric_limits<double>::max_digits10);
+                   forEachBatch(values, total, [&](auto batch)
+                                {
+                                    for (const auto value : batch)
+                                    {
+                                        out << value << '\n';
+                                    } });
+                   if (!out)
+                   {
+                       throw std::runtime_error{"could not write " + path};
+                   }
+               });
+
+        report("printf", printfSize,
+               [&](const auto &values)
+               {
+                   std::FILE *out{std::fopen(path.c_str(), "w")};
+                   if (out == nullptr)
+                   {
+                       throw std::system_error{errno, std::generic_category(), "could not open " + path};
+                   }
+                   forEachBatch(values, total, [&](auto batch)
+                                {
+                                    for (const auto value : batch)
+                                    {
+                                        if constexpr (std::is_same_v<std::decay_t<decltype(value)>, double>)
+                                        {
+                                            std::fprintf(out, "%.17g\n", value);
+                                        }
+                                        else
+                                        {
+                                            std::fprintf(out, "%" PRId64 "\n", value);
+                                        }
+                                    } });
+                   if (std::fclose(out) != 0)
+                   {
+                       throw std::system_error{errno, std::generic_category(), "could not write " + path};
+                   }
+               });
+
+        report("format_column", columnSize,
+               [&](const auto &values)
+               {
+                   std::ofstream out{path};
+                   forEachBatch(values, total, [&](auto batch)
+                                { write_column(out, batch); });
+                   if (!out)
+                   {
+                       throw std::runtime_error{"could not write " + path};
+                   }
+               });
+
+        std::cout << std::endl
+                  << "Time per number; in brackets, bytes per number including the line break" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include "number_format.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+    // "00", "01", ..., "99"
+    constexpr auto digitPairs{[]
+                              {
+                                  std::array<char, 200> pairs{};
+                                  for (std::size_t i{0}; i < 100; ++i)
+                                  {
+                                      pairs[2 * i] = static_cast<char>('0' + i / 10);
+                                      pairs[2 * i + 1] = static_cast<char>('0' + i % 10);
+                                  }
+                                  return pairs;
+                              }()};
+
+    constexpr auto powersOf10{[]
+                              {
+                                  std::array<std::uint64_t, 20> powers{};
+                                  powers[0] = 1;
+                                  for (std::size_t i{1}; i < powers.size(); ++i)
+                                  {
+                                      powers[i] = powers[i - 1] * 10;
+                                  }
+                                  return powers;
+                              }()};
+
+    constexpr std::size_t writeBufferSize{std::size_t{1} << 20};
+
+    // Number of decimal digits, 1 for 0
+    unsigned digitCount(std::uint64_t value)
+    {
+        // Setting the lowest bit changes no digit count, except that of 0.
+        // A number of n bits has n * log10(2) digits (1233 / 4096 is just
+        // above log10(2)), rounded down or up: the table tells which
+        const auto odd{value | 1};
+        const auto guess{(static_cast<unsigned>(std::bit_width(odd)) * 1233) >> 12};
+        return guess + (odd >= powersOf10[guess]);
+    }
+
+    // Writes the digits of value so that they end at end
+    template <typename U>
+    void writeDigits(U value, char *end)
+    {
+        // % 100 and / 100 by a constant are multiplications and shifts
+        while (value >= 100)
+        {
+            end -= 2;
+            std::memcpy(end, &digitPairs[(value % 100) * 2], 2);
+            value /= 100;
+        }
+        if (value >= 10)
+        {
+            std::memcpy(end - 2, &digitPairs[value * 2], 2);
+        }
+        else
+        {
+            end[-1] = static_cast<char>('0' + value);
+        }
+    }
+
+    // Writes exactly 8 digits, with leading zeros, so that they end at end
+    void writeEightDigits(std::uint32_t value, char *end)
+    {
+        for (int pair{0}; pair < 4; ++pair)
+        {
+            end -= 2;
+            std::memcpy(end, &digitPairs[(value % 100) * 2], 2);
+            value /= 100;
+        }
+    }
+
+    char *formatUnsigned(std::uint64_t value, char *out)
+    {
+        char *const end{out + digitCount(value)};
+        // Dividing 32-bit numbers by a constant is cheaper, so larger ones
+        // are first cut into 8 digits at a time with one 64-bit division
+        char *digitsEnd{end};
+        while (value > std::numeric_limits<std::uint32_t>::max())
+        {
+            constexpr std::uint64_t hundredMillion{100000000};
+            writeEightDigits(static_cast<std::uint32_t>(value % hundredMillion), digitsEnd);
+            value /= hundredMillion;
+            digitsEnd -= 8;
+        }
+        writeDigits(static_cast<std::uint32_t>(value), digitsEnd);
+        return end;
+    }
+
+    template <typename T>
+    char *formatSigned(T value, char *out)
+    {
+        // Always write the sign, but only keep it for negative numbers.
+        // The magnitude is computed unsigned, so that it also works for the
+        // minimum value
+        const bool negative{value < 0};
+        const auto bits{static_cast<std::uint64_t>(static_cast<std::int64_t>(value))};
+        *out = '-';
+        return formatUnsigned(negative ? 0 - bits : bits, out + negative);
+    }
+}
+
+template <Formattable T>
+char *format_number(T value, char *out)
+{
+    if constexpr (std::floating_point<T>)
+    {
+        // Without a format or a precision, to_chars writes the shortest
+        // text that reads back as value
+        return std::to_chars(out, out + max_formatted_size<T>, value).ptr;
+    }
+    else if constexpr (std::is_signed_v<T>)
+    {
+        return formatSigned(value, out);
+    }
+    else
+    {
+        return formatUnsigned(value, out);
+    }
+}
+
+template <Formattable T>
+FormatResult format_column(std::span<const T> values, std::span<char> buffer, char separator)
+{
+    constexpr auto maxSize{max_formatted_size<T> + 1};
+    char *out{buffer.data()};
+    char *const end{buffer.data() + buffer.size()};
+    std::size_t written{0};
+    while (written < values.size())
+    {
+        // As many values as surely fit, without checking the space left
+        // after each one
+        const auto room{static_cast<std::size_t>(end - out) / maxSize};
+        if (room == 0)
+        {
+            break;
+        }
+        const auto count{std::min(room, values.size() - written)};
+        for (const auto value : values.subspan(written, count))
+        {
+            out = format_number(value, out);
+            *out++ = separator;
+        }
+        written += count;
+    }
+    return {written, static_cast<std::size_t>(out - buffer.data())};
+}
+
+template <Formattable T>
+void write_column(std::ostream &out, std::span<const T> values, char separator)
+{
+    auto buffer = std::vector<char>(writeBufferSize);
+    while (!values.empty())
+    {
+        const auto done{format_column(values, std::span<char>{buffer}, separator)};
+        out.write(buffer.data(), static_cast<std::streamsize>(done.bytes));
+        values = values.subspan(done.values);
+    }
+}
+
+template char *format_number<std::int32_t>(std::int32_t, char *);
+template char *format_number<std::uint32_t>(std::uint32_t, char *);
+template char *format_number<std::int64_t>(std::int64_t, char *);
+template char *format_number<std::uint64_t>(std::uint64_t, char *);
+template char *format_number<float>(float, char *);
+template char *format_number<double>(double, char *);
+
+template FormatResult format_column<std::int32_t>(std::span<const std::int32_t>, std::span<char>, char);
+template FormatResult format_column<std::uint32_t>(std::span<const std::uint32_t>, std::span<char>, char);
+template FormatResult format_column<std::int64_t>(std::span<const std::int64_t>, std::span<char>, char);
+template FormatResult format_column<std::uint64_t>(std::span<const std::uint64_t>, std::span<char>, char);
+template FormatResult format_column<float>(std::span<const float>, std::span<char>, char);
+template FormatResult format_column<double>(std::span<const double>, std::span<char>, char);
+
+template void write_column<std::int32_t>(std::ostream &, std::span<const std::int32_t>, char);
+template void write_column<std::uint32_t>(std::ostream &, std::span<const std::uint32_t>, char);
+template void write_column<std::int64_t>(std::ostream &, std::span<const std::int64_t>, char);
+template void write_column<std::uint64_t>(std::ostream &, std::span<const std::uint64_t>, char);
+template void write_column<float>(std::ostream &, std::span<const float>, char);
+template void write_column<double>(std::ostream &, std::span<const double>, char);
@@ -0,0 +1,43 @@
+#ifndef ASYMMETRIC_FENCE_H
+#define ASYMMETRIC_FENCE_H
+
+#include <atomic>
+
+/**
+ * A pair of memory fences for code where one side runs all the time and
+ * the other rarely: readers announcing what they use, and a reclaimer
+ * checking those announcements before it frees memory.
+ *
+ *     reader:                          reclaimer:
+ *         announced.store(x);              unlink(x);
+ *         light_fence();                   heavy_fence();
+ *         use(shared.load());              if (!announced(x)) free(x);
+ *
+ * Normally both sides would need std::atomic_thread_fence(seq_cst), which is
+ * an mfence instruction on x86 and costs tens of cycles on every read. On
+ * Linux, the membarrier system call lets the reclaimer run a full fence on
+ * every CPU that runs one of this program's threads, so the reader only has
+ * to stop the compiler from reordering. heavy_fence() is a system call then,
+ * fine for something done once per thousands of reads. Without membarrier,
+ * both fences are ordinary sequentially consistent fences.
+ */
+
+// Whether membarrier is used; decided on first use
+bool asymmetric_fences_available();
+
+inline void light_fence()
+{
+    static const bool asymmetric{asymmetric_fences_available()};
+    if (asymmetric)
+    {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+    else
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void heavy_fence();
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef HAZARD_POINTERS_H
+#define HAZARD_POINTERS_H
+
+#include "asymmetric_fence.h"
+#include "thread_registry.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * Hazard pointers: like EpochDomain, lets readers use shared objects while
+ * writers retire them, but readers protect individual objects instead of
+ * a whole epoch:
+ *
+ *     HazardDomain domain{};
+ *     std::atomic<Config *> current{new Config{}};
+ *
+ *     // Reader
+ *     {
+ *         HazardPointer hazard{domain};
+ *         const Config *config{hazard.protect(current)};
+ *         use(*config);   // safe until the hazard pointer goes away
+ *     }
+ *
+ *     // Writer
+ *     domain.retire(current.exchange(new Config{}));
+ *
+ * Each thread has a few slots where it publishes the pointers it is using.
+ * Before deleting retired objects, a thread collects all published pointers
+ * and keeps the retired objects among them for later. A stalled reader
+ * therefore holds on to only the objects it protects, never more than
+ * slotsPerThread each, unlike a stalled reader in an epoch. The price is
+ * paid on every read: publish, light_fence(), then load the source again to
+ * check that the object was not retired in between.
+ */
+class HazardDomain
+{
+public:
+    static constexpr std::size_t slotsPerThread{4};
+
+    // A thread scans the hazard pointers every retireThreshold retirements
+    explicit HazardDomain(std::size_t retireThreshold = 64);
+
+    // Deletes everything still retired; no hazard pointers may be in use
+    ~HazardDomain();
+
+    HazardDomain(const HazardDomain &) = delete;
+    HazardDomain &operator=(const HazardDomain &) = delete;
+
+    // Deletes object with deleter once no hazard pointer protects it
+    void retire(void *object, void (*deleter)(void *));
+
+    template <typename T>
+    void retire(T *object)
+    {
+        retire(object, [](void *pointer) { delete static_cast<T *>(pointer); });
+    }
+
+    // Deletes the calling thread's retired objects that are not protected
+    void collect();
+
+    // Objects retired but not yet deleted
+    std::size_t pending() const { return m_pending.load(std::memory_order_relaxed); }
+
+private:
+    friend class HazardPointer;
+
+    struct Retired
+    {
+        void *object{nullptr};
+        void (*deleter)(void *){nullptr};
+    };
+
+    struct alignas(64) ThreadRecord
+    {
+        std::atomic<const void *> slots[slotsPerThread]{};
+        std::size_t used{0};
+        std::vector<Retired> retired{};
+    };
+
+    std::size_t m_retireThreshold{0};
+    std::atomic<std::size_t> m_pending{0};
+    std::unique_ptr<ThreadRecord[]> m_records{};
+};
+
+/**
+ * One of the calling thread's hazard pointer slots, for the lifetime of
+ * this object. Calls std::terminate if the thread already uses all of
+ * them.
+ */
+class HazardPointer
+{
+public:
+    explicit HazardPointer(HazardDomain &domain);
+    ~HazardPointer();
+
+    HazardPointer(const HazardPointer &) = delete;
+    HazardPointer &operator=(const HazardPointer &) = delete;
+
+    // Loads source and protects what it points to from being deleted
+    template <typename T>
+    T *protect(const std::atomic<T *> &source)
+    {
+        T *pointer{source.load(std::memory_order_relaxed)};
+        while (true)
+        {
+            m_slot->store(pointer, std::memory_order_relaxed);
+            light_fence();
+            // Still there after publishing, so no scan that missed the
+            // hazard pointer can delete it
+            T *again{source.load(std::memory_order_acquire)};
+            if (again == pointer)
+            {
+                return pointer;
+            }
+            pointer = again;
+        }
+    }
+
+    void reset() { m_slot->store(nullptr, std::memory_order_release); }
+
+private:
+    HazardDomain::ThreadRecord &m_record;
+    std::atomic<const void *> *m_slot{nullptr};
+};
+
+#endif
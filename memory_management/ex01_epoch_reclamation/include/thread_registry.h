@@ -0,0 +1,37 @@
+#ifndef THREAD_REGISTRY_H
+#define THREAD_REGISTRY_H
+
+#include <cstddef>
+
+// Most threads that can use the reclamation domains at the same time
+constexpr std::size_t maxThreads{256};
+
+// Claims a number when a thread first asks for one and gives it back when
+// the thread exits
+struct ThreadNumber
+{
+    std::size_t index{0};
+
+    ThreadNumber();
+    ~ThreadNumber();
+
+    ThreadNumber(const ThreadNumber &) = delete;
+    ThreadNumber &operator=(const ThreadNumber &) = delete;
+};
+
+/**
+ * A small number identifying the calling thread, below maxThreads, so
+ * per-thread data can live in a plain array. A thread keeps its number
+ * until it exits, then the next new thread gets it. Calls std::terminate if
+ * more than maxThreads threads use it at once.
+ */
+inline std::size_t thread_index()
+{
+    thread_local const ThreadNumber number{};
+    return number.index;
+}
+
+// One more than the highest number handed out so far
+std::size_t thread_index_limit();
+
+#endif
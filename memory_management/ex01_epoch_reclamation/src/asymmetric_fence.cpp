@@ -0,0 +1,35 @@
+#include "asymmetric_fence.h"
+
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    bool registerMembarrier()
+    {
+        // A process has to register before it may use the expedited
+        // version, which interrupts only the CPUs running its threads
+        const long commands{syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0, 0)};
+        return commands >= 0 && (commands & MEMBARRIER_CMD_PRIVATE_EXPEDITED) != 0 &&
+               syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+    }
+}
+
+bool asymmetric_fences_available()
+{
+    static const bool available{registerMembarrier()};
+    return available;
+}
+
+void heavy_fence()
+{
+    if (asymmetric_fences_available())
+    {
+        syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+    }
+    else
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
@@ -0,0 +1,71 @@
+#include "epoch_domain.h"
+
+#include <algorithm>
+
+EpochDomain::EpochDomain(std::size_t retireThreshold)
+    : m_retireThreshold{std::max<std::size_t>(retireThreshold, 1)}, m_records{std::make_unique<ThreadRecord[]>(maxThreads)}
+{
+}
+
+EpochDomain::~EpochDomain()
+{
+    for (std::size_t i{0}; i < maxThreads; ++i)
+    {
+        for (const auto &retired : m_records[i].retired)
+        {
+            retired.deleter(retired.object);
+        }
+    }
+}
+
+void EpochDomain::retire(void *object, void (*deleter)(void *))
+{
+    auto &record{m_records[thread_index()]};
+    record.retired.push_back({object, deleter, m_epoch.load(std::memory_order_acquire)});
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    if (record.retired.size() % m_retireThreshold == 0)
+    {
+        collect();
+    }
+}
+
+bool EpochDomain::tryAdvance()
+{
+    const auto epoch{m_epoch.load(std::memory_order_acquire)};
+
+    // Pairs with the light_fence() in enter(): afterwards, every reader has
+    // either announced its epoch visibly to this thread, or will load the
+    // shared pointers only after the unlinking this thread did before
+    heavy_fence();
+    const auto threads{thread_index_limit()};
+    for (std::size_t i{0}; i < threads; ++i)
+    {
+        const auto announced{m_records[i].epoch.load(std::memory_order_acquire)};
+        if (announced != idle && announced != epoch)
+        {
+            return false;
+        }
+    }
+    // Another thread may have advanced it meanwhile, then this one fails
+    auto expected{epoch};
+    return m_epoch.compare_exchange_strong(expected, epoch + 1, std::memory_order_acq_rel);
+}
+
+void EpochDomain::collect()
+{
+    tryAdvance();
+    const auto epoch{m_epoch.load(std::memory_order_acquire)};
+
+    // Retired in epoch e, an object may still be in use by readers that
+    // announced e or e - 1 (they announced it before the retiring thread
+    // read the epoch), so it is safe from epoch e + 2 on
+    auto &retired{m_records[thread_index()].retired};
+    const auto kept{std::partition(retired.begin(), retired.end(),
+                                   [epoch](const Retired &object) { return object.epoch + 2 > epoch; })};
+    for (auto object{kept}; object != retired.end(); ++object)
+    {
+        object->deleter(object->object);
+    }
+    m_pending.fetch_sub(static_cast<std::size_t>(retired.end() - kept), std::memory_order_relaxed);
+    retired.erase(kept, retired.end());
+}
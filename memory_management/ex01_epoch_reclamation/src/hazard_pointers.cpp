@@ -0,0 +1,83 @@
+#include "hazard_pointers.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+HazardDomain::HazardDomain(std::size_t retireThreshold)
+    : m_retireThreshold{std::max<std::size_t>(retireThreshold, 1)}, m_records{std::make_unique<ThreadRecord[]>(maxThreads)}
+{
+}
+
+HazardDomain::~HazardDomain()
+{
+    for (std::size_t i{0}; i < maxThreads; ++i)
+    {
+        for (const auto &retired : m_records[i].retired)
+        {
+            retired.deleter(retired.object);
+        }
+    }
+}
+
+void HazardDomain::retire(void *object, void (*deleter)(void *))
+{
+    auto &record{m_records[thread_index()]};
+    record.retired.push_back({object, deleter});
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    if (record.retired.size() % m_retireThreshold == 0)
+    {
+        collect();
+    }
+}
+
+void HazardDomain::collect()
+{
+    // Pairs with the light_fence() in protect(): afterwards, every reader
+    // has either published its hazard pointer visibly to this thread, or
+    // will find the source changed and try again
+    heavy_fence();
+
+    std::vector<const void *> protectedObjects{};
+    const auto threads{thread_index_limit()};
+    for (std::size_t i{0}; i < threads; ++i)
+    {
+        for (const auto &slot : m_records[i].slots)
+        {
+            if (const auto *object{slot.load(std::memory_order_acquire)}; object != nullptr)
+            {
+                protectedObjects.push_back(object);
+            }
+        }
+    }
+    std::sort(protectedObjects.begin(), protectedObjects.end());
+
+    auto &retired{m_records[thread_index()].retired};
+    const auto kept{std::partition(retired.begin(), retired.end(),
+                                   [&protectedObjects](const Retired &object) {
+                                       return std::binary_search(protectedObjects.begin(), protectedObjects.end(),
+                                                                 static_cast<const void *>(object.object));
+                                   })};
+    for (auto object{kept}; object != retired.end(); ++object)
+    {
+        object->deleter(object->object);
+    }
+    m_pending.fetch_sub(static_cast<std::size_t>(retired.end() - kept), std::memory_order_relaxed);
+    retired.erase(kept, retired.end());
+}
+
+HazardPointer::HazardPointer(HazardDomain &domain) : m_record{domain.m_records[thread_index()]}
+{
+    if (m_record.used == HazardDomain::slotsPerThread)
+    {
+        std::cerr << "More than " << HazardDomain::slotsPerThread << " hazard pointers in one thread" << std::endl;
+        std::terminate();
+    }
+    m_slot = &m_record.slots[m_record.used++];
+}
+
+HazardPointer::~HazardPointer()
+{
+    reset();
+    --m_record.used;
+}
@@ -0,0 +1,223 @@
+/**
+ * Epoch-Based Reclamation and Hazard Pointers
+ *
+ * The dangling pointer example in crashes_and_undefined_behavior deletes an
+ * int and then reads it. In one thread that is easy to avoid: do not use a
+ * pointer after deleting what it points to. With several threads it is not:
+ * a writer that replaces a shared object cannot know whether some reader
+ * loaded the old pointer a moment ago and is still using it. Locks solve
+ * that, but make every reader wait for the writer and for each other.
+ *
+ * std::shared_ptr solves it with reference counting: a reader holds a
+ * shared_ptr while it uses the object, and the last owner deletes it. But
+ * every read then increments and decrements the same counter, an atomic
+ * read-modify-write on a cache line all reader threads fight over, so
+ * adding threads makes each read slower.
+ *
+ * Memory reclamation schemes let readers use plain pointers instead, and
+ * move the work to the writer, which retires the old object instead of
+ * deleting it:
+ *
+ *     1. Epochs (epoch_domain.h): a reader announces that it is reading,
+ *        once per batch of reads, by storing to its own cache line.
+ *        Retired objects are deleted once all readers have moved on.
+ *     2. Hazard pointers (hazard_pointers.h): a reader publishes each
+ *        pointer it uses. Retired objects are deleted when no published
+ *        pointer points to them.
+ *
+ * In the benchmark, reader threads read a shared Config over and over,
+ * while a writer keeps replacing it. How reads scale with more threads
+ * depends on having that many CPUs: with fewer, the threads take turns.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="64 500"   # up to 64 threads, 500 ms per measurement
+ */
+
+#include "epoch_domain.h"
+#include "hazard_pointers.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The shared object; a reader that sees a deleted one finds check wrong
+struct Config
+{
+    std::uint64_t version{0};
+    std::uint64_t check{0};
+
+    static inline std::atomic<std::int64_t> live{0};
+
+    explicit Config(std::uint64_t v) : version{v}, check{expectedCheck(v)} { live.fetch_add(1); }
+
+    ~Config()
+    {
+        check = 0;
+        live.fetch_sub(1);
+    }
+
+    Config(const Config &) = delete;
+    Config &operator=(const Config &) = delete;
+
+    static std::uint64_t expectedCheck(std::uint64_t v) { return v * 0x9E3779B97F4A7C15ULL + 1; }
+
+    bool valid() const { return check == expectedCheck(version); }
+};
+
+struct Result
+{
+    double readsPerSecond{0.0};
+    std::uint64_t invalid{0};
+};
+
+/**
+ * Runs threadCount readers calling read() in a loop and one writer calling
+ * write() in a loop for the given time. read() returns false when it saw an
+ * invalid Config.
+ */
+template <typename Read, typename Write>
+Result measure(std::size_t threadCount, std::chrono::milliseconds duration, Read read, Write write)
+{
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> reads{0};
+    std::atomic<std::uint64_t> invalid{0};
+    std::uint64_t updates{0};
+
+    std::vector<std::thread> readers{};
+    for (std::size_t i{0}; i < threadCount; ++i)
+    {
+        readers.emplace_back(
+            [&]
+            {
+                std::uint64_t count{0};
+                std::uint64_t bad{0};
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    // Check the stop flag only every so often
+                    for (int j{0}; j < 256; ++j)
+                    {
+                        bad += read() ? 0 : 1;
+                    }
+                    count += 256;
+                }
+                reads.fetch_add(count);
+                invalid.fetch_add(bad);
+            });
+    }
+    std::thread writer{[&]
+                       {
+                           while (!stop.load(std::memory_order_relaxed))
+                           {
+                               write(++updates);
+                               std::this_thread::sleep_for(std::chrono::microseconds{20});
+                           }
+                       }};
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    writer.join();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    const auto seconds = std::chrono::duration<double>(end - start).count();
+    return {static_cast<double>(reads.load()) / seconds, invalid.load()};
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        const auto maxReaders = std::size_t{argc > 1 ? std::stoul(argv[1]) : 64};
+        const auto duration = std::chrono::milliseconds{argc > 2 ? std::stoul(argv[2]) : 200};
+        if (maxReaders + 2 > maxThreads)
+        {
+            std::cout << "Error: at most " << maxThreads - 2 << " reader threads" << std::endl;
+            return 1;
+        }
+
+        std::cout << "Membarrier for asymmetric fences: " << (asymmetric_fences_available() ? "yes" : "no")
+                  << std::endl
+                  << std::endl
+                  << "Million reads per second, all readers together:" << std::endl
+                  << std::setw(8) << "threads" << std::setw(14) << "shared_ptr" << std::setw(14) << "epochs"
+                  << std::setw(14) << "hazards" << std::endl;
+
+        std::uint64_t invalid{0};
+        for (std::size_t threads{1}; threads <= maxReaders; threads *= 4)
+        {
+            std::cout << std::setw(8) << threads << std::fixed << std::setprecision(1);
+
+            {
+                std::atomic<std::shared_ptr<const Config>> current{std::make_shared<const Config>(0)};
+                const auto result = measure(
+                    threads, duration, [&current] { return current.load()->valid(); },
+                    [&current](std::uint64_t version) { current.store(std::make_shared<const Config>(version)); });
+                std::cout << std::setw(14) << result.readsPerSecond / 1e6;
+                invalid += result.invalid;
+            }
+            {
+                EpochDomain domain{};
+                std::atomic<Config *> current{new Config{0}};
+                const auto result = measure(
+                    threads, duration,
+                    [&]
+                    {
+                        const EpochGuard guard{domain};
+                        return current.load(std::memory_order_acquire)->valid();
+                    },
+                    [&](std::uint64_t version) { domain.retire(current.exchange(new Config{version})); });
+                std::cout << std::setw(14) << result.readsPerSecond / 1e6;
+                invalid += result.invalid;
+                delete current.load();
+            }
+            {
+                HazardDomain domain{};
+                std::atomic<Config *> current{new Config{0}};
+                const auto result = measure(
+                    threads, duration,
+                    [&]
+                    {
+                        HazardPointer hazard{domain};
+                        return hazard.protect(current)->valid();
+                    },
+                    [&](std::uint64_t version) { domain.retire(current.exchange(new Config{version})); });
+                std::cout << std::setw(14) << result.readsPerSecond / 1e6;
+                invalid += result.invalid;
+                delete current.load();
+            }
+            std::cout << std::endl;
+        }
+
+        if (invalid != 0)
+        {
+            std::cout << "Error: readers saw " << invalid << " deleted Configs" << std::endl;
+            return 1;
+        }
+        if (Config::live.load() != 0)
+        {
+            std::cout << "Error: " << Config::live.load() << " Configs were never deleted" << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "thread_registry.h"
+
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    std::mutex g_mutex{};
+    std::vector<std::size_t> g_free{};
+    std::atomic<std::size_t> g_limit{0};
+}
+
+ThreadNumber::ThreadNumber()
+{
+    const std::lock_guard lock{g_mutex};
+    if (!g_free.empty())
+    {
+        index = g_free.back();
+        g_free.pop_back();
+        return;
+    }
+    index = g_limit.load();
+    if (index >= maxThreads)
+    {
+        std::cerr << "More than " << maxThreads << " threads use memory reclamation" << std::endl;
+        std::terminate();
+    }
+    g_limit.store(index + 1, std::memory_order_release);
+}
+
+ThreadNumber::~ThreadNumber()
+{
+    const std::lock_guard lock{g_mutex};
+    g_free.push_back(index);
+}
+
+std::size_t thread_index_limit()
+{
+    return g_limit.load(std::memory_order_acquire);
+}
@@ -0,0 +1,92 @@
+#ifndef RCU_H
+#define RCU_H
+
+#include "asymmetric_fence.h"
+#include "thread_registry.h"
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Read-copy-update: readers use shared data without locks, writers never
+ * change what readers may be looking at. A writer copies the data, changes
+ * the copy, publishes it with one pointer store, and deletes the old
+ * version after a grace period, once every reader that could have seen it
+ * is done:
+ *
+ *     // Reader
+ *     rcu_read_lock();
+ *     const Table *table{current.load(std::memory_order_acquire)};
+ *     use(*table);
+ *     rcu_read_unlock();
+ *
+ *     // Writer
+ *     auto *next{new Table{*current.load()}};
+ *     next->reload();
+ *     const Table *old{current.exchange(next)};
+ *     synchronize_rcu();
+ *     delete old;
+ *
+ * Each thread has a record on its own cache line. rcu_read_lock() stores
+ * the current grace period number there and rcu_read_unlock() stores zero:
+ * plain stores, no read-modify-write, and no contention between readers.
+ * synchronize_rcu() starts a new grace period and waits until no thread is
+ * still reading in an older one. Readers never wait, so reading is
+ * wait-free; instead, a writer waits for the slowest reader.
+ *
+ * RcuPtr (rcu_ptr.h) wraps all of this for a single shared object.
+ */
+
+// A reader thread's state, on its own cache line
+struct alignas(64) RcuReader
+{
+    // Grace period the thread started reading in, 0 while not reading
+    std::atomic<std::uint64_t> period{0};
+    std::uint32_t nesting{0};
+};
+
+extern RcuReader g_rcuReaders[maxThreads];
+extern std::atomic<std::uint64_t> g_rcuPeriod;
+
+// Starts a read-side critical section; may be nested
+inline void rcu_read_lock()
+{
+    auto &reader{g_rcuReaders[thread_index()]};
+    if (reader.nesting++ == 0)
+    {
+        reader.period.store(g_rcuPeriod.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        // Makes the announcement visible before reading shared pointers
+        light_fence();
+    }
+}
+
+inline void rcu_read_unlock()
+{
+    auto &reader{g_rcuReaders[thread_index()]};
+    if (--reader.nesting == 0)
+    {
+        // Release: all reads of shared data happen before a writer can see
+        // this thread is done
+        reader.period.store(0, std::memory_order_release);
+    }
+}
+
+/**
+ * Waits until every read-side critical section that started before the
+ * call has ended. Must not be called inside one, or it waits for itself
+ * forever.
+ */
+void synchronize_rcu();
+
+// Keeps the calling thread in a read-side critical section for its lifetime
+class RcuReadGuard
+{
+public:
+    RcuReadGuard() { rcu_read_lock(); }
+    ~RcuReadGuard() { rcu_read_unlock(); }
+
+    RcuReadGuard(const RcuReadGuard &) = delete;
+    RcuReadGuard &operator=(const RcuReadGuard &) = delete;
+};
+
+#endif
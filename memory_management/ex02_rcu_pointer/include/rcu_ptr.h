@@ -0,0 +1,107 @@
+#ifndef RCU_PTR_H
+#define RCU_PTR_H
+
+#include "rcu.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+/**
+ * A shared object that many threads read and a few replace, such as a
+ * lookup table that is reloaded while the program runs:
+ *
+ *     RcuPtr<Table> table{std::make_unique<Table>(load_table())};
+ *
+ *     // Reader
+ *     {
+ *         const auto snapshot{table.read()};
+ *         use(snapshot->lookup(key));   // this version stays alive
+ *     }
+ *
+ *     // Writer: publish a whole new version...
+ *     table.store(std::make_unique<Table>(load_table()));
+ *     // ...or copy the current one and change the copy
+ *     table.update([](Table &copy) { copy.set(key, value); });
+ *
+ * A snapshot is a read-side critical section: the version it shows is not
+ * deleted before the snapshot goes away, even if a writer publishes a new
+ * one meanwhile. Pointers and references into the version must not outlive
+ * the snapshot, the same mistake as a lambda capturing a local by
+ * reference. Snapshots belong to the thread that took them, and a thread
+ * holding one must not call store() or update(), which wait for it.
+ *
+ * Readers never block and never write shared memory, so any number of
+ * them can read at full speed. Writers pay instead: a copy of the object
+ * and a grace period per store.
+ */
+template <typename T>
+class RcuPtr
+{
+public:
+    class Snapshot
+    {
+    public:
+        explicit Snapshot(const std::atomic<T *> &source)
+            : m_guard{}, m_object{source.load(std::memory_order_acquire)}
+        {
+        }
+
+        Snapshot(const Snapshot &) = delete;
+        Snapshot &operator=(const Snapshot &) = delete;
+
+        const T *get() const { return m_object; }
+        const T &operator*() const { return *m_object; }
+        const T *operator->() const { return m_object; }
+
+    private:
+        // Declared first, so the critical section starts before the load
+        RcuReadGuard m_guard;
+        const T *m_object{nullptr};
+    };
+
+    explicit RcuPtr(std::unique_ptr<T> initial) : m_current{initial.release()} {}
+
+    // No snapshots may be left
+    ~RcuPtr() { delete m_current.load(); }
+
+    RcuPtr(const RcuPtr &) = delete;
+    RcuPtr &operator=(const RcuPtr &) = delete;
+
+    Snapshot read() const { return Snapshot{m_current}; }
+
+    // Publishes next, then deletes the previous version after a grace period
+    void store(std::unique_ptr<T> next)
+    {
+        const std::unique_ptr<T> old{replace(std::move(next))};
+        synchronize_rcu();
+    }
+
+    // Publishes a copy of the current version, changed by modify(T &)
+    template <typename Modify>
+    void update(Modify modify)
+    {
+        std::unique_ptr<T> old{};
+        {
+            // Writers take turns copying, so none loses another's changes
+            const std::lock_guard lock{m_writerMutex};
+            auto next{std::make_unique<T>(*m_current.load(std::memory_order_relaxed))};
+            modify(*next);
+            old.reset(m_current.exchange(next.release(), std::memory_order_acq_rel));
+        }
+        synchronize_rcu();
+    }
+
+private:
+    std::unique_ptr<T> replace(std::unique_ptr<T> next)
+    {
+        const std::lock_guard lock{m_writerMutex};
+        return std::unique_ptr<T>{m_current.exchange(next.release(), std::memory_order_acq_rel)};
+    }
+
+    std::atomic<T *> m_current{nullptr};
+    std::mutex m_writerMutex{};
+};
+
+#endif
@@ -0,0 +1,275 @@
+/**
+ * Read-Copy-Update Snapshots
+ *
+ * The dangling capture example in crashes_and_undefined_behavior returns a
+ * lambda holding a reference to an int that is deleted before the lambda
+ * runs. The same happens when a program reloads a lookup table while other
+ * threads are reading it: delete the old table as soon as the new one is
+ * in place, and a reader that fetched the old one a moment earlier reads
+ * freed memory.
+ *
+ * The usual fixes make readers pay. A std::shared_mutex makes each read
+ * take the lock, an atomic read-modify-write on a counter shared by all
+ * readers. std::atomic<std::shared_ptr> also increments and decrements a
+ * shared counter per read, and in libstdc++ briefly locks the pointer, too.
+ * With more reader threads, they spend more and more of their time passing
+ * that cache line between CPUs.
+ *
+ * RcuPtr (rcu_ptr.h) turns this around: a reader takes a snapshot with two
+ * stores to its own cache line, and a writer waits for a grace period
+ * before deleting the old version, until every reader that could still see
+ * it is done. Tables are reloaded rarely and read all the time, so the
+ * waiting happens where it hurts least.
+ *
+ * First, several threads update() the same RcuPtr, to check that no update
+ * is lost. Then reader threads look up values in a table while a writer
+ * reloads it every millisecond, with each of the three approaches. How
+ * reads scale with more threads depends on having that many CPUs: with
+ * fewer, the threads take turns.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="64 500"   # up to 64 threads, 500 ms per measurement
+ */
+
+#include "rcu_ptr.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A reloadable table; a reader that sees a deleted or half-built one finds
+// values that do not match the version
+struct LookupTable
+{
+    static constexpr std::size_t size{1024};
+
+    std::uint64_t version{0};
+    std::vector<std::uint64_t> values{};
+
+    static inline std::atomic<std::int64_t> live{0};
+
+    explicit LookupTable(std::uint64_t v) : version{v}, values(size)
+    {
+        for (std::size_t i{0}; i < size; ++i)
+        {
+            values[i] = version + i;
+        }
+        live.fetch_add(1);
+    }
+
+    LookupTable(const LookupTable &other) : version{other.version}, values{other.values} { live.fetch_add(1); }
+    LookupTable &operator=(const LookupTable &) = delete;
+
+    ~LookupTable()
+    {
+        values.assign(size, 0);
+        live.fetch_sub(1);
+    }
+
+    bool check(std::size_t key) const { return values[key % size] == version + key % size; }
+};
+
+struct Result
+{
+    double readsPerSecond{0.0};
+    std::uint64_t invalid{0};
+};
+
+/**
+ * Runs threadCount readers calling read(key) in a loop and one writer
+ * calling reload(version) every millisecond for the given time. read()
+ * returns false when it saw an invalid table.
+ */
+template <typename Read, typename Reload>
+Result measure(std::size_t threadCount, std::chrono::milliseconds duration, Read read, Reload reload)
+{
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> reads{0};
+    std::atomic<std::uint64_t> invalid{0};
+
+    std::vector<std::thread> readers{};
+    for (std::size_t i{0}; i < threadCount; ++i)
+    {
+        readers.emplace_back(
+            [&, i]
+            {
+                std::uint64_t count{0};
+                std::uint64_t bad{0};
+                std::size_t key{i * 97};
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    // Check the stop flag only every so often
+                    for (int j{0}; j < 256; ++j)
+                    {
+                        bad += read(key++) ? 0 : 1;
+                    }
+                    count += 256;
+                }
+                reads.fetch_add(count);
+                invalid.fetch_add(bad);
+            });
+    }
+    std::thread writer{[&]
+                       {
+                           std::uint64_t version{0};
+                           while (!stop.load(std::memory_order_relaxed))
+                           {
+                               reload(++version);
+                               std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                           }
+                       }};
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    writer.join();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    const auto seconds = std::chrono::duration<double>(end - start).count();
+    return {static_cast<double>(reads.load()) / seconds, invalid.load()};
+}
+
+// Several threads increment the version of one table with update()
+bool checkConcurrentUpdates()
+{
+    constexpr std::size_t threadCount{4};
+    constexpr std::uint64_t updatesPerThread{200};
+
+    RcuPtr<LookupTable> table{std::make_unique<LookupTable>(0)};
+    std::vector<std::thread> writers{};
+    for (std::size_t i{0}; i < threadCount; ++i)
+    {
+        writers.emplace_back(
+            [&table]
+            {
+                for (std::uint64_t j{0}; j < updatesPerThread; ++j)
+                {
+                    table.update(
+                        [](LookupTable &copy)
+                        {
+                            ++copy.version;
+                            for (auto &value : copy.values)
+                            {
+                                ++value;
+                            }
+                        });
+                }
+            });
+    }
+    for (auto &writer : writers)
+    {
+        writer.join();
+    }
+
+    const auto snapshot{table.read()};
+    std::cout << "Concurrent updates: " << snapshot->version << " of " << threadCount * updatesPerThread
+              << std::endl
+              << std::endl;
+    return snapshot->version == threadCount * updatesPerThread && snapshot->check(1);
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        const auto maxReaders = std::size_t{argc > 1 ? std::stoul(argv[1]) : 64};
+        const auto duration = std::chrono::milliseconds{argc > 2 ? std::stoul(argv[2]) : 200};
+        if (maxReaders + 2 > maxThreads)
+        {
+            std::cout << "Error: at most " << maxThreads - 2 << " reader threads" << std::endl;
+            return 1;
+        }
+
+        if (!checkConcurrentUpdates())
+        {
+            std::cout << "Error: updates were lost" << std::endl;
+            return 1;
+        }
+
+        std::cout << "Membarrier for asymmetric fences: " << (asymmetric_fences_available() ? "yes" : "no")
+                  << std::endl
+                  << std::endl
+                  << "Million lookups per second, all readers together:" << std::endl
+                  << std::setw(8) << "threads" << std::setw(14) << "shared_mutex" << std::setw(14) << "shared_ptr"
+                  << std::setw(14) << "RcuPtr" << std::endl;
+
+        std::uint64_t invalid{0};
+        for (std::size_t threads{1}; threads <= maxReaders; threads *= 4)
+        {
+            std::cout << std::setw(8) << threads << std::fixed << std::setprecision(1);
+
+            {
+                std::shared_mutex mutex{};
+                auto current = std::make_unique<const LookupTable>(0);
+                const auto result = measure(
+                    threads, duration,
+                    [&](std::size_t key)
+                    {
+                        const std::shared_lock lock{mutex};
+                        return current->check(key);
+                    },
+                    [&](std::uint64_t version)
+                    {
+                        // Build the new table outside the lock, delete the
+                        // old one after it
+                        auto next = std::make_unique<const LookupTable>(version);
+                        const std::unique_lock lock{mutex};
+                        current.swap(next);
+                    });
+                std::cout << std::setw(14) << result.readsPerSecond / 1e6;
+                invalid += result.invalid;
+            }
+            {
+                std::atomic<std::shared_ptr<const LookupTable>> current{std::make_shared<const LookupTable>(0)};
+                const auto result = measure(
+                    threads, duration, [&](std::size_t key) { return current.load()->check(key); },
+                    [&](std::uint64_t version) { current.store(std::make_shared<const LookupTable>(version)); });
+                std::cout << std::setw(14) << result.readsPerSecond / 1e6;
+                invalid += result.invalid;
+            }
+            {
+                RcuPtr<LookupTable> current{std::make_unique<LookupTable>(0)};
+                const auto result = measure(
+                    threads, duration, [&](std::size_t key) { return current.read()->check(key); },
+                    [&](std::uint64_t version) { current.store(std::make_unique<LookupTable>(version)); });
+                std::cout << std::setw(14) << result.readsPerSecond / 1e6;
+                invalid += result.invalid;
+            }
+            std::cout << std::endl;
+        }
+
+        if (invalid != 0)
+        {
+            std::cout << "Error: readers saw " << invalid << " invalid tables" << std::endl;
+            return 1;
+        }
+        if (LookupTable::live.load() != 0)
+        {
+            std::cout << "Error: " << LookupTable::live.load() << " tables were never deleted" << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "rcu.h"
+
+#include <mutex>
+#include <thread>
+
+RcuReader g_rcuReaders[maxThreads]{};
+std::atomic<std::uint64_t> g_rcuPeriod{1};
+
+namespace
+{
+    std::mutex g_writerMutex{};
+}
+
+void synchronize_rcu()
+{
+    // One grace period at a time; writers that arrive meanwhile wait here
+    // and then start their own
+    const std::lock_guard lock{g_writerMutex};
+
+    const auto period{g_rcuPeriod.fetch_add(1, std::memory_order_acq_rel) + 1};
+
+    // Pairs with the light_fence() in rcu_read_lock(): afterwards, every
+    // reader has either announced an old period visibly to this thread, or
+    // will load shared pointers only after what the caller published
+    heavy_fence();
+
+    const auto threads{thread_index_limit()};
+    for (std::size_t i{0}; i < threads; ++i)
+    {
+        const auto &reader{g_rcuReaders[i]};
+        while (true)
+        {
+            // Readers that started in this period or later cannot have
+            // seen anything the caller replaced before
+            const auto started{reader.period.load(std::memory_order_acquire)};
+            if (started == 0 || started >= period)
+            {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+// Heap memory currently allocated through operator new
+struct AllocationStats
+{
+    std::size_t allocations{0};
+    // Including what malloc rounds up to and its header in front of each
+    // allocation, so this is what the allocations really take up
+    std::size_t bytes{0};
+};
+
+/**
+ * Linking allocation_counter.cpp replaces the global operator new and
+ * delete with versions that count:
+ *
+ *     const auto before{allocation_stats()};
+ *     auto object{std::make_shared<Widget>()};
+ *     const auto after{allocation_stats()};
+ *     // after.bytes - before.bytes is what make_shared allocated
+ */
+AllocationStats allocation_stats();
+
+#endif
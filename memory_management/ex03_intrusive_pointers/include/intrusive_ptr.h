@@ -0,0 +1,140 @@
+#ifndef INTRUSIVE_PTR_H
+#define INTRUSIVE_PTR_H
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Base class that puts the reference count inside the object, for use
+ * with IntrusivePtr:
+ *
+ *     struct Node : RefCounted<Node>
+ *     {
+ *         int value{0};
+ *     };
+ *
+ *     IntrusivePtr<Node> node{make_intrusive<Node>()};
+ *     IntrusivePtr<Node> copy{node};   // count is now 2
+ *
+ * std::shared_ptr keeps its count in a separate control block, next to the
+ * object with std::make_shared, in a second allocation otherwise. Here the
+ * count is part of the object, so the pointer is a single raw pointer and
+ * any raw pointer to the object can be turned back into an owning one.
+ *
+ * With ThreadSafe, the count is atomic like std::shared_ptr's, so copies
+ * can be made and destroyed in different threads. Objects that never leave
+ * one thread can use RefCounted<Node, false>, where copying is a plain
+ * increment.
+ */
+template <typename Derived, bool ThreadSafe = true>
+class RefCounted
+{
+public:
+    void addRef() const noexcept
+    {
+        if constexpr (ThreadSafe)
+        {
+            // Whoever copies a pointer already holds a reference, so
+            // nothing needs to be ordered against the increment
+            m_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            ++m_count;
+        }
+    }
+
+    // Deletes the object when this was the last reference
+    void release() const noexcept
+    {
+        if constexpr (ThreadSafe)
+        {
+            // Acquire-release: all uses of the object in other threads
+            // happen before the deleting thread deletes it
+            if (m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                delete static_cast<const Derived *>(this);
+            }
+        }
+        else
+        {
+            if (--m_count == 0)
+            {
+                delete static_cast<const Derived *>(this);
+            }
+        }
+    }
+
+    std::uint32_t useCount() const noexcept { return m_count; }
+
+protected:
+    RefCounted() = default;
+
+    // A copy of an object is a new object, with no references yet
+    RefCounted(const RefCounted &) noexcept : m_count{0} {}
+    RefCounted &operator=(const RefCounted &) noexcept { return *this; }
+
+    ~RefCounted() = default;
+
+private:
+    using Count = std::conditional_t<ThreadSafe, std::atomic<std::uint32_t>, std::uint32_t>;
+
+    mutable Count m_count{0};
+};
+
+// Owning pointer to an object derived from RefCounted
+template <typename T>
+class IntrusivePtr
+{
+public:
+    IntrusivePtr() = default;
+
+    // Takes a new reference, so it also works for objects other pointers own
+    explicit IntrusivePtr(T *object) noexcept : m_object{object}
+    {
+        if (m_object != nullptr)
+        {
+            m_object->addRef();
+        }
+    }
+
+    IntrusivePtr(const IntrusivePtr &other) noexcept : IntrusivePtr{other.m_object} {}
+
+    IntrusivePtr(IntrusivePtr &&other) noexcept : m_object{std::exchange(other.m_object, nullptr)} {}
+
+    IntrusivePtr &operator=(IntrusivePtr other) noexcept
+    {
+        std::swap(m_object, other.m_object);
+        return *this;
+    }
+
+    ~IntrusivePtr()
+    {
+        if (m_object != nullptr)
+        {
+            m_object->release();
+        }
+    }
+
+    T *get() const noexcept { return m_object; }
+    T &operator*() const noexcept { return *m_object; }
+    T *operator->() const noexcept { return m_object; }
+    explicit operator bool() const noexcept { return m_object != nullptr; }
+
+    void reset() noexcept { IntrusivePtr{}.swap(*this); }
+    void swap(IntrusivePtr &other) noexcept { std::swap(m_object, other.m_object); }
+
+private:
+    T *m_object{nullptr};
+};
+
+// Creates an object in a single allocation, count and all
+template <typename T, typename... Args>
+IntrusivePtr<T> make_intrusive(Args &&...args)
+{
+    return IntrusivePtr<T>{new T(std::forward<Args>(args)...)};
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef LOCAL_SHARED_PTR_H
+#define LOCAL_SHARED_PTR_H
+
+#include <cstdint>
+#include <utility>
+
+/**
+ * A std::shared_ptr for objects that stay in one thread:
+ *
+ *     LocalSharedPtr<Widget> widget{make_local_shared<Widget>(arguments)};
+ *     LocalSharedPtr<Widget> copy{widget};   // count is now 2
+ *
+ * Works for any type, like std::shared_ptr and unlike IntrusivePtr, but the
+ * count is a plain integer: copying is an increment instead of an atomic
+ * read-modify-write, which the compiler can also combine or leave out.
+ * Copies must therefore never be made or destroyed in two threads at once;
+ * with threads, use std::shared_ptr.
+ *
+ * The count and the object live in one allocation, and the pointer is a
+ * single pointer to it, half the size of a std::shared_ptr. What it leaves
+ * out to get there: weak pointers, custom deleters, adopting objects
+ * created with new, and converting to pointers to base classes.
+ */
+template <typename T>
+class LocalSharedPtr
+{
+public:
+    LocalSharedPtr() = default;
+
+    LocalSharedPtr(const LocalSharedPtr &other) noexcept : m_block{other.m_block}
+    {
+        if (m_block != nullptr)
+        {
+            ++m_block->count;
+        }
+    }
+
+    LocalSharedPtr(LocalSharedPtr &&other) noexcept : m_block{std::exchange(other.m_block, nullptr)} {}
+
+    LocalSharedPtr &operator=(LocalSharedPtr other) noexcept
+    {
+        std::swap(m_block, other.m_block);
+        return *this;
+    }
+
+    ~LocalSharedPtr()
+    {
+        if (m_block != nullptr && --m_block->count == 0)
+        {
+            delete m_block;
+        }
+    }
+
+    T *get() const noexcept { return m_block != nullptr ? &m_block->object : nullptr; }
+    T &operator*() const noexcept { return m_block->object; }
+    T *operator->() const noexcept { return &m_block->object; }
+    explicit operator bool() const noexcept { return m_block != nullptr; }
+
+    std::uint32_t useCount() const noexcept { return m_block != nullptr ? m_block->count : 0; }
+
+    void reset() noexcept { LocalSharedPtr{}.swap(*this); }
+    void swap(LocalSharedPtr &other) noexcept { std::swap(m_block, other.m_block); }
+
+private:
+    template <typename U, typename... Args>
+    friend LocalSharedPtr<U> make_local_shared(Args &&...args);
+
+    struct Block
+    {
+        std::uint32_t count{1};
+        T object;
+
+        template <typename... Args>
+        explicit Block(Args &&...args) : count{1}, object(std::forward<Args>(args)...)
+        {
+        }
+    };
+
+    explicit LocalSharedPtr(Block *block) noexcept : m_block{block} {}
+
+    Block *m_block{nullptr};
+};
+
+// Creates an object and its count in a single allocation
+template <typename T, typename... Args>
+LocalSharedPtr<T> make_local_shared(Args &&...args)
+{
+    return LocalSharedPtr<T>{new typename LocalSharedPtr<T>::Block(std::forward<Args>(args)...)};
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+namespace
+{
+    std::atomic<std::size_t> g_allocations{0};
+    std::atomic<std::size_t> g_bytes{0};
+
+    // glibc keeps the chunk size in front of every allocation
+    constexpr std::size_t mallocHeader{sizeof(std::size_t)};
+
+    std::size_t footprint(void *pointer)
+    {
+        return malloc_usable_size(pointer) + mallocHeader;
+    }
+}
+
+void *operator new(std::size_t size)
+{
+    void *pointer{std::malloc(size == 0 ? 1 : size)};
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc{};
+    }
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(footprint(pointer), std::memory_order_relaxed);
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    if (pointer != nullptr)
+    {
+        g_allocations.fetch_sub(1, std::memory_order_relaxed);
+        g_bytes.fetch_sub(footprint(pointer), std::memory_order_relaxed);
+        std::free(pointer);
+    }
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+AllocationStats allocation_stats()
+{
+    return {g_allocations.load(std::memory_order_relaxed), g_bytes.load(std::memory_order_relaxed)};
+}
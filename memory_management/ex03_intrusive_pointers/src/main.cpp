@@ -0,0 +1,182 @@
+/**
+ * Intrusive and Non-Atomic Reference Counting
+ *
+ * The dangling pointer examples in crashes_and_undefined_behavior are the
+ * usual argument for smart pointers: a std::shared_ptr deletes its object
+ * when the last owner lets go, so no owner is left dangling. That safety
+ * has a price on hot paths that copy pointers a lot:
+ *
+ *     1. The count is atomic, so every copy and every destruction is a
+ *        locked read-modify-write, even in a program where the object
+ *        never leaves its thread.
+ *     2. The count lives in a separate control block. std::shared_ptr<T>(
+ *        new T) allocates twice, std::make_shared once, but either way the
+ *        block also holds a weak count and a vtable pointer for the
+ *        deleter, and the pointer itself is two pointers wide.
+ *
+ * Two alternatives for when those features are not needed:
+ *
+ *     1. IntrusivePtr (intrusive_ptr.h): the object derives from
+ *        RefCounted and carries its own count, atomic or not.
+ *     2. LocalSharedPtr (local_shared_ptr.h): works for any type like
+ *        std::shared_ptr, with a plain count, for objects that stay in
+ *        one thread.
+ *
+ * For each kind of pointer, the benchmark creates a number of particles
+ * and reports the heap memory each took, then copies all pointers into a
+ * vector and clears it, over and over, and reports the time per copy and
+ * destruction.
+ *
+ * libstdc++ leaves out std::shared_ptr's atomic operations as long as the
+ * program has never started a second thread. Real servers have, so the
+ * benchmark starts one before measuring.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="100000 200"   # 100000 objects, copied 200 times
+ */
+
+#include "allocation_counter.h"
+#include "intrusive_ptr.h"
+#include "local_shared_ptr.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Particle
+{
+    double x{0.0};
+    double y{0.0};
+    double z{0.0};
+    std::uint32_t id{0};
+
+    explicit Particle(std::uint32_t i) : x{0.0}, y{0.0}, z{0.0}, id{i} {}
+};
+
+struct CountedParticle : RefCounted<CountedParticle>, Particle
+{
+    explicit CountedParticle(std::uint32_t i) : RefCounted{}, Particle{i} {}
+};
+
+struct LocalCountedParticle : RefCounted<LocalCountedParticle, false>, Particle
+{
+    explicit LocalCountedParticle(std::uint32_t i) : RefCounted{}, Particle{i} {}
+};
+
+/**
+ * Creates objectCount objects with make(id), then copies and destroys the
+ * pointers rounds times. Prints a table row and returns the sum of the ids
+ * seen through the copies.
+ */
+template <typename Make>
+std::uint64_t measure(const std::string &name, std::size_t objectCount, std::size_t rounds, Make make)
+{
+    using Pointer = decltype(make(0));
+
+    std::vector<Pointer> objects{};
+    objects.reserve(objectCount);
+    std::vector<Pointer> copies{};
+    copies.reserve(objectCount);
+
+    const auto before{allocation_stats()};
+    for (std::size_t i{0}; i < objectCount; ++i)
+    {
+        objects.push_back(make(static_cast<std::uint32_t>(i)));
+    }
+    const auto after{allocation_stats()};
+
+    std::uint64_t sum{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    for (std::size_t round{0}; round < rounds; ++round)
+    {
+        for (const auto &object : objects)
+        {
+            copies.push_back(object);
+        }
+        sum += copies[round % objectCount]->id;
+        copies.clear();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    const auto copyCount = static_cast<double>(objectCount * rounds);
+    const auto nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << std::setw(26) << name << std::setw(10) << sizeof(Pointer) << std::setw(10)
+              << static_cast<double>(after.allocations - before.allocations) / static_cast<double>(objectCount)
+              << std::setw(10)
+              << static_cast<double>(after.bytes - before.bytes) / static_cast<double>(objectCount) << std::setw(14)
+              << nanoseconds / copyCount << std::endl;
+    return sum;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        const auto objectCount = std::size_t{argc > 1 ? std::stoul(argv[1]) : 1000};
+        const auto rounds = std::size_t{argc > 2 ? std::stoul(argv[2]) : 20000};
+        if (objectCount == 0)
+        {
+            std::cout << "Error: need at least one object" << std::endl;
+            return 1;
+        }
+
+        // From now on, std::shared_ptr counts atomically
+        std::thread{[] {}}.join();
+
+        std::vector<std::uint64_t> sums{};
+        sums.reserve(5);
+        const auto baseline{allocation_stats()};
+        std::cout << "Payload: " << sizeof(Particle) << " bytes" << std::endl
+                  << std::endl
+                  << std::setw(26) << "pointer" << std::setw(10) << "handle" << std::setw(10) << "allocs"
+                  << std::setw(10) << "bytes" << std::setw(14) << "ns per copy" << std::endl
+                  << std::fixed << std::setprecision(2);
+
+        sums.push_back(measure("std::shared_ptr(new)", objectCount, rounds,
+                               [](std::uint32_t id) { return std::shared_ptr<Particle>(new Particle{id}); }));
+        sums.push_back(measure("std::make_shared", objectCount, rounds,
+                               [](std::uint32_t id) { return std::make_shared<Particle>(id); }));
+        sums.push_back(measure("make_intrusive", objectCount, rounds,
+                               [](std::uint32_t id) { return make_intrusive<CountedParticle>(id); }));
+        sums.push_back(measure("make_intrusive (local)", objectCount, rounds,
+                               [](std::uint32_t id) { return make_intrusive<LocalCountedParticle>(id); }));
+        sums.push_back(measure("make_local_shared", objectCount, rounds,
+                               [](std::uint32_t id) { return make_local_shared<Particle>(id); }));
+
+        std::cout << std::endl
+                  << "handle: size of the pointer itself; allocs and bytes: heap memory per object, including"
+                  << std::endl
+                  << "what malloc adds to each allocation" << std::endl;
+
+        for (const auto sum : sums)
+        {
+            if (sum != sums.front())
+            {
+                std::cout << "Error: the pointers saw different objects" << std::endl;
+                return 1;
+            }
+        }
+        if (allocation_stats().allocations != baseline.allocations)
+        {
+            std::cout << "Error: " << allocation_stats().allocations - baseline.allocations
+                      << " allocations were never freed" << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef CENTRAL_CACHE_H
+#define CENTRAL_CACHE_H
+
+#include "page_heap.h"
+#include "size_classes.h"
+
+#include <cstddef>
+#include <mutex>
+
+// Free objects are linked through their first word
+inline void *&next_free(void *object)
+{
+    return *static_cast<void **>(object);
+}
+
+/**
+ * The layer between the threads' caches and the page heap, one list per
+ * size class, each with its own lock:
+ *
+ *     void *head{nullptr};
+ *     const auto count{CentralCache::instance().fetch(sizeClass, 32, head)};
+ *     ...
+ *     CentralCache::instance().release(sizeClass, head, count);
+ *
+ * Threads move objects in batches of SizeClass::batch, linked into a
+ * chain. A transfer cache keeps whole chains as they are, so moving a
+ * batch from one thread to another takes a lock and a pointer copy. Only
+ * when it is empty or full does the central list take objects out of spans
+ * or put them back, and a span whose objects are all back returns to the
+ * page heap.
+ */
+class CentralCache
+{
+public:
+    // The one central cache, created on first use and never destroyed
+    static CentralCache &instance();
+
+    CentralCache();
+
+    CentralCache(const CentralCache &) = delete;
+    CentralCache &operator=(const CentralCache &) = delete;
+
+    // Up to count objects as a chain ending in nullptr; returns how many,
+    // fewer only when out of memory
+    std::size_t fetch(std::size_t sizeClass, std::size_t count, void *&head);
+
+    // Takes back a chain of count objects
+    void release(std::size_t sizeClass, void *head, std::size_t count);
+
+private:
+    static constexpr std::size_t transferSlots{64};
+
+    struct alignas(64) ClassList
+    {
+        std::mutex mutex{};
+        // Chains of exactly batch objects
+        void *batches[transferSlots]{};
+        std::size_t batchCount{0};
+        // Spans of the class that have free objects left
+        Span spans{};
+    };
+
+    bool addSpan(ClassList &list, std::size_t sizeClass);
+    void returnObject(ClassList &list, void *object);
+
+    ClassList m_lists[classCount]{};
+};
+
+#endif
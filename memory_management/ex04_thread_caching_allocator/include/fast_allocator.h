@@ -0,0 +1,48 @@
+#ifndef FAST_ALLOCATOR_H
+#define FAST_ALLOCATOR_H
+
+#include <cstddef>
+
+/**
+ * A general-purpose allocator in the style of tcmalloc and mimalloc:
+ *
+ *     void *memory{fast_malloc(100)};
+ *     ...
+ *     fast_free(memory);
+ *
+ * Building with ALLOCATOR=fast also routes every new and delete in the
+ * program here (operator_new.cpp).
+ *
+ * Small requests, up to maxSmallSize, are rounded up to a size class
+ * (size_classes.h). Every thread keeps a free list per class, so most
+ * allocations and frees pop or push a list in thread-local memory, with no
+ * lock and no atomic instruction. When a list runs empty or grows too
+ * long, the thread moves a batch of objects from or to the central cache
+ * (central_cache.h), which gets them from spans of pages in the page heap
+ * (page_heap.h). Large requests get a span of their own from the page heap.
+ *
+ * Memory freed by a thread goes to that thread's cache, whichever thread
+ * allocated it, and when a thread exits, its cache goes back to the
+ * central cache. Every object is aligned to 16 bytes, like malloc's.
+ */
+
+// nullptr when out of memory
+void *fast_malloc(std::size_t size);
+
+// Memory from fast_malloc, or nullptr
+void fast_free(void *memory);
+
+// Saves looking up the size of memory, which must be the size it was
+// allocated with
+void fast_free_sized(void *memory, std::size_t size);
+
+// Bytes that can be used at memory, at least the size it was allocated with
+std::size_t fast_usable_size(const void *memory);
+
+// Whether memory came from fast_malloc
+bool fast_allocator_owns(const void *memory);
+
+// Memory the allocator took from the system so far
+std::size_t fast_allocator_committed_bytes();
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef PAGE_HEAP_H
+#define PAGE_HEAP_H
+
+#include "size_classes.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// A run of pages, either free, holding objects of one size class, or
+// holding one large object
+struct Span
+{
+    std::size_t start{0};
+    std::size_t pages{0};
+    // Free objects in the span, linked through their first word
+    void *freeList{nullptr};
+    // 0 for free spans and large objects
+    std::uint32_t sizeClass{0};
+    std::uint32_t allocated{0};
+    bool isFree{false};
+    Span *prev{nullptr};
+    Span *next{nullptr};
+};
+
+// Span lists are circular, with an unused Span as the head
+inline void init_span_list(Span &list)
+{
+    list.prev = &list;
+    list.next = &list;
+}
+
+inline bool span_list_empty(const Span &list)
+{
+    return list.next == &list;
+}
+
+inline void link_span(Span &list, Span *span)
+{
+    span->prev = &list;
+    span->next = list.next;
+    list.next->prev = span;
+    list.next = span;
+}
+
+inline void unlink_span(Span *span)
+{
+    span->prev->next = span->next;
+    span->next->prev = span->prev;
+    span->prev = nullptr;
+    span->next = nullptr;
+}
+
+/**
+ * Hands out spans of pages, the bottom layer of the allocator:
+ *
+ *     auto &heap{PageHeap::instance()};
+ *     Span *span{heap.allocate(4)};
+ *     void *memory{heap.startOf(*span)};   // 4 * pageSize bytes
+ *     ...
+ *     heap.deallocate(heap.spanOf(memory));
+ *
+ * At startup it reserves a large range of address space without memory
+ * behind it, and makes more of it usable as spans run out, so every page
+ * has a number. A page map, an array with one entry per page of the range,
+ * finds the span of any address in one lookup; free() needs nothing else
+ * to know the size of an object. Free spans are kept in lists by length,
+ * and neighbouring free spans are merged, so memory freed by one size
+ * class can be reused by another.
+ *
+ * Freed memory is kept for reuse, never given back to the system.
+ */
+class PageHeap
+{
+public:
+    // The one page heap, created on first use and never destroyed, so that
+    // memory can be freed until the very end of the program
+    static PageHeap &instance();
+
+    PageHeap();
+
+    PageHeap(const PageHeap &) = delete;
+    PageHeap &operator=(const PageHeap &) = delete;
+
+    // A span of the given length, or nullptr when out of address space
+    Span *allocate(std::size_t pages);
+
+    void deallocate(Span *span);
+
+    // Span containing address, which must be in a span in use; takes no
+    // lock
+    Span *spanOf(const void *address) const
+    {
+        return m_pageMap[static_cast<std::size_t>(static_cast<const char *>(address) - m_base) >> pageShift];
+    }
+
+    void *startOf(const Span &span) const { return m_base + (span.start << pageShift); }
+
+    // Whether address is in the range this heap hands out
+    bool owns(const void *address) const;
+
+    // Memory made usable so far, in use or free
+    std::size_t committedBytes() const { return m_committedPages.load(std::memory_order_relaxed) << pageShift; }
+
+private:
+    // Free spans of this many pages and more share the last list
+    static constexpr std::size_t listCount{128};
+
+    Span *findFree(std::size_t pages);
+    bool grow(std::size_t pages);
+    void insertFree(Span *span);
+    void mapPages(Span *span, std::size_t first, std::size_t count);
+    Span *newSpan();
+    void deleteSpan(Span *span);
+
+    std::mutex m_mutex{};
+    char *m_base{nullptr};
+    std::size_t m_reservedPages{0};
+    std::atomic<std::size_t> m_committedPages{0};
+    Span **m_pageMap{nullptr};
+    Span m_free[listCount + 1]{};
+
+    // Span structures come from memory of their own, not from the heap
+    Span *m_unusedSpans{nullptr};
+    char *m_metadataNext{nullptr};
+    char *m_metadataEnd{nullptr};
+};
+
+#endif
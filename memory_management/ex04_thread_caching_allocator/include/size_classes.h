@@ -0,0 +1,63 @@
+#ifndef SIZE_CLASSES_H
+#define SIZE_CLASSES_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Size classes: the allocator rounds every small request up to one of a
+ * few sizes and keeps a separate free list per size, so any free object of
+ * the class fits and no block ever has to be split or merged:
+ *
+ *     16, 32, 48, ... 128        steps of 16
+ *     160, 192, 224, 256         then four classes per power of two,
+ *     320, 384, 448, 512         so at most 25% is wasted to rounding
+ *     ...
+ *     20480, 24576, 28672, 32768
+ *
+ * Objects of a class are carved out of spans, runs of pages that hold
+ * objects of that class only. Larger requests get spans of their own.
+ */
+
+constexpr std::size_t pageShift{13};
+constexpr std::size_t pageSize{std::size_t{1} << pageShift};
+
+// Largest size served from size classes
+constexpr std::size_t maxSmallSize{32768};
+
+struct SizeClass
+{
+    std::uint32_t size{0};
+    // Pages per span, and objects moved at once between a thread's cache
+    // and the central lists
+    std::uint32_t pages{0};
+    std::uint32_t batch{0};
+};
+
+// Class 0 stands for "not a small object", then eight classes up to 128
+// and four per power of two from there
+constexpr std::size_t classCount{1 + 8 + 4 * (std::bit_width(maxSmallSize / 128) - 1)};
+
+struct SizeClassTable
+{
+    SizeClass classes[classCount]{};
+    // Class for sizes up to 1024, by (size + 15) / 16, and for larger ones
+    // by (size + 127) / 128
+    std::uint8_t bySixteen[1024 / 16 + 1]{};
+    std::uint8_t byHundredTwentyEight[maxSmallSize / 128 + 1]{};
+};
+
+extern const SizeClassTable g_sizeClasses;
+
+// Class of a size up to maxSmallSize, with two table lookups at most
+inline std::size_t size_class(std::size_t size)
+{
+    if (size <= 1024)
+    {
+        return g_sizeClasses.bySixteen[(size + 15) >> 4];
+    }
+    return g_sizeClasses.byHundredTwentyEight[(size + 127) >> 7];
+}
+
+#endif
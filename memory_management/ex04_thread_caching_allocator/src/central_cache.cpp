@@ -0,0 +1,114 @@
+#include "central_cache.h"
+
+#include <new>
+
+CentralCache &CentralCache::instance()
+{
+    alignas(CentralCache) static unsigned char storage[sizeof(CentralCache)];
+    static CentralCache *const cache{new (storage) CentralCache{}};
+    return *cache;
+}
+
+CentralCache::CentralCache()
+{
+    for (auto &list : m_lists)
+    {
+        init_span_list(list.spans);
+    }
+}
+
+std::size_t CentralCache::fetch(std::size_t sizeClass, std::size_t count, void *&head)
+{
+    auto &list{m_lists[sizeClass]};
+    const std::lock_guard lock{list.mutex};
+    if (count == g_sizeClasses.classes[sizeClass].batch && list.batchCount > 0)
+    {
+        head = list.batches[--list.batchCount];
+        return count;
+    }
+
+    head = nullptr;
+    std::size_t taken{0};
+    while (taken < count)
+    {
+        if (span_list_empty(list.spans) && !addSpan(list, sizeClass))
+        {
+            break;
+        }
+        Span *span{list.spans.next};
+        while (taken < count && span->freeList != nullptr)
+        {
+            void *object{span->freeList};
+            span->freeList = next_free(object);
+            next_free(object) = head;
+            head = object;
+            ++span->allocated;
+            ++taken;
+        }
+        if (span->freeList == nullptr)
+        {
+            unlink_span(span);
+        }
+    }
+    return taken;
+}
+
+void CentralCache::release(std::size_t sizeClass, void *head, std::size_t count)
+{
+    auto &list{m_lists[sizeClass]};
+    const std::lock_guard lock{list.mutex};
+    if (count == g_sizeClasses.classes[sizeClass].batch && list.batchCount < transferSlots)
+    {
+        list.batches[list.batchCount++] = head;
+        return;
+    }
+    while (head != nullptr)
+    {
+        void *next{next_free(head)};
+        returnObject(list, head);
+        head = next;
+    }
+}
+
+bool CentralCache::addSpan(ClassList &list, std::size_t sizeClass)
+{
+    auto &heap{PageHeap::instance()};
+    const auto &sizeClassInfo{g_sizeClasses.classes[sizeClass]};
+    Span *span{heap.allocate(sizeClassInfo.pages)};
+    if (span == nullptr)
+    {
+        return false;
+    }
+    span->sizeClass = static_cast<std::uint32_t>(sizeClass);
+
+    // Carve the span into objects, linked in address order
+    auto *start{static_cast<char *>(heap.startOf(*span))};
+    const auto objects{(span->pages << pageShift) / sizeClassInfo.size};
+    void *freeList{nullptr};
+    for (auto i{objects}; i > 0; --i)
+    {
+        void *object{start + (i - 1) * sizeClassInfo.size};
+        next_free(object) = freeList;
+        freeList = object;
+    }
+    span->freeList = freeList;
+    link_span(list.spans, span);
+    return true;
+}
+
+void CentralCache::returnObject(ClassList &list, void *object)
+{
+    auto &heap{PageHeap::instance()};
+    Span *span{heap.spanOf(object)};
+    if (span->freeList == nullptr)
+    {
+        link_span(list.spans, span);
+    }
+    next_free(object) = span->freeList;
+    span->freeList = object;
+    if (--span->allocated == 0)
+    {
+        unlink_span(span);
+        heap.deallocate(span);
+    }
+}
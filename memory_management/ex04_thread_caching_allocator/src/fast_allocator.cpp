@@ -0,0 +1,216 @@
+#include "fast_allocator.h"
+#include "central_cache.h"
+#include "page_heap.h"
+#include "size_classes.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+    // A thread's list may grow to this many batches
+    constexpr std::uint32_t maxListBatches{16};
+
+    struct FreeList
+    {
+        void *head{nullptr};
+        std::uint32_t length{0};
+        // 0 until the thread first uses the class
+        std::uint32_t maxLength{0};
+    };
+
+    // Constant-initialized, so using it costs no check for initialization
+    struct ThreadCache
+    {
+        FreeList lists[classCount]{};
+        bool finished{false};
+    };
+
+    thread_local ThreadCache t_cache{};
+
+    // Takes count objects off the front of a list as a chain
+    void *takeChain(FreeList &list, std::size_t count)
+    {
+        void *head{list.head};
+        void *tail{head};
+        for (std::size_t i{1}; i < count; ++i)
+        {
+            tail = next_free(tail);
+        }
+        list.head = next_free(tail);
+        next_free(tail) = nullptr;
+        list.length -= static_cast<std::uint32_t>(count);
+        return head;
+    }
+
+    // Gives the thread's cache back when the thread exits
+    struct CacheFlusher
+    {
+        CacheFlusher() = default;
+        CacheFlusher(const CacheFlusher &) = delete;
+        CacheFlusher &operator=(const CacheFlusher &) = delete;
+
+        ~CacheFlusher()
+        {
+            auto &central{CentralCache::instance()};
+            for (std::size_t cls{1}; cls < classCount; ++cls)
+            {
+                auto &list{t_cache.lists[cls]};
+                while (list.length > 0)
+                {
+                    const auto count{std::min<std::size_t>(list.length, g_sizeClasses.classes[cls].batch)};
+                    central.release(cls, takeChain(list, count), count);
+                }
+                list = {};
+            }
+            // Destructors of other thread_local objects may still allocate
+            // and free, they go straight to the central cache
+            t_cache.finished = true;
+        }
+    };
+
+    // Whether the calling thread can cache objects; false only while it
+    // exits
+    bool cacheUsable()
+    {
+        if (t_cache.finished)
+        {
+            return false;
+        }
+        thread_local const CacheFlusher flusher{};
+        return true;
+    }
+
+    void *refill(std::size_t cls)
+    {
+        auto &central{CentralCache::instance()};
+        void *head{nullptr};
+        if (!cacheUsable())
+        {
+            return central.fetch(cls, 1, head) == 1 ? head : nullptr;
+        }
+
+        // Classes the thread keeps coming back for get longer lists
+        auto &list{t_cache.lists[cls]};
+        const auto batch{g_sizeClasses.classes[cls].batch};
+        list.maxLength = std::min(list.maxLength + batch, batch * maxListBatches);
+
+        const auto count{central.fetch(cls, batch, head)};
+        if (count == 0)
+        {
+            return nullptr;
+        }
+        list.head = next_free(head);
+        list.length = static_cast<std::uint32_t>(count - 1);
+        return head;
+    }
+
+    // Called with the object already pushed, when the list is too long
+    void overflow(std::size_t cls)
+    {
+        auto &central{CentralCache::instance()};
+        auto &list{t_cache.lists[cls]};
+        if (!cacheUsable())
+        {
+            central.release(cls, takeChain(list, 1), 1);
+            return;
+        }
+        const auto batch{g_sizeClasses.classes[cls].batch};
+        if (list.maxLength == 0)
+        {
+            // First free of the class in this thread
+            list.maxLength = batch;
+            return;
+        }
+        central.release(cls, takeChain(list, batch), batch);
+    }
+
+    void *allocateSmall(std::size_t cls)
+    {
+        auto &list{t_cache.lists[cls]};
+        if (void *object{list.head}; object != nullptr)
+        {
+            list.head = next_free(object);
+            --list.length;
+            return object;
+        }
+        return refill(cls);
+    }
+
+    void freeSmall(void *memory, std::size_t cls)
+    {
+        auto &list{t_cache.lists[cls]};
+        next_free(memory) = list.head;
+        list.head = memory;
+        if (++list.length > list.maxLength)
+        {
+            overflow(cls);
+        }
+    }
+
+    void *allocateLarge(std::size_t size)
+    {
+        auto &heap{PageHeap::instance()};
+        if (size > (std::size_t{1} << 40))
+        {
+            return nullptr;
+        }
+        Span *span{heap.allocate((size + pageSize - 1) >> pageShift)};
+        return span != nullptr ? heap.startOf(*span) : nullptr;
+    }
+}
+
+void *fast_malloc(std::size_t size)
+{
+    if (size <= maxSmallSize)
+    {
+        return allocateSmall(size_class(size));
+    }
+    return allocateLarge(size);
+}
+
+void fast_free(void *memory)
+{
+    if (memory == nullptr)
+    {
+        return;
+    }
+    auto &heap{PageHeap::instance()};
+    Span *span{heap.spanOf(memory)};
+    if (span->sizeClass == 0)
+    {
+        heap.deallocate(span);
+        return;
+    }
+    freeSmall(memory, span->sizeClass);
+}
+
+void fast_free_sized(void *memory, std::size_t size)
+{
+    if (memory != nullptr && size <= maxSmallSize)
+    {
+        freeSmall(memory, size_class(size));
+        return;
+    }
+    fast_free(memory);
+}
+
+std::size_t fast_usable_size(const void *memory)
+{
+    const Span *span{PageHeap::instance().spanOf(memory)};
+    if (span->sizeClass == 0)
+    {
+        return span->pages << pageShift;
+    }
+    return g_sizeClasses.classes[span->sizeClass].size;
+}
+
+bool fast_allocator_owns(const void *memory)
+{
+    return PageHeap::instance().owns(memory);
+}
+
+std::size_t fast_allocator_committed_bytes()
+{
+    return PageHeap::instance().committedBytes();
+}
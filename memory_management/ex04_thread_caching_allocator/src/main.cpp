@@ -0,0 +1,282 @@
+/**
+ * A Thread-Caching Allocator
+ *
+ * The stack and heap example in ch20_functions_and_lambdas describes new
+ * as one slow path to "the heap". Inside, a general-purpose allocator is
+ * several layers, and how fast new is depends on which one a request gets
+ * to. glibc's malloc has a small per-thread cache too, but soon falls back
+ * to arenas shared by threads and protected by locks, and keeps the size
+ * of every block in a header in front of it.
+ *
+ * fast_allocator.h is an allocator in the style of tcmalloc and mimalloc:
+ *
+ *     1. Thread caches: a free list per size class and thread, no locks.
+ *     2. A central cache per size class, passing whole batches of objects
+ *        between threads' caches.
+ *     3. A page heap handing out spans of pages, with a page map to find
+ *        the span, and so the size, of any address.
+ *
+ * The benchmark keeps a few thousand objects alive per thread and replaces
+ * a random one over and over, with mostly small sizes, in more and more
+ * threads: the churn of a server building and dropping requests. The
+ * thread-caching allocator and glibc's malloc are called directly; the
+ * third column calls new and delete, which go to malloc unless the program
+ * is built with ALLOCATOR=fast. Before that, one thread allocates and
+ * another frees, to check that objects freed by a different thread are
+ * handed out again correctly. How churn scales with more threads depends
+ * on having that many CPUs: with fewer, the threads take turns.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="16 2000000"   # up to 16 threads, 2000000 operations each
+ *     > make clean && make ALLOCATOR=fast && make run
+ */
+
+#include "fast_allocator.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Objects each thread keeps alive
+constexpr std::size_t liveObjects{4096};
+
+struct Block
+{
+    void *memory{nullptr};
+    std::size_t size{0};
+};
+
+std::uint64_t nextRandom(std::uint64_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Mostly small objects, like the nodes, strings and messages of a server
+std::size_t randomSize(std::uint64_t random)
+{
+    const auto percent{random % 100};
+    random /= 100;
+    if (percent < 80)
+    {
+        return 16 + random % 113;
+    }
+    if (percent < 98)
+    {
+        return 129 + random % 896;
+    }
+    return 1025 + random % 7168;
+}
+
+// Writes a tag to the first and last 8 bytes, so that blocks handed out
+// twice or overlapping show up as wrong tags
+void writeTag(const Block &block, std::uint64_t tag)
+{
+    auto *bytes{static_cast<unsigned char *>(block.memory)};
+    std::memcpy(bytes, &tag, sizeof(tag));
+    std::memcpy(bytes + block.size - sizeof(tag), &tag, sizeof(tag));
+}
+
+bool checkTag(const Block &block, std::uint64_t tag)
+{
+    const auto *bytes{static_cast<const unsigned char *>(block.memory)};
+    std::uint64_t first{0};
+    std::uint64_t last{0};
+    std::memcpy(&first, bytes, sizeof(first));
+    std::memcpy(&last, bytes + block.size - sizeof(last), sizeof(last));
+    return first == tag && last == tag;
+}
+
+struct Result
+{
+    double operationsPerSecond{0.0};
+    std::uint64_t corrupted{0};
+};
+
+/**
+ * Runs threadCount threads that each replace random blocks of their own
+ * operations times, with allocate(size) and deallocate(memory, size).
+ */
+template <typename Allocate, typename Deallocate>
+Result churn(std::size_t threadCount, std::size_t operations, Allocate allocate, Deallocate deallocate)
+{
+    std::atomic<std::size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<std::uint64_t> corrupted{0};
+
+    std::vector<std::thread> threads{};
+    for (std::size_t t{0}; t < threadCount; ++t)
+    {
+        threads.emplace_back(
+            [&, t]
+            {
+                std::vector<Block> blocks(liveObjects);
+                std::uint64_t random{0x9E3779B97F4A7C15ULL * (t + 1)};
+                std::uint64_t bad{0};
+
+                ready.fetch_add(1);
+                while (!go.load())
+                {
+                    std::this_thread::yield();
+                }
+                for (std::size_t i{0}; i < operations; ++i)
+                {
+                    const auto slot{nextRandom(random) % liveObjects};
+                    auto &block{blocks[slot]};
+                    const auto tag{(t << 32) | slot};
+                    if (block.memory != nullptr)
+                    {
+                        bad += checkTag(block, tag) ? 0 : 1;
+                        deallocate(block.memory, block.size);
+                    }
+                    block.size = randomSize(nextRandom(random));
+                    block.memory = allocate(block.size);
+                    writeTag(block, tag);
+                }
+                for (auto &block : blocks)
+                {
+                    if (block.memory != nullptr)
+                    {
+                        deallocate(block.memory, block.size);
+                    }
+                }
+                corrupted.fetch_add(bad);
+            });
+    }
+
+    while (ready.load() != threadCount)
+    {
+        std::this_thread::yield();
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    go.store(true);
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    const auto seconds = std::chrono::duration<double>(end - start).count();
+    return {static_cast<double>(threadCount * operations) / seconds, corrupted.load()};
+}
+
+/**
+ * One thread allocates and tags blocks, another checks and frees them, so
+ * they end up in the second thread's cache. Then checks that allocating
+ * again never hands out the same block twice.
+ */
+bool checkCrossThreadFrees()
+{
+    constexpr std::size_t count{100000};
+    std::vector<Block> blocks(count);
+
+    std::thread producer{[&blocks]
+                         {
+                             std::uint64_t random{42};
+                             for (std::size_t i{0}; i < count; ++i)
+                             {
+                                 blocks[i].size = randomSize(nextRandom(random));
+                                 blocks[i].memory = fast_malloc(blocks[i].size);
+                                 writeTag(blocks[i], i);
+                             }
+                         }};
+    producer.join();
+
+    bool intact{true};
+    std::thread consumer{[&blocks, &intact]
+                         {
+                             for (std::size_t i{0}; i < count; ++i)
+                             {
+                                 intact = intact && checkTag(blocks[i], i);
+                                 fast_free(blocks[i].memory);
+                             }
+                         }};
+    consumer.join();
+
+    std::set<void *> seen{};
+    bool unique{true};
+    for (auto &block : blocks)
+    {
+        block.memory = fast_malloc(block.size);
+        unique = unique && fast_usable_size(block.memory) >= block.size && seen.insert(block.memory).second;
+    }
+    for (const auto &block : blocks)
+    {
+        fast_free(block.memory);
+    }
+    return intact && unique;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        const auto maxThreads = std::size_t{argc > 1 ? std::stoul(argv[1]) : 8};
+        const auto operations = std::size_t{argc > 2 ? std::stoul(argv[2]) : 1000000};
+
+        if (!checkCrossThreadFrees())
+        {
+            std::cout << "Error: blocks freed by another thread were corrupted or handed out twice" << std::endl;
+            return 1;
+        }
+
+        auto *probe = new int{0};
+        std::cout << "new and delete use: " << (fast_allocator_owns(probe) ? "thread-caching allocator" : "malloc")
+                  << std::endl
+                  << std::endl
+                  << "Million allocations and frees per second, all threads together:" << std::endl
+                  << std::setw(8) << "threads" << std::setw(16) << "glibc malloc" << std::setw(16)
+                  << "thread-caching" << std::setw(16) << "new/delete" << std::endl;
+        delete probe;
+
+        std::uint64_t corrupted{0};
+        for (std::size_t threads{1}; threads <= maxThreads; threads *= 2)
+        {
+            const auto glibc = churn(
+                threads, operations, [](std::size_t size) { return std::malloc(size); },
+                [](void *memory, std::size_t) { std::free(memory); });
+            const auto fast = churn(threads, operations, fast_malloc,
+                                    [](void *memory, std::size_t) { fast_free(memory); });
+            const auto global = churn(
+                threads, operations, [](std::size_t size) { return ::operator new(size); },
+                [](void *memory, std::size_t size) { ::operator delete(memory, size); });
+
+            std::cout << std::setw(8) << threads << std::fixed << std::setprecision(1) << std::setw(16)
+                      << glibc.operationsPerSecond / 1e6 << std::setw(16) << fast.operationsPerSecond / 1e6
+                      << std::setw(16) << global.operationsPerSecond / 1e6 << std::endl;
+            corrupted += glibc.corrupted + fast.corrupted + global.corrupted;
+        }
+
+        std::cout << std::endl
+                  << "Memory the thread-caching allocator took from the system: "
+                  << fast_allocator_committed_bytes() / (1024 * 1024) << " MiB" << std::endl;
+
+        if (corrupted != 0)
+        {
+            std::cout << "Error: " << corrupted << " blocks were overwritten while in use" << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
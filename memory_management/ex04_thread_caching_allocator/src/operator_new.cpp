@@ -0,0 +1,53 @@
+#include "fast_allocator.h"
+
+#include <cstddef>
+#include <new>
+
+// Replaces the global operator new and delete with the thread-caching
+// allocator when built with ALLOCATOR=fast (see the Makefile). The nothrow
+// and array versions of new from the standard library call these. Aligned new
+// is left alone; the standard library pairs it with its own aligned
+// delete.
+
+#ifdef REPLACE_GLOBAL_NEW
+
+void *operator new(std::size_t size)
+{
+    void *memory{fast_malloc(size)};
+    while (memory == nullptr)
+    {
+        // Like the standard version: let the new handler free some memory,
+        // or throw std::bad_alloc without one
+        const auto handler{std::get_new_handler()};
+        if (handler == nullptr)
+        {
+            throw std::bad_alloc{};
+        }
+        handler();
+        memory = fast_malloc(size);
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    fast_free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    fast_free(memory);
+}
+
+// The compiler passes the size where it knows it, saving a page map lookup
+void operator delete(void *memory, std::size_t size) noexcept
+{
+    fast_free_sized(memory, size);
+}
+
+void operator delete[](void *memory, std::size_t size) noexcept
+{
+    fast_free_sized(memory, size);
+}
+
+#endif
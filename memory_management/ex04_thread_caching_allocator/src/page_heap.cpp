@@ -0,0 +1,219 @@
+#include "page_heap.h"
+
+#include <algorithm>
+#include <new>
+
+#include <sys/mman.h>
+
+namespace
+{
+    // Address space reserved up front; only what is used takes memory
+    constexpr std::size_t reservedBytes{std::size_t{16} << 30};
+
+    // The heap grows by at least this much at a time
+    constexpr std::size_t growPages{(std::size_t{1} << 20) / pageSize};
+
+    constexpr std::size_t metadataChunk{std::size_t{64} << 10};
+
+    void *mapMemory(std::size_t bytes, int protection, int flags)
+    {
+        void *memory{mmap(nullptr, bytes, protection, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0)};
+        return memory == MAP_FAILED ? nullptr : memory;
+    }
+}
+
+PageHeap &PageHeap::instance()
+{
+    alignas(PageHeap) static unsigned char storage[sizeof(PageHeap)];
+    static PageHeap *const heap{new (storage) PageHeap{}};
+    return *heap;
+}
+
+PageHeap::PageHeap()
+{
+    for (auto &list : m_free)
+    {
+        init_span_list(list);
+    }
+
+    // One extra page to round the start up to a page boundary
+    auto *reserved{static_cast<char *>(mapMemory(reservedBytes + pageSize, PROT_NONE, MAP_NORESERVE))};
+    auto *pageMap{static_cast<Span **>(
+        mapMemory(reservedBytes / pageSize * sizeof(Span *), PROT_READ | PROT_WRITE, MAP_NORESERVE))};
+    if (reserved == nullptr || pageMap == nullptr)
+    {
+        // Every allocation fails then
+        return;
+    }
+    const auto address{reinterpret_cast<std::uintptr_t>(reserved)};
+    m_base = reinterpret_cast<char *>((address + pageSize - 1) & ~(pageSize - 1));
+    m_reservedPages = reservedBytes / pageSize;
+    m_pageMap = pageMap;
+}
+
+Span *PageHeap::allocate(std::size_t pages)
+{
+    const std::lock_guard lock{m_mutex};
+    Span *span{findFree(pages)};
+    if (span == nullptr)
+    {
+        if (!grow(pages))
+        {
+            return nullptr;
+        }
+        span = findFree(pages);
+    }
+
+    unlink_span(span);
+    span->isFree = false;
+    Span *rest{nullptr};
+    if (span->pages > pages)
+    {
+        // Without a Span for the rest, hand out the whole span
+        rest = newSpan();
+        if (rest != nullptr)
+        {
+            rest->start = span->start + pages;
+            rest->pages = span->pages - pages;
+            span->pages = pages;
+        }
+    }
+    // Every page, so spanOf() works for any address in the span, and
+    // before the rest looks for free neighbours
+    mapPages(span, span->start, span->pages);
+    if (rest != nullptr)
+    {
+        insertFree(rest);
+    }
+    return span;
+}
+
+void PageHeap::deallocate(Span *span)
+{
+    const std::lock_guard lock{m_mutex};
+    insertFree(span);
+}
+
+bool PageHeap::owns(const void *address) const
+{
+    const auto *byte{static_cast<const char *>(address)};
+    return m_base != nullptr && byte >= m_base && byte < m_base + (m_reservedPages << pageShift);
+}
+
+Span *PageHeap::findFree(std::size_t pages)
+{
+    for (std::size_t length{pages}; length < listCount; ++length)
+    {
+        if (!span_list_empty(m_free[length]))
+        {
+            return m_free[length].next;
+        }
+    }
+    // Best fit among the long spans
+    Span *best{nullptr};
+    for (Span *span{m_free[listCount].next}; span != &m_free[listCount]; span = span->next)
+    {
+        if (span->pages >= pages && (best == nullptr || span->pages < best->pages))
+        {
+            best = span;
+        }
+    }
+    return best;
+}
+
+bool PageHeap::grow(std::size_t pages)
+{
+    const auto committed{m_committedPages.load(std::memory_order_relaxed)};
+    auto count{std::max(pages, growPages)};
+    if (m_base == nullptr || pages > m_reservedPages - committed)
+    {
+        return false;
+    }
+    count = std::min(count, m_reservedPages - committed);
+    // The Span first, so that pages are never opened without one to hold
+    // them
+    Span *span{newSpan()};
+    if (span == nullptr)
+    {
+        return false;
+    }
+    if (mprotect(m_base + (committed << pageShift), count << pageShift, PROT_READ | PROT_WRITE) != 0)
+    {
+        deleteSpan(span);
+        return false;
+    }
+    span->start = committed;
+    span->pages = count;
+    m_committedPages.store(committed + count, std::memory_order_relaxed);
+    insertFree(span);
+    return true;
+}
+
+void PageHeap::insertFree(Span *span)
+{
+    span->isFree = true;
+    span->sizeClass = 0;
+    span->allocated = 0;
+    span->freeList = nullptr;
+
+    // Merge with free neighbours. The page map is right for the first and
+    // last page of every span, which is all this looks at
+    if (span->start > 0)
+    {
+        if (Span *left{m_pageMap[span->start - 1]}; left != nullptr && left->isFree)
+        {
+            unlink_span(left);
+            span->start = left->start;
+            span->pages += left->pages;
+            deleteSpan(left);
+        }
+    }
+    const auto end{span->start + span->pages};
+    if (end < m_committedPages.load(std::memory_order_relaxed))
+    {
+        if (Span *right{m_pageMap[end]}; right != nullptr && right->isFree)
+        {
+            unlink_span(right);
+            span->pages += right->pages;
+            deleteSpan(right);
+        }
+    }
+
+    mapPages(span, span->start, 1);
+    mapPages(span, span->start + span->pages - 1, 1);
+    link_span(m_free[std::min(span->pages, listCount)], span);
+}
+
+void PageHeap::mapPages(Span *span, std::size_t first, std::size_t count)
+{
+    std::fill_n(m_pageMap + first, count, span);
+}
+
+Span *PageHeap::newSpan()
+{
+    if (m_unusedSpans != nullptr)
+    {
+        Span *span{m_unusedSpans};
+        m_unusedSpans = span->next;
+        return new (span) Span{};
+    }
+    if (m_metadataNext == m_metadataEnd)
+    {
+        auto *chunk{static_cast<char *>(mapMemory(metadataChunk, PROT_READ | PROT_WRITE, 0))};
+        if (chunk == nullptr)
+        {
+            return nullptr;
+        }
+        m_metadataNext = chunk;
+        m_metadataEnd = chunk + metadataChunk / sizeof(Span) * sizeof(Span);
+    }
+    void *memory{m_metadataNext};
+    m_metadataNext += sizeof(Span);
+    return new (memory) Span{};
+}
+
+void PageHeap::deleteSpan(Span *span)
+{
+    span->next = m_unusedSpans;
+    m_unusedSpans = span;
+}
@@ -0,0 +1,60 @@
+#include "size_classes.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr std::size_t nextSize(std::size_t size)
+    {
+        return size < 128 ? size + 16 : size + std::bit_floor(size) / 4;
+    }
+
+    // Enough pages for at least eight objects, with at most an eighth of
+    // the span left over at the end
+    constexpr std::uint32_t spanPages(std::size_t size)
+    {
+        std::size_t pages{1};
+        while (pages * pageSize < size * 8 || (pages * pageSize) % size > pages * pageSize / 8)
+        {
+            ++pages;
+        }
+        return static_cast<std::uint32_t>(pages);
+    }
+
+    constexpr SizeClassTable makeTable()
+    {
+        SizeClassTable table{};
+        std::size_t index{1};
+        for (std::size_t size{16}; size <= maxSmallSize; size = nextSize(size), ++index)
+        {
+            table.classes[index] = {static_cast<std::uint32_t>(size), spanPages(size),
+                                    static_cast<std::uint32_t>(std::clamp<std::size_t>(65536 / size, 2, 32))};
+        }
+
+        // Smallest class that fits each rounded size
+        std::size_t cls{1};
+        for (std::size_t i{0}; i <= 1024 / 16; ++i)
+        {
+            while (table.classes[cls].size < i * 16)
+            {
+                ++cls;
+            }
+            table.bySixteen[i] = static_cast<std::uint8_t>(cls);
+        }
+        cls = 1;
+        for (std::size_t i{0}; i <= maxSmallSize / 128; ++i)
+        {
+            while (table.classes[cls].size < i * 128)
+            {
+                ++cls;
+            }
+            table.byHundredTwentyEight[i] = static_cast<std::uint8_t>(cls);
+        }
+        return table;
+    }
+
+    constexpr SizeClassTable table{makeTable()};
+    static_assert(table.classes[classCount - 1].size == maxSmallSize, "classCount does not match the classes");
+}
+
+const SizeClassTable g_sizeClasses{table};
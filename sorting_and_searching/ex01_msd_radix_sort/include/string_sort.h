@@ -0,0 +1,19 @@
+#ifndef STRING_SORT_H
+#define STRING_SORT_H
+
+#include <span>
+#include <string_view>
+
+/**
+ * Sorts a range of string views in lexicographic order (the same order as
+ * std::sort with the default std::string_view comparison).
+ *
+ * The strings themselves are not copied or moved, only the views are
+ * rearranged, so the characters they point to must outlive the call.
+ *
+ * threadCount is the number of threads used to sort the top-level buckets.
+ * A value of 0 uses std::thread::hardware_concurrency().
+ */
+void msd_radix_sort(std::span<std::string_view> strings, unsigned threadCount = 0);
+
+#endif
@@ -0,0 +1,148 @@
+/**
+ * MSD Radix Sort for Strings
+ *
+ * The reverse range example in vectors/ex03_reverse_range assumes its words
+ * are "sorted in alphabetical order". For a handful of words std::sort is all
+ * we need, but sorting tens of millions of short strings with std::sort is
+ * much slower than sorting the same number of integers. Every comparison
+ * follows two pointers to the characters of the strings, and since the
+ * strings are scattered around the heap, most of those reads are cache
+ * misses. The comparison also starts over from the first character every
+ * time, even when the strings being compared are known to share a prefix.
+ *
+ * Most Significant Digit (MSD) Radix Sort
+ *
+ * An MSD radix sort treats each character as a "digit". It first distributes
+ * the strings into 256 buckets by their first character (a counting sort, no
+ * comparisons at all), then sorts each bucket by the following characters.
+ * Strings in different buckets never need to be compared.
+ *
+ * Multikey Quicksort with Cached Keys
+ *
+ * Inside each bucket we use multikey quicksort: a three-way quicksort on one
+ * "digit" at a time, where the group of strings equal to the pivot moves on
+ * to the next digit. Instead of one character per digit, we load the next 8
+ * characters into a 64-bit integer *key* and store it right next to the
+ * string view. Comparing two keys compares 8 characters in one instruction
+ * without touching the string data, so the hot loop walks a contiguous array.
+ *
+ * Parallelism
+ *
+ * The top-level buckets are independent, so they can be sorted on different
+ * threads without any locking. Each thread grabs the next unsorted bucket
+ * from a shared atomic counter.
+ *
+ * Usage:
+ *
+ *     > make run                      # sort 2 million random strings
+ *     > make run ARGS="20000000"      # sort 20 million random strings
+ */
+
+#include "string_sort.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Builds count random lowercase words packed into one buffer, with views into it
+std::vector<std::string_view> makeWords(std::string &buffer, std::size_t count)
+{
+    std::mt19937_64 rng{42};
+    std::uniform_int_distribution<std::size_t> length{4, 16};
+    std::uniform_int_distribution<int> letter{'a', 'z'};
+
+    std::vector<std::size_t> lengths(count);
+    for (auto &len : lengths)
+    {
+        len = length(rng);
+    }
+
+    buffer.clear();
+    for (auto len : lengths)
+    {
+        for (auto i = std::size_t{0}; i < len; ++i)
+        {
+            buffer.push_back(static_cast<char>(letter(rng)));
+        }
+    }
+
+    auto words = std::vector<std::string_view>{};
+    words.reserve(count);
+    auto offset = std::size_t{0};
+    for (auto len : lengths)
+    {
+        words.emplace_back(buffer.data() + offset, len);
+        offset += len;
+    }
+
+    return words;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    // The words from the reverse range example, out of order this time
+    auto pets = std::vector<std::string_view>{"Hamster", "Cat", "Goldfish", "Dog"};
+    msd_radix_sort(pets);
+
+    std::cout << "Sorted pets: ";
+    for (const auto &pet : pets)
+    {
+        std::cout << pet << ' ';
+    }
+    std::cout << "\n\n";
+
+    auto count = std::size_t{2000000};
+    try
+    {
+        count = argc > 1 ? std::stoul(argv[1]) : count;
+    }
+    catch (const std::logic_error &)
+    {
+        std::cout << "Error: the number of words must be a number, not " << argv[1] << std::endl;
+        return 1;
+    }
+
+    auto buffer = std::string{};
+    const auto words = makeWords(buffer, count);
+    std::cout << "Sorting " << count << " random words..." << std::endl;
+
+    auto expected = words;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::sort(expected.begin(), expected.end());
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
+    std::cout << "std::sort:                 " << duration.count() << " ms" << std::endl;
+
+    auto sorted = words;
+    start = std::chrono::high_resolution_clock::now();
+    msd_radix_sort(sorted, 1);
+    stop = std::chrono::high_resolution_clock::now();
+    duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
+    std::cout << "msd_radix_sort (1 thread): " << duration.count() << " ms" << std::endl;
+
+    if (sorted != expected)
+    {
+        std::cout << "Error: msd_radix_sort and std::sort disagree!" << std::endl;
+        return 1;
+    }
+
+    sorted = words;
+    start = std::chrono::high_resolution_clock::now();
+    msd_radix_sort(sorted);
+    stop = std::chrono::high_resolution_clock::now();
+    duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
+    std::cout << "msd_radix_sort (parallel): " << duration.count() << " ms" << std::endl;
+
+    if (sorted != expected)
+    {
+        std::cout << "Error: msd_radix_sort and std::sort disagree!" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include "string_sort.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    /**
+     * A string view together with a cached key: the next 8 characters of the
+     * string (starting at the current depth) packed big-endian into an
+     * integer. Comparing two keys compares 8 characters at once, and since the
+     * key sits right next to the view, most comparisons never have to follow
+     * the pointer to the characters at all. That pointer chase is the cache
+     * miss that makes std::sort on strings slow.
+     */
+    struct Entry
+    {
+        std::uint64_t key{0};
+        std::string_view str{};
+    };
+
+    constexpr std::size_t keyBytes{sizeof(std::uint64_t)};
+    constexpr std::ptrdiff_t insertionSortThreshold{32};
+
+    // Bucket 0 holds empty strings, bucket c + 1 holds strings starting with c
+    constexpr std::size_t numBuckets{257};
+
+    std::uint64_t loadKey(std::string_view str, std::size_t depth)
+    {
+        if (depth >= str.size())
+        {
+            return 0;
+        }
+
+        // Characters past the end of the string are left as zero bytes
+        std::uint64_t key{0};
+        std::memcpy(&key, str.data() + depth, std::min(keyBytes, str.size() - depth));
+
+        // Make the first character the most significant byte so that integer
+        // comparison matches lexicographic comparison
+        if constexpr (std::endian::native == std::endian::little)
+        {
+            key = __builtin_bswap64(key);
+        }
+
+        return key;
+    }
+
+    std::size_t bucketOf(std::string_view str)
+    {
+        return str.empty() ? 0 : static_cast<unsigned char>(str.front()) + std::size_t{1};
+    }
+
+    // All entries passed in share their first depth characters
+    bool lessAt(const Entry &a, const Entry &b, std::size_t depth)
+    {
+        if (a.key != b.key)
+        {
+            return a.key < b.key;
+        }
+
+        return a.str.substr(std::min(depth, a.str.size())) < b.str.substr(std::min(depth, b.str.size()));
+    }
+
+    void insertionSort(Entry *first, Entry *last, std::size_t depth)
+    {
+        for (Entry *i{first + 1}; i < last; ++i)
+        {
+            Entry value{*i};
+            Entry *j{i};
+            for (; j > first && lessAt(value, *(j - 1), depth); --j)
+            {
+                *j = *(j - 1);
+            }
+            *j = value;
+        }
+    }
+
+    std::uint64_t medianOfThree(std::uint64_t a, std::uint64_t b, std::uint64_t c)
+    {
+        return std::max(std::min(a, b), std::min(std::max(a, b), c));
+    }
+
+    /**
+     * Multikey quicksort on the cached keys. Each round does a three-way
+     * partition on the key; the smaller and larger parts are sorted at the
+     * same depth while the equal part, which shares the next 8 characters,
+     * moves on to the following 8 characters. Only the two smallest parts
+     * are sorted by recursion and the loop goes on with the largest, so
+     * each call halves the range and the stack stays logarithmic however
+     * the pivots fall or however long the shared prefixes are.
+     */
+    void sortEntries(Entry *first, Entry *last, std::size_t depth)
+    {
+        while (last - first > insertionSortThreshold)
+        {
+            const std::uint64_t pivot{medianOfThree(first->key, first[(last - first) / 2].key, (last - 1)->key)};
+
+            // Dijkstra three-way partition: [first, lt) < pivot, [lt, i) == pivot, (gt, last) > pivot
+            Entry *lt{first};
+            Entry *i{first};
+            Entry *gt{last};
+            while (i < gt)
+            {
+                if (i->key < pivot)
+                {
+                    std::swap(*lt++, *i++);
+                }
+                else if (i->key > pivot)
+                {
+                    std::swap(*i, *--gt);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+
+            // Strings that ended inside this key are prefixes of the strings
+            // that did not, so they go first. They can only differ by trailing
+            // zero bytes, so ordering them by length finishes them.
+            Entry *unfinished{std::partition(lt, gt, [depth](const Entry &e)
+                                             { return e.str.size() <= depth + keyBytes; })};
+            std::sort(lt, unfinished, [](const Entry &a, const Entry &b)
+                      { return a.str.size() < b.str.size(); });
+
+            for (Entry *e{unfinished}; e < gt; ++e)
+            {
+                e->key = loadKey(e->str, depth + keyBytes);
+            }
+
+            struct Part
+            {
+                Entry *first;
+                Entry *last;
+                std::size_t depth;
+            };
+            std::array<Part, 3> parts{{{first, lt, depth}, {unfinished, gt, depth + keyBytes}, {gt, last, depth}}};
+            std::iter_swap(parts.begin(), std::max_element(parts.begin(), parts.end(), [](const Part &a, const Part &b)
+                                                           { return a.last - a.first < b.last - b.first; }));
+            sortEntries(parts[1].first, parts[1].last, parts[1].depth);
+            sortEntries(parts[2].first, parts[2].last, parts[2].depth);
+
+            first = parts[0].first;
+            last = parts[0].last;
+            depth = parts[0].depth;
+        }
+
+        insertionSort(first, last, depth);
+    }
+}
+
+void msd_radix_sort(std::span<std::string_view> strings, unsigned threadCount)
+{
+    if (strings.size() < 2)
+    {
+        return;
+    }
+
+    // Counting sort on the first character into the top-level buckets
+    std::array<std::size_t, numBuckets + 1> offsets{};
+    for (std::string_view str : strings)
+    {
+        ++offsets[bucketOf(str) + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    // Every string in a bucket shares its first character, so keys start at depth 1
+    std::vector<Entry> entries(strings.size());
+    std::array<std::size_t, numBuckets + 1> next{offsets};
+    for (std::string_view str : strings)
+    {
+        entries[next[bucketOf(str)]++] = Entry{loadKey(str, 1), str};
+    }
+
+    // Hand out the largest buckets first so that one big bucket picked up
+    // last does not leave the other threads idle
+    std::vector<std::size_t> order(numBuckets);
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::sort(order.begin(), order.end(), [&offsets](std::size_t a, std::size_t b)
+              { return offsets[a + 1] - offsets[a] > offsets[b + 1] - offsets[b]; });
+
+    std::atomic<std::size_t> nextBucket{0};
+    auto worker{[&]()
+                {
+                    for (std::size_t i{nextBucket++}; i < numBuckets; i = nextBucket++)
+                    {
+                        const std::size_t bucket{order[i]};
+                        Entry *first{entries.data() + offsets[bucket]};
+                        Entry *last{entries.data() + offsets[bucket + 1]};
+                        if (bucket != 0)
+                        {
+                            sortEntries(first, last, 1);
+                        }
+                        for (std::size_t j{offsets[bucket]}; j < offsets[bucket + 1]; ++j)
+                        {
+                            strings[j] = entries[j].str;
+                        }
+                    }
+                }};
+
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<std::jthread> threads{};
+    for (unsigned t{1}; t < threadCount; ++t)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+}
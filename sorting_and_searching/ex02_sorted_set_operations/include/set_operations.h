@@ -0,0 +1,40 @@
+#ifndef SET_OPERATIONS_H
+#define SET_OPERATIONS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * Set operations on sorted lists of IDs.
+ *
+ * Every input must be a *set*: sorted in increasing order with no duplicates.
+ * The two-list intersections write into out, which must have room for at
+ * least min(a.size(), b.size()) values, and return the number of values
+ * written.
+ */
+
+// Classic two-pointer merge, one comparison per step
+std::size_t intersect_merge(std::span<const std::uint32_t> a, std::span<const std::uint32_t> b,
+                            std::span<std::uint32_t> out);
+
+// Exponential search of each value of the smaller set in the larger set
+std::size_t intersect_galloping(std::span<const std::uint32_t> a, std::span<const std::uint32_t> b,
+                                std::span<std::uint32_t> out);
+
+// Compares blocks of 4 (SSE4.2) or 8 (AVX2) values at once, chosen at runtime
+std::size_t intersect_simd(std::span<const std::uint32_t> a, std::span<const std::uint32_t> b,
+                           std::span<std::uint32_t> out);
+
+// Picks galloping for very different sizes and SIMD for similar sizes
+std::size_t intersect(std::span<const std::uint32_t> a, std::span<const std::uint32_t> b,
+                      std::span<std::uint32_t> out);
+
+// Intersection of any number of sets, starting from the smallest
+std::vector<std::uint32_t> intersect_all(std::span<const std::span<const std::uint32_t>> sets);
+
+// Union of any number of sets using a k-way merge over a loser tree
+std::vector<std::uint32_t> union_all(std::span<const std::span<const std::uint32_t>> sets);
+
+#endif
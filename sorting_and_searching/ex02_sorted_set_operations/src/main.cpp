@@ -0,0 +1,194 @@
+/**
+ * Sorted Set Intersection and Union
+ *
+ * A sorted std::vector of unique integers, like the prime vector in
+ * ch16_containers_and_arrays/ex03_unsigned_length_problem, is a compact and
+ * cache-friendly way to store a set of IDs. The standard library can combine
+ * two such sets with std::set_intersection and std::set_union, which walk
+ * both lists with one pointer each and do one comparison per step.
+ *
+ * That one comparison is hard for the CPU to predict (which list advances
+ * next is essentially random), and it is a poor fit for two common cases:
+ *
+ * Skewed Sizes: Galloping
+ *
+ * Intersecting 1,000 IDs with 10,000,000 IDs should not touch all 10 million.
+ * A *galloping* (exponential) search looks up each value of the small set in
+ * the large set, doubling its step until it overshoots and then binary
+ * searching the last step. The cost is about small * log(large / small).
+ *
+ * Similar Sizes: SIMD Block Intersection
+ *
+ * When both sets have similar sizes, we compare whole blocks instead. A SIMD
+ * register holds 4 (SSE) or 8 (AVX2) IDs. Comparing a block of a against
+ * every rotation of a block of b finds all matches between the two blocks
+ * with a handful of instructions and no unpredictable branches. A shuffle
+ * then packs the matches together so they can be stored in one go.
+ *
+ * Many Sets: Loser Tree Union
+ *
+ * Merging k sorted sets is done with a *loser tree*: a tournament where each
+ * internal node remembers the loser of its match. Advancing the winner only
+ * replays the log2(k) matches on its path to the root.
+ *
+ * The intersect() front end picks among these based on the set sizes and on
+ * which instruction sets the CPU supports at runtime.
+ *
+ * Usage:
+ *
+ *     > make run                  # sets of 1 million IDs
+ *     > make run ARGS="10000000"  # sets of 10 million IDs
+ */
+
+#include "cpu_dispatch.h"
+#include "set_operations.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+// Returns about count unique random IDs below universe, sorted
+std::vector<std::uint32_t> makeSet(std::size_t count, std::uint32_t universe, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<std::uint32_t> id{0, universe - 1};
+
+    auto set = std::vector<std::uint32_t>(count);
+    for (auto &value : set)
+    {
+        value = id(rng);
+    }
+    std::sort(set.begin(), set.end());
+    set.erase(std::unique(set.begin(), set.end()), set.end());
+
+    return set;
+}
+
+template <typename Function>
+long long timeMs(Function function, int repeats)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto r = int{0}; r < repeats; ++r)
+    {
+        function();
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    // Which SIMD kernels this CPU runs
+    print_cpu_report(std::cout);
+    std::cout << '\n';
+
+    // Small example: which primes are also in a list of odd IDs?
+    auto prime = std::vector<std::uint32_t>{2, 3, 5, 7, 11, 13, 17, 19};
+    auto odd = std::vector<std::uint32_t>{1, 3, 5, 7, 9, 11, 13, 15, 17, 19};
+    auto both = std::vector<std::uint32_t>(std::min(prime.size(), odd.size()));
+    both.resize(intersect(prime, odd, both));
+
+    std::cout << "Odd primes: ";
+    for (auto p : both)
+    {
+        std::cout << p << ' ';
+    }
+    std::cout << "\n\n";
+
+    const auto n = std::size_t{argc > 1 ? std::stoul(argv[1]) : 1000000};
+    const auto repeats = int{10};
+    auto rng = std::mt19937{42};
+
+    // Similar sizes
+    const auto a = makeSet(n, static_cast<std::uint32_t>(4 * n), rng);
+    const auto b = makeSet(n, static_cast<std::uint32_t>(4 * n), rng);
+    auto expected = std::vector<std::uint32_t>{};
+    auto out = std::vector<std::uint32_t>(std::min(a.size(), b.size()));
+    auto count = std::size_t{0};
+
+    std::cout << "Intersecting two sets of ~" << n << " IDs, " << repeats << " times..." << std::endl;
+    std::cout << "std::set_intersection: " << timeMs([&]()
+                                                     { expected.clear();
+                                                       std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected)); },
+                                                     repeats)
+              << " ms" << std::endl;
+    std::cout << "intersect_merge:       " << timeMs([&]()
+                                                     { count = intersect_merge(a, b, out); }, repeats)
+              << " ms" << std::endl;
+    std::cout << "intersect_simd:        " << timeMs([&]()
+                                                     { count = intersect_simd(a, b, out); }, repeats)
+              << " ms" << std::endl;
+    std::cout << "intersect (adaptive):  " << timeMs([&]()
+                                                     { count = intersect(a, b, out); }, repeats)
+              << " ms" << std::endl;
+
+    if (!std::equal(expected.begin(), expected.end(), out.begin(), out.begin() + static_cast<std::ptrdiff_t>(count)))
+    {
+        std::cout << "Error: intersections disagree!" << std::endl;
+        return 1;
+    }
+
+    // Skewed sizes
+    const auto small = makeSet(n / 1000 + 1, static_cast<std::uint32_t>(16 * n), rng);
+    const auto large = makeSet(4 * n, static_cast<std::uint32_t>(16 * n), rng);
+
+    std::cout << "\nIntersecting " << small.size() << " IDs with " << large.size() << " IDs, "
+              << repeats << " times..." << std::endl;
+    std::cout << "std::set_intersection: " << timeMs([&]()
+                                                     { expected.clear();
+                                                       std::set_intersection(small.begin(), small.end(), large.begin(), large.end(), std::back_inserter(expected)); },
+                                                     repeats)
+              << " ms" << std::endl;
+    std::cout << "intersect_galloping:   " << timeMs([&]()
+                                                     { count = intersect_galloping(small, large, out); }, repeats)
+              << " ms" << std::endl;
+    std::cout << "intersect (adaptive):  " << timeMs([&]()
+                                                     { count = intersect(small, large, out); }, repeats)
+              << " ms" << std::endl;
+
+    if (!std::equal(expected.begin(), expected.end(), out.begin(), out.begin() + static_cast<std::ptrdiff_t>(count)))
+    {
+        std::cout << "Error: intersections disagree!" << std::endl;
+        return 1;
+    }
+
+    // k-way union
+    const auto k = std::size_t{16};
+    auto sets = std::vector<std::vector<std::uint32_t>>{};
+    for (auto s = std::size_t{0}; s < k; ++s)
+    {
+        sets.push_back(makeSet(n / 4, static_cast<std::uint32_t>(4 * n), rng));
+    }
+    const auto views = std::vector<std::span<const std::uint32_t>>(sets.begin(), sets.end());
+    auto merged = std::vector<std::uint32_t>{};
+
+    std::cout << "\nUnion of " << k << " sets of ~" << n / 4 << " IDs..." << std::endl;
+    std::cout << "std::set_union (pairwise): " << timeMs([&]()
+                                                         {
+                                                             expected.clear();
+                                                             for (const auto &set : sets)
+                                                             {
+                                                                 auto next = std::vector<std::uint32_t>{};
+                                                                 next.reserve(expected.size() + set.size());
+                                                                 std::set_union(expected.begin(), expected.end(), set.begin(), set.end(), std::back_inserter(next));
+                                                                 expected.swap(next);
+                                                             } },
+                                                         1)
+              << " ms" << std::endl;
+    std::cout << "union_all (loser tree):    " << timeMs([&]()
+                                                         { merged = union_all(views); }, 1)
+              << " ms" << std::endl;
+
+    if (merged != expected)
+    {
+        std::cout << "Error: unions disagree!" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,390 @@
+#include "set_operations.h"
+
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <immintrin.h>
+#include <limits>
+
+namespace
+{
+    // Galloping wins once one set is this many times larger than the other
+    constexpr std::size_t gallopingRatio{32};
+
+    /**
+     * Shuffle masks that pack the matching lanes of a block to the front.
+     * Entry m lists, in order, the lanes whose bit is set in m. The SSE
+     * table works on bytes (for pshufb) and the AVX2 table on 32-bit lanes
+     * (for vpermd).
+     */
+    constexpr auto makeSseShuffles()
+    {
+        std::array<std::array<std::uint8_t, 16>, 16> table{};
+        for (std::size_t mask{0}; mask < 16; ++mask)
+        {
+            table[mask].fill(0x80); // pshufb writes zero for these bytes
+            std::size_t next{0};
+            for (std::size_t lane{0}; lane < 4; ++lane)
+            {
+                if (mask & (std::size_t{1} << lane))
+                {
+                    for (std::size_t byte{0}; byte < 4; ++byte)
+                    {
+                        table[mask][next++] = static_cast<std::uint8_t>(lane * 4 + byte);
+                    }
+                }
+            }
+        }
+        return table;
+    }
+
+    constexpr auto makeAvx2Permutes()
+    {
+        std::array<std::array<std::uint32_t, 8>, 256> table{};
+        for (std::size_t mask{0}; mask < 256; ++mask)
+        {
+            std::size_t next{0};
+            for (std::uint32_t lane{0}; lane < 8; ++lane)
+            {
+                if (mask & (std::size_t{1} << lane))
+                {
+                    table[mask][next++] = lane;
+                }
+            }
+        }
+        return table;
+    }
+
+    alignas(16) constexpr auto sseShuffles{makeSseShuffles()};
+    alignas(32) constexpr auto avx2Permutes{makeAvx2Permutes()};
+
+    std::size_t mergeTail(const std::uint32_t *a, std::size_t na, const std::uint32_t *b, std::size_t nb,
+                          std::uint32_t *out)
+    {
+        std::size_t i{0};
+        std::size_t j{0};
+        std::size_t count{0};
+        while (i < na && j < nb)
+        {
+            if (a[i] < b[j])
+            {
+                ++i;
+            }
+            else if (b[j] < a[i])
+            {
+                ++j;
+            }
+            else
+            {
+                out[count++] = a[i];
+                ++i;
+                ++j;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Block intersection (Schlegel et al., Lemire et al.): load 4 values from
+     * each set, compare every value of a against all 4 rotations of b's block
+     * to get a mask of matching lanes in a, then pack the matches to the front
+     * with a single shuffle. The block with the smaller last value is used up
+     * and replaced (or both, when the last values are equal).
+     *
+     * Every iteration stores a full block, so the loop stops once out has
+     * less than a block of room left and the scalar tail finishes the job.
+     */
+    __attribute__((target("sse4.2,popcnt"))) std::size_t intersectSse(const std::uint32_t *a, std::size_t na,
+                                                                      const std::uint32_t *b, std::size_t nb,
+                                                                      std::uint32_t *out, std::size_t nout)
+    {
+        std::size_t i{0};
+        std::size_t j{0};
+        std::size_t count{0};
+        while (i + 4 <= na && j + 4 <= nb && count + 4 <= nout)
+        {
+            const __m128i va{_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i))};
+            const __m128i vb{_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j))};
+
+            const __m128i cmp0{_mm_cmpeq_epi32(va, vb)};
+            const __m128i cmp1{_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))};
+            const __m128i cmp2{_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)))};
+            const __m128i cmp3{_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))};
+            const __m128i cmp{_mm_or_si128(_mm_or_si128(cmp0, cmp1), _mm_or_si128(cmp2, cmp3))};
+            const int mask{_mm_movemask_ps(_mm_castsi128_ps(cmp))};
+
+            const __m128i shuffle{_mm_load_si128(reinterpret_cast<const __m128i *>(sseShuffles[static_cast<std::size_t>(mask)].data()))};
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + count), _mm_shuffle_epi8(va, shuffle));
+            count += static_cast<std::size_t>(_mm_popcnt_u32(static_cast<unsigned>(mask)));
+
+            const std::uint32_t aLast{a[i + 3]};
+            const std::uint32_t bLast{b[j + 3]};
+            i += aLast <= bLast ? 4 : 0;
+            j += bLast <= aLast ? 4 : 0;
+        }
+        return count + mergeTail(a + i, na - i, b + j, nb - j, out + count);
+    }
+
+    // Same as intersectSse with 8 lanes and 8 rotations
+    __attribute__((target("avx2,popcnt"))) std::size_t intersectAvx2(const std::uint32_t *a, std::size_t na,
+                                                                     const std::uint32_t *b, std::size_t nb,
+                                                                     std::uint32_t *out, std::size_t nout)
+    {
+        const __m256i rotate{_mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0)};
+
+        std::size_t i{0};
+        std::size_t j{0};
+        std::size_t count{0};
+        while (i + 8 <= na && j + 8 <= nb && count + 8 <= nout)
+        {
+            const __m256i va{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i))};
+            __m256i vb{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j))};
+
+            __m256i cmp{_mm256_cmpeq_epi32(va, vb)};
+            for (int r{1}; r < 8; ++r)
+            {
+                vb = _mm256_permutevar8x32_epi32(vb, rotate);
+                cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi32(va, vb));
+            }
+            const int mask{_mm256_movemask_ps(_mm256_castsi256_ps(cmp))};
+
+            const __m256i permute{_mm256_load_si256(reinterpret_cast<const __m256i *>(avx2Permutes[static_cast<std::size_t>(mask)].data()))};
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + count), _mm256_permutevar8x32_epi32(va, permute));
+            count += static_cast<std::size_t>(_mm_popcnt_u32(static_cast<unsigned>(mask)));
+
+            const std::uint32_t aLast{a[i + 7]};
+            const std::uint32_t bLast{b[j + 7]};
+            i += aLast <= bLast ? 8 : 0;
+            j += bLast <= aLast ? 8 : 0;
+        }
+        return count + mergeTail(a + i, na - i, b + j, nb - j, out + count);
+    }
+
+    std::size_t intersectScalar(const std::uint32_t *a, std::size_t na, const std::uint32_t *b, std::size_t nb,
+                                std::uint32_t *out, std::size_t)
+    {
+        return mergeTail(a, na, b, nb, out);
+    }
+
+    const CpuDispatch<std::size_t(const std::uint32_t *, std::size_t, const std::uint32_t *, std::size_t,
+                                  std::uint32_t *, std::size_t)>
+        intersectBlocks{"intersect_simd",
+                        {{"avx2", [](const CpuFeatures &cpu)
+                          { return cpu.avx2 && cpu.popcnt; },
+                          intersectAvx2},
+                         {"sse4.2", [](const CpuFeatures &cpu)
+                          { return cpu.sse42 && cpu.popcnt; },
+                          intersectSse},
+                         {"scalar", nullptr, intersectScalar}}};
+
+    /**
+     * Loser tree (tournament tree) over k sorted sources. Each internal node
+     * remembers the *loser* of the match played there and the overall winner
+     * is kept separately. After the winner's source advances, only the
+     * matches on the path from its leaf to the root are replayed, so each
+     * output value costs log2(k) comparisons instead of the 2 log2(k) of a
+     * binary heap.
+     *
+     * A node packs a source's current value (high 32 bits) and the source
+     * index (low 32 bits) into one integer, so a match is a min and a max
+     * that can be computed without unpredictable branches.
+     */
+    class LoserTree
+    {
+    public:
+        static constexpr std::uint64_t exhausted{std::numeric_limits<std::uint64_t>::max()};
+
+        explicit LoserTree(std::span<const std::span<const std::uint32_t>> sets)
+            : m_cursors(sets.size()), m_ends(sets.size()), m_nodes(sets.size()), m_winner{exhausted}
+        {
+            for (std::size_t s{0}; s < sets.size(); ++s)
+            {
+                m_cursors[s] = sets[s].data();
+                m_ends[s] = sets[s].data() + sets[s].size();
+            }
+            m_winner = build(1);
+        }
+
+        bool empty() const { return m_winner == exhausted; }
+
+        // Smallest remaining value, only valid when the tree is not empty
+        std::uint32_t top() const { return static_cast<std::uint32_t>(m_winner >> 32); }
+
+        void pop()
+        {
+            const std::size_t source{static_cast<std::uint32_t>(m_winner)};
+            std::uint64_t winner{nodeOf(source, ++m_cursors[source])};
+            for (std::size_t node{(source + m_nodes.size()) / 2}; node >= 1; node /= 2)
+            {
+                // min and max through a mask, since compilers tend to turn
+                // std::min and std::max back into branches here
+                const std::uint64_t loser{m_nodes[node]};
+                const std::uint64_t mask{std::uint64_t{0} - (loser < winner ? 1u : 0u)};
+                const std::uint64_t smaller{winner ^ ((winner ^ loser) & mask)};
+                m_nodes[node] = loser ^ winner ^ smaller;
+                winner = smaller;
+            }
+            m_winner = winner;
+        }
+
+    private:
+        std::uint64_t nodeOf(std::size_t source, const std::uint32_t *cursor) const
+        {
+            if (cursor == m_ends[source])
+            {
+                return exhausted;
+            }
+            return (std::uint64_t{*cursor} << 32) | source;
+        }
+
+        // Leaves are nodes k..2k-1, internal nodes are 1..k-1
+        std::uint64_t build(std::size_t node)
+        {
+            const std::size_t k{m_nodes.size()};
+            if (node >= k)
+            {
+                return nodeOf(node - k, m_cursors[node - k]);
+            }
+
+            const std::uint64_t left{build(2 * node)};
+            const std::uint64_t right{build(2 * node + 1)};
+            m_nodes[node] = std::max(left, right);
+            return std::min(left, right);
+        }
+
+        std::vector<const std::uint32_t *> m_cursors;
+        std::vector<const std::uint32_t *> m_ends;
+        std::vector<std::uint64_t> m_nodes;
+        std::uint64_t m_winner;
+    };
+}
+
+std::size_t intersect_merge(std::span<const std::uint32_t> a, std::span<const std::uint32_t> b,
+                            std::span<std::uint32_t> out)
+{
+    return mergeTail(a.data(), a.size(), b.data(), b.size(), out.data());
+}
+
+std::size_t intersect_galloping(std::span<const std::uint32_t> a, std::span<const std::uint32_t> b,
+                                std::span<std::uint32_t> out)
+{
+    const auto small{a.size() <= b.size() ? a : b};
+    const auto large{a.size() <= b.size() ? b : a};
+
+    std::size_t count{0};
+    std::size_t low{0};
+    for (const std::uint32_t value : small)
+    {
+        // Double the step until we pass value, then binary search the last step
+        std::size_t high{low};
+        std::size_t step{1};
+        while (high < large.size() && large[high] < value)
+        {
+            low = high + 1;
+            high += step;
+            step *= 2;
+        }
+
+        const auto first{large.begin() + static_cast<std::ptrdiff_t>(low)};
+        const auto last{large.begin() + static_cast<std::ptrdiff_t>(std::min(high + 1, large.size()))};
+        const auto found{std::lower_bound(first, last, value)};
+        low = static_cast<std::size_t>(found - large.begin());
+
+        if (low == large.size())
+        {
+            break;
+        }
+        if (*found == value)
+        {
+            out[count++] = value;
+            ++low;
+        }
+    }
+    return count;
+}
+
+std::size_t intersect_simd(std::span<const std::uint32_t> a, std::span<const std::uint32_t> b,
+                           std::span<std::uint32_t> out)
+{
+    return intersectBlocks(a.data(), a.size(), b.data(), b.size(), out.data(), out.size());
+}
+
+std::size_t intersect(std::span<const std::uint32_t> a, std::span<const std::uint32_t> b,
+                      std::span<std::uint32_t> out)
+{
+    const std::size_t small{std::min(a.size(), b.size())};
+    const std::size_t large{std::max(a.size(), b.size())};
+
+    if (small == 0)
+    {
+        return 0;
+    }
+    if (large / small >= gallopingRatio)
+    {
+        return intersect_galloping(a, b, out);
+    }
+    return intersect_simd(a, b, out);
+}
+
+std::vector<std::uint32_t> intersect_all(std::span<const std::span<const std::uint32_t>> sets)
+{
+    if (sets.empty())
+    {
+        return {};
+    }
+
+    // Starting from the smallest sets keeps every intermediate result small
+    std::vector<std::span<const std::uint32_t>> bySize(sets.begin(), sets.end());
+    std::sort(bySize.begin(), bySize.end(), [](const auto &x, const auto &y)
+              { return x.size() < y.size(); });
+
+    std::vector<std::uint32_t> result(bySize.front().begin(), bySize.front().end());
+    std::vector<std::uint32_t> scratch(result.size());
+    for (std::size_t s{1}; s < bySize.size() && !result.empty(); ++s)
+    {
+        scratch.resize(result.size());
+        scratch.resize(intersect(result, bySize[s], scratch));
+        std::swap(result, scratch);
+    }
+    return result;
+}
+
+std::vector<std::uint32_t> union_all(std::span<const std::span<const std::uint32_t>> sets)
+{
+    std::size_t total{0};
+    for (const auto &set : sets)
+    {
+        total += set.size();
+    }
+
+    std::vector<std::uint32_t> result{};
+
+    if (sets.size() == 1)
+    {
+        result.assign(sets.front().begin(), sets.front().end());
+        return result;
+    }
+    if (sets.empty())
+    {
+        return result;
+    }
+
+    // Every value is written, but the output position only moves past it
+    // if it differs from the previous one. The same ID often appears in
+    // several sets, and this drops the copies without a hard-to-predict branch.
+    result.resize(total);
+    std::size_t count{0};
+    std::uint32_t previous{0};
+    LoserTree tree{sets};
+    for (; !tree.empty(); tree.pop())
+    {
+        const std::uint32_t value{tree.top()};
+        result[count] = value;
+        count += (count == 0 || value != previous) ? 1 : 0;
+        previous = value;
+    }
+    result.resize(count);
+    return result;
+}
@@ -0,0 +1,69 @@
+#ifndef AHO_CORASICK_H
+#define AHO_CORASICK_H
+
+#include "packed_strings.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/**
+ * Multi-pattern substring matcher.
+ *
+ * Build it once from the search terms, then scan any number of strings for
+ * all of the terms in a single pass over each string:
+ *
+ *     AhoCorasick matcher{patterns};
+ *     for (const auto &match : matcher.find_all(corpus))
+ *     {
+ *         // patterns[match.pattern] occurs in corpus[match.string]
+ *     }
+ *
+ * The patterns are copied into the matcher's tables, so they do not need to
+ * outlive it. Empty patterns are ignored.
+ */
+class AhoCorasick
+{
+public:
+    struct Match
+    {
+        std::size_t string{};
+        std::size_t pattern{};
+    };
+
+    explicit AhoCorasick(std::span<const std::string_view> patterns);
+
+    // Every (string, pattern) pair where the pattern occurs in the string,
+    // reported once per pair, ordered by string
+    std::vector<Match> find_all(const PackedStrings &corpus) const;
+
+    // Number of DFA states and size of the transition table in bytes
+    std::size_t states() const { return m_transitions.size() / m_numClasses; }
+    std::size_t table_bytes() const { return m_transitions.size() * sizeof(std::uint32_t); }
+
+    // True if the SIMD prefilter is used to skip bytes that cannot start a match
+    bool prefilter_enabled() const { return m_prefilter; }
+
+private:
+    template <typename Report>
+    void scan(std::string_view text, Report report) const;
+
+    std::size_t skipToCandidate(std::string_view text, std::size_t pos) const;
+
+    std::array<std::uint8_t, 256> m_classOf{};
+    std::size_t m_numClasses{1};
+    std::vector<std::uint32_t> m_transitions{};
+    std::vector<std::uint32_t> m_outputStart{};
+    std::vector<std::uint32_t> m_outputs{};
+    std::size_t m_numPatterns{0};
+
+    bool m_prefilter{false};
+    std::array<bool, 256> m_startByte{};
+    std::array<std::uint8_t, 16> m_lowNibbleMasks{};
+    std::array<std::uint8_t, 16> m_highNibbleMasks{};
+};
+
+#endif
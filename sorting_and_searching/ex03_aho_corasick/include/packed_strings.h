@@ -0,0 +1,34 @@
+#ifndef PACKED_STRINGS_H
+#define PACKED_STRINGS_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * A collection of strings stored back to back in one buffer.
+ *
+ * Compared to a std::vector<std::string>, there is one allocation in total
+ * instead of one per (long) string, and scanning every string reads memory
+ * strictly in order.
+ */
+class PackedStrings
+{
+public:
+    void push_back(std::string_view str);
+
+    std::size_t size() const { return m_offsets.size() - 1; }
+    std::size_t bytes() const { return m_bytes.size(); }
+
+    std::string_view operator[](std::size_t index) const
+    {
+        return std::string_view{m_bytes}.substr(m_offsets[index], m_offsets[index + 1] - m_offsets[index]);
+    }
+
+private:
+    std::string m_bytes{};
+    std::vector<std::size_t> m_offsets{0};
+};
+
+#endif
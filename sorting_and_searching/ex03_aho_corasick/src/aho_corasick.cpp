@@ -0,0 +1,287 @@
+#include "aho_corasick.h"
+
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <immintrin.h>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    // Set on a transition whose target state ends at least one pattern
+    constexpr std::uint32_t outputFlag{std::uint32_t{1} << 31};
+
+    // Skipping ahead only pays off when few bytes can start a match
+    constexpr std::size_t maxPrefilterStartBytes{16};
+
+    /**
+     * "Shufti" byte classification (from Hyperscan): a byte b may start a
+     * match if lowMasks[b & 15] & highMasks[b >> 4] is not zero. Both lookups
+     * are a single pshufb on 32 bytes at once. Returns the position of the
+     * first candidate byte at or after pos, or the end of the 32-byte blocks.
+     */
+    __attribute__((target("avx2,bmi"))) std::size_t skipAvx2(const char *data, std::size_t pos, std::size_t size,
+                                                             const std::uint8_t *lowMasks, const std::uint8_t *highMasks)
+    {
+        const __m256i low{_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lowMasks)))};
+        const __m256i high{_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(highMasks)))};
+        const __m256i nibble{_mm256_set1_epi8(0x0f)};
+        const __m256i zero{_mm256_setzero_si256()};
+
+        for (; pos + 32 <= size; pos += 32)
+        {
+            const __m256i bytes{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos))};
+            const __m256i lowNibbles{_mm256_and_si256(bytes, nibble)};
+            const __m256i highNibbles{_mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble)};
+            const __m256i classes{_mm256_and_si256(_mm256_shuffle_epi8(low, lowNibbles), _mm256_shuffle_epi8(high, highNibbles))};
+
+            const auto candidates{~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(classes, zero)))};
+            if (candidates != 0)
+            {
+                return pos + _tzcnt_u32(candidates);
+            }
+        }
+        return pos;
+    }
+
+    // Without AVX2 the scalar loop in skipToCandidate does all the skipping
+    std::size_t skipScalar(const char *, std::size_t pos, std::size_t, const std::uint8_t *, const std::uint8_t *)
+    {
+        return pos;
+    }
+
+    const CpuDispatch<std::size_t(const char *, std::size_t, std::size_t, const std::uint8_t *, const std::uint8_t *)>
+        skipBlocks{"aho_corasick_prefilter",
+                   {{"avx2", [](const CpuFeatures &cpu)
+                     { return cpu.avx2 && cpu.bmi1; },
+                     skipAvx2},
+                    {"scalar", nullptr, skipScalar}}};
+}
+
+AhoCorasick::AhoCorasick(std::span<const std::string_view> patterns)
+    : m_numPatterns{patterns.size()}
+{
+    /**
+     * Alphabet reduction: every byte that appears in some pattern gets its
+     * own class and all other bytes share class 0. The rows of the transition
+     * table then only need one column per class instead of 256, which keeps
+     * the hot upper levels of the automaton within a few cache lines.
+     */
+    for (std::string_view pattern : patterns)
+    {
+        for (char c : pattern)
+        {
+            auto &cls{m_classOf[static_cast<unsigned char>(c)]};
+            if (cls == 0)
+            {
+                cls = static_cast<std::uint8_t>(m_numClasses++);
+            }
+        }
+    }
+    if (m_numClasses > 256)
+    {
+        // All 256 byte values are used (and class 0 was handed out again), so
+        // fall back to one class per byte value
+        for (std::size_t c{0}; c < 256; ++c)
+        {
+            m_classOf[c] = static_cast<std::uint8_t>(c);
+        }
+        m_numClasses = 256;
+    }
+    const std::size_t nc{m_numClasses};
+
+    // Trie of the patterns. State 0 is the root, which is never the target
+    // of a trie edge, so 0 marks a missing edge.
+    std::vector<std::uint32_t> delta(nc, 0);
+    std::vector<std::vector<std::uint32_t>> outputs(1);
+    for (std::size_t p{0}; p < patterns.size(); ++p)
+    {
+        if (patterns[p].empty())
+        {
+            continue;
+        }
+
+        std::size_t state{0};
+        for (char c : patterns[p])
+        {
+            const std::size_t edge{state * nc + m_classOf[static_cast<unsigned char>(c)]};
+            if (delta[edge] == 0)
+            {
+                delta[edge] = static_cast<std::uint32_t>(outputs.size());
+                delta.resize(delta.size() + nc, 0);
+                outputs.emplace_back();
+            }
+            state = delta[edge];
+        }
+        outputs[state].push_back(static_cast<std::uint32_t>(p));
+        m_startByte[static_cast<unsigned char>(patterns[p].front())] = true;
+    }
+
+    const std::size_t numStates{outputs.size()};
+    if (numStates * nc >= outputFlag)
+    {
+        throw std::length_error{"AhoCorasick: too many patterns for a 31-bit transition table"};
+    }
+
+    /**
+     * Breadth-first pass turning the trie into a DFA. The failure link of a
+     * state is the longest proper suffix of its string that is also in the
+     * trie. A missing edge is filled with the same edge of the failure
+     * state, which was already completed since it is shallower. Outputs are
+     * merged along failure links so every state lists every pattern that
+     * ends there.
+     */
+    std::vector<std::uint32_t> fail(numStates, 0);
+    std::vector<std::uint32_t> order{0};
+    for (std::size_t next{0}; next < order.size(); ++next)
+    {
+        const std::uint32_t state{order[next]};
+        for (std::size_t cls{0}; cls < nc; ++cls)
+        {
+            const std::uint32_t child{delta[state * nc + cls]};
+            const std::uint32_t fallback{state == 0 ? 0 : delta[fail[state] * nc + cls]};
+            if (child == 0)
+            {
+                delta[state * nc + cls] = fallback;
+                continue;
+            }
+
+            fail[child] = fallback;
+            const auto &inherited{outputs[fallback]};
+            outputs[child].insert(outputs[child].end(), inherited.begin(), inherited.end());
+            order.push_back(child);
+        }
+    }
+
+    /**
+     * Renumber the states in breadth-first order so the shallow states, which
+     * are visited most often, sit together at the front of the table. Each
+     * transition stores the row offset of its target (saving a multiply per
+     * byte) and a flag when the target has outputs (saving a lookup per byte).
+     */
+    std::vector<std::uint32_t> newId(numStates);
+    for (std::size_t i{0}; i < numStates; ++i)
+    {
+        newId[order[i]] = static_cast<std::uint32_t>(i);
+    }
+
+    m_transitions.resize(numStates * nc);
+    m_outputStart.reserve(numStates + 1);
+    for (std::uint32_t state : order)
+    {
+        for (std::size_t cls{0}; cls < nc; ++cls)
+        {
+            const std::uint32_t target{delta[state * nc + cls]};
+            const std::uint32_t flag{outputs[target].empty() ? 0 : outputFlag};
+            m_transitions[newId[state] * nc + cls] = static_cast<std::uint32_t>(newId[target] * nc) | flag;
+        }
+        m_outputStart.push_back(static_cast<std::uint32_t>(m_outputs.size()));
+        m_outputs.insert(m_outputs.end(), outputs[state].begin(), outputs[state].end());
+    }
+    m_outputStart.push_back(static_cast<std::uint32_t>(m_outputs.size()));
+
+    /**
+     * Prefilter tables. Start bytes are grouped by their high nibble; high
+     * nibbles that share the same set of low nibbles share one of 8 bits. If
+     * there are more than 8 groups the extra ones are folded into the last
+     * bit, which can only add false candidates, never miss a real one.
+     */
+    const std::size_t numStartBytes{static_cast<std::size_t>(std::count(m_startByte.begin(), m_startByte.end(), true))};
+    m_prefilter = numStartBytes > 0 && numStartBytes <= maxPrefilterStartBytes;
+
+    std::vector<std::uint16_t> groups{};
+    for (std::size_t high{0}; high < 16; ++high)
+    {
+        std::uint16_t lows{0};
+        for (std::size_t low{0}; low < 16; ++low)
+        {
+            if (m_startByte[high * 16 + low])
+            {
+                lows = static_cast<std::uint16_t>(lows | (1u << low));
+            }
+        }
+        if (lows == 0)
+        {
+            continue;
+        }
+
+        auto found{std::find(groups.begin(), groups.end(), lows)};
+        if (found == groups.end())
+        {
+            found = groups.insert(groups.end(), lows);
+        }
+        const std::size_t group{std::min<std::size_t>(static_cast<std::size_t>(found - groups.begin()), 7)};
+
+        m_highNibbleMasks[high] = static_cast<std::uint8_t>(m_highNibbleMasks[high] | (1u << group));
+        for (std::size_t low{0}; low < 16; ++low)
+        {
+            if (lows & (1u << low))
+            {
+                m_lowNibbleMasks[low] = static_cast<std::uint8_t>(m_lowNibbleMasks[low] | (1u << group));
+            }
+        }
+    }
+}
+
+std::size_t AhoCorasick::skipToCandidate(std::string_view text, std::size_t pos) const
+{
+    pos = skipBlocks(text.data(), pos, text.size(), m_lowNibbleMasks.data(), m_highNibbleMasks.data());
+    while (pos < text.size() && !m_startByte[static_cast<unsigned char>(text[pos])])
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+template <typename Report>
+void AhoCorasick::scan(std::string_view text, Report report) const
+{
+    const std::uint32_t *table{m_transitions.data()};
+    std::uint32_t row{0};
+
+    for (std::size_t pos{0}; pos < text.size(); ++pos)
+    {
+        // In the root state, bytes that cannot start a pattern lead back to the root
+        if (row == 0 && m_prefilter)
+        {
+            pos = skipToCandidate(text, pos);
+            if (pos == text.size())
+            {
+                break;
+            }
+        }
+
+        const std::uint32_t entry{table[row + m_classOf[static_cast<unsigned char>(text[pos])]]};
+        row = entry & ~outputFlag;
+        if (entry & outputFlag)
+        {
+            report(row / m_numClasses);
+        }
+    }
+}
+
+std::vector<AhoCorasick::Match> AhoCorasick::find_all(const PackedStrings &corpus) const
+{
+    std::vector<Match> matches{};
+
+    // Last string each pattern was reported for, to report each pair once
+    std::vector<std::size_t> lastString(m_numPatterns, std::numeric_limits<std::size_t>::max());
+
+    for (std::size_t s{0}; s < corpus.size(); ++s)
+    {
+        scan(corpus[s], [&](std::size_t state)
+             {
+                 for (std::uint32_t o{m_outputStart[state]}; o < m_outputStart[state + 1]; ++o)
+                 {
+                     const std::uint32_t pattern{m_outputs[o]};
+                     if (lastString[pattern] != s)
+                     {
+                         lastString[pattern] = s;
+                         matches.push_back(Match{s, pattern});
+                     }
+                 } });
+    }
+
+    return matches;
+}
@@ -0,0 +1,189 @@
+/**
+ * Multi-Pattern Search with Aho-Corasick
+ *
+ * The lambda captures example in ch20_functions_and_lambdas reads one search
+ * string and uses std::find_if with a lambda that captures it to find the
+ * first fruit containing it. To answer the same question for thousands of
+ * search terms we could run that loop once per term, but then every string
+ * is scanned once per term: the cost is (number of terms) x (total bytes).
+ *
+ * The Aho-Corasick Automaton
+ *
+ * Aho-Corasick builds one automaton for all the terms and scans each string
+ * exactly once, one byte at a time, no matter how many terms there are.
+ *
+ *     1. Insert every term into a trie (a tree with one edge per character).
+ *     2. Give every node a *failure link* to the longest proper suffix of its
+ *        string that is also in the trie. If the text stops matching the
+ *        current path, the failure link tells us how much of what we have
+ *        already read can still be the start of another term.
+ *     3. Precompute, for every node and every character, where we end up
+ *        after following failure links. This turns the automaton into a
+ *        deterministic finite automaton (DFA): exactly one table lookup per
+ *        byte of text, with no backtracking.
+ *
+ * Making the Table Cache-Friendly
+ *
+ * The transition table has one row per state and one column per character.
+ * Columns are only kept for bytes that appear in some term (all other bytes
+ * share one column), rows are stored breadth-first so the states near the
+ * root (which are visited most) share cache lines, and each entry stores
+ * the offset of the next row directly, with a flag bit when a term ends there.
+ *
+ * SIMD Prefilter
+ *
+ * While the automaton sits in its root state, any byte that cannot start a
+ * term keeps it there. When the terms start with only a few distinct bytes,
+ * we skip over such bytes 32 at a time with AVX2 before stepping the DFA.
+ *
+ * Usage:
+ *
+ *     > make run                      # 200,000 strings, 200 search terms
+ *     > make run ARGS="1000000 2000"  # 1,000,000 strings, 2,000 search terms
+ */
+
+#include "aho_corasick.h"
+#include "cpu_dispatch.h"
+#include "packed_strings.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+std::string randomWord(std::mt19937 &rng, std::size_t minLength, std::size_t maxLength)
+{
+    std::uniform_int_distribution<std::size_t> length{minLength, maxLength};
+    std::uniform_int_distribution<int> letter{'a', 'z'};
+
+    auto word = std::string(length(rng), ' ');
+    for (auto &c : word)
+    {
+        c = static_cast<char>(letter(rng));
+    }
+    return word;
+}
+
+// Terms cut out of random corpus strings, so that most of them occur somewhere
+std::vector<std::string> sampleTerms(const PackedStrings &corpus, std::size_t count, std::string_view prefix, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<std::size_t> pick{0, corpus.size() - 1};
+    auto terms = std::vector<std::string>{};
+
+    while (terms.size() < count)
+    {
+        const auto str = corpus[pick(rng)];
+        const auto start = str.find(prefix);
+        if (start == std::string_view::npos || str.size() - start < prefix.size() + 4)
+        {
+            continue;
+        }
+        const auto length = std::min<std::size_t>(str.size() - start, prefix.size() + 4 + rng() % 4);
+        terms.emplace_back(str.substr(start, length));
+    }
+    return terms;
+}
+
+bool compare(const PackedStrings &corpus, const std::vector<std::string> &terms)
+{
+    const auto views = std::vector<std::string_view>(terms.begin(), terms.end());
+
+    // One pass over the corpus per term, like the lambda captures example
+    auto expected = std::vector<std::size_t>(terms.size());
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto t = std::size_t{0}; t < views.size(); ++t)
+    {
+        const auto search = views[t];
+        for (auto s = std::size_t{0}; s < corpus.size(); ++s)
+        {
+            // Capture @search
+            auto contains{[search](std::string_view str)
+                          { return str.find(search) != std::string_view::npos; }};
+            expected[t] += contains(corpus[s]) ? 1 : 0;
+        }
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "Lambda per term:  " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count()
+              << " ms" << std::endl;
+
+    // One pass over the corpus in total
+    start = std::chrono::high_resolution_clock::now();
+    const auto matcher = AhoCorasick{views};
+    stop = std::chrono::high_resolution_clock::now();
+    std::cout << "Aho-Corasick build: " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count()
+              << " ms (" << matcher.states() << " states, " << matcher.table_bytes() / 1024 << " KiB table, prefilter "
+              << (matcher.prefilter_enabled() ? "on" : "off") << ")" << std::endl;
+
+    auto found = std::vector<std::size_t>(terms.size());
+    start = std::chrono::high_resolution_clock::now();
+    for (const auto &match : matcher.find_all(corpus))
+    {
+        ++found[match.pattern];
+    }
+    stop = std::chrono::high_resolution_clock::now();
+    std::cout << "Aho-Corasick scan:  " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count()
+              << " ms" << std::endl;
+
+    if (found != expected)
+    {
+        std::cout << "Error: results disagree!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    // Which SIMD kernels this CPU runs
+    print_cpu_report(std::cout);
+    std::cout << '\n';
+
+    // The fruit search from the lambda captures example, with several terms at once
+    auto fruits = PackedStrings{};
+    for (auto fruit : std::array<std::string_view, 4>{"apple", "banana", "walnut", "lemon"})
+    {
+        fruits.push_back(fruit);
+    }
+    const auto searches = std::array<std::string_view, 4>{"an", "le", "nut", "kiwi"};
+    const auto fruitMatcher = AhoCorasick{searches};
+    for (const auto &match : fruitMatcher.find_all(fruits))
+    {
+        std::cout << "Found \"" << searches[match.pattern] << "\" in " << fruits[match.string] << '\n';
+    }
+    std::cout << '\n';
+
+    const auto numStrings = std::size_t{argc > 1 ? std::stoul(argv[1]) : 200000};
+    const auto numTerms = std::size_t{argc > 2 ? std::stoul(argv[2]) : 200};
+
+    // Random lowercase strings, about 1 in 100 of them with a #tag in it
+    auto rng = std::mt19937{42};
+    auto corpus = PackedStrings{};
+    for (auto s = std::size_t{0}; s < numStrings; ++s)
+    {
+        auto str = randomWord(rng, 5, 30);
+        if (rng() % 100 == 0)
+        {
+            str += " #" + randomWord(rng, 4, 8) + " " + randomWord(rng, 5, 10);
+        }
+        corpus.push_back(str);
+    }
+
+    std::cout << "Searching " << numStrings << " strings (" << corpus.bytes() / (1024 * 1024) << " MiB) for "
+              << numTerms << " terms..." << std::endl;
+    if (!compare(corpus, sampleTerms(corpus, numTerms, "", rng)))
+    {
+        return 1;
+    }
+
+    std::cout << "\nSearching for " << numTerms << " #tags (few start bytes, so the prefilter can skip)..." << std::endl;
+    if (!compare(corpus, sampleTerms(corpus, numTerms, "#", rng)))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,7 @@
+#include "packed_strings.h"
+
+void PackedStrings::push_back(std::string_view str)
+{
+    m_bytes.append(str);
+    m_offsets.push_back(m_bytes.size());
+}
@@ -0,0 +1,56 @@
+#ifndef SUFFIX_ARRAY_H
+#define SUFFIX_ARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Substring index over a collection of strings.
+ *
+ * The strings are copied into one text (separated by '\0' bytes) once, and a
+ * suffix array with its LCP array is built over that text. After that, each
+ * query costs O(m log n) for a pattern of length m in a text of n bytes,
+ * plus the time to report the matches, instead of a scan of the whole text.
+ *
+ *     SuffixArrayIndex index{strings};
+ *     for (std::size_t i : index.find("nut"))
+ *     {
+ *         // strings[i] contains "nut"
+ *     }
+ *
+ * Patterns containing '\0' never match. The total size of the strings must be
+ * below 2 GiB, since positions are stored as 32-bit integers.
+ */
+class SuffixArrayIndex
+{
+public:
+    explicit SuffixArrayIndex(std::span<const std::string_view> strings);
+
+    // Indices of the strings containing pattern, in increasing order
+    std::vector<std::size_t> find(std::string_view pattern) const;
+
+    // Number of occurrences of pattern (overlapping occurrences count)
+    std::size_t count(std::string_view pattern) const;
+
+    // Longest substring that occurs at least twice in the text
+    std::string_view longest_repeat() const;
+
+    // Bytes used by the index, including its copy of the text
+    std::size_t memory_bytes() const;
+
+private:
+    // First suffix array position whose suffix starts with pattern, or
+    // m_suffixes.size() if there is none
+    std::size_t lowerBound(std::string_view pattern) const;
+
+    std::string m_text{};
+    std::vector<std::uint32_t> m_starts{};
+    std::vector<std::int32_t> m_suffixes{};
+    std::vector<std::int32_t> m_lcp{};
+};
+
+#endif
@@ -0,0 +1,185 @@
+/**
+ * Suffix Array Substring Index
+ *
+ * In the lambda captures example in ch20_functions_and_lambdas, every search
+ * runs std::find_if with a lambda calling str.find(search) on each string.
+ * Each query reads every byte of every string, so a query against 1 GB of
+ * text costs a full 1 GB scan. That is fine for one query, but not for
+ * millions of queries against the same strings.
+ *
+ * Suffix Arrays
+ *
+ * A *suffix* of a text is the text starting from some position: the
+ * suffixes of "banana" are "banana", "anana", "nana", "ana", "na" and "a".
+ * Every substring of the text is a prefix of some suffix. A *suffix array*
+ * lists the starting positions of all suffixes in sorted order:
+ *
+ *     5 a
+ *     3 ana
+ *     1 anana
+ *     0 banana
+ *     4 na
+ *     2 nana
+ *
+ * All the suffixes starting with a pattern ("an" -> "ana" and "anana") sit
+ * next to each other, so a binary search finds all occurrences of any
+ * pattern in O(m log n) time, no matter how large the text is.
+ *
+ * The *LCP array* stores the length of the longest common prefix of each
+ * suffix with the previous one (0, 1, 3, 0, 0, 2 above). Once we have found
+ * the first suffix starting with a pattern, the rest of the matches are the
+ * following suffixes whose LCP is at least the pattern's length.
+ *
+ * Building the Index
+ *
+ * Sorting the suffixes with std::sort would compare long, overlapping
+ * strings. SA-IS sorts them in linear time by sorting a small subset (the
+ * "LMS" suffixes) recursively and inducing the order of all the others from
+ * them, and Kasai's algorithm computes the LCP array in linear time.
+ *
+ * Memory
+ *
+ * The index stores a copy of the text (1 byte per byte), the suffix array
+ * (4 bytes per byte) and the LCP array (4 bytes per byte), so it needs about
+ * 9 bytes for every byte of text. Building it needs about twice that.
+ *
+ * Usage:
+ *
+ *     > make run                 # 16 MiB of text, 1000 queries
+ *     > make run ARGS="1024"     # 1 GiB of text (needs ~20 GB of memory)
+ */
+
+#include "suffix_array.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+std::vector<std::size_t> linearScan(const std::vector<std::string_view> &strings, std::string_view search)
+{
+    auto found = std::vector<std::size_t>{};
+    auto it = strings.begin();
+    while (true)
+    {
+        // Capture @search, as in the lambda captures example
+        it = std::find_if(it, strings.end(), [search](std::string_view str)
+                          { return str.find(search) != std::string_view::npos; });
+        if (it == strings.end())
+        {
+            break;
+        }
+        found.push_back(static_cast<std::size_t>(it - strings.begin()));
+        ++it;
+    }
+    return found;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    // The fruits from the lambda captures example
+    const auto fruits = std::vector<std::string_view>{"apple", "banana", "walnut", "lemon"};
+    const auto fruitIndex = SuffixArrayIndex{fruits};
+    for (auto search : {"an", "le", "nut", "kiwi"})
+    {
+        std::cout << "\"" << search << "\" found in:";
+        for (auto i : fruitIndex.find(search))
+        {
+            std::cout << ' ' << fruits[i];
+        }
+        std::cout << '\n';
+    }
+    std::cout << "Longest repeated substring: \"" << fruitIndex.longest_repeat() << "\"\n\n";
+
+    const auto mebibytes = std::size_t{argc > 1 ? std::stoul(argv[1]) : 16};
+    const auto numQueries = std::size_t{argc > 2 ? std::stoul(argv[2]) : 1000};
+    const auto textBytes = mebibytes * 1024 * 1024;
+
+    // Random lowercase strings with 8 letters, so that queries of 5-8
+    // characters have a reasonable number of matches
+    auto rng = std::mt19937{42};
+    std::uniform_int_distribution<std::size_t> length{5, 40};
+    std::uniform_int_distribution<int> letter{'a', 'h'};
+
+    auto buffer = std::string{};
+    buffer.reserve(textBytes);
+    auto lengths = std::vector<std::size_t>{};
+    while (buffer.size() < textBytes)
+    {
+        lengths.push_back(length(rng));
+        for (auto i = std::size_t{0}; i < lengths.back(); ++i)
+        {
+            buffer.push_back(static_cast<char>(letter(rng)));
+        }
+    }
+
+    auto strings = std::vector<std::string_view>{};
+    auto offset = std::size_t{0};
+    for (auto len : lengths)
+    {
+        strings.emplace_back(buffer.data() + offset, len);
+        offset += len;
+    }
+
+    auto queries = std::vector<std::string>{};
+    std::uniform_int_distribution<std::size_t> pick{0, strings.size() - 1};
+    std::uniform_int_distribution<std::size_t> queryLength{5, 8};
+    while (queries.size() < numQueries)
+    {
+        const auto str = strings[pick(rng)];
+        const auto len = queryLength(rng);
+        if (str.size() >= len)
+        {
+            queries.emplace_back(str.substr(0, len));
+        }
+    }
+
+    std::cout << "Indexing " << strings.size() << " strings (" << mebibytes << " MiB)..." << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    const auto index = SuffixArrayIndex{strings};
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "Build time: " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count()
+              << " ms" << std::endl;
+    std::cout << "Memory: " << static_cast<double>(index.memory_bytes()) / static_cast<double>(buffer.size())
+              << " bytes per input byte" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    auto totalMatches = std::size_t{0};
+    for (const auto &query : queries)
+    {
+        totalMatches += index.find(query).size();
+    }
+    stop = std::chrono::high_resolution_clock::now();
+    auto seconds = std::chrono::duration<double>(stop - start).count();
+    std::cout << "Index queries: " << static_cast<double>(queries.size()) / seconds << " queries/s ("
+              << totalMatches / queries.size() << " matching strings per query)" << std::endl;
+
+    // The linear scan is far slower, so only time a few queries
+    const auto numScans = std::min<std::size_t>(queries.size(), 10);
+    auto scanResults = std::vector<std::vector<std::size_t>>{};
+    scanResults.reserve(numScans);
+    start = std::chrono::high_resolution_clock::now();
+    for (auto q = std::size_t{0}; q < numScans; ++q)
+    {
+        scanResults.push_back(linearScan(strings, queries[q]));
+    }
+    stop = std::chrono::high_resolution_clock::now();
+    seconds = std::chrono::duration<double>(stop - start).count();
+    std::cout << "Linear scan:   " << static_cast<double>(numScans) / seconds << " queries/s" << std::endl;
+
+    // Checked after the clock stops, so that the index is not timed as
+    // part of the scan
+    for (auto q = std::size_t{0}; q < numScans; ++q)
+    {
+        if (scanResults[q] != index.find(queries[q]))
+        {
+            std::cout << "Error: index and linear scan disagree!" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
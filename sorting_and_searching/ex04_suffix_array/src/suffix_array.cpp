@@ -0,0 +1,368 @@
+#include "suffix_array.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    /**
+     * SA-IS (Nong, Zhang and Chan, 2009): linear time suffix sorting by
+     * induced sorting.
+     *
+     * Every suffix is classified as S-type (smaller than the suffix after
+     * it) or L-type (larger). An S-type suffix right after an L-type one is a
+     * *leftmost S-type* (LMS) suffix. Once the LMS suffixes are in sorted
+     * order, two linear passes over the buckets "induce" the order of all
+     * the other suffixes: the L-types left to right, then the S-types right
+     * to left. The LMS suffixes are sorted by inducing once from an
+     * arbitrary order, naming the resulting LMS substrings, and recursing on
+     * the (at most half as long) string of names when names repeat.
+     *
+     * symbols holds values in [0, upper].
+     */
+    template <typename Symbol>
+    std::vector<std::int32_t> sais(std::span<const Symbol> s, std::size_t upper)
+    {
+        const auto n{static_cast<std::int32_t>(s.size())};
+        if (n == 0)
+        {
+            return {};
+        }
+        if (n == 1)
+        {
+            return {0};
+        }
+        if (n == 2)
+        {
+            return s[0] < s[1] ? std::vector<std::int32_t>{0, 1} : std::vector<std::int32_t>{1, 0};
+        }
+
+        auto at{[&s](std::int32_t i)
+                { return static_cast<std::size_t>(s[static_cast<std::size_t>(i)]); }};
+
+        std::vector<std::int32_t> sa(s.size());
+
+        // isS[i] is 1 if suffix i is S-type (bytes rather than std::vector<bool>,
+        // since the induce passes read it at random positions)
+        std::vector<std::uint8_t> isS(s.size());
+        for (std::int32_t i{n - 2}; i >= 0; --i)
+        {
+            const auto u{static_cast<std::size_t>(i)};
+            isS[u] = at(i) == at(i + 1) ? isS[u + 1] : static_cast<std::uint8_t>(at(i) < at(i + 1));
+        }
+        auto isLms{[&isS](std::int32_t i)
+                   { return i > 0 && isS[static_cast<std::size_t>(i)] && !isS[static_cast<std::size_t>(i - 1)]; }};
+
+        // Bucket c holds the suffixes starting with c: its L-types at the
+        // front (from startL[c]) and its S-types at the back (from startS[c])
+        std::vector<std::int32_t> startL(upper + 2);
+        std::vector<std::int32_t> startS(upper + 2);
+        for (std::int32_t i{0}; i < n; ++i)
+        {
+            if (isS[static_cast<std::size_t>(i)])
+            {
+                ++startL[at(i) + 1];
+            }
+            else
+            {
+                ++startS[at(i)];
+            }
+        }
+        for (std::size_t c{0}; c <= upper; ++c)
+        {
+            startS[c] += startL[c];
+            startL[c + 1] += startS[c];
+        }
+
+        std::vector<std::int32_t> next(upper + 2);
+        auto induce{[&](const std::vector<std::int32_t> &lms)
+                    {
+                        std::fill(sa.begin(), sa.end(), -1);
+
+                        std::copy(startS.begin(), startS.end(), next.begin());
+                        for (std::int32_t d : lms)
+                        {
+                            sa[static_cast<std::size_t>(next[at(d)]++)] = d;
+                        }
+
+                        std::copy(startL.begin(), startL.end(), next.begin());
+                        sa[static_cast<std::size_t>(next[at(n - 1)]++)] = n - 1;
+                        for (std::int32_t i{0}; i < n; ++i)
+                        {
+                            const std::int32_t v{sa[static_cast<std::size_t>(i)]};
+                            if (v >= 1 && !isS[static_cast<std::size_t>(v - 1)])
+                            {
+                                sa[static_cast<std::size_t>(next[at(v - 1)]++)] = v - 1;
+                            }
+                        }
+
+                        std::copy(startL.begin(), startL.end(), next.begin());
+                        for (std::int32_t i{n - 1}; i >= 0; --i)
+                        {
+                            const std::int32_t v{sa[static_cast<std::size_t>(i)]};
+                            if (v >= 1 && isS[static_cast<std::size_t>(v - 1)])
+                            {
+                                sa[static_cast<std::size_t>(--next[at(v - 1) + 1])] = v - 1;
+                            }
+                        }
+                    }};
+
+        // lmsIndex[i] is the rank of LMS suffix i in text order, or -1
+        std::vector<std::int32_t> lmsIndex(s.size(), -1);
+        std::vector<std::int32_t> lms{};
+        for (std::int32_t i{1}; i < n; ++i)
+        {
+            if (isLms(i))
+            {
+                lmsIndex[static_cast<std::size_t>(i)] = static_cast<std::int32_t>(lms.size());
+                lms.push_back(i);
+            }
+        }
+        const auto m{static_cast<std::int32_t>(lms.size())};
+
+        induce(lms);
+        if (m == 0)
+        {
+            return sa;
+        }
+
+        // LMS suffixes in the order induced from their LMS substrings
+        std::vector<std::int32_t> sortedLms{};
+        sortedLms.reserve(lms.size());
+        for (std::int32_t v : sa)
+        {
+            if (v >= 0 && lmsIndex[static_cast<std::size_t>(v)] != -1)
+            {
+                sortedLms.push_back(v);
+            }
+        }
+
+        // Name the LMS substrings; equal substrings get equal names
+        auto lmsEnd{[&](std::int32_t v)
+                    {
+                        const std::int32_t k{lmsIndex[static_cast<std::size_t>(v)] + 1};
+                        return k < m ? lms[static_cast<std::size_t>(k)] : n;
+                    }};
+
+        std::vector<std::int32_t> names(lms.size());
+        std::int32_t name{0};
+        names[static_cast<std::size_t>(lmsIndex[static_cast<std::size_t>(sortedLms[0])])] = 0;
+        for (std::size_t i{1}; i < sortedLms.size(); ++i)
+        {
+            std::int32_t l{sortedLms[i - 1]};
+            std::int32_t r{sortedLms[i]};
+            const std::int32_t endL{lmsEnd(l)};
+            const std::int32_t endR{lmsEnd(r)};
+
+            bool same{endL - l == endR - r};
+            if (same)
+            {
+                while (l < endL && at(l) == at(r))
+                {
+                    ++l;
+                    ++r;
+                }
+                same = l < n && r < n && at(l) == at(r) && l == endL;
+            }
+            if (!same)
+            {
+                ++name;
+            }
+            names[static_cast<std::size_t>(lmsIndex[static_cast<std::size_t>(sortedLms[i])])] = name;
+        }
+
+        // Recurse to sort the LMS suffixes, then induce the final order
+        const std::vector<std::int32_t> lmsOrder{sais<std::int32_t>(names, static_cast<std::size_t>(name))};
+        for (std::size_t i{0}; i < lms.size(); ++i)
+        {
+            sortedLms[i] = lms[static_cast<std::size_t>(lmsOrder[i])];
+        }
+        induce(sortedLms);
+
+        return sa;
+    }
+
+    /**
+     * Kasai et al. (2001): LCP array in linear time. lcp[i] is the length of
+     * the longest common prefix of the suffixes at sa[i - 1] and sa[i].
+     * Walking the suffixes in text order, the LCP can drop by at most one
+     * from one suffix to the next, so the total work is O(n).
+     */
+    std::vector<std::int32_t> kasai(std::string_view text, const std::vector<std::int32_t> &sa)
+    {
+        const std::size_t n{text.size()};
+        std::vector<std::int32_t> rank(n);
+        for (std::size_t i{0}; i < n; ++i)
+        {
+            rank[static_cast<std::size_t>(sa[i])] = static_cast<std::int32_t>(i);
+        }
+
+        std::vector<std::int32_t> lcp(n, 0);
+        std::size_t h{0};
+        for (std::size_t i{0}; i < n; ++i)
+        {
+            const auto r{static_cast<std::size_t>(rank[i])};
+            if (r == 0)
+            {
+                h = 0;
+                continue;
+            }
+
+            const auto j{static_cast<std::size_t>(sa[r - 1])};
+            while (i + h < n && j + h < n && text[i + h] == text[j + h])
+            {
+                ++h;
+            }
+            lcp[r] = static_cast<std::int32_t>(h);
+            h = h > 0 ? h - 1 : 0;
+        }
+        return lcp;
+    }
+}
+
+SuffixArrayIndex::SuffixArrayIndex(std::span<const std::string_view> strings)
+{
+    std::size_t total{0};
+    for (std::string_view str : strings)
+    {
+        total += str.size() + 1;
+    }
+    if (total >= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+    {
+        throw std::length_error{"SuffixArrayIndex: text must be smaller than 2 GiB"};
+    }
+
+    m_text.reserve(total);
+    m_starts.reserve(strings.size());
+    for (std::string_view str : strings)
+    {
+        if (!m_text.empty())
+        {
+            m_text.push_back('\0');
+        }
+        m_starts.push_back(static_cast<std::uint32_t>(m_text.size()));
+        m_text.append(str);
+    }
+
+    const std::span<const unsigned char> symbols{reinterpret_cast<const unsigned char *>(m_text.data()), m_text.size()};
+    m_suffixes = sais(symbols, 255);
+    m_lcp = kasai(m_text, m_suffixes);
+}
+
+std::size_t SuffixArrayIndex::lowerBound(std::string_view pattern) const
+{
+    // Compares the first pattern.size() bytes of the suffix at pos with the
+    // pattern, skipping the first known bytes which are known to match
+    auto compare{[this, pattern](std::int32_t pos, std::size_t known, std::size_t &matched)
+                 {
+                     const std::string_view suffix{std::string_view{m_text}.substr(static_cast<std::size_t>(pos))};
+                     matched = known;
+                     while (matched < pattern.size() && matched < suffix.size() && suffix[matched] == pattern[matched])
+                     {
+                         ++matched;
+                     }
+                     if (matched == pattern.size())
+                     {
+                         return 0;
+                     }
+                     if (matched == suffix.size())
+                     {
+                         return -1;
+                     }
+                     return static_cast<unsigned char>(suffix[matched]) < static_cast<unsigned char>(pattern[matched]) ? -1 : 1;
+                 }};
+
+    /**
+     * Binary search for the first suffix that is not less than the pattern.
+     * Every suffix between lo and hi shares at least min(lcpLo, lcpHi)
+     * characters with the pattern, so comparisons can start from there
+     * (Manber and Myers). This makes typical queries close to O(m + log n).
+     */
+    std::size_t lo{0};
+    std::size_t hi{m_suffixes.size()};
+    std::size_t lcpLo{0};
+    std::size_t lcpHi{0};
+    while (lo < hi)
+    {
+        const std::size_t mid{lo + (hi - lo) / 2};
+        std::size_t matched{0};
+        if (compare(m_suffixes[mid], std::min(lcpLo, lcpHi), matched) < 0)
+        {
+            lo = mid + 1;
+            lcpLo = matched;
+        }
+        else
+        {
+            hi = mid;
+            lcpHi = matched;
+        }
+    }
+
+    std::size_t matched{0};
+    if (lo == m_suffixes.size() || compare(m_suffixes[lo], 0, matched) != 0)
+    {
+        return m_suffixes.size();
+    }
+    return lo;
+}
+
+std::vector<std::size_t> SuffixArrayIndex::find(std::string_view pattern) const
+{
+    std::vector<std::size_t> found{};
+    if (pattern.empty() || pattern.find('\0') != std::string_view::npos)
+    {
+        return found;
+    }
+
+    // The suffixes starting with pattern are contiguous, and the ones after
+    // the first share at least pattern.size() characters with their
+    // predecessor, so the LCP array gives us the end of the range for free
+    const std::size_t first{lowerBound(pattern)};
+    const auto m{static_cast<std::int32_t>(pattern.size())};
+    for (std::size_t i{first}; i < m_suffixes.size() && (i == first || m_lcp[i] >= m); ++i)
+    {
+        const auto pos{static_cast<std::uint32_t>(m_suffixes[i])};
+        const auto owner{std::upper_bound(m_starts.begin(), m_starts.end(), pos) - m_starts.begin() - 1};
+        found.push_back(static_cast<std::size_t>(owner));
+    }
+
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    return found;
+}
+
+std::size_t SuffixArrayIndex::count(std::string_view pattern) const
+{
+    if (pattern.empty() || pattern.find('\0') != std::string_view::npos)
+    {
+        return 0;
+    }
+
+    const std::size_t first{lowerBound(pattern)};
+    const auto m{static_cast<std::int32_t>(pattern.size())};
+    std::size_t last{first};
+    while (last < m_suffixes.size() && (last == first || m_lcp[last] >= m))
+    {
+        ++last;
+    }
+    return last - first;
+}
+
+std::string_view SuffixArrayIndex::longest_repeat() const
+{
+    const auto longest{std::max_element(m_lcp.begin(), m_lcp.end())};
+    if (longest == m_lcp.end())
+    {
+        return {};
+    }
+
+    const auto pos{static_cast<std::size_t>(m_suffixes[static_cast<std::size_t>(longest - m_lcp.begin())])};
+    return std::string_view{m_text}.substr(pos, static_cast<std::size_t>(*longest));
+}
+
+std::size_t SuffixArrayIndex::memory_bytes() const
+{
+    return m_text.capacity() + m_starts.capacity() * sizeof(std::uint32_t) +
+           (m_suffixes.capacity() + m_lcp.capacity()) * sizeof(std::int32_t);
+}
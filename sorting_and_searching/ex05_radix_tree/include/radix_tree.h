@@ -0,0 +1,87 @@
+#ifndef RADIX_TREE_H
+#define RADIX_TREE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Read-only radix tree (compressed trie) mapping strings to 32-bit values.
+ *
+ * The tree is bulk-loaded once from keys in sorted order with no duplicates
+ * (std::invalid_argument is thrown otherwise). A common pattern is to store
+ * the index of each key in its own array as the value:
+ *
+ *     RadixTree tree{sortedKeys, indices};
+ *     tree.find("June");                // the value stored for "June", if any
+ *     tree.values_with_prefix("Ju");    // values of "July" and "June"
+ *     tree.longest_prefix("Junebug");   // {4, value of "June"}
+ *
+ * The keys are copied into the tree, so they do not need to outlive it.
+ */
+class RadixTree
+{
+public:
+    RadixTree(std::span<const std::string_view> sortedKeys, std::span<const std::uint32_t> values);
+
+    // Value stored for key, if key is in the tree
+    std::optional<std::uint32_t> find(std::string_view key) const;
+
+    // Values of all keys starting with prefix, in key order
+    std::vector<std::uint32_t> values_with_prefix(std::string_view prefix) const;
+
+    // Length and value of the longest key that is a prefix of text
+    std::optional<std::pair<std::size_t, std::uint32_t>> longest_prefix(std::string_view text) const;
+
+    std::size_t size() const { return m_size; }
+    std::size_t memory_bytes() const;
+
+private:
+    static constexpr std::size_t maxInlineChildren{48};
+    static constexpr std::uint8_t bigNode{0xff};
+    static constexpr std::uint32_t noChild{0xffffffff};
+
+    /**
+     * One node per cache line. The children of a node are stored next to
+     * each other, so a node only needs the index of its first child plus
+     * the first byte of each child's label, which are searched 16 at a time.
+     * Nodes with more than 48 children keep a 256-entry table instead, and
+     * leaves use the same space to hold their label.
+     */
+    struct alignas(64) Node
+    {
+        std::uint32_t labelOffset{0};
+        std::uint32_t value{0};
+        std::uint32_t firstChild{0};
+        std::uint16_t labelLength{0};
+        std::uint8_t numChildren{0}; // bigNode if the children are in m_bigTables
+        std::uint8_t hasValue{0};
+        std::array<std::uint8_t, maxInlineChildren> childBytes{}; // or a leaf's label
+    };
+    static_assert(sizeof(Node) == 64);
+
+    // For nodes with many children: child rank + 1 for every byte, 0 if none
+    struct BigTable
+    {
+        std::array<std::uint16_t, 256> rankPlusOne{};
+        std::uint32_t numChildren{0};
+    };
+
+    std::string_view label(const Node &node) const;
+    std::uint32_t child(const Node &node, unsigned char byte) const;
+    std::size_t childCount(const Node &node) const;
+    void collect(const Node &node, std::vector<std::uint32_t> &out) const;
+
+    std::vector<Node> m_nodes{};
+    std::vector<BigTable> m_bigTables{};
+    std::string m_labels{};
+    std::size_t m_size{0};
+};
+
+#endif
@@ -0,0 +1,233 @@
+/**
+ * Radix Tree for Prefix Lookups
+ *
+ * The string arrays in the examples (the fruits in the lambda captures
+ * example, the months in the lambdas example, the pets in the reverse range
+ * example) are only ever searched one element at a time. For large word
+ * lists the usual next step is std::map or std::unordered_map, but neither
+ * is a great fit for questions about *prefixes*:
+ *
+ *     * Which words start with "Ju"?              (prefix enumeration)
+ *     * Which word is the longest prefix of       (longest-prefix match, as
+ *       "Decemberists"?                            used for routing tables)
+ *
+ * A hash map cannot answer either without trying every prefix, and std::map
+ * stores every key in its own heap-allocated tree node, so a lookup follows
+ * about log2(n) pointers to nodes spread around the heap.
+ *
+ * Tries and Radix Trees
+ *
+ * A *trie* stores keys as paths from the root, one character per edge, so
+ * keys with a common prefix share the nodes for it. A lookup follows one
+ * edge per character and never compares whole keys. A *radix tree* (or
+ * compressed trie) merges chains of single-child nodes into one node with a
+ * multi-character label, so the number of nodes is at most twice the number
+ * of keys.
+ *
+ * Cache-Friendly Layout
+ *
+ * Every node in this tree is exactly one 64-byte cache line. The children of
+ * a node are stored next to each other, so a node only keeps the first
+ * character of each child (up to 48 of them), and finding the right child is
+ * three 16-byte SIMD comparisons within the same cache line. Since the tree
+ * is built once from sorted keys, it is laid out breadth first: the top
+ * levels, which every lookup visits, are packed together at the front.
+ *
+ * Usage:
+ *
+ *     > make run                  # 1 million keys
+ *     > make run ARGS="10000000"  # 10 million keys
+ */
+
+#include "radix_tree.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Lets std::unordered_map<std::string, ...> look up std::string_view keys
+struct StringHash
+{
+    using is_transparent = void;
+    std::size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+};
+
+// Runs function once and prints the average time per query
+template <typename Function>
+void timePerQuery(std::string_view name, std::size_t numQueries, Function function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << name << std::chrono::duration<double, std::nano>(stop - start).count() / static_cast<double>(numQueries)
+              << " ns" << std::endl;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    // The months from the lambdas example, sorted for bulk loading
+    auto months = std::array<std::string_view, 12>{"January", "February", "March", "April", "May", "June",
+                                                   "July", "August", "September", "October", "November", "December"};
+    std::sort(months.begin(), months.end());
+    auto monthIds = std::vector<std::uint32_t>(months.size());
+    std::iota(monthIds.begin(), monthIds.end(), 0u);
+
+    const auto monthTree = RadixTree{months, monthIds};
+    std::cout << "Is \"May\" a month? " << (monthTree.find("May") ? "yes" : "no") << '\n';
+    std::cout << "Months starting with \"Ju\":";
+    for (auto id : monthTree.values_with_prefix("Ju"))
+    {
+        std::cout << ' ' << months[id];
+    }
+    std::cout << '\n';
+    if (const auto match = monthTree.longest_prefix("Decemberists"))
+    {
+        std::cout << "Longest month prefix of \"Decemberists\": " << months[match->second] << "\n\n";
+    }
+
+    const auto count = std::size_t{argc > 1 ? std::stoul(argv[1]) : 1000000};
+
+    // Keys made of a shared stem and a random ending, like real word lists
+    auto rng = std::mt19937{42};
+    std::uniform_int_distribution<int> letter{'a', 'z'};
+    auto randomWord = [&](std::size_t minLength, std::size_t maxLength)
+    {
+        auto word = std::string(std::uniform_int_distribution<std::size_t>{minLength, maxLength}(rng), ' ');
+        for (auto &c : word)
+        {
+            c = static_cast<char>(letter(rng));
+        }
+        return word;
+    };
+
+    auto stems = std::vector<std::string>{};
+    for (auto i = std::size_t{0}; i < count / 100 + 1; ++i)
+    {
+        stems.push_back(randomWord(3, 8));
+    }
+    auto keyStrings = std::vector<std::string>{};
+    std::uniform_int_distribution<std::size_t> pickStem{0, stems.size() - 1};
+    for (auto i = std::size_t{0}; i < count; ++i)
+    {
+        keyStrings.push_back(stems[pickStem(rng)] + randomWord(0, 8));
+    }
+    std::sort(keyStrings.begin(), keyStrings.end());
+    keyStrings.erase(std::unique(keyStrings.begin(), keyStrings.end()), keyStrings.end());
+
+    const auto keys = std::vector<std::string_view>(keyStrings.begin(), keyStrings.end());
+    auto ids = std::vector<std::uint32_t>(keys.size());
+    std::iota(ids.begin(), ids.end(), 0u);
+
+    // Half of the lookups hit, half miss
+    auto queries = std::vector<std::string>{};
+    std::uniform_int_distribution<std::size_t> pickKey{0, keys.size() - 1};
+    for (auto i = std::size_t{0}; i < keys.size(); ++i)
+    {
+        queries.push_back(i % 2 == 0 ? std::string{keys[pickKey(rng)]} : stems[pickStem(rng)] + randomWord(0, 8));
+    }
+    std::shuffle(queries.begin(), queries.end(), rng);
+
+    std::cout << "Building from " << keys.size() << " keys..." << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    const auto tree = RadixTree{keys, ids};
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "Radix tree bulk load: " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count()
+              << " ms, " << tree.memory_bytes() / keys.size() << " bytes per key" << std::endl;
+
+    auto ordered = std::map<std::string, std::uint32_t, std::less<>>{};
+    auto hashed = std::unordered_map<std::string, std::uint32_t, StringHash, std::equal_to<>>{};
+    for (auto i = std::size_t{0}; i < keys.size(); ++i)
+    {
+        ordered.emplace(keys[i], ids[i]);
+        hashed.emplace(keys[i], ids[i]);
+    }
+
+    // Exact match
+    auto treeHits = std::size_t{0};
+    auto mapHits = std::size_t{0};
+    auto hashHits = std::size_t{0};
+    std::cout << "\nExact match (per query):" << std::endl;
+    timePerQuery("Radix tree:         ", queries.size(), [&]()
+                 {
+                     for (const auto &query : queries)
+                     {
+                         treeHits += tree.find(query).has_value();
+                     } });
+    timePerQuery("std::map:           ", queries.size(), [&]()
+                 {
+                     for (const auto &query : queries)
+                     {
+                         mapHits += ordered.contains(std::string_view{query});
+                     } });
+    timePerQuery("std::unordered_map: ", queries.size(), [&]()
+                 {
+                     for (const auto &query : queries)
+                     {
+                         hashHits += hashed.contains(std::string_view{query});
+                     } });
+
+    // Prefix enumeration, using the stems as prefixes
+    const auto numPrefixQueries = std::min<std::size_t>(stems.size(), 10000);
+    auto treeFound = std::size_t{0};
+    auto mapFound = std::size_t{0};
+    std::cout << "\nPrefix enumeration (per query):" << std::endl;
+    timePerQuery("Radix tree:         ", numPrefixQueries, [&]()
+                 {
+                     for (auto s = std::size_t{0}; s < numPrefixQueries; ++s)
+                     {
+                         treeFound += tree.values_with_prefix(stems[s]).size();
+                     } });
+    timePerQuery("std::map:           ", numPrefixQueries, [&]()
+                 {
+                     for (auto s = std::size_t{0}; s < numPrefixQueries; ++s)
+                     {
+                         auto found = std::vector<std::uint32_t>{};
+                         for (auto it = ordered.lower_bound(stems[s]); it != ordered.end() && it->first.starts_with(stems[s]); ++it)
+                         {
+                             found.push_back(it->second);
+                         }
+                         mapFound += found.size();
+                     } });
+
+    // Longest-prefix match; a hash map has to try every prefix length
+    auto treeLongest = std::size_t{0};
+    auto hashLongest = std::size_t{0};
+    std::cout << "\nLongest-prefix match (per query):" << std::endl;
+    timePerQuery("Radix tree:         ", queries.size(), [&]()
+                 {
+                     for (const auto &query : queries)
+                     {
+                         const auto match = tree.longest_prefix(query);
+                         treeLongest += match ? match->first : 0;
+                     } });
+    timePerQuery("std::unordered_map: ", queries.size(), [&]()
+                 {
+                     for (const auto &query : queries)
+                     {
+                         for (auto len = query.size(); len > 0; --len)
+                         {
+                             if (hashed.contains(std::string_view{query}.substr(0, len)))
+                             {
+                                 hashLongest += len;
+                                 break;
+                             }
+                         }
+                     } });
+
+    if (treeHits != mapHits || treeHits != hashHits || treeFound != mapFound || treeLongest != hashLongest)
+    {
+        std::cout << "Error: results disagree!" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
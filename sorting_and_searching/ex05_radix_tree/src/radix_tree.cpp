@@ -0,0 +1,301 @@
+#include "radix_tree.h"
+
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+RadixTree::RadixTree(std::span<const std::string_view> sortedKeys, std::span<const std::uint32_t> values)
+    : m_size{sortedKeys.size()}
+{
+    if (sortedKeys.size() != values.size())
+    {
+        throw std::invalid_argument{"RadixTree: need one value per key"};
+    }
+    for (std::size_t i{0}; i < sortedKeys.size(); ++i)
+    {
+        if (i > 0 && !(sortedKeys[i - 1] < sortedKeys[i]))
+        {
+            throw std::invalid_argument{"RadixTree: keys must be sorted and unique"};
+        }
+        if (sortedKeys[i].size() > std::numeric_limits<std::uint16_t>::max())
+        {
+            throw std::length_error{"RadixTree: keys must be shorter than 64 KiB"};
+        }
+    }
+
+    /**
+     * Bulk load, breadth first. Each pending node covers a range of keys
+     * that share their first depth characters. Its label is the rest of the
+     * prefix shared by the whole range, which is just the common prefix of
+     * the first and last key since the keys are sorted. Below the label the
+     * range splits into runs of keys with the same next character, and each
+     * run becomes a child. All children of a node are allocated together.
+     */
+    struct Pending
+    {
+        std::uint32_t node{};
+        std::size_t lo{};
+        std::size_t hi{};
+        std::size_t depth{};
+    };
+
+    m_nodes.emplace_back();
+    std::vector<Pending> queue{Pending{0, 0, sortedKeys.size(), 0}};
+    for (std::size_t next{0}; next < queue.size(); ++next)
+    {
+        auto [index, lo, hi, depth]{queue[next]};
+        if (lo == hi)
+        {
+            continue;
+        }
+
+        const std::string_view first{sortedKeys[lo]};
+        const std::string_view last{sortedKeys[hi - 1]};
+        std::size_t end{depth};
+        while (end < first.size() && end < last.size() && first[end] == last[end])
+        {
+            ++end;
+        }
+
+        // In sorted order, a key that ends here comes before all the longer ones
+        if (first.size() == end)
+        {
+            m_nodes[index].hasValue = 1;
+            m_nodes[index].value = values[lo];
+            ++lo;
+        }
+
+        // Leaves have no child bytes, so short leaf labels are stored in
+        // their place and reading them does not touch another cache line
+        const std::string_view nodeLabel{first.substr(depth, end - depth)};
+        m_nodes[index].labelLength = static_cast<std::uint16_t>(nodeLabel.size());
+        if (lo == hi && nodeLabel.size() <= maxInlineChildren)
+        {
+            std::memcpy(m_nodes[index].childBytes.data(), nodeLabel.data(), nodeLabel.size());
+        }
+        else
+        {
+            m_nodes[index].labelOffset = static_cast<std::uint32_t>(m_labels.size());
+            m_labels.append(nodeLabel);
+        }
+
+        std::vector<std::size_t> runStarts{};
+        for (std::size_t i{lo}; i < hi; ++i)
+        {
+            if (i == lo || sortedKeys[i][end] != sortedKeys[i - 1][end])
+            {
+                runStarts.push_back(i);
+            }
+        }
+        runStarts.push_back(hi);
+        const std::size_t numChildren{runStarts.size() - 1};
+        if (numChildren == 0)
+        {
+            continue;
+        }
+
+        const auto firstChild{static_cast<std::uint32_t>(m_nodes.size())};
+        m_nodes.resize(m_nodes.size() + numChildren);
+        m_nodes[index].firstChild = firstChild;
+
+        if (numChildren <= maxInlineChildren)
+        {
+            m_nodes[index].numChildren = static_cast<std::uint8_t>(numChildren);
+        }
+        else
+        {
+            // The table index goes where the child bytes would be
+            const auto table{static_cast<std::uint32_t>(m_bigTables.size())};
+            m_bigTables.emplace_back();
+            m_bigTables.back().numChildren = static_cast<std::uint32_t>(numChildren);
+            m_nodes[index].numChildren = bigNode;
+            std::memcpy(m_nodes[index].childBytes.data(), &table, sizeof(table));
+        }
+
+        for (std::size_t c{0}; c < numChildren; ++c)
+        {
+            const auto byte{static_cast<unsigned char>(sortedKeys[runStarts[c]][end])};
+            if (numChildren <= maxInlineChildren)
+            {
+                m_nodes[index].childBytes[c] = byte;
+            }
+            else
+            {
+                m_bigTables.back().rankPlusOne[byte] = static_cast<std::uint16_t>(c + 1);
+            }
+            queue.push_back(Pending{static_cast<std::uint32_t>(firstChild + c), runStarts[c], runStarts[c + 1], end});
+        }
+    }
+}
+
+std::string_view RadixTree::label(const Node &node) const
+{
+    if (node.numChildren == 0 && node.labelLength <= maxInlineChildren)
+    {
+        return std::string_view{reinterpret_cast<const char *>(node.childBytes.data()), node.labelLength};
+    }
+    return std::string_view{m_labels}.substr(node.labelOffset, node.labelLength);
+}
+
+std::uint32_t RadixTree::child(const Node &node, unsigned char byte) const
+{
+    if (node.numChildren == bigNode)
+    {
+        std::uint32_t table{};
+        std::memcpy(&table, node.childBytes.data(), sizeof(table));
+        const std::uint16_t rankPlusOne{m_bigTables[table].rankPlusOne[byte]};
+        return rankPlusOne == 0 ? noChild : node.firstChild + rankPlusOne - 1;
+    }
+
+#if defined(__SSE2__)
+    // Compare all 48 child bytes with the wanted byte, 16 at a time
+    const __m128i needle{_mm_set1_epi8(static_cast<char>(byte))};
+    const auto *bytes{reinterpret_cast<const __m128i *>(node.childBytes.data())};
+    std::uint64_t matches{static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(bytes), needle)))};
+    matches |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(bytes + 1), needle))) << 16;
+    matches |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(bytes + 2), needle))) << 32;
+    matches &= (std::uint64_t{1} << node.numChildren) - 1;
+    return matches == 0 ? noChild : node.firstChild + static_cast<std::uint32_t>(std::countr_zero(matches));
+#else
+    for (std::uint32_t c{0}; c < node.numChildren; ++c)
+    {
+        if (node.childBytes[c] == byte)
+        {
+            return node.firstChild + c;
+        }
+    }
+    return noChild;
+#endif
+}
+
+std::size_t RadixTree::childCount(const Node &node) const
+{
+    if (node.numChildren == bigNode)
+    {
+        std::uint32_t table{};
+        std::memcpy(&table, node.childBytes.data(), sizeof(table));
+        return m_bigTables[table].numChildren;
+    }
+    return node.numChildren;
+}
+
+std::optional<std::uint32_t> RadixTree::find(std::string_view key) const
+{
+    const Node *node{&m_nodes.front()};
+    std::size_t pos{0};
+    while (true)
+    {
+        const std::string_view nodeLabel{label(*node)};
+        if (key.substr(pos, nodeLabel.size()) != nodeLabel)
+        {
+            return std::nullopt;
+        }
+        pos += nodeLabel.size();
+
+        if (pos == key.size())
+        {
+            return node->hasValue ? std::optional<std::uint32_t>{node->value} : std::nullopt;
+        }
+
+        const std::uint32_t next{child(*node, static_cast<unsigned char>(key[pos]))};
+        if (next == noChild)
+        {
+            return std::nullopt;
+        }
+        node = &m_nodes[next];
+    }
+}
+
+void RadixTree::collect(const Node &node, std::vector<std::uint32_t> &out) const
+{
+    if (node.hasValue)
+    {
+        out.push_back(node.value);
+    }
+
+    // Children are stored in order of their first byte, i.e. in key order
+    const std::size_t count{childCount(node)};
+    for (std::size_t c{0}; c < count; ++c)
+    {
+        collect(m_nodes[node.firstChild + c], out);
+    }
+}
+
+std::vector<std::uint32_t> RadixTree::values_with_prefix(std::string_view prefix) const
+{
+    std::vector<std::uint32_t> found{};
+
+    const Node *node{&m_nodes.front()};
+    std::size_t pos{0};
+    while (true)
+    {
+        const std::string_view nodeLabel{label(*node)};
+        const std::string_view rest{prefix.substr(pos)};
+
+        // The prefix ends inside (or at the end of) this node's label
+        if (rest.size() <= nodeLabel.size())
+        {
+            if (nodeLabel.starts_with(rest))
+            {
+                collect(*node, found);
+            }
+            return found;
+        }
+
+        if (!rest.starts_with(nodeLabel))
+        {
+            return found;
+        }
+        pos += nodeLabel.size();
+
+        const std::uint32_t next{child(*node, static_cast<unsigned char>(prefix[pos]))};
+        if (next == noChild)
+        {
+            return found;
+        }
+        node = &m_nodes[next];
+    }
+}
+
+std::optional<std::pair<std::size_t, std::uint32_t>> RadixTree::longest_prefix(std::string_view text) const
+{
+    std::optional<std::pair<std::size_t, std::uint32_t>> best{};
+
+    const Node *node{&m_nodes.front()};
+    std::size_t pos{0};
+    while (true)
+    {
+        const std::string_view nodeLabel{label(*node)};
+        if (text.substr(pos, nodeLabel.size()) != nodeLabel)
+        {
+            return best;
+        }
+        pos += nodeLabel.size();
+
+        if (node->hasValue)
+        {
+            best = std::pair{pos, node->value};
+        }
+        if (pos == text.size())
+        {
+            return best;
+        }
+
+        const std::uint32_t next{child(*node, static_cast<unsigned char>(text[pos]))};
+        if (next == noChild)
+        {
+            return best;
+        }
+        node = &m_nodes[next];
+    }
+}
+
+std::size_t RadixTree::memory_bytes() const
+{
+    return m_nodes.capacity() * sizeof(Node) + m_bigTables.capacity() * sizeof(BigTable) + m_labels.capacity();
+}
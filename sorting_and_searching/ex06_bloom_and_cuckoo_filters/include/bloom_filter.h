@@ -0,0 +1,61 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Blocked Bloom filter: a compact set that can answer "definitely not
+ * present" or "probably present".
+ *
+ * Size it for the number of keys and the false positive rate you can accept,
+ * then insert the hash of every key:
+ *
+ *     BlockedBloomFilter filter{keys.size(), 0.01};
+ *     for (const auto &key : keys)
+ *     {
+ *         filter.insert(filter_hash(key));
+ *     }
+ *
+ *     if (filter.may_contain(filter_hash(query)))
+ *     {
+ *         // Only now do the expensive search
+ *     }
+ *
+ * A lower false positive rate costs more bits per key (about 10 for 1%, 16
+ * for 0.1%). Inserting more keys than expected is allowed, but raises the
+ * false positive rate. Keys cannot be removed; use a CuckooFilter for that.
+ */
+class BlockedBloomFilter
+{
+public:
+    BlockedBloomFilter(std::size_t expectedKeys, double falsePositiveRate);
+
+    void insert(std::uint64_t hash);
+    bool may_contain(std::uint64_t hash) const;
+
+    std::size_t memory_bytes() const { return m_blocks.size() * sizeof(Block); }
+
+    // False positive rate expected once expectedKeys keys are inserted
+    double expected_false_positive_rate() const { return m_expectedRate; }
+
+private:
+    /**
+     * Every key sets one bit in each of the 8 words of a single 32-byte
+     * block, so a lookup touches one cache line and the 8 bits can be tested
+     * with one AVX2 instruction.
+     */
+    struct alignas(32) Block
+    {
+        std::array<std::uint32_t, 8> words{};
+    };
+
+    std::size_t blockIndex(std::uint64_t hash) const;
+
+    std::vector<Block> m_blocks{};
+    double m_expectedRate{0};
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef CUCKOO_FILTER_H
+#define CUCKOO_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Cuckoo filter: like a Bloom filter, it answers "definitely not present" or
+ * "probably present", but keys can also be removed again.
+ *
+ *     CuckooFilter filter{keys.size(), 0.001};
+ *     filter.insert(filter_hash(key));     // false if the filter is full
+ *     filter.may_contain(filter_hash(key));
+ *     filter.erase(filter_hash(key));      // only for keys that were inserted
+ *
+ * The filter stores a small fingerprint of every key, so a lower false
+ * positive rate means longer fingerprints: 8-bit fingerprints (about 8.5 bits
+ * per key) give about 3%, longer ones are stored in 16 bits (about 17 bits
+ * per key) and reach about 0.01%. Inserting the same key twice stores two
+ * copies, and it must then be erased twice.
+ */
+class CuckooFilter
+{
+public:
+    CuckooFilter(std::size_t capacity, double falsePositiveRate);
+
+    bool insert(std::uint64_t hash);
+    bool may_contain(std::uint64_t hash) const;
+    bool erase(std::uint64_t hash);
+
+    std::size_t size() const { return m_size; }
+    std::size_t memory_bytes() const { return m_table.size(); }
+    unsigned fingerprint_bits() const { return m_fingerprintBits; }
+
+    // Upper bound on the false positive rate of a full filter
+    double expected_false_positive_rate() const;
+
+private:
+    static constexpr std::size_t slotsPerBucket{4};
+    static constexpr unsigned maxKicks{500};
+
+    std::uint32_t fingerprint(std::uint64_t hash) const;
+    std::size_t alternateBucket(std::size_t bucket, std::uint32_t fingerprint) const;
+    std::uint32_t slot(std::size_t bucket, std::size_t index) const;
+    void setSlot(std::size_t bucket, std::size_t index, std::uint32_t fingerprint);
+    bool bucketContains(std::size_t bucket, std::uint32_t fingerprint) const;
+    bool insertIntoBucket(std::size_t bucket, std::uint32_t fingerprint);
+    bool eraseFromBucket(std::size_t bucket, std::uint32_t fingerprint);
+    void relocate(std::size_t bucket, std::uint32_t fingerprint);
+
+    // Buckets of 4 slots of 1 or 2 bytes; a slot holding 0 is empty
+    std::vector<std::uint8_t> m_table{};
+    std::size_t m_numBuckets{1};
+    std::size_t m_slotBytes{1};
+    unsigned m_fingerprintBits{8};
+    std::size_t m_size{0};
+    std::uint64_t m_random{0x2545f4914f6cdd1d};
+
+    // A fingerprint that could not be placed; once set, the filter is full
+    std::uint32_t m_victim{0};
+    std::size_t m_victimBucket{0};
+};
+
+#endif
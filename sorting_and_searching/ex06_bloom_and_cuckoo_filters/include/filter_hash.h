@@ -0,0 +1,31 @@
+#ifndef FILTER_HASH_H
+#define FILTER_HASH_H
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+/**
+ * 64-bit hashes for the filters.
+ *
+ * The filters take the hash of a key rather than the key itself, so they
+ * work with any key type and each key is only hashed once even when it is
+ * looked up in several filters. Both overloads finish with the splitmix64
+ * mixer, so every bit of the result depends on every bit of the key (which
+ * std::hash of an integer does not guarantee: it is often the identity).
+ */
+
+inline std::uint64_t filter_hash(std::uint64_t key)
+{
+    key += 0x9e3779b97f4a7c15;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+    return key ^ (key >> 31);
+}
+
+inline std::uint64_t filter_hash(std::string_view key)
+{
+    return filter_hash(static_cast<std::uint64_t>(std::hash<std::string_view>{}(key)));
+}
+
+#endif
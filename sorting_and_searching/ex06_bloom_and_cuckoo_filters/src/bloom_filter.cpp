@@ -0,0 +1,124 @@
+#include "bloom_filter.h"
+
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <immintrin.h>
+
+namespace
+{
+    // Odd constants that turn one 32-bit hash into 8 different bit positions
+    alignas(32) constexpr std::array<std::uint32_t, 8> salts{0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+                                                             0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31};
+
+    std::uint32_t bitInWord(std::uint32_t key, std::size_t word)
+    {
+        return std::uint32_t{1} << ((key * salts[word]) >> 27);
+    }
+
+    __attribute__((target("avx2"))) bool mayContainAvx2(const std::uint32_t *words, std::uint32_t key)
+    {
+        const __m256i shifts{_mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(key)),
+                                                                  _mm256_load_si256(reinterpret_cast<const __m256i *>(salts.data()))),
+                                               27)};
+        const __m256i mask{_mm256_sllv_epi32(_mm256_set1_epi32(1), shifts)};
+        const __m256i bits{_mm256_load_si256(reinterpret_cast<const __m256i *>(words))};
+        // testc is true if every bit set in mask is also set in bits
+        return _mm256_testc_si256(bits, mask) != 0;
+    }
+
+    bool mayContainScalar(const std::uint32_t *words, std::uint32_t key)
+    {
+        for (std::size_t w{0}; w < salts.size(); ++w)
+        {
+            if ((words[w] & bitInWord(key, w)) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const CpuDispatch<bool(const std::uint32_t *, std::uint32_t)> mayContainBlock{
+        "bloom_may_contain",
+        {{"avx2", [](const CpuFeatures &cpu)
+          { return cpu.avx2; },
+          mayContainAvx2},
+         {"scalar", nullptr, mayContainScalar}}};
+
+    /**
+     * The keys land in blocks at random, so the number of keys in a block
+     * follows a Poisson distribution with mean keysPerBlock. A block with n
+     * keys has each bit of a word set with probability 1 - (31/32)^n, and a
+     * false positive needs the tested bit set in all 8 words.
+     *
+     * The terms are computed in log space: exp(-keysPerBlock) alone would
+     * underflow to 0 for more than about 745 keys per block, and the rate
+     * with it, which would make the smallest filters look the best.
+     */
+    double falsePositiveRate(double keysPerBlock)
+    {
+        const double spread{20 * std::sqrt(keysPerBlock) + 30};
+        const double logMean{std::log(keysPerBlock)};
+        double rate{0};
+        // No keys, no false positives: n = 0 adds nothing
+        for (double n{std::max(1.0, std::floor(keysPerBlock - spread))}; n <= keysPerBlock + spread; ++n)
+        {
+            const double logPoisson{n * logMean - keysPerBlock - std::lgamma(n + 1)};
+            rate += std::exp(logPoisson + 8 * std::log1p(-std::pow(31.0 / 32.0, n)));
+        }
+        return std::min(rate, 1.0);
+    }
+}
+
+BlockedBloomFilter::BlockedBloomFilter(std::size_t expectedKeys, double falsePositiveRate)
+{
+    if (!(falsePositiveRate > 0 && falsePositiveRate < 1))
+    {
+        throw std::invalid_argument{"BlockedBloomFilter: false positive rate must be between 0 and 1"};
+    }
+
+    // Smallest number of blocks that meets the rate; more blocks never hurt
+    const auto keys{static_cast<double>(expectedKeys)};
+    std::size_t lo{1};
+    std::size_t hi{expectedKeys + 1};
+    while (lo < hi)
+    {
+        const std::size_t mid{lo + (hi - lo) / 2};
+        if (::falsePositiveRate(keys / static_cast<double>(mid)) <= falsePositiveRate)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+
+    m_blocks.resize(lo);
+    m_expectedRate = ::falsePositiveRate(keys / static_cast<double>(lo));
+}
+
+std::size_t BlockedBloomFilter::blockIndex(std::uint64_t hash) const
+{
+    // Maps the upper 32 bits to [0, size) with a multiply instead of a modulo
+    return static_cast<std::size_t>(((hash >> 32) * m_blocks.size()) >> 32);
+}
+
+void BlockedBloomFilter::insert(std::uint64_t hash)
+{
+    auto &words{m_blocks[blockIndex(hash)].words};
+    const auto key{static_cast<std::uint32_t>(hash)};
+    for (std::size_t w{0}; w < words.size(); ++w)
+    {
+        words[w] |= bitInWord(key, w);
+    }
+}
+
+bool BlockedBloomFilter::may_contain(std::uint64_t hash) const
+{
+    return mayContainBlock(m_blocks[blockIndex(hash)].words.data(), static_cast<std::uint32_t>(hash));
+}
@@ -0,0 +1,211 @@
+#include "cuckoo_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    // Maps a 32-bit value to [0, n) with a multiply instead of a modulo
+    std::size_t scaleTo(std::uint32_t value, std::size_t n)
+    {
+        return static_cast<std::size_t>((std::uint64_t{value} * n) >> 32);
+    }
+
+    /**
+     * True if any of the 1-byte (or 2-byte) lanes of word is zero. Subtracting
+     * 1 from every lane only borrows into a lane's top bit if the lane was 0
+     * (or borrowed from below, which needs a zero lane too), so the test is
+     * exact about whether there is a zero lane.
+     */
+    template <typename Word>
+    bool hasZeroLane(Word word, Word ones, Word highBits)
+    {
+        return ((word - ones) & ~word & highBits) != 0;
+    }
+}
+
+CuckooFilter::CuckooFilter(std::size_t capacity, double falsePositiveRate)
+{
+    if (!(falsePositiveRate > 0 && falsePositiveRate < 1))
+    {
+        throw std::invalid_argument{"CuckooFilter: false positive rate must be between 0 and 1"};
+    }
+
+    // A lookup compares against 8 fingerprints (2 buckets of 4), each
+    // matching by chance with probability 1 / 2^bits
+    const double bits{std::ceil(std::log2(2.0 * slotsPerBucket / falsePositiveRate))};
+    m_fingerprintBits = static_cast<unsigned>(std::clamp(bits, 4.0, 16.0));
+    m_slotBytes = m_fingerprintBits <= 8 ? 1 : 2;
+
+    // Inserts start failing at about 95% occupancy
+    m_numBuckets = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(static_cast<double>(capacity) / (slotsPerBucket * 0.95))));
+    m_table.resize(m_numBuckets * slotsPerBucket * m_slotBytes);
+}
+
+double CuckooFilter::expected_false_positive_rate() const
+{
+    return 2.0 * slotsPerBucket / std::exp2(m_fingerprintBits);
+}
+
+std::uint32_t CuckooFilter::fingerprint(std::uint64_t hash) const
+{
+    // Uses the upper bits, the bucket comes from the lower ones; 0 means empty
+    const auto fp{static_cast<std::uint32_t>(hash >> (64 - m_fingerprintBits))};
+    return fp == 0 ? 1 : fp;
+}
+
+std::size_t CuckooFilter::alternateBucket(std::size_t bucket, std::uint32_t fingerprint) const
+{
+    /**
+     * The alternate bucket must be computable from the fingerprint alone,
+     * since that is all we keep of a key when we move it. With h derived
+     * from the fingerprint, (h - bucket) mod n maps each of the two buckets
+     * to the other one, for any number of buckets.
+     */
+    const std::size_t h{scaleTo(fingerprint * 0x5bd1e995u, m_numBuckets)};
+    return h >= bucket ? h - bucket : h + m_numBuckets - bucket;
+}
+
+std::uint32_t CuckooFilter::slot(std::size_t bucket, std::size_t index) const
+{
+    const std::uint8_t *bytes{&m_table[(bucket * slotsPerBucket + index) * m_slotBytes]};
+    return m_slotBytes == 1 ? bytes[0] : static_cast<std::uint32_t>(bytes[0] | bytes[1] << 8);
+}
+
+void CuckooFilter::setSlot(std::size_t bucket, std::size_t index, std::uint32_t fingerprint)
+{
+    std::uint8_t *bytes{&m_table[(bucket * slotsPerBucket + index) * m_slotBytes]};
+    bytes[0] = static_cast<std::uint8_t>(fingerprint);
+    if (m_slotBytes == 2)
+    {
+        bytes[1] = static_cast<std::uint8_t>(fingerprint >> 8);
+    }
+}
+
+bool CuckooFilter::bucketContains(std::size_t bucket, std::uint32_t fingerprint) const
+{
+    // Compares all 4 slots at once: a slot equal to the fingerprint becomes 0
+    const std::uint8_t *bytes{&m_table[bucket * slotsPerBucket * m_slotBytes]};
+    if (m_slotBytes == 1)
+    {
+        std::uint32_t word{};
+        std::memcpy(&word, bytes, sizeof(word));
+        return hasZeroLane<std::uint32_t>(word ^ (fingerprint * 0x01010101u), 0x01010101u, 0x80808080u);
+    }
+    std::uint64_t word{};
+    std::memcpy(&word, bytes, sizeof(word));
+    return hasZeroLane<std::uint64_t>(word ^ (fingerprint * 0x0001000100010001u), 0x0001000100010001u, 0x8000800080008000u);
+}
+
+bool CuckooFilter::insertIntoBucket(std::size_t bucket, std::uint32_t fingerprint)
+{
+    for (std::size_t i{0}; i < slotsPerBucket; ++i)
+    {
+        if (slot(bucket, i) == 0)
+        {
+            setSlot(bucket, i, fingerprint);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CuckooFilter::eraseFromBucket(std::size_t bucket, std::uint32_t fingerprint)
+{
+    for (std::size_t i{0}; i < slotsPerBucket; ++i)
+    {
+        if (slot(bucket, i) == fingerprint)
+        {
+            setSlot(bucket, i, 0);
+            return true;
+        }
+    }
+    return false;
+}
+
+void CuckooFilter::relocate(std::size_t bucket, std::uint32_t fingerprint)
+{
+    // Both buckets are full: evict a random fingerprint to its other bucket,
+    // and repeat until one lands in a bucket with a free slot
+    for (unsigned kick{0}; kick < maxKicks; ++kick)
+    {
+        m_random ^= m_random << 13;
+        m_random ^= m_random >> 7;
+        m_random ^= m_random << 17;
+
+        const std::size_t index{static_cast<std::size_t>(m_random % slotsPerBucket)};
+        const std::uint32_t evicted{slot(bucket, index)};
+        setSlot(bucket, index, fingerprint);
+        fingerprint = evicted;
+        bucket = alternateBucket(bucket, fingerprint);
+        if (insertIntoBucket(bucket, fingerprint))
+        {
+            return;
+        }
+    }
+
+    // Keep the last evicted fingerprint so that no inserted key is lost
+    m_victim = fingerprint;
+    m_victimBucket = bucket;
+}
+
+bool CuckooFilter::insert(std::uint64_t hash)
+{
+    if (m_victim != 0)
+    {
+        return false;
+    }
+
+    const std::uint32_t fp{fingerprint(hash)};
+    const std::size_t first{scaleTo(static_cast<std::uint32_t>(hash), m_numBuckets)};
+    const std::size_t second{alternateBucket(first, fp)};
+    if (!insertIntoBucket(first, fp) && !insertIntoBucket(second, fp))
+    {
+        relocate((m_random & 1) ? first : second, fp);
+    }
+    ++m_size;
+    return true;
+}
+
+bool CuckooFilter::may_contain(std::uint64_t hash) const
+{
+    const std::uint32_t fp{fingerprint(hash)};
+    const std::size_t first{scaleTo(static_cast<std::uint32_t>(hash), m_numBuckets)};
+    const std::size_t second{alternateBucket(first, fp)};
+    const bool victimMatches{m_victim == fp && (m_victimBucket == first || m_victimBucket == second)};
+    return bucketContains(first, fp) || bucketContains(second, fp) || victimMatches;
+}
+
+bool CuckooFilter::erase(std::uint64_t hash)
+{
+    const std::uint32_t fp{fingerprint(hash)};
+    const std::size_t first{scaleTo(static_cast<std::uint32_t>(hash), m_numBuckets)};
+    const std::size_t second{alternateBucket(first, fp)};
+
+    if (m_victim == fp && (m_victimBucket == first || m_victimBucket == second))
+    {
+        m_victim = 0;
+        --m_size;
+        return true;
+    }
+    if (!eraseFromBucket(first, fp) && !eraseFromBucket(second, fp))
+    {
+        return false;
+    }
+    --m_size;
+
+    // There is room again, so the victim gets a slot back
+    if (m_victim != 0)
+    {
+        const std::uint32_t victim{m_victim};
+        const std::size_t bucket{m_victimBucket};
+        m_victim = 0;
+        if (!insertIntoBucket(bucket, victim) && !insertIntoBucket(alternateBucket(bucket, victim), victim))
+        {
+            relocate(bucket, victim);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,239 @@
+/**
+ * Bloom and Cuckoo Filters
+ *
+ * In the lambda captures example in ch20_functions_and_lambdas, the answer
+ * "I don't know this area :(" only comes after std::find_if has compared the
+ * area with every element of the areas array. When most lookups are misses,
+ * almost all of the search time is spent proving that something is *not*
+ * there.
+ *
+ * A *filter* is a small summary of a set that can answer "definitely not in
+ * the set" or "maybe in the set". Put in front of a search, it answers most
+ * misses on its own, and only the hits plus a small fraction of false
+ * positives go on to the real search. The filter never stores the keys, so
+ * it needs only a few bits per key no matter how large they are.
+ *
+ * Bloom Filters
+ *
+ * A Bloom filter is an array of bits. Inserting a key sets k bits chosen by
+ * hashing it, and a lookup reports a miss if any of those bits is 0. A
+ * classic Bloom filter spreads the k bits over the whole array, so a lookup
+ * can cost k cache misses. A *blocked* Bloom filter first picks one block by
+ * hashing and puts all k bits inside it: a lookup costs one cache miss, and
+ * with the block split into 8 32-bit words with one bit each, all 8 bits are
+ * tested with a single AVX2 instruction.
+ *
+ * Cuckoo Filters
+ *
+ * A cuckoo filter stores a short fingerprint of each key in one of two
+ * buckets. If both are full, it evicts ("cuckoos") a fingerprint to its
+ * other bucket, like the cuckoo bird does with eggs. Because the
+ * fingerprints are stored rather than mixed into shared bits, a key can be
+ * removed again, which a Bloom filter cannot do.
+ *
+ * Usage:
+ *
+ *     > make run                        # 4 million keys, scan over 1000
+ *     > make run ARGS="50000000 10000"  # 50 million keys, scan over 10000
+ */
+
+#include "bloom_filter.h"
+#include "cpu_dispatch.h"
+#include "cuckoo_filter.h"
+#include "filter_hash.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Reports how many of the filter's answers for non-members are wrong, and
+// how long a lookup takes
+template <typename Filter>
+bool reportFilter(const std::string &name, const Filter &filter, const std::vector<std::uint64_t> &members,
+                  const std::vector<std::uint64_t> &nonMembers)
+{
+    for (auto key : members)
+    {
+        if (!filter.may_contain(filter_hash(key)))
+        {
+            std::cout << "Error: " << name << " lost a key!" << std::endl;
+            return false;
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto falsePositives = std::size_t{0};
+    for (auto key : nonMembers)
+    {
+        falsePositives += filter.may_contain(filter_hash(key));
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    const auto nanoseconds = std::chrono::duration<double, std::nano>(stop - start).count();
+    std::cout << std::left << std::setw(22) << name << std::right << std::setw(8)
+              << static_cast<double>(filter.memory_bytes() * 8) / static_cast<double>(members.size()) << " bits/key "
+              << std::setw(10) << 100.0 * static_cast<double>(falsePositives) / static_cast<double>(nonMembers.size())
+              << " % false positives (expected " << 100.0 * filter.expected_false_positive_rate() << " %) "
+              << std::setw(8) << nanoseconds / static_cast<double>(nonMembers.size()) << " ns/lookup" << std::endl;
+    return true;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    // Which SIMD kernels this CPU runs
+    print_cpu_report(std::cout);
+    std::cout << '\n';
+
+    // The areas from the lambda captures example
+    const auto areas = std::array{100, 25, 121, 40, 56};
+    auto knownAreas = CuckooFilter{areas.size(), 0.01};
+    for (auto area : areas)
+    {
+        knownAreas.insert(filter_hash(static_cast<std::uint64_t>(area)));
+    }
+    for (auto [width, height] : {std::pair{11, 11}, std::pair{6, 7}})
+    {
+        const auto hash = filter_hash(static_cast<std::uint64_t>(width * height));
+        std::cout << width << " x " << height << ": "
+                  << (knownAreas.may_contain(hash) ? "Area found :)" : "I don't know this area :(") << '\n';
+    }
+    knownAreas.erase(filter_hash(std::uint64_t{121}));
+    std::cout << "After erasing 121, 11 x 11: "
+              << (knownAreas.may_contain(filter_hash(std::uint64_t{121})) ? "Area found :)" : "I don't know this area :(")
+              << "\n\n";
+
+    const auto numKeys = std::size_t{argc > 1 ? std::stoul(argv[1]) : 4000000};
+    const auto scanSize = std::size_t{argc > 2 ? std::stoul(argv[2]) : 1000};
+
+    auto rng = std::mt19937_64{42};
+    auto members = std::vector<std::uint64_t>(numKeys);
+    for (auto &key : members)
+    {
+        key = rng() | 1; // Members are odd, non-members even
+    }
+    auto nonMembers = std::vector<std::uint64_t>(1000000);
+    for (auto &key : nonMembers)
+    {
+        key = rng() & ~std::uint64_t{1};
+    }
+
+    // Filters on their own
+    std::cout << "Filters over " << numKeys << " keys:" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto rate : {0.01, 0.001})
+    {
+        auto filter = BlockedBloomFilter{numKeys, rate};
+        for (auto key : members)
+        {
+            filter.insert(filter_hash(key));
+        }
+        if (!reportFilter("Bloom, " + std::to_string(rate * 100).substr(0, 4) + " %", filter, members, nonMembers))
+        {
+            return 1;
+        }
+    }
+    for (auto rate : {0.05, 0.0002})
+    {
+        auto filter = CuckooFilter{numKeys, rate};
+        for (auto key : members)
+        {
+            if (!filter.insert(filter_hash(key)))
+            {
+                std::cout << "Error: cuckoo filter is full!" << std::endl;
+                return 1;
+            }
+        }
+        if (!reportFilter("Cuckoo, " + std::to_string(filter.fingerprint_bits()) + "-bit", filter, members, nonMembers))
+        {
+            return 1;
+        }
+
+        // Erasing keys must not remove any of the others
+        for (auto i = std::size_t{0}; i < members.size(); i += 2)
+        {
+            filter.erase(filter_hash(members[i]));
+        }
+        for (auto i = std::size_t{1}; i < members.size(); i += 2)
+        {
+            if (!filter.may_contain(filter_hash(members[i])))
+            {
+                std::cout << "Error: erase removed the wrong key!" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    const auto exact = std::unordered_set<std::uint64_t>(members.begin(), members.end());
+    auto start = std::chrono::high_resolution_clock::now();
+    auto found = std::size_t{0};
+    for (auto key : nonMembers)
+    {
+        found += exact.contains(key);
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "std::unordered_set (exact): "
+              << std::chrono::duration<double, std::nano>(stop - start).count() / static_cast<double>(nonMembers.size())
+              << " ns/lookup, " << found << " false positives" << std::endl;
+
+    // Filters in front of a linear scan, as in the lambda captures example
+    const auto known = std::vector<std::uint64_t>(members.begin(), members.begin() + static_cast<std::ptrdiff_t>(std::min(scanSize, members.size())));
+    auto bloom = BlockedBloomFilter{known.size(), 0.01};
+    auto cuckoo = CuckooFilter{known.size(), 0.01};
+    for (auto key : known)
+    {
+        bloom.insert(filter_hash(key));
+        cuckoo.insert(filter_hash(key));
+    }
+
+    std::cout << "\nSearching " << known.size() << " known values:" << std::endl;
+    for (auto hitPercent : {1, 10, 50})
+    {
+        auto queries = std::vector<std::uint64_t>(100000);
+        std::uniform_int_distribution<std::size_t> pick{0, known.size() - 1};
+        for (auto i = std::size_t{0}; i < queries.size(); ++i)
+        {
+            queries[i] = static_cast<int>(i % 100) < hitPercent ? known[pick(rng)] : nonMembers[i];
+        }
+
+        auto search = [&](auto filter)
+        {
+            auto hits = std::size_t{0};
+            auto start = std::chrono::high_resolution_clock::now();
+            for (auto query : queries)
+            {
+                if (filter(query) && std::find(known.begin(), known.end(), query) != known.end())
+                {
+                    ++hits;
+                }
+            }
+            auto stop = std::chrono::high_resolution_clock::now();
+            std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << " ms  ";
+            return hits;
+        };
+
+        std::cout << std::setw(2) << hitPercent << " % hits:  scan ";
+        const auto scanHits = search([](std::uint64_t)
+                                     { return true; });
+        std::cout << "Bloom + scan ";
+        const auto bloomHits = search([&](std::uint64_t key)
+                                      { return bloom.may_contain(filter_hash(key)); });
+        std::cout << "cuckoo + scan ";
+        const auto cuckooHits = search([&](std::uint64_t key)
+                                       { return cuckoo.may_contain(filter_hash(key)); });
+        std::cout << std::endl;
+
+        if (scanHits != bloomHits || scanHits != cuckooHits)
+        {
+            std::cout << "Error: filtered and unfiltered searches disagree!" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
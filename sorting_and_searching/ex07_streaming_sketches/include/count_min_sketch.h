@@ -0,0 +1,43 @@
+#ifndef COUNT_MIN_SKETCH_H
+#define COUNT_MIN_SKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Count-min sketch: estimates how often each item occurs in a stream without
+ * storing the items.
+ *
+ *     CountMinSketch counts{0.0001, 0.01};
+ *     counts.add(sketch_hash(term));       // for every term in the stream
+ *     counts.estimate(sketch_hash(term));  // about how often term occurred
+ *
+ * The estimate is never too low. With probability 1 - delta it is too high
+ * by at most epsilon times the total count, so it is accurate for frequent
+ * items and meaningless for rare ones. The sketch needs e / epsilon by
+ * ln(1 / delta) 32-bit counters, which saturate instead of wrapping around.
+ * Sketches with the same epsilon and delta can be merged.
+ */
+class CountMinSketch
+{
+public:
+    CountMinSketch(double epsilon, double delta);
+
+    void add(std::uint64_t hash, std::uint32_t count = 1);
+    std::uint32_t estimate(std::uint64_t hash) const;
+    void merge(const CountMinSketch &other);
+
+    std::uint64_t total() const { return m_total; }
+    std::size_t memory_bytes() const { return m_counters.size() * sizeof(std::uint32_t); }
+
+private:
+    std::size_t counterIndex(std::uint64_t hash, std::size_t row) const;
+
+    std::size_t m_width{};
+    std::size_t m_depth{};
+    std::vector<std::uint32_t> m_counters{};
+    std::uint64_t m_total{0};
+};
+
+#endif
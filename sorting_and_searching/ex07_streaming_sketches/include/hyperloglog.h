@@ -0,0 +1,37 @@
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * HyperLogLog: estimates how many distinct items a stream contains using a
+ * fixed, small amount of memory.
+ *
+ *     HyperLogLog distinct{14};          // 2^14 one-byte registers
+ *     distinct.add(sketch_hash(term));   // for every term in the stream
+ *     distinct.estimate();               // about the number of distinct terms
+ *
+ * With precision p the sketch uses 2^p bytes and the typical relative error
+ * is 1.04 / sqrt(2^p), e.g. 16 KiB and 0.8% for p = 14. Sketches with the
+ * same precision can be filled on different threads and merged afterwards;
+ * the result is exactly the sketch of the combined stream.
+ */
+class HyperLogLog
+{
+public:
+    explicit HyperLogLog(unsigned precision);
+
+    void add(std::uint64_t hash);
+    void merge(const HyperLogLog &other);
+    double estimate() const;
+
+    std::size_t memory_bytes() const { return m_registers.size(); }
+
+private:
+    unsigned m_precision{};
+    std::vector<std::uint8_t> m_registers{};
+};
+
+#endif
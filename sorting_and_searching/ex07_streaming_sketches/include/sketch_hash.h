@@ -0,0 +1,25 @@
+#ifndef SKETCH_HASH_H
+#define SKETCH_HASH_H
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+/**
+ * 64-bit hash of a term for the sketches.
+ *
+ * The sketches take hashes rather than terms, so a term is hashed once and
+ * the same hash feeds every sketch. std::hash is finished with the
+ * splitmix64 mixer, because HyperLogLog needs every bit of the hash to be
+ * random, and std::hash makes no promise about that.
+ */
+inline std::uint64_t sketch_hash(std::string_view term)
+{
+    auto hash{static_cast<std::uint64_t>(std::hash<std::string_view>{}(term))};
+    hash += 0x9e3779b97f4a7c15;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+    return hash ^ (hash >> 31);
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SPACE_SAVING_H
+#define SPACE_SAVING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Space-saving summary: finds the most frequent items ("heavy hitters") of a
+ * stream while keeping a fixed number of counters.
+ *
+ *     SpaceSaving heavyHitters{1000};
+ *     heavyHitters.add(term);          // for every term in the stream
+ *     heavyHitters.top(10);            // the 10 most frequent terms
+ *     heavyHitters.find("pizza");      // its entry, if it is kept
+ *
+ * Each reported count is at most error too high. Any item that occurs more
+ * than total / capacity times is guaranteed to be in the summary, so keep a
+ * few times more counters than the number of items you want to report.
+ * Summaries can be merged, with the errors of both added up.
+ */
+class SpaceSaving
+{
+public:
+    struct Entry
+    {
+        std::string term{};
+        std::uint64_t count{0};
+        std::uint64_t error{0};
+    };
+
+    explicit SpaceSaving(std::size_t capacity);
+
+    void add(std::string_view term, std::uint64_t count = 1);
+    void merge(const SpaceSaving &other);
+
+    // The n most frequent items, most frequent first
+    std::vector<Entry> top(std::size_t n) const;
+
+    // The item's entry, or nullptr if the summary does not keep it
+    const Entry *find(std::string_view term) const;
+
+private:
+    struct TermHash
+    {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view term) const { return std::hash<std::string_view>{}(term); }
+    };
+
+    std::uint64_t smallestCount() const;
+    void siftDown(std::size_t position);
+    void siftUp(std::size_t position);
+    void swapInHeap(std::size_t a, std::size_t b);
+    void rebuild(std::vector<Entry> entries);
+
+    std::size_t m_capacity{};
+    // The entries never move; a min-heap of their indices on count keeps the
+    // entry to replace at the front, and sifting only moves small integers
+    std::vector<Entry> m_entries{};
+    std::vector<std::size_t> m_heap{};
+    std::vector<std::size_t> m_heapPosition{};
+    std::unordered_map<std::string, std::size_t, TermHash, std::equal_to<>> m_entryOf{};
+};
+
+#endif
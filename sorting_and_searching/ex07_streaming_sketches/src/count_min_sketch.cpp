@@ -0,0 +1,77 @@
+#include "count_min_sketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    std::uint32_t saturatingAdd(std::uint32_t a, std::uint32_t b)
+    {
+        const std::uint32_t sum{a + b};
+        return sum < a ? std::numeric_limits<std::uint32_t>::max() : sum;
+    }
+}
+
+CountMinSketch::CountMinSketch(double epsilon, double delta)
+{
+    if (!(epsilon > 0 && epsilon < 1) || !(delta > 0 && delta < 1))
+    {
+        throw std::invalid_argument{"CountMinSketch: epsilon and delta must be between 0 and 1"};
+    }
+    m_width = static_cast<std::size_t>(std::ceil(std::exp(1.0) / epsilon));
+    m_depth = static_cast<std::size_t>(std::ceil(std::log(1 / delta)));
+    m_counters.resize(m_width * m_depth);
+}
+
+std::size_t CountMinSketch::counterIndex(std::uint64_t hash, std::size_t row) const
+{
+    // Row hashes h1 + row * h2 from the two halves of one hash are as good as
+    // independent hashes here, and map to [0, width) with a multiply
+    const auto h1{static_cast<std::uint32_t>(hash)};
+    const auto h2{static_cast<std::uint32_t>(hash >> 32) | 1};
+    const std::uint32_t rowHash{h1 + static_cast<std::uint32_t>(row) * h2};
+    return row * m_width + static_cast<std::size_t>((std::uint64_t{rowHash} * m_width) >> 32);
+}
+
+void CountMinSketch::add(std::uint64_t hash, std::uint32_t count)
+{
+    /**
+     * Conservative update: the estimate is the smallest of the item's
+     * counters, so only counters below estimate + count need to grow. This
+     * keeps the estimates just as safe but noticeably tighter, and merged
+     * sketches stay valid upper bounds.
+     */
+    const std::uint32_t target{saturatingAdd(estimate(hash), count)};
+    for (std::size_t row{0}; row < m_depth; ++row)
+    {
+        auto &counter{m_counters[counterIndex(hash, row)]};
+        counter = std::max(counter, target);
+    }
+    m_total += count;
+}
+
+std::uint32_t CountMinSketch::estimate(std::uint64_t hash) const
+{
+    std::uint32_t smallest{std::numeric_limits<std::uint32_t>::max()};
+    for (std::size_t row{0}; row < m_depth; ++row)
+    {
+        smallest = std::min(smallest, m_counters[counterIndex(hash, row)]);
+    }
+    return smallest;
+}
+
+void CountMinSketch::merge(const CountMinSketch &other)
+{
+    if (other.m_width != m_width || other.m_depth != m_depth)
+    {
+        throw std::invalid_argument{"CountMinSketch: can only merge sketches of the same size"};
+    }
+    // Simple enough for the compiler to vectorize
+    for (std::size_t i{0}; i < m_counters.size(); ++i)
+    {
+        m_counters[i] = saturatingAdd(m_counters[i], other.m_counters[i]);
+    }
+    m_total += other.m_total;
+}
@@ -0,0 +1,130 @@
+#include "hyperloglog.h"
+
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+
+#include <immintrin.h>
+
+namespace
+{
+    // Element-wise maximum of two register arrays, 32 registers at a time
+    __attribute__((target("avx2"))) void mergeAvx2(std::uint8_t *into, const std::uint8_t *from, std::size_t count)
+    {
+        std::size_t i{0};
+        for (; i + 32 <= count; i += 32)
+        {
+            const __m256i a{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(into + i))};
+            const __m256i b{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(from + i))};
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(into + i), _mm256_max_epu8(a, b));
+        }
+        for (; i < count; ++i)
+        {
+            into[i] = std::max(into[i], from[i]);
+        }
+    }
+
+    void mergeScalar(std::uint8_t *into, const std::uint8_t *from, std::size_t count)
+    {
+        for (std::size_t i{0}; i < count; ++i)
+        {
+            into[i] = std::max(into[i], from[i]);
+        }
+    }
+
+    const CpuDispatch<void(std::uint8_t *, const std::uint8_t *, std::size_t)> mergeRegisters{
+        "hyperloglog_merge",
+        {{"avx2", [](const CpuFeatures &cpu)
+          { return cpu.avx2; },
+          mergeAvx2},
+         {"scalar", nullptr, mergeScalar}}};
+
+    // 2^-rank for every possible register value
+    constexpr auto makeInversePowers()
+    {
+        std::array<double, 65> table{};
+        double value{1};
+        for (auto &entry : table)
+        {
+            entry = value;
+            value /= 2;
+        }
+        return table;
+    }
+
+    constexpr auto inversePowers{makeInversePowers()};
+}
+
+HyperLogLog::HyperLogLog(unsigned precision)
+    : m_precision{precision}
+{
+    if (precision < 4 || precision > 18)
+    {
+        throw std::invalid_argument{"HyperLogLog: precision must be between 4 and 18"};
+    }
+    m_registers.resize(std::size_t{1} << precision);
+}
+
+void HyperLogLog::add(std::uint64_t hash)
+{
+    /**
+     * The first p bits pick a register, which remembers the longest run of
+     * leading zeros seen in the remaining bits. A run of r zeros turns up
+     * about once every 2^r distinct hashes, so the registers together tell
+     * roughly how many distinct hashes there were. The sentinel bit limits
+     * the run to the 64 - p bits that are left.
+     */
+    const auto index{static_cast<std::size_t>(hash >> (64 - m_precision))};
+    const std::uint64_t rest{(hash << m_precision) | (std::uint64_t{1} << (m_precision - 1))};
+    const auto rank{static_cast<std::uint8_t>(std::countl_zero(rest) + 1)};
+    m_registers[index] = std::max(m_registers[index], rank);
+}
+
+void HyperLogLog::merge(const HyperLogLog &other)
+{
+    if (other.m_precision != m_precision)
+    {
+        throw std::invalid_argument{"HyperLogLog: can only merge sketches with the same precision"};
+    }
+
+    mergeRegisters(m_registers.data(), other.m_registers.data(), m_registers.size());
+}
+
+double HyperLogLog::estimate() const
+{
+    const auto m{static_cast<double>(m_registers.size())};
+    double sum{0};
+    std::size_t zeros{0};
+    for (auto rank : m_registers)
+    {
+        sum += inversePowers[rank];
+        zeros += rank == 0;
+    }
+
+    double alpha{0.7213 / (1 + 1.079 / m)};
+    if (m_registers.size() == 16)
+    {
+        alpha = 0.673;
+    }
+    else if (m_registers.size() == 32)
+    {
+        alpha = 0.697;
+    }
+    else if (m_registers.size() == 64)
+    {
+        alpha = 0.709;
+    }
+
+    // The harmonic mean is biased for small counts, where counting the
+    // registers that are still empty is more accurate
+    const double raw{alpha * m * m / sum};
+    if (raw <= 2.5 * m && zeros > 0)
+    {
+        return m * std::log(m / static_cast<double>(zeros));
+    }
+    return raw;
+}
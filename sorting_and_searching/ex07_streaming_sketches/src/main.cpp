@@ -0,0 +1,384 @@
+/**
+ * Streaming Sketches for Search Terms
+ *
+ * The lambda captures example in ch20_functions_and_lambdas reads a search
+ * term from std::cin and forgets it after the search. Suppose we wanted
+ * statistics about the searches instead: how many different terms do people
+ * search for, and which terms are searched most? Counting every term exactly
+ * with a std::unordered_map<std::string, int> works, but the map grows with
+ * every new term, and a stream of search terms never ends.
+ *
+ * A *sketch* is a fixed-size summary of a stream that answers one question
+ * approximately, with a known bound on the error:
+ *
+ *     * HyperLogLog estimates the number of distinct terms, within about 1%,
+ *       using 16 KiB no matter how many terms there are.
+ *     * A count-min sketch estimates how often any given term occurred.
+ *     * A space-saving summary keeps the most frequent terms ("heavy
+ *       hitters") and their counts.
+ *
+ * All three can be *merged*: each thread summarizes its part of the stream,
+ * and the summaries are combined at the end, without any locking while the
+ * stream is read.
+ *
+ * Reading the Stream
+ *
+ * Reading one std::string at a time with std::cin >> term allocates and
+ * copies every term. Here the input is read in 1 MiB blocks and split into
+ * std::string_views that point into the block, so a term is never copied
+ * unless a summary decides to keep it. Each block is fed to the summaries
+ * and then reused for the next one, so a stream from std::cin of any
+ * length needs one block of memory besides the sketches. Only if asked
+ * are its terms also counted exactly, to compare, which takes memory for
+ * every distinct term again. Generated terms are kept in memory instead,
+ * to time each summary on its own and on several threads.
+ *
+ * Usage:
+ *
+ *     > make run                      # 5 million generated terms
+ *     > make run ARGS="50000000"      # 50 million generated terms
+ *     > make run ARGS="-" < text.txt  # the words of a text file
+ *     > make run ARGS="- exact" < text.txt   # compared with exact counts
+ */
+
+#include "count_min_sketch.h"
+#include "cpu_dispatch.h"
+#include "hyperloglog.h"
+#include "sketch_hash.h"
+#include "space_saving.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Calls function with every whitespace-separated term in text
+template <typename Function>
+void forEachTerm(std::string_view text, Function function)
+{
+    std::size_t pos{0};
+    while (true)
+    {
+        const auto start = text.find_first_not_of(" \t\r\n", pos);
+        if (start == std::string_view::npos)
+        {
+            return;
+        }
+        const auto end = std::min(text.find_first_of(" \t\r\n", start), text.size());
+        function(text.substr(start, end - start));
+        pos = end;
+    }
+}
+
+// Calls function with every term of std::cin, read in 1 MiB blocks. A term
+// cut off at the end of a block is carried over to the next one, so only
+// one block is in memory at a time. Returns the number of bytes read
+template <typename Function>
+std::size_t forEachInputTerm(Function function)
+{
+    std::ios::sync_with_stdio(false);
+    auto block = std::string(1 << 20, '\0');
+    auto carried = std::size_t{0};
+    auto totalBytes = std::size_t{0};
+    while (true)
+    {
+        std::cin.read(block.data() + carried, static_cast<std::streamsize>(block.size() - carried));
+        const auto read = static_cast<std::size_t>(std::cin.gcount());
+        totalBytes += read;
+        const auto filled = carried + read;
+        if (read == 0)
+        {
+            forEachTerm(std::string_view{block.data(), filled}, function);
+            return totalBytes;
+        }
+
+        // Everything up to the last whitespace is whole terms
+        const auto lastSpace = std::string_view{block.data(), filled}.find_last_of(" \t\r\n");
+        if (lastSpace == std::string_view::npos)
+        {
+            // A single term longer than the block
+            carried = filled;
+            if (carried == block.size())
+            {
+                block.resize(2 * block.size());
+            }
+            continue;
+        }
+        forEachTerm(std::string_view{block.data(), lastSpace}, function);
+        carried = filled - lastSpace - 1;
+        std::copy_n(block.data() + lastSpace + 1, carried, block.data());
+    }
+}
+
+// Search terms with a Zipf distribution: the term with rank r is searched
+// about 1/r as often as the most popular one
+std::string generateTerms(std::size_t count)
+{
+    auto rng = std::mt19937{42};
+    std::uniform_int_distribution<std::size_t> length{3, 10};
+    std::uniform_int_distribution<int> letter{'a', 'z'};
+
+    const auto vocabularySize = std::max<std::size_t>(count / 10, 1);
+    auto vocabulary = std::vector<std::string>(vocabularySize);
+    auto weights = std::vector<double>(vocabularySize);
+    for (auto r = std::size_t{0}; r < vocabularySize; ++r)
+    {
+        vocabulary[r].resize(length(rng));
+        for (auto &c : vocabulary[r])
+        {
+            c = static_cast<char>(letter(rng));
+        }
+        weights[r] = 1.0 / static_cast<double>(r + 1);
+    }
+
+    std::discrete_distribution<std::size_t> rank(weights.begin(), weights.end());
+    auto text = std::string{};
+    for (auto i = std::size_t{0}; i < count; ++i)
+    {
+        text += vocabulary[rank(rng)];
+        text += '\n';
+    }
+    return text;
+}
+
+// Lets std::unordered_map<std::string, ...> look up std::string_view keys
+struct TermHash
+{
+    using is_transparent = void;
+    std::size_t operator()(std::string_view term) const { return std::hash<std::string_view>{}(term); }
+};
+
+struct Sketches
+{
+    HyperLogLog distinct{14};
+    CountMinSketch counts{0.0001, 0.01};
+    SpaceSaving heavyHitters{1000};
+
+    void add(std::string_view term)
+    {
+        const auto hash = sketch_hash(term);
+        distinct.add(hash);
+        counts.add(hash);
+        heavyHitters.add(term);
+    }
+
+    void merge(const Sketches &other)
+    {
+        distinct.merge(other.distinct);
+        counts.merge(other.counts);
+        heavyHitters.merge(other.heavyHitters);
+    }
+};
+
+// Feeds every term of text to update and prints the update rate
+template <typename Function>
+void reportUpdates(std::string_view name, std::string_view text, std::size_t numTerms, Function update)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    forEachTerm(text, update);
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << name << static_cast<double>(numTerms) / std::chrono::duration<double, std::micro>(stop - start).count()
+              << " million terms/s" << std::endl;
+}
+
+using ExactCounts = std::unordered_map<std::string, std::uint64_t, TermHash, std::equal_to<>>;
+
+void countExactly(ExactCounts &exact, std::string_view term)
+{
+    if (auto it = exact.find(term); it != exact.end())
+    {
+        ++it->second;
+    }
+    else
+    {
+        exact.emplace(term, 1);
+    }
+}
+
+// Compares the sketches with the exact counts, and returns the most
+// frequent terms
+std::vector<std::pair<std::string_view, std::uint64_t>> reportAccuracy(const ExactCounts &exact,
+                                                                       const Sketches &sketches)
+{
+    const auto distinct = sketches.distinct.estimate();
+    std::cout << "\nDistinct terms: " << exact.size() << " exact, " << distinct << " estimated ("
+              << 100.0 * (distinct - static_cast<double>(exact.size())) / static_cast<double>(exact.size())
+              << " % error)" << std::endl;
+
+    auto exactTop = std::vector<std::pair<std::string_view, std::uint64_t>>(exact.begin(), exact.end());
+    const auto numTop = std::min<std::size_t>(exactTop.size(), 10);
+    std::partial_sort(exactTop.begin(), exactTop.begin() + static_cast<std::ptrdiff_t>(numTop), exactTop.end(),
+                      [](const auto &a, const auto &b)
+                      { return a.second > b.second; });
+    exactTop.resize(numTop);
+
+    // Every row is about one term; a term the space-saving summary did not
+    // keep shows as "-"
+    std::cout << "\nMost frequent terms:\n"
+              << std::setw(12) << "term" << std::setw(12) << "exact" << std::setw(14) << "space-saving"
+              << std::setw(12) << "(error)" << std::setw(12) << "count-min" << '\n';
+    for (const auto &[term, count] : exactTop)
+    {
+        std::cout << std::setw(12) << term << std::setw(12) << count;
+        if (const auto *entry = sketches.heavyHitters.find(term); entry != nullptr)
+        {
+            std::cout << std::setw(14) << entry->count << std::setw(12) << entry->error;
+        }
+        else
+        {
+            std::cout << std::setw(14) << "-" << std::setw(12) << "-";
+        }
+        std::cout << std::setw(12) << sketches.counts.estimate(sketch_hash(term)) << '\n';
+    }
+    std::cout << "Memory: exact map holds " << exact.size() << " terms, sketches use "
+              << (sketches.distinct.memory_bytes() + sketches.counts.memory_bytes()) / 1024
+              << " KiB + 1000 counters" << std::endl;
+    return exactTop;
+}
+
+// What the sketches alone say about a stream
+void reportSketches(const Sketches &sketches)
+{
+    std::cout << "\nDistinct terms: " << sketches.distinct.estimate() << " estimated" << std::endl;
+    std::cout << "\nMost frequent terms:\n"
+              << std::setw(12) << "term" << std::setw(14) << "space-saving" << std::setw(12) << "(error)"
+              << std::setw(12) << "count-min" << '\n';
+    for (const auto &entry : sketches.heavyHitters.top(10))
+    {
+        std::cout << std::setw(12) << entry.term << std::setw(14) << entry.count << std::setw(12) << entry.error
+                  << std::setw(12) << sketches.counts.estimate(sketch_hash(entry.term)) << '\n';
+    }
+    std::cout << "Memory: sketches use " << (sketches.distinct.memory_bytes() + sketches.counts.memory_bytes()) / 1024
+              << " KiB + 1000 counters" << std::endl;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    // Which SIMD kernels this CPU runs
+    print_cpu_report(std::cout);
+    std::cout << '\n';
+
+    std::cout << std::fixed << std::setprecision(1);
+    if (argc > 1 && std::string_view{argv[1]} == "-")
+    {
+        // One pass over the stream, which is never stored as a whole. The
+        // exact counts grow with every new term, so they are opt-in
+        const bool compare = argc > 2 && std::string_view{argv[2]} == "exact";
+        auto exact = ExactCounts{};
+        auto sketches = Sketches{};
+        auto numTerms = std::size_t{0};
+        auto start = std::chrono::high_resolution_clock::now();
+        const auto bytes = forEachInputTerm([&](std::string_view term)
+                                            {
+                                                ++numTerms;
+                                                if (compare)
+                                                {
+                                                    countExactly(exact, term);
+                                                }
+                                                sketches.add(term); });
+        auto stop = std::chrono::high_resolution_clock::now();
+        std::cout << "Stream of " << numTerms << " terms (" << bytes / 1024 / 1024 << " MiB) from std::cin, "
+                  << static_cast<double>(numTerms) / std::chrono::duration<double, std::micro>(stop - start).count()
+                  << " million terms/s with " << (compare ? "exact counting and " : "") << "all three sketches"
+                  << std::endl;
+        if (numTerms > 0)
+        {
+            if (compare)
+            {
+                reportAccuracy(exact, sketches);
+            }
+            else
+            {
+                reportSketches(sketches);
+            }
+        }
+        return 0;
+    }
+
+    const auto text = generateTerms(argc > 1 ? std::stoul(argv[1]) : 5000000);
+    auto numTerms = std::size_t{0};
+    forEachTerm(text, [&](std::string_view)
+                { ++numTerms; });
+    std::cout << "Stream of " << numTerms << " terms (" << text.size() / 1024 / 1024 << " MiB)\n\n";
+    if (numTerms == 0)
+    {
+        return 0;
+    }
+
+    // Update throughput, one summary at a time
+    std::cout << "Updates:" << std::endl;
+
+    auto exact = ExactCounts{};
+    reportUpdates("Exact counting: ", text, numTerms, [&](std::string_view term)
+                  { countExactly(exact, term); });
+
+    auto sketches = Sketches{};
+    reportUpdates("HyperLogLog:    ", text, numTerms, [&](std::string_view term)
+                  { sketches.distinct.add(sketch_hash(term)); });
+    reportUpdates("Count-min:      ", text, numTerms, [&](std::string_view term)
+                  { sketches.counts.add(sketch_hash(term)); });
+    reportUpdates("Space-saving:   ", text, numTerms, [&](std::string_view term)
+                  { sketches.heavyHitters.add(term); });
+
+    // Accuracy
+    const auto exactTop = reportAccuracy(exact, sketches);
+
+    // One set of sketches per thread, merged at the end
+    const auto numThreads = std::max(2u, std::thread::hardware_concurrency());
+    auto shards = std::vector<std::string_view>{};
+    auto shardStart = std::size_t{0};
+    for (auto t = 1u; t <= numThreads; ++t)
+    {
+        auto shardEnd = t == numThreads ? text.size() : text.size() * t / numThreads;
+        shardEnd = std::min(text.find('\n', shardEnd), text.size());
+        shards.push_back(std::string_view{text}.substr(shardStart, shardEnd - shardStart));
+        shardStart = shardEnd;
+    }
+
+    auto perThread = std::vector<Sketches>(numThreads);
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        auto threads = std::vector<std::jthread>{};
+        for (auto t = std::size_t{0}; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+                                 { forEachTerm(shards[t], [&](std::string_view term)
+                                               { perThread[t].add(term); }); });
+        }
+    }
+    auto merged = Sketches{};
+    for (const auto &sketches : perThread)
+    {
+        merged.merge(sketches);
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "\nAll three sketches on " << numThreads << " threads, then merged: "
+              << static_cast<double>(numTerms) / std::chrono::duration<double, std::micro>(stop - start).count()
+              << " million terms/s" << std::endl;
+
+    // Merging HyperLogLogs is exact, the others must stay upper bounds
+    if (merged.distinct.estimate() != sketches.distinct.estimate() || merged.counts.total() != numTerms)
+    {
+        std::cout << "Error: merged sketches disagree!" << std::endl;
+        return 1;
+    }
+    for (const auto &[term, count] : exactTop)
+    {
+        if (merged.counts.estimate(sketch_hash(term)) < count)
+        {
+            std::cout << "Error: count-min estimate below the exact count!" << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Merged top term: " << merged.heavyHitters.top(1).front().term << " ("
+              << merged.heavyHitters.top(1).front().count << ")" << std::endl;
+
+    return 0;
+}
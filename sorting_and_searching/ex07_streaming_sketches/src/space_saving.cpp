@@ -0,0 +1,174 @@
+#include "space_saving.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+SpaceSaving::SpaceSaving(std::size_t capacity)
+    : m_capacity{capacity}
+{
+    if (capacity == 0)
+    {
+        throw std::invalid_argument{"SpaceSaving: capacity must be at least 1"};
+    }
+    m_entries.reserve(capacity);
+    m_heap.reserve(capacity);
+    m_heapPosition.reserve(capacity);
+    m_entryOf.reserve(capacity);
+}
+
+std::uint64_t SpaceSaving::smallestCount() const
+{
+    // Items that are not in a full summary occurred at most this often
+    return m_entries.size() < m_capacity ? 0 : m_entries[m_heap.front()].count;
+}
+
+void SpaceSaving::swapInHeap(std::size_t a, std::size_t b)
+{
+    std::swap(m_heap[a], m_heap[b]);
+    m_heapPosition[m_heap[a]] = a;
+    m_heapPosition[m_heap[b]] = b;
+}
+
+void SpaceSaving::siftDown(std::size_t position)
+{
+    while (true)
+    {
+        const std::size_t left{2 * position + 1};
+        const std::size_t right{left + 1};
+        std::size_t smallest{position};
+        if (left < m_heap.size() && m_entries[m_heap[left]].count < m_entries[m_heap[smallest]].count)
+        {
+            smallest = left;
+        }
+        if (right < m_heap.size() && m_entries[m_heap[right]].count < m_entries[m_heap[smallest]].count)
+        {
+            smallest = right;
+        }
+        if (smallest == position)
+        {
+            return;
+        }
+        swapInHeap(position, smallest);
+        position = smallest;
+    }
+}
+
+void SpaceSaving::siftUp(std::size_t position)
+{
+    while (position > 0 && m_entries[m_heap[(position - 1) / 2]].count > m_entries[m_heap[position]].count)
+    {
+        swapInHeap(position, (position - 1) / 2);
+        position = (position - 1) / 2;
+    }
+}
+
+void SpaceSaving::add(std::string_view term, std::uint64_t count)
+{
+    if (const auto it{m_entryOf.find(term)}; it != m_entryOf.end())
+    {
+        // Counts only grow, so the entry can only move down the heap
+        m_entries[it->second].count += count;
+        siftDown(m_heapPosition[it->second]);
+        return;
+    }
+
+    if (m_entries.size() < m_capacity)
+    {
+        const std::size_t index{m_entries.size()};
+        m_entries.push_back(Entry{std::string{term}, count, 0});
+        m_entryOf.emplace(term, index);
+        m_heap.push_back(index);
+        m_heapPosition.push_back(index);
+        siftUp(index);
+        return;
+    }
+
+    /**
+     * The summary is full: the new item takes over the counter of the least
+     * frequent one. It may have occurred up to that many times before without
+     * being tracked, which is recorded as its error.
+     */
+    auto &smallest{m_entries[m_heap.front()]};
+    smallest.error = smallest.count;
+    smallest.count += count;
+
+    // Reuse the old term's map node instead of allocating a new one
+    auto node{m_entryOf.extract(smallest.term)};
+    node.key() = term;
+    m_entryOf.insert(std::move(node));
+    smallest.term = term;
+    siftDown(0);
+}
+
+void SpaceSaving::rebuild(std::vector<Entry> entries)
+{
+    m_entries = std::move(entries);
+    m_entryOf.clear();
+    m_heap.clear();
+    m_heapPosition.clear();
+    for (std::size_t i{0}; i < m_entries.size(); ++i)
+    {
+        m_entryOf.emplace(m_entries[i].term, i);
+        m_heap.push_back(i);
+        m_heapPosition.push_back(i);
+        siftUp(i);
+    }
+}
+
+void SpaceSaving::merge(const SpaceSaving &other)
+{
+    /**
+     * An item missing from one summary occurred at most that summary's
+     * smallest count times in its stream, so that much is added to both its
+     * count and its error. Then the largest counts are kept.
+     */
+    const std::uint64_t ownSmallest{smallestCount()};
+    const std::uint64_t otherSmallest{other.smallestCount()};
+
+    std::vector<Entry> combined{};
+    combined.reserve(m_entries.size() + other.m_entries.size());
+    for (const auto &entry : m_entries)
+    {
+        combined.push_back(Entry{entry.term, entry.count + otherSmallest, entry.error + otherSmallest});
+    }
+    for (const auto &entry : other.m_entries)
+    {
+        if (const auto it{m_entryOf.find(entry.term)}; it != m_entryOf.end())
+        {
+            auto &both{combined[it->second]};
+            both.count = both.count - otherSmallest + entry.count;
+            both.error = both.error - otherSmallest + entry.error;
+        }
+        else
+        {
+            combined.push_back(Entry{entry.term, entry.count + ownSmallest, entry.error + ownSmallest});
+        }
+    }
+
+    if (combined.size() > m_capacity)
+    {
+        std::nth_element(combined.begin(), combined.begin() + static_cast<std::ptrdiff_t>(m_capacity), combined.end(),
+                         [](const Entry &a, const Entry &b)
+                         { return a.count > b.count; });
+        combined.resize(m_capacity);
+    }
+    rebuild(std::move(combined));
+}
+
+std::vector<SpaceSaving::Entry> SpaceSaving::top(std::size_t n) const
+{
+    std::vector<Entry> entries{m_entries};
+    n = std::min(n, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(n), entries.end(),
+                      [](const Entry &a, const Entry &b)
+                      { return a.count > b.count; });
+    entries.resize(n);
+    return entries;
+}
+
+const SpaceSaving::Entry *SpaceSaving::find(std::string_view term) const
+{
+    const auto it{m_entryOf.find(term)};
+    return it == m_entryOf.end() ? nullptr : &m_entries[it->second];
+}
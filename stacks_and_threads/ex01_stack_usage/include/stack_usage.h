@@ -0,0 +1,84 @@
+#ifndef STACK_USAGE_H
+#define STACK_USAGE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Stack frame size of one function, as reported by GCC's -fstack-usage:
+ * "static" frames always have this size, "dynamic" ones grow at runtime
+ * (alloca, variable length arrays) and "bounded" ones grow but never beyond
+ * the size given.
+ */
+struct FunctionStackUsage
+{
+    std::string function{};
+    std::string location{};   // file:line:column
+    std::size_t bytes{0};
+    std::string kind{};       // static, dynamic or "dynamic,bounded"
+};
+
+/**
+ * Reads all .su files in directory (written by compiling with -fstack-usage)
+ * and returns every function, biggest frame first. Throws
+ * std::invalid_argument if directory has no .su files.
+ */
+std::vector<FunctionStackUsage> read_stack_usage(const std::filesystem::path &directory);
+
+/**
+ * Measures how deep the calling thread's stack gets, by "painting" the
+ * unused part of the stack with a known pattern and later looking for the
+ * lowest address where the pattern was overwritten:
+ *
+ *     StackWatermark watermark{};
+ *     work();
+ *     watermark.checkpoint("after work");
+ *     watermark.high_water_mark();   // most bytes of stack used so far
+ *
+ * Depths are counted from the top of the stack, so they include the frames
+ * of the callers of the function creating the watermark. At most maxDepth
+ * bytes below the caller are painted, since painting commits memory for the
+ * whole painted range; deeper use is not seen. Only for the thread that
+ * created it.
+ */
+class StackWatermark
+{
+public:
+    explicit StackWatermark(std::size_t maxDepth = 1024 * 1024);
+
+    StackWatermark(const StackWatermark &) = delete;
+    StackWatermark &operator=(const StackWatermark &) = delete;
+
+    // Most bytes of stack in use at any time since construction
+    std::size_t high_water_mark() const;
+
+    // Records the high water mark so far under a name
+    void checkpoint(std::string_view name);
+
+    const std::vector<std::pair<std::string, std::size_t>> &checkpoints() const { return m_checkpoints; }
+
+    // Size of the thread's whole stack
+    std::size_t stack_size() const { return static_cast<std::size_t>(m_high - m_low); }
+
+private:
+    std::byte *m_low{nullptr};
+    std::byte *m_high{nullptr};
+    std::byte *m_paintedLow{nullptr};
+    std::byte *m_paintedHigh{nullptr};
+    std::vector<std::pair<std::string, std::size_t>> m_checkpoints{};
+};
+
+/**
+ * Runs job on a new thread with a stack of stackSize bytes and returns the
+ * most stack the thread used, to find out how small a worker thread's stack
+ * can be. Throws std::system_error if the thread cannot be started, and
+ * rethrows exceptions thrown by job.
+ */
+std::size_t measure_stack_usage(std::size_t stackSize, const std::function<void()> &job);
+
+#endif
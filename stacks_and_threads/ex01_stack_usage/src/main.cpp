@@ -0,0 +1,228 @@
+/**
+ * Stack Usage: Frame Sizes and High Water Marks
+ *
+ * The stack overflow example in crashes_and_undefined_behavior recurses
+ * until the program crashes, and the out of memory example puts a 400 MB
+ * array on the stack. Neither tells us how much stack a function actually
+ * needs. There are two ways to find out:
+ *
+ *     1. At compile time: GCC's -fstack-usage writes the size of every
+ *        function's stack frame into a .su file next to the object file.
+ *        "static" frames always have that size, "dynamic" ones grow at
+ *        runtime (alloca, variable length arrays). The compiler cannot know
+ *        how deep calls go, though, so it says nothing about recursion.
+ *     2. At runtime: fill ("paint") the unused stack with a known pattern,
+ *        run the code, and look for the lowest address where the pattern
+ *        was overwritten. That is the stack's high water mark, the most
+ *        stack the thread ever used, including all library code and
+ *        recursion.
+ *
+ * The reason to care is threads. Every thread gets its own stack, 8 MB by
+ * default on Linux (the stack size limit from ulimit -s). Linux only backs
+ * the pages a thread really touches with memory, but the whole size is
+ * reserved address space and counts towards overcommit limits, and a thread
+ * that once went deep keeps those pages. With thousands of threads, a stack
+ * sized to the measured high water mark plus a safety margin is much
+ * cheaper, and pthread_attr_setstacksize sets it.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="100000"   # deeper recursion
+ *     > make stack-report       # rebuild with -fstack-usage and list frames
+ */
+
+#include "stack_usage.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+/**
+ * Like eat_stack in the stack overflow example, but stops at depth. Each
+ * frame has a buffer the next call reads, so the frame must stay alive and
+ * the compiler cannot turn the recursion into a loop.
+ */
+[[gnu::noinline]] std::uint64_t recurse(std::size_t depth, const volatile std::uint8_t *parent)
+{
+    volatile std::uint8_t frame[64];
+    frame[0] = static_cast<std::uint8_t>(depth + parent[0]);
+    if (depth == 0)
+    {
+        return frame[0];
+    }
+    return recurse(depth - 1, frame) + frame[0];
+}
+
+std::uint64_t recurse(std::size_t depth)
+{
+    const volatile std::uint8_t start{0};
+    return recurse(depth, &start);
+}
+
+// A big local array, like the out of memory example but small enough to fit
+[[gnu::noinline]] std::uint64_t bigLocalArray()
+{
+    std::array<std::uint8_t, 64 * 1024> buffer{};
+    for (std::size_t i{0}; i < buffer.size(); ++i)
+    {
+        buffer[i] = static_cast<std::uint8_t>(i * 31);
+    }
+    const volatile std::uint8_t *data{buffer.data()};
+    std::uint64_t sum{0};
+    for (std::size_t i{0}; i < buffer.size(); i += 4093)
+    {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// What a typical worker might do: sort some data and format a message
+std::string sortAndFormat()
+{
+    std::mt19937 random{42};
+    std::vector<double> values(10000);
+    for (auto &value : values)
+    {
+        value = std::uniform_real_distribution<double>{0.0, 1.0}(random);
+    }
+    std::sort(values.begin(), values.end());
+
+    std::ostringstream message{};
+    message << std::fixed << std::setprecision(3) << "median " << values[values.size() / 2];
+    return message.str();
+}
+
+// Stack size suggested for a measured high water mark: twice as much,
+// rounded up to whole pages
+std::size_t suggestedStackSize(std::size_t highWaterMark)
+{
+    constexpr std::size_t page{4096};
+    const auto size{std::max<std::size_t>(2 * highWaterMark, PTHREAD_STACK_MIN)};
+    return (size + page - 1) / page * page;
+}
+
+std::string formatBytes(std::size_t bytes)
+{
+    std::ostringstream text{};
+    text << std::fixed << std::setprecision(1);
+    if (bytes < 1024 * 1024)
+    {
+        text << static_cast<double>(bytes) / 1024.0 << " KiB";
+    }
+    else
+    {
+        text << static_cast<double>(bytes) / (1024.0 * 1024.0) << " MiB";
+    }
+    return text.str();
+}
+
+// Prints the biggest stack frames found by -fstack-usage
+void printReport(const std::filesystem::path &directory)
+{
+    const auto functions = read_stack_usage(directory);
+    std::cout << "Stack frames of " << functions.size() << " functions, biggest first:" << std::endl;
+    const auto shown = std::min<std::size_t>(functions.size(), 20);
+    for (std::size_t i{0}; i < shown; ++i)
+    {
+        const auto &function = functions[i];
+        std::cout << std::setw(8) << function.bytes << " bytes  " << std::setw(16) << std::left << function.kind
+                  << std::right << function.function << " (" << function.location << ")" << std::endl;
+    }
+
+    const auto dynamic = std::count_if(functions.begin(), functions.end(), [](const FunctionStackUsage &function)
+                                       { return function.kind.find("dynamic") != std::string::npos; });
+    std::cout << dynamic << " functions have frames that grow at runtime" << std::endl;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    try
+    {
+        if (argc > 2 && std::string{argv[1]} == "--report")
+        {
+            printReport(argv[2]);
+            return 0;
+        }
+        const auto depth = std::size_t{argc > 1 ? std::stoul(argv[1]) : 10000};
+
+        // Checkpoints of the main thread's own stack
+        auto watermark = StackWatermark{};
+        watermark.checkpoint("start");
+        const auto mainSum = bigLocalArray();
+        watermark.checkpoint("after the 64 KiB array");
+        const auto mainResult = recurse(1000);
+        watermark.checkpoint("after recursing 1000 deep");
+        std::cout << "Main thread (results " << mainSum << ", " << mainResult << "):" << std::endl;
+        for (const auto &[name, bytes] : watermark.checkpoints())
+        {
+            std::cout << "    " << name << ": " << formatBytes(bytes) << std::endl;
+        }
+        std::cout << std::endl;
+
+        // Each job on its own thread with a default sized stack, then again
+        // on a stack sized to what it needed
+        struct Job
+        {
+            std::string name{};
+            std::function<void()> run{};
+        };
+        std::uint64_t sink{0};
+        const auto jobs = std::vector<Job>{
+            {"nothing", [] {}},
+            {"recursing 100 deep", [&sink] { sink += recurse(100); }},
+            {"recursing " + std::to_string(depth) + " deep", [&sink, depth] { sink += recurse(depth); }},
+            {"64 KiB array", [&sink] { sink += bigLocalArray(); }},
+            {"sorting and formatting", [&sink] { sink += sortAndFormat().size(); }}};
+
+        constexpr std::size_t defaultStack{8 * 1024 * 1024};
+        constexpr std::size_t threads{10000};
+        std::size_t maxSuggested{0};
+        std::cout << "Jobs on threads with " << formatBytes(defaultStack) << " stacks:" << std::endl;
+        for (const auto &[name, run] : jobs)
+        {
+            const auto highWaterMark = measure_stack_usage(defaultStack, run);
+            const auto suggested = suggestedStackSize(highWaterMark);
+
+            // Proves the smaller stack is enough
+            const auto again = measure_stack_usage(suggested, run);
+            std::cout << "    " << name << ": used " << formatBytes(highWaterMark) << ", suggested stack "
+                      << formatBytes(suggested) << " (used " << formatBytes(again) << " of it)" << std::endl;
+            maxSuggested = std::max(maxSuggested, suggested);
+        }
+
+        // Frame size from the difference between two recursion depths
+        const auto shallow = measure_stack_usage(defaultStack, [&sink] { sink += recurse(100); });
+        const auto deep = measure_stack_usage(defaultStack, [&sink, depth] { sink += recurse(depth); });
+        if (depth > 100)
+        {
+            std::cout << "    recurse() takes "
+                      << static_cast<double>(deep - shallow) / static_cast<double>(depth - 100)
+                      << " bytes of stack per call (compare with make stack-report)" << std::endl;
+        }
+
+        std::cout << std::endl
+                  << "Stacks for " << threads << " threads: " << formatBytes(threads * defaultStack) << " by default, "
+                  << formatBytes(threads * maxSuggested) << " sized to the largest job (result " << sink % 10 << ")"
+                  << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
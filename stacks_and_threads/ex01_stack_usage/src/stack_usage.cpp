@@ -0,0 +1,205 @@
+#include "stack_usage.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <pthread.h>
+
+namespace
+{
+    // Unlikely to be left on the stack by real code
+    constexpr std::uint64_t paint{0x5CA1AB1E0DDBA11ULL};
+
+    // Bytes below the painting function's frame that are not painted, so
+    // painting does not overwrite its own frame or the red zone below it
+    constexpr std::size_t margin{512};
+
+    // Lowest and highest address of the calling thread's stack
+    void stackBounds(std::byte *&low, std::byte *&high)
+    {
+        pthread_attr_t attributes{};
+        const int error{pthread_getattr_np(pthread_self(), &attributes)};
+        if (error != 0)
+        {
+            throw std::system_error{error, std::generic_category(), "pthread_getattr_np"};
+        }
+        void *address{nullptr};
+        std::size_t size{0};
+        pthread_attr_getstack(&attributes, &address, &size);
+        pthread_attr_destroy(&attributes);
+        low = static_cast<std::byte *>(address);
+        high = low + size;
+    }
+
+    /**
+     * Writes the pattern from below this function's own frame down to
+     * lowest and returns the highest painted address. Writing below the
+     * stack pointer is exactly what a deeper call would do, but
+     * AddressSanitizer may have marked some of it, so it must not check this
+     * function. The volatile stores keep the compiler from replacing the
+     * loop with a call to memset, whose frame would be painted over.
+     */
+    [[gnu::noinline]] __attribute__((no_sanitize_address)) std::byte *paintBelow(std::byte *lowest)
+    {
+        volatile std::uint64_t here{0};
+        auto top{reinterpret_cast<std::uintptr_t>(&here) - margin};
+        top &= ~std::uintptr_t{sizeof(std::uint64_t) - 1};
+
+        auto *word{reinterpret_cast<volatile std::uint64_t *>(top)};
+        auto *const end{reinterpret_cast<volatile std::uint64_t *>(lowest)};
+        while (word > end)
+        {
+            *--word = paint;
+        }
+        return reinterpret_cast<std::byte *>(top);
+    }
+
+    // Lowest painted address whose pattern was overwritten, or high if none
+    __attribute__((no_sanitize_address)) const std::byte *lowestTouched(const std::byte *low, const std::byte *high)
+    {
+        auto *word{reinterpret_cast<const volatile std::uint64_t *>(low)};
+        auto *const end{reinterpret_cast<const volatile std::uint64_t *>(high)};
+        while (word < end && *word == paint)
+        {
+            ++word;
+        }
+        return low + (word - reinterpret_cast<const volatile std::uint64_t *>(low)) * sizeof(std::uint64_t);
+    }
+}
+
+std::vector<FunctionStackUsage> read_stack_usage(const std::filesystem::path &directory)
+{
+    std::vector<FunctionStackUsage> functions{};
+    bool found{false};
+    for (const auto &entry : std::filesystem::directory_iterator{directory})
+    {
+        if (entry.path().extension() != ".su")
+        {
+            continue;
+        }
+        found = true;
+
+        // Each line is "file:line:column:function<TAB>bytes<TAB>qualifiers"
+        std::ifstream file{entry.path()};
+        std::string line{};
+        while (std::getline(file, line))
+        {
+            const auto bytesStart{line.find('\t')};
+            const auto kindStart{line.find('\t', bytesStart + 1)};
+            if (bytesStart == std::string::npos || kindStart == std::string::npos)
+            {
+                continue;
+            }
+
+            // The function name itself may contain colons (A::f), so split
+            // after the third one
+            std::size_t nameStart{0};
+            for (int colons{0}; colons < 3 && nameStart != std::string::npos; ++colons)
+            {
+                nameStart = line.find(':', nameStart);
+                nameStart = nameStart == std::string::npos ? nameStart : nameStart + 1;
+            }
+            if (nameStart == std::string::npos || nameStart > bytesStart)
+            {
+                continue;
+            }
+
+            functions.push_back({line.substr(nameStart, bytesStart - nameStart), line.substr(0, nameStart - 1),
+                                 std::stoull(line.substr(bytesStart + 1, kindStart - bytesStart - 1)),
+                                 line.substr(kindStart + 1)});
+        }
+    }
+    if (!found)
+    {
+        throw std::invalid_argument{"no .su files in " + directory.string() + ", build with -fstack-usage"};
+    }
+
+    std::stable_sort(functions.begin(), functions.end(),
+                     [](const FunctionStackUsage &a, const FunctionStackUsage &b) { return a.bytes > b.bytes; });
+    return functions;
+}
+
+StackWatermark::StackWatermark(std::size_t maxDepth)
+{
+    stackBounds(m_low, m_high);
+
+    // The main thread's stack grows on demand up to its limit, so only
+    // paint as far down as asked for
+    const auto here{reinterpret_cast<std::uintptr_t>(&maxDepth)};
+    const auto low{reinterpret_cast<std::uintptr_t>(m_low)};
+    const auto lowest{here - low > maxDepth ? here - maxDepth : low};
+
+    m_paintedLow = reinterpret_cast<std::byte *>(lowest + sizeof(std::uint64_t) - 1);
+    m_paintedLow -= reinterpret_cast<std::uintptr_t>(m_paintedLow) % sizeof(std::uint64_t);
+    m_paintedHigh = paintBelow(m_paintedLow);
+}
+
+std::size_t StackWatermark::high_water_mark() const
+{
+    const auto *touched{lowestTouched(m_paintedLow, m_paintedHigh)};
+    return static_cast<std::size_t>(m_high - touched);
+}
+
+void StackWatermark::checkpoint(std::string_view name)
+{
+    m_checkpoints.emplace_back(std::string{name}, high_water_mark());
+}
+
+namespace
+{
+    struct Measurement
+    {
+        const std::function<void()> *job{nullptr};
+        std::size_t highWaterMark{0};
+        std::exception_ptr error{};
+    };
+
+    void *measureThread(void *argument)
+    {
+        auto &measurement{*static_cast<Measurement *>(argument)};
+        try
+        {
+            // Paint the whole stack, it is the only way to see all of it
+            const StackWatermark watermark{~std::size_t{0}};
+            (*measurement.job)();
+            measurement.highWaterMark = watermark.high_water_mark();
+        }
+        catch (...)
+        {
+            measurement.error = std::current_exception();
+        }
+        return nullptr;
+    }
+}
+
+std::size_t measure_stack_usage(std::size_t stackSize, const std::function<void()> &job)
+{
+    pthread_attr_t attributes{};
+    pthread_attr_init(&attributes);
+    int error{pthread_attr_setstacksize(&attributes, stackSize)};
+    if (error != 0)
+    {
+        pthread_attr_destroy(&attributes);
+        throw std::system_error{error, std::generic_category(), "pthread_attr_setstacksize"};
+    }
+
+    Measurement measurement{&job};
+    pthread_t thread{};
+    error = pthread_create(&thread, &attributes, measureThread, &measurement);
+    pthread_attr_destroy(&attributes);
+    if (error != 0)
+    {
+        throw std::system_error{error, std::generic_category(), "pthread_create"};
+    }
+    pthread_join(thread, nullptr);
+
+    if (measurement.error)
+    {
+        std::rethrow_exception(measurement.error);
+    }
+    return measurement.highWaterMark;
+}
@@ -0,0 +1,90 @@
+#ifndef STACK_WORKERS_H
+#define STACK_WORKERS_H
+
+#include "thread_stack.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Where the stack of a job's thread comes from
+enum class StackSource
+{
+    system,   // pthread_attr_setstacksize, the C library maps the stack
+    fresh,    // a ThreadStack mapped for the job and unmapped afterwards
+    pooled,   // a ThreadStack from a StackPool
+};
+
+struct JobState;
+class StackWorkers;
+
+/**
+ * A job running on its own thread. join() waits for it and rethrows what
+ * the job threw; the destructor waits too, but drops exceptions.
+ */
+class Job
+{
+public:
+    Job(Job &&other) noexcept;
+    Job &operator=(Job &&) = delete;
+    ~Job();
+
+    Job(const Job &) = delete;
+    Job &operator=(const Job &) = delete;
+
+    void join();
+
+private:
+    friend class StackWorkers;
+    Job(StackWorkers &workers, std::unique_ptr<JobState> state);
+
+    StackWorkers *m_workers{nullptr};
+    std::unique_ptr<JobState> m_state{};
+};
+
+/**
+ * Runs jobs on threads with stacks of a chosen size, for work that
+ * recurses deeper than a default stack allows, or so thousands of threads
+ * with small stacks fit in memory:
+ *
+ *     StackWorkers workers{64 * 1024 * 1024, StackSource::pooled};
+ *     Job job{workers.launch("parse", [&] { result = parse(deeplyNested); })};
+ *     job.join();
+ *
+ * Every stack has a guard page below it, and every thread an alternate
+ * signal stack. If a job runs into its guard page, a SIGSEGV handler prints
+ * which job overflowed its stack of how many bytes before the program dies
+ * as usual, instead of an unexplained segmentation fault. The handler does
+ * not try to recover: the job's frames cannot be unwound from a signal
+ * handler, so whatever they own would leak or stay locked.
+ */
+class StackWorkers
+{
+public:
+    StackWorkers(std::size_t stackSize, StackSource source, std::size_t poolCapacity = 64);
+
+    StackWorkers(const StackWorkers &) = delete;
+    StackWorkers &operator=(const StackWorkers &) = delete;
+
+    // Starts job on a new thread. Throws std::system_error if the thread
+    // or its stack cannot be created.
+    Job launch(std::string name, std::function<void()> job);
+
+    // Number of stacks mapped so far (system stacks are not counted)
+    std::size_t stacks_mapped() const;
+
+private:
+    friend class Job;
+    void finish(JobState &state);
+    void releaseStack(const JobState &state);
+
+    std::size_t m_stackSize{0};
+    std::size_t m_guardSize{0};
+    StackSource m_source{StackSource::system};
+    StackPool m_pool;
+    std::atomic<std::size_t> m_freshMapped{0};
+};
+
+#endif
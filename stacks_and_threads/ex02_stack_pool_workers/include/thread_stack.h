@@ -0,0 +1,79 @@
+#ifndef THREAD_STACK_H
+#define THREAD_STACK_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * Memory for one thread, mapped with mmap:
+ *
+ *     | guard | stack ... | guard | signal stack |
+ *     low addresses                 high addresses
+ *
+ * The stack grows down towards its guard page, which is neither readable nor
+ * writable, so running off the end of the stack faults instead of silently
+ * overwriting other memory. The signal stack is where the overflow handler
+ * runs, since the thread's own stack is full at that point. A frame bigger
+ * than the guard can jump over it, so functions with big local arrays need a
+ * bigger guard (or GCC's -fstack-clash-protection).
+ */
+struct ThreadStack
+{
+    std::byte *mapping{nullptr};
+    std::size_t mappingSize{0};
+    std::byte *stack{nullptr};
+    std::size_t stackSize{0};
+    std::byte *guard{nullptr};
+    std::size_t guardSize{0};
+    std::byte *signalStack{nullptr};
+    std::size_t signalStackSize{0};
+};
+
+/**
+ * Maps a ThreadStack with at least stackSize bytes of stack and guardSize
+ * bytes of guard, both rounded up to whole pages. Throws std::system_error
+ * if the memory cannot be mapped.
+ */
+ThreadStack map_thread_stack(std::size_t stackSize, std::size_t guardSize);
+void unmap_thread_stack(const ThreadStack &stack);
+
+/**
+ * Keeps the stacks of finished threads for the next ones, so starting a
+ * thread does not have to mmap, mprotect and later munmap its memory:
+ *
+ *     StackPool pool{256 * 1024, 4096, 64};
+ *     ThreadStack stack{pool.acquire()};
+ *     ...   // run a thread on it and wait for it to finish
+ *     pool.release(stack);
+ *
+ * At most capacity stacks are kept, further ones are unmapped. A reused
+ * stack keeps the pages its earlier threads touched, which is memory a
+ * fresh stack does not use yet but also no page faults to pay again.
+ * Safe to use from several threads.
+ */
+class StackPool
+{
+public:
+    StackPool(std::size_t stackSize, std::size_t guardSize, std::size_t capacity);
+    ~StackPool();
+
+    StackPool(const StackPool &) = delete;
+    StackPool &operator=(const StackPool &) = delete;
+
+    ThreadStack acquire();
+    void release(const ThreadStack &stack);
+
+    // Number of stacks mapped so far
+    std::size_t mapped() const;
+
+private:
+    std::size_t m_stackSize{0};
+    std::size_t m_guardSize{0};
+    std::size_t m_capacity{0};
+    mutable std::mutex m_mutex{};
+    std::vector<ThreadStack> m_free{};
+    std::size_t m_mapped{0};
+};
+
+#endif
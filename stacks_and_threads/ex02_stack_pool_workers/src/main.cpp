@@ -0,0 +1,161 @@
+/**
+ * Worker Threads with Chosen Stack Sizes
+ *
+ * The stack overflow example in crashes_and_undefined_behavior recurses in
+ * eat_stack() until the 8 MB main thread stack runs out, and the program
+ * dies with nothing but "Segmentation fault". Some work really does recurse
+ * deeply (parsers of nested input, tree algorithms), and the way to give it
+ * room is a thread with a bigger stack. The opposite case, many threads
+ * doing shallow work, wants small stacks (see ex01_stack_usage).
+ *
+ * StackWorkers runs jobs on threads with a chosen stack size. It protects
+ * each stack with a guard page and gives each thread an alternate signal
+ * stack (sigaltstack), so that running out of stack ends the program with a
+ * message saying which job overflowed.
+ *
+ * Starting a thread means getting memory for its stack: mmap it, make the
+ * guard page inaccessible with mprotect, touch the first pages (page
+ * faults), and munmap it all again when the thread ends. Reusing the stacks
+ * of finished threads from a pool skips all of that. glibc does the same
+ * for stacks it allocates itself (pthread_attr_setstacksize), but only
+ * keeps up to 40 MB of them, so big stacks are mapped anew every time.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="10000"      # more jobs in the benchmark
+ *     > make run ARGS="overflow"   # a job that overflows its stack
+ */
+
+#include "stack_workers.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Like eat_stack in the stack overflow example, but stops at depth. Each
+ * frame has a buffer the next call reads, so the frame must stay alive and
+ * the compiler cannot turn the recursion into a loop.
+ */
+[[gnu::noinline]] std::uint64_t eatStack(std::size_t depth, const volatile std::uint8_t *parent)
+{
+    volatile std::uint8_t frame[64];
+    frame[0] = static_cast<std::uint8_t>(depth + parent[0]);
+    if (depth == 0)
+    {
+        return frame[0];
+    }
+    return eatStack(depth - 1, frame) + frame[0];
+}
+
+std::uint64_t eatStack(std::size_t depth)
+{
+    const volatile std::uint8_t start{0};
+    return eatStack(depth, &start);
+}
+
+std::string sourceName(StackSource source)
+{
+    switch (source)
+    {
+    case StackSource::system:
+        return "system";
+    case StackSource::fresh:
+        return "fresh ";
+    case StackSource::pooled:
+        return "pooled";
+    }
+    return "";
+}
+
+// Launches at least jobCount jobs in batches of batchSize threads and waits
+// for each batch; returns the time per job in microseconds
+double launchLatency(StackWorkers &workers, std::size_t jobCount, std::size_t batchSize, std::size_t depth,
+                     std::uint64_t &sink)
+{
+    std::vector<std::uint64_t> results(batchSize);
+    std::size_t launched{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    for (; launched < jobCount; launched += batchSize)
+    {
+        std::vector<Job> batch{};
+        batch.reserve(batchSize);
+        for (std::size_t i{0}; i < batchSize; ++i)
+        {
+            batch.push_back(workers.launch("benchmark", [&results, i, depth] { results[i] = eatStack(depth); }));
+        }
+        for (auto &job : batch)
+        {
+            job.join();
+        }
+        for (const auto result : results)
+        {
+            sink += result;
+        }
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(stop - start).count() / static_cast<double>(launched);
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    constexpr std::size_t kibibyte{1024};
+    constexpr std::size_t mebibyte{1024 * 1024};
+
+    try
+    {
+        if (argc > 1 && std::string{argv[1]} == "overflow")
+        {
+            // Never returns: the handler reports the overflow, then the
+            // program dies of the segmentation fault
+            auto workers = StackWorkers{256 * kibibyte, StackSource::pooled};
+            auto job = workers.launch("bottomless recursion", [] { eatStack(~std::size_t{0}); });
+            job.join();
+            return 0;
+        }
+        const auto jobCount = std::size_t{argc > 1 ? std::stoul(argv[1]) : 2000};
+
+        // About 16 MB of recursion, twice what the main thread has
+        constexpr std::size_t deep{200000};
+        auto bigWorkers = StackWorkers{64 * mebibyte, StackSource::pooled};
+        std::uint64_t deepResult{0};
+        auto deepJob = bigWorkers.launch("deep recursion", [&deepResult] { deepResult = eatStack(deep); });
+        deepJob.join();
+        std::cout << "Recursed " << deep << " calls deep on a 64 MiB stack (result " << deepResult << ")" << std::endl
+                  << std::endl;
+
+        constexpr std::size_t batchSize{8};
+        constexpr std::size_t depth{1000};
+        std::uint64_t sink{0};
+        std::cout << jobCount << " jobs, " << batchSize << " at a time, each recursing " << depth
+                  << " calls deep:" << std::endl;
+        for (const auto stackSize : {256 * kibibyte, 64 * mebibyte})
+        {
+            std::cout << "    " << stackSize / kibibyte << " KiB stacks" << std::endl;
+            for (const auto source : {StackSource::system, StackSource::fresh, StackSource::pooled})
+            {
+                auto workers = StackWorkers{stackSize, source};
+                const auto microseconds = launchLatency(workers, jobCount, batchSize, depth, sink);
+                std::cout << "        " << sourceName(source) << ": " << microseconds << " us per job";
+                if (source != StackSource::system)
+                {
+                    std::cout << ", " << workers.stacks_mapped() << " stacks mapped";
+                }
+                std::cout << std::endl;
+            }
+        }
+        std::cout << "(checksum " << sink << ")" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include "stack_workers.h"
+
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <utility>
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+struct JobState
+{
+    std::string name{};
+    std::function<void()> job{};
+    std::size_t stackSize{0};
+    ThreadStack stack{};   // unused for StackSource::system
+    std::unique_ptr<std::byte[]> systemSignalStack{};
+    pthread_t thread{};
+    bool joined{false};
+    std::exception_ptr error{};
+};
+
+namespace
+{
+    // What the overflow handler needs to know about the job on this thread
+    thread_local const char *t_jobName{nullptr};
+    thread_local std::size_t t_stackSize{0};
+    thread_local const std::byte *t_guardLow{nullptr};
+    thread_local const std::byte *t_guardHigh{nullptr};
+
+    // Only async-signal-safe functions may be called from a signal handler,
+    // which rules out everything that formats or allocates
+    void writeText(const char *text)
+    {
+        std::size_t length{0};
+        while (text[length] != '\0')
+        {
+            ++length;
+        }
+        [[maybe_unused]] const auto written{write(STDERR_FILENO, text, length)};
+    }
+
+    void writeNumber(std::size_t number)
+    {
+        char digits[24]{};
+        char *digit{digits + sizeof(digits) - 1};
+        do
+        {
+            *--digit = static_cast<char>('0' + number % 10);
+            number /= 10;
+        } while (number != 0);
+        writeText(digit);
+    }
+
+    void onSegmentationFault(int, siginfo_t *info, void *)
+    {
+        const auto *address{static_cast<const std::byte *>(info->si_addr)};
+        if (t_jobName != nullptr && address >= t_guardLow && address < t_guardHigh)
+        {
+            writeText("Stack overflow in job \"");
+            writeText(t_jobName);
+            writeText("\": it used all of its ");
+            writeNumber(t_stackSize);
+            writeText(" byte stack\n");
+        }
+        // Returning runs the faulting instruction again, which now ends the
+        // program the usual way (and writes a core dump if enabled)
+        signal(SIGSEGV, SIG_DFL);
+    }
+
+    void installOverflowHandler()
+    {
+        struct sigaction action{};
+        action.sa_sigaction = onSegmentationFault;
+        action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGSEGV, &action, nullptr);
+    }
+
+    void *runJob(void *argument)
+    {
+        auto &state{*static_cast<JobState *>(argument)};
+
+        // The handler must not run on the full stack
+        stack_t signalStack{};
+        if (state.stack.mapping != nullptr)
+        {
+            signalStack.ss_sp = state.stack.signalStack;
+            signalStack.ss_size = state.stack.signalStackSize;
+            t_guardLow = state.stack.guard;
+            t_guardHigh = state.stack.guard + state.stack.guardSize;
+        }
+        else
+        {
+            signalStack.ss_sp = state.systemSignalStack.get();
+            signalStack.ss_size = static_cast<std::size_t>(sysconf(_SC_SIGSTKSZ));
+
+            // The C library puts its guard right below the stack
+            pthread_attr_t attributes{};
+            pthread_getattr_np(pthread_self(), &attributes);
+            void *low{nullptr};
+            std::size_t size{0};
+            std::size_t guardSize{0};
+            pthread_attr_getstack(&attributes, &low, &size);
+            pthread_attr_getguardsize(&attributes, &guardSize);
+            pthread_attr_destroy(&attributes);
+            t_guardHigh = static_cast<const std::byte *>(low);
+            t_guardLow = t_guardHigh - guardSize;
+        }
+        sigaltstack(&signalStack, nullptr);
+        t_stackSize = state.stackSize;
+        t_jobName = state.name.c_str();
+
+        try
+        {
+            state.job();
+        }
+        catch (...)
+        {
+            state.error = std::current_exception();
+        }
+
+        // The signal stack's memory may go to another thread next
+        t_jobName = nullptr;
+        signalStack.ss_flags = SS_DISABLE;
+        sigaltstack(&signalStack, nullptr);
+        return nullptr;
+    }
+}
+
+Job::Job(StackWorkers &workers, std::unique_ptr<JobState> state) : m_workers{&workers}, m_state{std::move(state)}
+{
+}
+
+Job::Job(Job &&other) noexcept : m_workers{other.m_workers}, m_state{std::move(other.m_state)}
+{
+}
+
+Job::~Job()
+{
+    if (m_state && !m_state->joined)
+    {
+        m_workers->finish(*m_state);
+    }
+}
+
+void Job::join()
+{
+    if (!m_state || m_state->joined)
+    {
+        return;
+    }
+    m_workers->finish(*m_state);
+    if (m_state->error)
+    {
+        std::rethrow_exception(std::exchange(m_state->error, nullptr));
+    }
+}
+
+StackWorkers::StackWorkers(std::size_t stackSize, StackSource source, std::size_t poolCapacity)
+    : m_stackSize{stackSize}, m_guardSize{static_cast<std::size_t>(sysconf(_SC_PAGESIZE))}, m_source{source},
+      m_pool{stackSize, m_guardSize, poolCapacity}
+{
+    static std::once_flag installed{};
+    std::call_once(installed, installOverflowHandler);
+}
+
+Job StackWorkers::launch(std::string name, std::function<void()> job)
+{
+    auto state{std::make_unique<JobState>()};
+    state->name = std::move(name);
+    state->job = std::move(job);
+    state->stackSize = m_stackSize;
+
+    switch (m_source)
+    {
+    case StackSource::system:
+        state->systemSignalStack = std::make_unique<std::byte[]>(static_cast<std::size_t>(sysconf(_SC_SIGSTKSZ)));
+        break;
+    case StackSource::fresh:
+        state->stack = map_thread_stack(m_stackSize, m_guardSize);
+        ++m_freshMapped;
+        break;
+    case StackSource::pooled:
+        state->stack = m_pool.acquire();
+        break;
+    }
+
+    pthread_attr_t attributes{};
+    pthread_attr_init(&attributes);
+    int error{0};
+    if (m_source == StackSource::system)
+    {
+        error = pthread_attr_setstacksize(&attributes, m_stackSize);
+        if (error == 0)
+        {
+            error = pthread_attr_setguardsize(&attributes, m_guardSize);
+        }
+    }
+    else
+    {
+        // glibc puts the thread's own bookkeeping and thread_local variables
+        // at the top of a stack it is given, so a little less is left for
+        // the job
+        error = pthread_attr_setstack(&attributes, state->stack.stack, state->stack.stackSize);
+    }
+    if (error == 0)
+    {
+        error = pthread_create(&state->thread, &attributes, runJob, state.get());
+    }
+    pthread_attr_destroy(&attributes);
+
+    if (error != 0)
+    {
+        state->joined = true;
+        releaseStack(*state);
+        throw std::system_error{error, std::generic_category(), "starting job " + state->name};
+    }
+    return Job{*this, std::move(state)};
+}
+
+void StackWorkers::finish(JobState &state)
+{
+    pthread_join(state.thread, nullptr);
+    state.joined = true;
+    releaseStack(state);
+}
+
+void StackWorkers::releaseStack(const JobState &state)
+{
+    if (m_source == StackSource::pooled)
+    {
+        m_pool.release(state.stack);
+    }
+    else if (m_source == StackSource::fresh)
+    {
+        unmap_thread_stack(state.stack);
+    }
+}
+
+std::size_t StackWorkers::stacks_mapped() const
+{
+    return m_source == StackSource::pooled ? m_pool.mapped() : m_freshMapped.load();
+}
@@ -0,0 +1,112 @@
+#include "thread_stack.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    std::size_t roundToPages(std::size_t bytes)
+    {
+        const auto page{static_cast<std::size_t>(sysconf(_SC_PAGESIZE))};
+        return (bytes + page - 1) / page * page;
+    }
+
+    void protect(std::byte *address, std::size_t size)
+    {
+        if (mprotect(address, size, PROT_NONE) != 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "mprotect"};
+        }
+    }
+}
+
+ThreadStack map_thread_stack(std::size_t stackSize, std::size_t guardSize)
+{
+    ThreadStack result{};
+    result.stackSize = roundToPages(stackSize);
+    result.guardSize = roundToPages(guardSize);
+    result.signalStackSize = roundToPages(static_cast<std::size_t>(sysconf(_SC_SIGSTKSZ)));
+    result.mappingSize = 2 * result.guardSize + result.stackSize + result.signalStackSize;
+
+    void *mapping{mmap(nullptr, result.mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                       -1, 0)};
+    if (mapping == MAP_FAILED)
+    {
+        throw std::system_error{errno, std::generic_category(), "mmap"};
+    }
+    result.mapping = static_cast<std::byte *>(mapping);
+    result.guard = result.mapping;
+    result.stack = result.guard + result.guardSize;
+    result.signalStack = result.stack + result.stackSize + result.guardSize;
+
+    try
+    {
+        protect(result.guard, result.guardSize);
+        protect(result.stack + result.stackSize, result.guardSize);
+    }
+    catch (...)
+    {
+        unmap_thread_stack(result);
+        throw;
+    }
+    return result;
+}
+
+void unmap_thread_stack(const ThreadStack &stack)
+{
+    munmap(stack.mapping, stack.mappingSize);
+}
+
+StackPool::StackPool(std::size_t stackSize, std::size_t guardSize, std::size_t capacity)
+    : m_stackSize{stackSize}, m_guardSize{guardSize}, m_capacity{capacity}
+{
+}
+
+StackPool::~StackPool()
+{
+    for (const auto &stack : m_free)
+    {
+        unmap_thread_stack(stack);
+    }
+}
+
+ThreadStack StackPool::acquire()
+{
+    {
+        const std::lock_guard lock{m_mutex};
+        if (!m_free.empty())
+        {
+            const ThreadStack stack{m_free.back()};
+            m_free.pop_back();
+            return stack;
+        }
+    }
+    // Map outside the lock, other threads can take or return stacks meanwhile
+    const ThreadStack stack{map_thread_stack(m_stackSize, m_guardSize)};
+    // Only counted once mapping succeeded, since it throws on failure
+    const std::lock_guard lock{m_mutex};
+    ++m_mapped;
+    return stack;
+}
+
+void StackPool::release(const ThreadStack &stack)
+{
+    {
+        const std::lock_guard lock{m_mutex};
+        if (m_free.size() < m_capacity)
+        {
+            m_free.push_back(stack);
+            return;
+        }
+    }
+    unmap_thread_stack(stack);
+}
+
+std::size_t StackPool::mapped() const
+{
+    const std::lock_guard lock{m_mutex};
+    return m_mapped;
+}
@@ -0,0 +1,101 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string_view>
+
+#include <x86intrin.h>
+
+/**
+ * A flight recorder: every thread writes small binary events into its own
+ * ring buffer, keeping only the most recent ones, and when the program
+ * crashes a signal handler writes all rings to a file. It is cheap enough
+ * to leave on in production, where a full trace would be too slow, and
+ * tells what every thread did right before the crash:
+ *
+ *     install_flight_recorder("crash.flight");
+ *     const EventId requestStarted{define_event("request started")};
+ *     ...
+ *     record_event(requestStarted, requestId, size);   // a few nanoseconds
+ *
+ * and later, maybe on another machine:
+ *
+ *     decode_flight_record("crash.flight", std::cout);
+ *
+ * Recording takes no locks and allocates nothing: the rings are static
+ * memory, and a thread claims one on its first event. At most
+ * maxRecordedThreads threads get a ring, the events of further threads are
+ * dropped.
+ */
+
+using EventId = std::uint32_t;
+
+struct FlightEvent
+{
+    std::uint64_t timestamp{0};   // time stamp counter (rdtsc)
+    EventId id{0};
+    std::uint32_t reserved{0};
+    std::uint64_t a{0};
+    std::uint64_t b{0};
+};
+
+constexpr std::size_t ringCapacity{1024};   // events kept per thread
+constexpr std::size_t maxRecordedThreads{64};
+constexpr std::size_t maxEventNames{256};
+constexpr std::size_t maxEventNameLength{48};
+
+// Cache line aligned, so threads do not slow each other down by writing
+// next to each other's rings
+struct alignas(64) FlightRing
+{
+    FlightEvent events[ringCapacity]{};
+    std::atomic<std::uint64_t> written{0};   // events ever written
+    std::uint64_t threadId{0};
+};
+
+// Set by the crash handler; from then on the rings are frozen for it to copy
+inline std::atomic<bool> flightRecorderCrashed{false};
+
+/**
+ * Installs the crash handler for SIGSEGV, SIGBUS, SIGILL, SIGFPE and
+ * SIGABRT, which writes the rings to path and then lets the signal end the
+ * program as it would have. Throws std::invalid_argument if path is too long
+ * and std::system_error if a handler cannot be installed.
+ */
+void install_flight_recorder(const std::filesystem::path &path);
+
+// Gives an event a name for the decoder. Throws std::length_error when all
+// maxEventNames are taken.
+EventId define_event(std::string_view name);
+
+// The calling thread's ring, claimed on first use; nullptr if none is left
+FlightRing *claim_flight_ring();
+
+inline void record_event(EventId id, std::uint64_t a = 0, std::uint64_t b = 0)
+{
+    thread_local FlightRing *const ring{claim_flight_ring()};
+    if (ring == nullptr || flightRecorderCrashed.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    // Only this thread writes the ring, so a relaxed load of its own count
+    // is enough; the release store lets a crash handler running on another
+    // thread see the complete event
+    const auto written{ring->written.load(std::memory_order_relaxed)};
+    ring->events[written % ringCapacity] = {__rdtsc(), id, 0, a, b};
+    ring->written.store(written + 1, std::memory_order_release);
+}
+
+/**
+ * Prints a file written by the crash handler: the signal, the registers of
+ * the crashing thread and the last lastEvents events of every thread, oldest
+ * first, with times relative to the crash. Throws std::runtime_error if the
+ * file cannot be read or is not a flight record.
+ */
+void decode_flight_record(const std::filesystem::path &path, std::ostream &out, std::size_t lastEvents = 8);
+
+#endif
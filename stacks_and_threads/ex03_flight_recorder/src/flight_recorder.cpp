@@ -0,0 +1,356 @@
+#include "flight_recorder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+// Where the linker placed the start and the end of the program; with
+// address space layout randomization they differ between runs
+extern "C" const char __executable_start[];
+extern "C" const char _end[];
+
+namespace
+{
+    constexpr char magic[8]{'F', 'L', 'I', 'G', 'H', 'T', '1', '\0'};
+
+    // Registers saved in the file, in the order of the kernel's gregs
+    constexpr const char *registerNames[]{"r8",  "r9",  "r10", "r11", "r12", "r13", "r14", "r15",
+                                          "rdi", "rsi", "rbp", "rbx", "rdx", "rax", "rcx", "rsp",
+                                          "rip", "efl", "csgsfs", "err", "trapno", "oldmask", "cr2"};
+    constexpr std::size_t registerCount{std::size(registerNames)};
+
+    /**
+     * The file is written with raw write calls and read back by the decoder
+     * on the same kind of machine:
+     *
+     *     FileHeader
+     *     registers:  std::uint64_t[registerCount]
+     *     names:      char[nameCount][maxEventNameLength]
+     *     per ring:   FlightEvent[ringCapacity], RingHeader
+     */
+    struct FileHeader
+    {
+        char magic[8]{};
+        std::int32_t signal{0};
+        std::int32_t code{0};
+        std::uint64_t faultAddress{0};
+        std::uint64_t threadId{0};
+        std::uint64_t timestamp{0};
+        std::uint64_t loadAddress{0};
+        std::uint64_t endAddress{0};
+        double ticksPerNanosecond{0.0};
+        std::uint32_t registerCount{0};
+        std::uint32_t nameCount{0};
+        std::uint32_t ringCount{0};
+        std::uint32_t ringCapacity{0};
+    };
+
+    struct RingHeader
+    {
+        std::uint64_t threadId{0};
+        std::uint64_t written{0};   // events written when the crash happened
+        std::uint64_t after{0};     // events written once the ring was copied
+    };
+
+    FlightRing g_rings[maxRecordedThreads]{};
+    std::atomic<std::size_t> g_ringCount{0};
+    thread_local FlightRing *t_ring{nullptr};
+
+    char g_names[maxEventNames][maxEventNameLength]{};
+    std::atomic<std::uint32_t> g_nameCount{0};
+
+    // A thread that overflows its stack cannot run the handler on it
+    constexpr std::size_t signalStackSize{64 * 1024};
+    alignas(16) std::byte g_signalStacks[maxRecordedThreads + 1][signalStackSize]{};
+
+    char g_path[4096]{};
+    double g_ticksPerNanosecond{1.0};
+    std::atomic<bool> g_recordWritten{false};
+
+    void useSignalStack(std::size_t index)
+    {
+        stack_t signalStack{};
+        signalStack.ss_sp = g_signalStacks[index];
+        signalStack.ss_size = signalStackSize;
+        sigaltstack(&signalStack, nullptr);
+    }
+
+    // How fast the time stamp counter ticks, measured against the clock
+    double measureTicksPerNanosecond()
+    {
+        const auto start{std::chrono::steady_clock::now()};
+        const auto startTicks{__rdtsc()};
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds{20})
+        {
+        }
+        const auto ticks{__rdtsc() - startTicks};
+        const auto nanoseconds{std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)};
+        return static_cast<double>(ticks) / nanoseconds.count();
+    }
+
+    void writeAll(int file, const void *data, std::size_t size)
+    {
+        const auto *bytes{static_cast<const char *>(data)};
+        while (size > 0)
+        {
+            const auto written{write(file, bytes, size)};
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                return;
+            }
+            bytes += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+
+    /**
+     * Runs in the middle of a crash, maybe with a corrupted heap or while
+     * another thread holds a lock, so it may only call async-signal-safe
+     * functions: open, write and close, but nothing that allocates, locks
+     * or formats. Everything it writes is already in static memory.
+     */
+    void onCrash(int number, siginfo_t *info, void *context)
+    {
+        // If several threads crash at once, the first one writes the file
+        // and the others wait for it, since their signal would end the
+        // program in the middle of writing
+        if (flightRecorderCrashed.exchange(true))
+        {
+            const timespec millisecond{0, 1000000};
+            while (!g_recordWritten.load())
+            {
+                nanosleep(&millisecond, nullptr);
+            }
+        }
+        else
+        {
+            FileHeader header{};
+            std::memcpy(header.magic, magic, sizeof(magic));
+            header.signal = number;
+            header.code = info->si_code;
+            header.faultAddress = reinterpret_cast<std::uint64_t>(info->si_addr);
+            header.threadId = static_cast<std::uint64_t>(gettid());
+            header.timestamp = __rdtsc();
+            header.loadAddress = reinterpret_cast<std::uint64_t>(__executable_start);
+            header.endAddress = reinterpret_cast<std::uint64_t>(_end);
+            header.ticksPerNanosecond = g_ticksPerNanosecond;
+            header.registerCount = registerCount;
+            header.nameCount = g_nameCount.load();
+            header.ringCount = static_cast<std::uint32_t>(std::min(g_ringCount.load(), maxRecordedThreads));
+            header.ringCapacity = ringCapacity;
+
+            // Other threads stop recording once they see the flag, but may
+            // finish the event they are writing; the decoder shows the
+            // events before these counts that were not overwritten by the
+            // time the ring was copied
+            RingHeader rings[maxRecordedThreads]{};
+            for (std::size_t i{0}; i < header.ringCount; ++i)
+            {
+                rings[i] = {g_rings[i].threadId, g_rings[i].written.load(std::memory_order_acquire), 0};
+            }
+
+            std::uint64_t registers[registerCount]{};
+            const auto &machine{static_cast<const ucontext_t *>(context)->uc_mcontext};
+            for (std::size_t i{0}; i < registerCount; ++i)
+            {
+                registers[i] = static_cast<std::uint64_t>(machine.gregs[i]);
+            }
+
+            const int file{open(g_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+            if (file >= 0)
+            {
+                writeAll(file, &header, sizeof(header));
+                writeAll(file, registers, sizeof(registers));
+                writeAll(file, g_names, header.nameCount * maxEventNameLength);
+                for (std::size_t i{0}; i < header.ringCount; ++i)
+                {
+                    writeAll(file, g_rings[i].events, sizeof(g_rings[i].events));
+                    rings[i].after = g_rings[i].written.load(std::memory_order_acquire);
+                    writeAll(file, &rings[i], sizeof(rings[i]));
+                }
+                close(file);
+            }
+            g_recordWritten.store(true);
+        }
+
+        // Let the signal do what it would have done without the handler: it
+        // is blocked while the handler runs and arrives again on return
+        signal(number, SIG_DFL);
+        raise(number);
+    }
+}
+
+void install_flight_recorder(const std::filesystem::path &path)
+{
+    const auto text{path.string()};
+    if (text.size() >= sizeof(g_path))
+    {
+        throw std::invalid_argument{"flight recorder path too long: " + text};
+    }
+    std::memcpy(g_path, text.c_str(), text.size() + 1);
+    g_ticksPerNanosecond = measureTicksPerNanosecond();
+
+    // Threads without a ring crash on their own stack; the calling thread
+    // gets the spare signal stack
+    useSignalStack(maxRecordedThreads);
+
+    struct sigaction action{};
+    action.sa_sigaction = onCrash;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (const int signal : {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT})
+    {
+        if (sigaction(signal, &action, nullptr) != 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "sigaction"};
+        }
+    }
+}
+
+EventId define_event(std::string_view name)
+{
+    // Take a slot first, so that threads defining events at the same time
+    // get different ones, but never one past the last
+    auto id{g_nameCount.load()};
+    do
+    {
+        if (id >= maxEventNames)
+        {
+            throw std::length_error{"too many flight recorder events"};
+        }
+    } while (!g_nameCount.compare_exchange_weak(id, id + 1));
+    const auto length{std::min(name.size(), maxEventNameLength - 1)};
+    std::memcpy(g_names[id], name.data(), length);
+    g_names[id][length] = '\0';
+    return id;
+}
+
+FlightRing *claim_flight_ring()
+{
+    if (t_ring == nullptr)
+    {
+        const auto index{g_ringCount.fetch_add(1)};
+        if (index >= maxRecordedThreads)
+        {
+            return nullptr;
+        }
+        t_ring = &g_rings[index];
+        t_ring->threadId = static_cast<std::uint64_t>(gettid());
+        useSignalStack(index);
+    }
+    return t_ring;
+}
+
+namespace
+{
+    template <typename T>
+    void readAll(std::ifstream &file, T *data, std::size_t count)
+    {
+        if (!file.read(reinterpret_cast<char *>(data), static_cast<std::streamsize>(count * sizeof(T))))
+        {
+            throw std::runtime_error{"flight record is truncated"};
+        }
+    }
+
+    std::string hex(std::uint64_t value)
+    {
+        std::ostringstream text{};
+        text << "0x" << std::hex << std::setw(16) << std::setfill('0') << value;
+        return text.str();
+    }
+}
+
+void decode_flight_record(const std::filesystem::path &path, std::ostream &out, std::size_t lastEvents)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        throw std::runtime_error{"cannot open " + path.string()};
+    }
+    FileHeader header{};
+    readAll(file, &header, 1);
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.registerCount != registerCount)
+    {
+        throw std::runtime_error{path.string() + " is not a flight record"};
+    }
+
+    std::vector<std::uint64_t> registers(header.registerCount);
+    readAll(file, registers.data(), registers.size());
+    std::vector<char> names(std::size_t{header.nameCount} * maxEventNameLength);
+    readAll(file, names.data(), names.size());
+
+    out << "Signal " << header.signal << " (" << strsignal(header.signal) << ") in thread " << header.threadId;
+    if (header.signal != SIGABRT)
+    {
+        out << " at address " << hex(header.faultAddress);
+    }
+    out << std::endl;
+    for (std::size_t i{0}; i < registers.size(); ++i)
+    {
+        out << (i % 4 == 0 ? "    " : "  ") << std::setw(8) << std::left << registerNames[i] << std::right
+            << hex(registers[i]) << (i % 4 == 3 || i + 1 == registers.size() ? "\n" : "");
+    }
+
+    // rip is only meaningful relative to where the program was loaded, and
+    // not at all when the crash happened in a shared library such as libc
+    const auto rip{registers[16]};
+    if (rip >= header.loadAddress && rip < header.endAddress)
+    {
+        out << "    rip is at offset " << hex(rip - header.loadAddress)
+            << " in the program, addr2line -Cfe <program> <offset> finds the line" << std::endl;
+    }
+    else
+    {
+        out << "    rip is outside the program, in a shared library" << std::endl;
+    }
+
+    std::vector<FlightEvent> events(header.ringCapacity);
+    for (std::uint32_t ring{0}; ring < header.ringCount; ++ring)
+    {
+        RingHeader ringHeader{};
+        readAll(file, events.data(), events.size());
+        readAll(file, &ringHeader, 1);
+
+        // Slots below first were overwritten by events after the crash
+        // while the ring was copied
+        const auto first{ringHeader.after > header.ringCapacity ? ringHeader.after - header.ringCapacity : 0};
+        const auto kept{ringHeader.written > first ? ringHeader.written - first : 0};
+        const auto shown{std::min<std::uint64_t>(kept, lastEvents)};
+        out << "Thread " << ringHeader.threadId << (ringHeader.threadId == header.threadId ? " (crashed)" : "")
+            << ", last " << shown << " of " << ringHeader.written << " events:" << std::endl;
+        for (auto i{ringHeader.written - shown}; i < ringHeader.written; ++i)
+        {
+            const auto &event{events[i % header.ringCapacity]};
+            const auto ticks{static_cast<double>(static_cast<std::int64_t>(event.timestamp - header.timestamp))};
+            out << "    " << std::fixed << std::setprecision(3) << std::setw(12)
+                << ticks / header.ticksPerNanosecond / 1000.0 << " us  ";
+            if (event.id < header.nameCount)
+            {
+                out << &names[event.id * maxEventNameLength];
+            }
+            else
+            {
+                out << "event " << event.id;
+            }
+            out << " (" << event.a << ", " << event.b << ")" << std::endl;
+        }
+    }
+}
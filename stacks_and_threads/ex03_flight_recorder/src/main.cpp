@@ -0,0 +1,208 @@
+/**
+ * Flight Recorder
+ *
+ * The four examples in crashes_and_undefined_behavior die with nothing but
+ * "Segmentation fault" or "Aborted". In production that is often all there
+ * is: a debugger is not attached, and a full trace of everything the
+ * program does would slow it down too much to leave on.
+ *
+ * Like the flight recorder of an aircraft, this keeps only the last moments,
+ * cheaply: each thread writes small binary events (an id, a time stamp and
+ * two numbers) into its own ring buffer, overwriting the oldest. There are
+ * no locks and no allocation, so recording an event costs a few
+ * nanoseconds. When the program crashes, a signal handler writes all rings
+ * and the crashing thread's registers to a file, using only functions that
+ * are safe in a signal handler. The file is decoded later, by this program.
+ *
+ * The example starts a child process that runs a small multi-threaded
+ * "server" and crashes it in one of three ways, then decodes what the
+ * child's flight recorder wrote. The time stamps and registers are x86-64
+ * specific.
+ *
+ * Usage:
+ *
+ *     > make run
+ *     > make run ARGS="abort"      # crash by std::abort
+ *     > make run ARGS="overflow"   # crash by stack overflow
+ *     > make run ARGS="segfault 100000000"   # more events in the benchmark
+ */
+
+#include "flight_recorder.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Like eat_stack in the stack overflow example, but stops at depth, which is
+// never reached when it is huge
+[[gnu::noinline]] std::uint64_t eatStack(std::uint64_t depth, const volatile std::uint8_t *parent)
+{
+    volatile std::uint8_t frame[256];
+    frame[0] = static_cast<std::uint8_t>(depth + parent[0]);
+    if (depth == 0)
+    {
+        return frame[0];
+    }
+    return eatStack(depth - 1, frame) + frame[0];
+}
+
+void crash(const std::string &kind)
+{
+    if (kind == "abort")
+    {
+        std::abort();
+    }
+    if (kind == "overflow")
+    {
+        const volatile std::uint8_t start{0};
+        eatStack(~std::uint64_t{0}, &start);
+    }
+    // Both volatiles are needed: the compiler must neither see that the
+    // pointer is null nor drop the write as one nobody reads
+    volatile int *volatile pointer{nullptr};
+    *pointer = 42;
+}
+
+// Pretend work for a request
+std::uint64_t handle(std::uint64_t size)
+{
+    std::uint64_t hash{size};
+    for (std::uint64_t i{0}; i < size; ++i)
+    {
+        hash = hash * 31 + i;
+    }
+    return hash % 1000;
+}
+
+/**
+ * A pretend server: workers take requests from a shared counter and record
+ * what they do. Request 5000 crashes its worker.
+ */
+[[noreturn]] void runServer(const std::string &crashKind)
+{
+    const auto requestStarted = define_event("request started");
+    const auto bytesParsed = define_event("bytes parsed");
+    const auto requestFinished = define_event("request finished");
+    const auto crashing = define_event("about to crash");
+
+    std::atomic<std::uint64_t> nextRequest{0};
+    auto worker = [&](std::uint64_t workerNumber)
+    {
+        while (true)
+        {
+            const auto request = nextRequest.fetch_add(1);
+            record_event(requestStarted, request, workerNumber);
+            const auto size = (request * 2654435761u) % 4096;
+            record_event(bytesParsed, request, size);
+            if (request == 5000)
+            {
+                record_event(crashing, request, workerNumber);
+                crash(crashKind);
+            }
+            record_event(requestFinished, request, handle(size));
+        }
+    };
+
+    std::vector<std::thread> workers{};
+    for (std::uint64_t i{0}; i < 4; ++i)
+    {
+        workers.emplace_back(worker, i);
+    }
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+    std::exit(0);
+}
+
+// Nanoseconds per recorded event
+double measureRecording(std::size_t events)
+{
+    const auto id = define_event("benchmark");
+    auto start = std::chrono::high_resolution_clock::now();
+    for (std::uint64_t i{0}; i < events; ++i)
+    {
+        record_event(id, i, i * 3);
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / static_cast<double>(events);
+}
+
+// Nanoseconds per rdtsc instruction, which some virtual machines make slow
+double measureTimestamps(std::size_t count)
+{
+    std::uint64_t sum{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    for (std::size_t i{0}; i < count; ++i)
+    {
+        sum += __rdtsc();
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    const volatile std::uint64_t sink{sum};
+    static_cast<void>(sink);
+    return std::chrono::duration<double, std::nano>(stop - start).count() / static_cast<double>(count);
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    const auto crashKind = std::string{argc > 1 ? argv[1] : "segfault"};
+    const auto events = std::size_t{argc > 2 ? std::stoul(argv[2]) : 10000000};
+    if (crashKind != "segfault" && crashKind != "abort" && crashKind != "overflow")
+    {
+        std::cout << "Error: unknown crash " << crashKind << ", use segfault, abort or overflow" << std::endl;
+        return 1;
+    }
+    const auto recordPath = std::filesystem::path{argv[0]}.parent_path() / "crash.flight";
+
+    try
+    {
+        // The child crashes, so it must not share anything with the parent
+        // but the file it leaves behind
+        std::cout.flush();
+        const pid_t child = fork();
+        if (child == 0)
+        {
+            install_flight_recorder(recordPath);
+            runServer(crashKind);
+        }
+        if (child < 0)
+        {
+            std::cout << "Error: fork failed" << std::endl;
+            return 1;
+        }
+        int status{0};
+        waitpid(child, &status, 0);
+        if (!WIFSIGNALED(status))
+        {
+            std::cout << "Error: the child did not crash" << std::endl;
+            return 1;
+        }
+        std::cout << "The server died of signal " << WTERMSIG(status) << " (" << strsignal(WTERMSIG(status))
+                  << "), its flight recorder says:" << std::endl
+                  << std::endl;
+        decode_flight_record(recordPath, std::cout);
+        std::cout << std::endl;
+
+        std::cout << "Recording " << events << " events: " << measureRecording(events) << " ns per event, "
+                  << measureTimestamps(events) << " ns of which are reading the time stamp counter" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}